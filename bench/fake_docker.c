@@ -0,0 +1,603 @@
+#include "fake_docker.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <event2/buffer.h>
+#include <event2/event.h>
+#include <event2/http.h>
+#include <event2/listener.h>
+#include <event2/keyvalq_struct.h>
+#include <jansson.h>
+
+/**
+ * 模擬的服務，每個服務只有一個任務
+ */
+typedef struct fake_service
+{
+    // 服務ID
+    gchar* id;
+    // 服務名稱
+    gchar* name;
+    // 版本
+    guint64 version;
+    // TaskTemplate.ForceUpdate
+    json_int_t force_update;
+    // 當前任務序號
+    guint task;
+    // 當前任務是否在運行
+    gboolean running;
+    // 最近一次更新完成的時間（單調時鐘）
+    gint64 converged_at;
+} fake_service;
+
+struct fake_docker
+{
+    // 行為
+    fake_docker_options options;
+    // Unix socket 路徑
+    gchar* socket_path;
+    // 服務
+    fake_service* services;
+    // 服務數量
+    guint n_services;
+    // 填充內容
+    gchar* padding;
+    // 保護 services 與統計
+    GMutex lock;
+    // 統計
+    fake_docker_stats stats;
+    // 事件循環
+    struct event_base* base;
+    // HTTP 服務
+    struct evhttp* http;
+    // 訂閱 /events 的請求 (evhttp_request*)
+    GPtrArray* subscribers;
+    // 隨機數，只在服務線程中使用
+    GRand* rand;
+    // 服務線程
+    GThread* thread;
+    // 停止通知
+    gint stop_fd;
+    // 停止事件
+    struct event* stop_event;
+};
+
+/**
+ * 延遲的響應
+ */
+typedef struct fake_response
+{
+    // 請求
+    struct evhttp_request* req;
+    // 狀態碼
+    gint code;
+    // 響應內容
+    gchar* body;
+} fake_response;
+
+/**
+ * 延遲的更新完成
+ */
+typedef struct fake_rollout
+{
+    // 模擬 API
+    fake_docker* docker;
+    // 服務
+    fake_service* service;
+    // 觸發完成的任務序號，期間再次更新時作廢
+    guint task;
+} fake_rollout;
+
+/**
+ * 發送響應
+ * @param response 響應
+ */
+static void send_response(fake_response* response)
+{
+    struct evbuffer* buffer = evbuffer_new();
+    evbuffer_add(buffer, response->body, strlen(response->body));
+    evhttp_add_header(evhttp_request_get_output_headers(response->req), "Content-Type", "application/json");
+    evhttp_send_reply(response->req, response->code, response->code < 400 ? "OK" : "Error", buffer);
+    evbuffer_free(buffer);
+    g_free(response->body);
+    g_free(response);
+}
+
+/**
+ * 延遲響應的定時器回調
+ * @param fd 文件描述符
+ * @param event 事件類型
+ * @param arg 響應
+ */
+static void response_callback(const evutil_socket_t fd, const short event, void* arg)
+{
+    (void)fd; // 未使用
+    (void)event; // 未使用
+    send_response(arg);
+}
+
+/**
+ * 按配置的延遲響應
+ * @param docker 模擬 API
+ * @param req 請求
+ * @param code 狀態碼
+ * @param body 響應內容（所有權轉移）
+ */
+static void reply(fake_docker* docker, struct evhttp_request* req, const gint code, json_t* body)
+{
+    fake_response* response = g_malloc0(sizeof(fake_response));
+    response->req = req;
+    response->code = code;
+    gchar* text = json_dumps(body, JSON_COMPACT);
+    response->body = g_strdup(text);
+    free(text);
+    json_decref(body);
+
+    gint64 delay_ms = docker->options.latency_ms;
+    if (docker->options.jitter_ms > 0) delay_ms += g_rand_int_range(docker->rand, 0, docker->options.jitter_ms + 1);
+    if (delay_ms <= 0)
+    {
+        send_response(response);
+        return;
+    }
+    const struct timeval tv = {.tv_sec = delay_ms / 1000, .tv_usec = delay_ms % 1000 * 1000};
+    event_base_once(docker->base, -1, EV_TIMEOUT, response_callback, response, &tv);
+}
+
+/**
+ * 錯誤響應
+ * @param docker 模擬 API
+ * @param req 請求
+ * @param code 狀態碼
+ * @param message 錯誤信息
+ */
+static void reply_error(fake_docker* docker, struct evhttp_request* req, const gint code, const gchar* message)
+{
+    reply(docker, req, code, json_pack("{s:s}", "message", message));
+}
+
+/**
+ * 向 /events 的訂閱者推送事件
+ * @param docker 模擬 API
+ * @param type 類型
+ * @param action 動作
+ * @param id 對象ID
+ */
+static void publish_event(fake_docker* docker, const gchar* type, const gchar* action, const gchar* id)
+{
+    if (docker->subscribers->len == 0) return;
+
+    json_t* event = json_pack("{s:s,s:s,s:{s:s},s:I}", "Type", type, "Action", action, "Actor", "ID", id, "time",
+                              (json_int_t)(g_get_real_time() / G_USEC_PER_SEC));
+    gchar* text = json_dumps(event, JSON_COMPACT);
+    json_decref(event);
+    for (guint i = 0; i < docker->subscribers->len; ++i)
+    {
+        struct evbuffer* buffer = evbuffer_new();
+        evbuffer_add_printf(buffer, "%s\n", text);
+        evhttp_send_reply_chunk(g_ptr_array_index(docker->subscribers, i), buffer);
+        evbuffer_free(buffer);
+    }
+    free(text);
+}
+
+/**
+ * 服務轉為 JSON
+ * @param docker 模擬 API
+ * @param service 服務
+ * @return JSON 對象
+ */
+static json_t* service_to_json(const fake_docker* docker, const fake_service* service)
+{
+    return json_pack("{s:s,s:{s:I},s:{s:s,s:{s:s},s:{s:{s:s},s:I}}}", "ID", service->id, "Version", "Index",
+                     (json_int_t)service->version, "Spec", "Name", service->name, "Labels", "bench.padding",
+                     docker->padding, "TaskTemplate", "ContainerSpec", "Image", "redis:7", "ForceUpdate",
+                     service->force_update);
+}
+
+/**
+ * 任務轉為 JSON
+ * @param docker 模擬 API
+ * @param service 服務
+ * @return JSON 對象
+ */
+static json_t* task_to_json(const fake_docker* docker, const fake_service* service)
+{
+    gchar* id = g_strdup_printf("%s.%u", service->id, service->task);
+    json_t* task = json_pack("{s:s,s:s,s:s,s:{s:s},s:{s:s}}", "ID", id, "ServiceID", service->id, "DesiredState",
+                             "running", "Status", "State", service->running ? "running" : "starting", "Labels",
+                             "bench.padding", docker->padding);
+    g_free(id);
+    return task;
+}
+
+/**
+ * 查找服務，支持ID或名稱
+ * @param docker 模擬 API
+ * @param key ID或名稱
+ * @return 服務，不存在時返回空
+ */
+static fake_service* find_service(const fake_docker* docker, const gchar* key)
+{
+    for (guint i = 0; i < docker->n_services; ++i)
+    {
+        if (g_str_equal(docker->services[i].id, key) || g_str_equal(docker->services[i].name, key))
+            return &docker->services[i];
+    }
+    return nullptr;
+}
+
+/**
+ * 更新完成的定時器回調
+ * @param fd 文件描述符
+ * @param event 事件類型
+ * @param arg 延遲的更新完成
+ */
+static void rollout_callback(const evutil_socket_t fd, const short event, void* arg)
+{
+    (void)fd; // 未使用
+    (void)event; // 未使用
+
+    fake_rollout* rollout = arg;
+    fake_docker* docker = rollout->docker;
+    fake_service* service = rollout->service;
+    g_mutex_lock(&docker->lock);
+    const gboolean current = service->task == rollout->task;
+    if (current)
+    {
+        service->running = TRUE;
+        service->converged_at = g_get_monotonic_time();
+    }
+    g_mutex_unlock(&docker->lock);
+
+    if (current) publish_event(docker, "container", "start", service->id);
+    g_free(rollout);
+}
+
+/**
+ * POST /services/<id>/update?version=<n>
+ * @param docker 模擬 API
+ * @param req 請求
+ * @param service 服務
+ * @param query 查詢參數
+ */
+static void handle_update(fake_docker* docker, struct evhttp_request* req, fake_service* service,
+                          const struct evkeyvalq* query)
+{
+    const gchar* version_text = evhttp_find_header(query, "version");
+    if (version_text == nullptr)
+    {
+        reply_error(docker, req, HTTP_BADREQUEST, "version is required");
+        return;
+    }
+
+    // 讀取新的 Spec
+    struct evbuffer* input = evhttp_request_get_input_buffer(req);
+    const gsize length = evbuffer_get_length(input);
+    json_error_t error;
+    json_t* spec = json_loadb((const gchar*)evbuffer_pullup(input, -1), length, 0, &error);
+    if (spec == nullptr)
+    {
+        reply_error(docker, req, HTTP_BADREQUEST, error.text);
+        return;
+    }
+    const json_t* force_update = json_object_get(json_object_get(spec, "TaskTemplate"), "ForceUpdate");
+
+    g_mutex_lock(&docker->lock);
+    // 模擬其他客戶端搶先更新
+    if (docker->options.conflict_rate > 0 && g_rand_double(docker->rand) < docker->options.conflict_rate)
+    {
+        service->version++;
+        docker->stats.conflicts++;
+    }
+    if (g_ascii_strtoull(version_text, nullptr, 10) != service->version)
+    {
+        g_mutex_unlock(&docker->lock);
+        json_decref(spec);
+        reply_error(docker, req, HTTP_BADREQUEST,
+                    "rpc error: code = Unknown desc = update out of sequence");
+        return;
+    }
+
+    // 滾動更新：舊任務停止，新任務在 converge_ms 後進入 running
+    service->version++;
+    if (json_is_integer(force_update)) service->force_update = json_integer_value(force_update);
+    service->task++;
+    service->running = FALSE;
+    docker->stats.updates++;
+    fake_rollout* rollout = g_malloc0(sizeof(fake_rollout));
+    rollout->docker = docker;
+    rollout->service = service;
+    rollout->task = service->task;
+    g_mutex_unlock(&docker->lock);
+    json_decref(spec);
+
+    publish_event(docker, "service", "update", service->id);
+    const struct timeval tv = {
+        .tv_sec = docker->options.converge_ms / 1000, .tv_usec = docker->options.converge_ms % 1000 * 1000
+    };
+    event_base_once(docker->base, -1, EV_TIMEOUT, rollout_callback, rollout, &tv);
+    reply(docker, req, HTTP_OK, json_pack("{s:[]}", "Warnings"));
+}
+
+/**
+ * /events 連接關閉回調，移除訂閱
+ * @param connection 連接
+ * @param arg 模擬 API
+ */
+static void events_closed(struct evhttp_connection* connection, void* arg)
+{
+    const fake_docker* docker = arg;
+    for (guint i = 0; i < docker->subscribers->len; ++i)
+    {
+        if (evhttp_request_get_connection(g_ptr_array_index(docker->subscribers, i)) != connection) continue;
+        g_ptr_array_remove_index_fast(docker->subscribers, i);
+        return;
+    }
+}
+
+/**
+ * 請求回調，在服務線程中調用
+ * @param req 請求
+ * @param arg 模擬 API
+ */
+static void request_callback(struct evhttp_request* req, void* arg)
+{
+    fake_docker* docker = arg;
+    const enum evhttp_cmd_type command = evhttp_request_get_command(req);
+    const struct evhttp_uri* uri = evhttp_request_get_evhttp_uri(req);
+    const gchar* path = evhttp_uri_get_path(uri);
+    const gchar* query_text = evhttp_uri_get_query(uri);
+    struct evkeyvalq query;
+    evhttp_parse_query_str(query_text != nullptr ? query_text : "", &query);
+
+    g_mutex_lock(&docker->lock);
+    docker->stats.requests++;
+    g_mutex_unlock(&docker->lock);
+
+    // 客戶端可能帶 API 版本前綴，如 /v1.43/services
+    if (path != nullptr && path[0] == '/' && path[1] == 'v' && g_ascii_isdigit(path[2]))
+    {
+        const gchar* rest = strchr(path + 1, '/');
+        if (rest != nullptr) path = rest;
+    }
+
+    if (docker->options.failure_rate > 0 && g_rand_double(docker->rand) < docker->options.failure_rate)
+    {
+        g_mutex_lock(&docker->lock);
+        docker->stats.failures++;
+        g_mutex_unlock(&docker->lock);
+        reply_error(docker, req, HTTP_INTERNAL, "injected failure");
+    }
+    else if (command == EVHTTP_REQ_GET && g_strcmp0(path, "/services") == 0)
+    {
+        json_t* list = json_array();
+        g_mutex_lock(&docker->lock);
+        for (guint i = 0; i < docker->n_services; ++i)
+            json_array_append_new(list, service_to_json(docker, &docker->services[i]));
+        g_mutex_unlock(&docker->lock);
+        reply(docker, req, HTTP_OK, list);
+    }
+    else if (command == EVHTTP_REQ_GET && g_strcmp0(path, "/tasks") == 0)
+    {
+        json_t* list = json_array();
+        g_mutex_lock(&docker->lock);
+        for (guint i = 0; i < docker->n_services; ++i)
+            json_array_append_new(list, task_to_json(docker, &docker->services[i]));
+        g_mutex_unlock(&docker->lock);
+        reply(docker, req, HTTP_OK, list);
+    }
+    else if (command == EVHTTP_REQ_GET && g_strcmp0(path, "/events") == 0)
+    {
+        // 保持連接，以 chunked 編碼逐行推送事件
+        evhttp_add_header(evhttp_request_get_output_headers(req), "Content-Type", "application/json");
+        evhttp_send_reply_start(req, HTTP_OK, "OK");
+        g_ptr_array_add(docker->subscribers, req);
+        evhttp_connection_set_closecb(evhttp_request_get_connection(req), events_closed, docker);
+    }
+    else if (path != nullptr && g_str_has_prefix(path, "/services/"))
+    {
+        gchar* key = g_strdup(path + strlen("/services/"));
+        gchar* suffix = strchr(key, '/');
+        if (suffix != nullptr) *suffix++ = '\0';
+
+        fake_service* service = find_service(docker, key);
+        if (service == nullptr)
+        {
+            reply_error(docker, req, HTTP_NOTFOUND, "service not found");
+        }
+        else if (suffix == nullptr && command == EVHTTP_REQ_GET)
+        {
+            g_mutex_lock(&docker->lock);
+            json_t* body = service_to_json(docker, service);
+            g_mutex_unlock(&docker->lock);
+            reply(docker, req, HTTP_OK, body);
+        }
+        else if (g_strcmp0(suffix, "update") == 0 && command == EVHTTP_REQ_POST)
+        {
+            handle_update(docker, req, service, &query);
+        }
+        else
+        {
+            reply_error(docker, req, HTTP_NOTFOUND, "page not found");
+        }
+        g_free(key);
+    }
+    else
+    {
+        reply_error(docker, req, HTTP_NOTFOUND, "page not found");
+    }
+    evhttp_clear_headers(&query);
+}
+
+/**
+ * 停止通知回調
+ * @param fd 文件描述符
+ * @param event 事件類型
+ * @param arg 模擬 API
+ */
+static void stop_callback(const evutil_socket_t fd, const short event, void* arg)
+{
+    (void)event; // 未使用
+
+    eventfd_t count = 0;
+    eventfd_read(fd, &count);
+    event_base_loopbreak(((fake_docker*)arg)->base);
+}
+
+/**
+ * 服務線程
+ * @param data 模擬 API
+ * @return 未使用
+ */
+static gpointer server_thread(gpointer data)
+{
+    const fake_docker* docker = data;
+    event_base_dispatch(docker->base);
+    return nullptr;
+}
+
+/**
+ * 啟動模擬 Docker Engine API
+ * @param socket_path Unix socket 路徑，已存在時會被刪除
+ * @param n_services 服務數量
+ * @param options 行為
+ * @return 服務，失敗時返回空
+ */
+fake_docker* fake_docker_start(const gchar* socket_path, const guint n_services, const fake_docker_options* options)
+{
+    struct sockaddr_un address = {.sun_family = AF_UNIX};
+    if (strlen(socket_path) >= sizeof(address.sun_path))
+    {
+        g_printerr("Socket path for the fake Docker API is too long: %s\n", socket_path);
+        return nullptr;
+    }
+    g_strlcpy(address.sun_path, socket_path, sizeof(address.sun_path));
+    unlink(socket_path);
+
+    fake_docker* docker = g_malloc0(sizeof(fake_docker));
+    docker->options = *options;
+    docker->socket_path = g_strdup(socket_path);
+    docker->n_services = n_services;
+    docker->services = g_new0(fake_service, n_services);
+    docker->padding = g_strnfill(MAX(options->payload_bytes, 0), 'x');
+    docker->subscribers = g_ptr_array_new();
+    docker->rand = g_rand_new();
+    docker->stop_fd = -1;
+    g_mutex_init(&docker->lock);
+    for (guint i = 0; i < n_services; ++i)
+    {
+        // 與 Docker 一樣使用 25 位的小寫字母數字ID
+        docker->services[i].id = g_strdup_printf("bench%020u", i);
+        docker->services[i].name = g_strdup_printf("redis-%05u", i);
+        docker->services[i].version = 1;
+        docker->services[i].running = TRUE;
+    }
+
+    docker->base = event_base_new();
+    docker->http = evhttp_new(docker->base);
+    evhttp_set_allowed_methods(docker->http, EVHTTP_REQ_GET | EVHTTP_REQ_POST);
+    evhttp_set_gencb(docker->http, request_callback, docker);
+    struct evconnlistener* listener = evconnlistener_new_bind(
+        docker->base, nullptr, nullptr, LEV_OPT_CLOSE_ON_FREE | LEV_OPT_CLOSE_ON_EXEC, 4096,
+        (struct sockaddr*)&address, sizeof(address));
+    if (listener == nullptr || evhttp_bind_listener(docker->http, listener) == nullptr)
+    {
+        g_printerr("Cannot listen on %s for the fake Docker API: %s\n", socket_path, g_strerror(errno));
+        if (listener != nullptr) evconnlistener_free(listener);
+        fake_docker_stop(docker);
+        return nullptr;
+    }
+
+    docker->stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    docker->stop_event = event_new(docker->base, docker->stop_fd, EV_READ | EV_PERSIST, stop_callback, docker);
+    event_add(docker->stop_event, nullptr);
+    docker->thread = g_thread_new("fake-docker", server_thread, docker);
+    return docker;
+}
+
+/**
+ * 獲取服務ID
+ * @param docker 模擬 API
+ * @param index 服務序號
+ * @return 服務ID
+ */
+const gchar* fake_docker_service_id(const fake_docker* docker, const guint index)
+{
+    return docker->services[index % docker->n_services].id;
+}
+
+/**
+ * 獲取服務最近一次更新完成的時間，可在任意線程中調用
+ * @param docker 模擬 API
+ * @param index 服務序號
+ * @return 單調時鐘（微秒），自上次重置後未完成更新時為 0
+ */
+gint64 fake_docker_converged_at(fake_docker* docker, const guint index)
+{
+    g_mutex_lock(&docker->lock);
+    const gint64 converged_at = docker->services[index % docker->n_services].converged_at;
+    g_mutex_unlock(&docker->lock);
+    return converged_at;
+}
+
+/**
+ * 清除所有服務的完成時間，可在任意線程中調用
+ * @param docker 模擬 API
+ */
+void fake_docker_reset(fake_docker* docker)
+{
+    g_mutex_lock(&docker->lock);
+    for (guint i = 0; i < docker->n_services; ++i) docker->services[i].converged_at = 0;
+    g_mutex_unlock(&docker->lock);
+}
+
+/**
+ * 獲取統計，可在任意線程中調用
+ * @param docker 模擬 API
+ * @param stats 輸出的統計
+ */
+void fake_docker_get_stats(fake_docker* docker, fake_docker_stats* stats)
+{
+    g_mutex_lock(&docker->lock);
+    *stats = docker->stats;
+    g_mutex_unlock(&docker->lock);
+}
+
+/**
+ * 停止服務並刪除 Unix socket
+ * @param docker 模擬 API
+ */
+void fake_docker_stop(fake_docker* docker)
+{
+    if (docker->thread != nullptr)
+    {
+        eventfd_write(docker->stop_fd, 1);
+        g_thread_join(docker->thread);
+    }
+    if (docker->stop_event != nullptr) event_free(docker->stop_event);
+    if (docker->stop_fd >= 0) close(docker->stop_fd);
+    // 釋放 HTTP 服務時會關閉 /events 的連接並觸發 events_closed
+    evhttp_free(docker->http);
+    // 未觸發的延遲響應與更新隨事件循環一起丟棄，進程即將退出，不逐一回收
+    event_base_free(docker->base);
+    unlink(docker->socket_path);
+
+    for (guint i = 0; i < docker->n_services; ++i)
+    {
+        g_free(docker->services[i].id);
+        g_free(docker->services[i].name);
+    }
+    g_free(docker->services);
+    g_ptr_array_free(docker->subscribers, TRUE);
+    g_rand_free(docker->rand);
+    g_mutex_clear(&docker->lock);
+    g_free(docker->padding);
+    g_free(docker->socket_path);
+    g_free(docker);
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <glib.h>
+
+/**
+ * 模擬 Docker Engine API 的行為
+ */
+typedef struct fake_docker_options
+{
+    // 每個響應的固定延遲毫秒數
+    gint latency_ms;
+    // 在固定延遲上額外增加的隨機延遲毫秒數上限
+    gint jitter_ms;
+    // 服務與任務對象中填充的字節數，模擬大型 Spec
+    gint payload_bytes;
+    // 請求返回 500 的概率
+    gdouble failure_rate;
+    // 更新時版本衝突（其他客戶端搶先更新）的概率
+    gdouble conflict_rate;
+    // 更新後新任務進入 running 的毫秒數
+    gint converge_ms;
+} fake_docker_options;
+
+/**
+ * 模擬 Docker Engine API 的統計
+ */
+typedef struct fake_docker_stats
+{
+    // 處理的請求數
+    guint64 requests;
+    // 注入的失敗數
+    guint64 failures;
+    // 注入的版本衝突數
+    guint64 conflicts;
+    // 成功的服務更新數
+    guint64 updates;
+} fake_docker_stats;
+
+/**
+ * 模擬 Docker Engine API，在獨立線程中監聽 Unix socket
+ *
+ * 支持 GET /services、GET /services/<id>、POST /services/<id>/update?version=<n>、GET /tasks 與 GET /events
+ */
+typedef struct fake_docker fake_docker;
+
+/**
+ * 啟動模擬 Docker Engine API
+ * @param socket_path Unix socket 路徑，已存在時會被刪除
+ * @param n_services 服務數量
+ * @param options 行為
+ * @return 服務，失敗時返回空
+ */
+fake_docker* fake_docker_start(const gchar* socket_path, guint n_services, const fake_docker_options* options);
+
+/**
+ * 獲取服務ID
+ * @param docker 模擬 API
+ * @param index 服務序號
+ * @return 服務ID
+ */
+const gchar* fake_docker_service_id(const fake_docker* docker, guint index);
+
+/**
+ * 獲取服務最近一次更新完成的時間，可在任意線程中調用
+ * @param docker 模擬 API
+ * @param index 服務序號
+ * @return 單調時鐘（微秒），自上次重置後未完成更新時為 0
+ */
+gint64 fake_docker_converged_at(fake_docker* docker, guint index);
+
+/**
+ * 清除所有服務的完成時間，可在任意線程中調用
+ * @param docker 模擬 API
+ */
+void fake_docker_reset(fake_docker* docker);
+
+/**
+ * 獲取統計，可在任意線程中調用
+ * @param docker 模擬 API
+ * @param stats 輸出的統計
+ */
+void fake_docker_get_stats(fake_docker* docker, fake_docker_stats* stats);
+
+/**
+ * 停止服務並刪除 Unix socket
+ * @param docker 模擬 API
+ */
+void fake_docker_stop(fake_docker* docker);
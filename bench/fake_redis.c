@@ -0,0 +1,384 @@
+#include "fake_redis.h"
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/eventfd.h>
+#include <event2/buffer.h>
+#include <event2/bufferevent.h>
+#include <event2/event.h>
+#include <event2/listener.h>
+#include <hiredis/hiredis.h>
+
+// INFO 的回覆內容
+#define FAKE_INFO "# Server\r\nuptime_in_seconds:86400\r\n# Clients\r\nconnected_clients:1\r\nblocked_clients:0\r\n" \
+    "# Memory\r\nused_memory:1048576\r\n# Stats\r\ninstantaneous_ops_per_sec:100\r\n"
+
+struct fake_redis
+{
+    // 行為
+    fake_redis_options options;
+    // 事件循環
+    struct event_base* base;
+    // 監聽器
+    GPtrArray* listeners;
+    // 監聽的端口
+    GArray* ports;
+    // 服務線程
+    GThread* thread;
+    // 停止通知
+    gint stop_fd;
+    // 停止事件
+    struct event* stop_event;
+    // 隨機數，只在服務線程中使用
+    GRand* rand;
+    // 統計
+    _Atomic guint64 connections;
+    _Atomic guint64 commands;
+    _Atomic guint64 drops;
+    _Atomic guint64 auth_rejects;
+};
+
+/**
+ * 客戶端連接，延遲的回覆持有引用，連接關閉後回覆被丟棄
+ */
+typedef struct fake_connection
+{
+    // 所屬服務
+    fake_redis* server;
+    // 連接
+    struct bufferevent* bev;
+    // RESP 解析器
+    redisReader* reader;
+    // 引用計數
+    gint refs;
+    // 最後一個延遲回覆的發送時間（單調時鐘），保證回覆順序
+    gint64 last_due;
+} fake_connection;
+
+/**
+ * 延遲的回覆
+ */
+typedef struct fake_reply
+{
+    // 連接
+    fake_connection* connection;
+    // 回覆內容
+    gchar* text;
+} fake_reply;
+
+/**
+ * 釋放連接的引用
+ * @param connection 連接
+ */
+static void unref_connection(fake_connection* connection)
+{
+    if (--connection->refs > 0) return;
+    g_free(connection);
+}
+
+/**
+ * 關閉連接
+ * @param connection 連接
+ */
+static void close_connection(fake_connection* connection)
+{
+    if (connection->bev == nullptr) return;
+    bufferevent_free(connection->bev);
+    connection->bev = nullptr;
+    redisReaderFree(connection->reader);
+    connection->reader = nullptr;
+    unref_connection(connection);
+}
+
+/**
+ * 延遲回覆的定時器回調
+ * @param fd 文件描述符
+ * @param event 事件類型
+ * @param arg 延遲的回覆
+ */
+static void reply_callback(const evutil_socket_t fd, const short event, void* arg)
+{
+    (void)fd; // 未使用
+    (void)event; // 未使用
+
+    fake_reply* reply = arg;
+    fake_connection* connection = reply->connection;
+    if (connection->bev != nullptr) bufferevent_write(connection->bev, reply->text, strlen(reply->text));
+    unref_connection(connection);
+    g_free(reply->text);
+    g_free(reply);
+}
+
+/**
+ * 按配置的延遲發送回覆
+ * @param connection 連接
+ * @param text 回覆內容（所有權轉移）
+ */
+static void send_reply(fake_connection* connection, gchar* text)
+{
+    const fake_redis_options* options = &connection->server->options;
+    gint64 delay_ms = options->latency_ms;
+    if (options->jitter_ms > 0) delay_ms += g_rand_int_range(connection->server->rand, 0, options->jitter_ms + 1);
+    if (delay_ms <= 0 && connection->last_due <= g_get_monotonic_time())
+    {
+        bufferevent_write(connection->bev, text, strlen(text));
+        g_free(text);
+        return;
+    }
+
+    // 不早於前一個回覆，保持回覆順序
+    const gint64 now = g_get_monotonic_time();
+    const gint64 due = MAX(now + delay_ms * 1000, connection->last_due);
+    connection->last_due = due;
+
+    fake_reply* reply = g_malloc0(sizeof(fake_reply));
+    reply->connection = connection;
+    reply->text = text;
+    connection->refs++;
+    const struct timeval tv = {.tv_sec = (due - now) / G_USEC_PER_SEC, .tv_usec = (due - now) % G_USEC_PER_SEC};
+    event_base_once(connection->server->base, -1, EV_TIMEOUT, reply_callback, reply, &tv);
+}
+
+/**
+ * 處理一條命令
+ * @param connection 連接
+ * @param command 命令
+ * @return 連接是否仍然打開
+ */
+static gboolean handle_command(fake_connection* connection, const redisReply* command)
+{
+    fake_redis* server = connection->server;
+    atomic_fetch_add_explicit(&server->commands, 1, memory_order_relaxed);
+
+    if (server->options.drop_rate > 0 && g_rand_double(server->rand) < server->options.drop_rate)
+    {
+        atomic_fetch_add_explicit(&server->drops, 1, memory_order_relaxed);
+        close_connection(connection);
+        return FALSE;
+    }
+
+    if (command->type != REDIS_REPLY_ARRAY || command->elements == 0 ||
+        command->element[0]->type != REDIS_REPLY_STRING)
+    {
+        send_reply(connection, g_strdup("-ERR Protocol error\r\n"));
+        return TRUE;
+    }
+
+    const gchar* name = command->element[0]->str;
+    if (g_ascii_strcasecmp(name, "PING") == 0)
+    {
+        send_reply(connection, g_strdup("+PONG\r\n"));
+    }
+    else if (g_ascii_strcasecmp(name, "AUTH") == 0)
+    {
+        if (server->options.auth_reject_rate > 0 && g_rand_double(server->rand) < server->options.auth_reject_rate)
+        {
+            atomic_fetch_add_explicit(&server->auth_rejects, 1, memory_order_relaxed);
+            send_reply(connection, g_strdup("-WRONGPASS invalid username-password pair or user is disabled.\r\n"));
+        }
+        else
+        {
+            send_reply(connection, g_strdup("+OK\r\n"));
+        }
+    }
+    else if (g_ascii_strcasecmp(name, "INFO") == 0)
+    {
+        send_reply(connection, g_strdup_printf("$%zu\r\n%s\r\n", strlen(FAKE_INFO), FAKE_INFO));
+    }
+    else
+    {
+        send_reply(connection, g_strdup_printf("-ERR unknown command '%s'\r\n", name));
+    }
+    return TRUE;
+}
+
+/**
+ * 讀取回調，解析所有完整的命令
+ * @param bev 連接
+ * @param arg 連接狀態
+ */
+static void read_callback(struct bufferevent* bev, void* arg)
+{
+    fake_connection* connection = arg;
+    struct evbuffer* input = bufferevent_get_input(bev);
+    const gsize length = evbuffer_get_length(input);
+    redisReaderFeed(connection->reader, (const gchar*)evbuffer_pullup(input, -1), length);
+    evbuffer_drain(input, length);
+
+    void* command = nullptr;
+    while (connection->reader != nullptr)
+    {
+        if (redisReaderGetReply(connection->reader, &command) != REDIS_OK)
+        {
+            close_connection(connection);
+            return;
+        }
+        if (command == nullptr) return;
+        const gboolean open = handle_command(connection, command);
+        freeReplyObject(command);
+        if (!open) return;
+    }
+}
+
+/**
+ * 連接事件回調，對端關閉或出錯時釋放連接
+ * @param bev 連接
+ * @param events 事件
+ * @param arg 連接狀態
+ */
+static void event_callback(struct bufferevent* bev, const short events, void* arg)
+{
+    (void)bev; // 未使用
+    if (events & (BEV_EVENT_EOF | BEV_EVENT_ERROR)) close_connection(arg);
+}
+
+/**
+ * 接受連接回調
+ * @param listener 監聽器
+ * @param fd 連接
+ * @param address 對端地址
+ * @param length 地址長度
+ * @param arg 服務
+ */
+static void accept_callback(struct evconnlistener* listener, const evutil_socket_t fd, struct sockaddr* address,
+                            const gint length, void* arg)
+{
+    (void)listener; // 未使用
+    (void)address; // 未使用
+    (void)length; // 未使用
+
+    fake_redis* server = arg;
+    atomic_fetch_add_explicit(&server->connections, 1, memory_order_relaxed);
+
+    fake_connection* connection = g_malloc0(sizeof(fake_connection));
+    connection->server = server;
+    connection->refs = 1;
+    connection->reader = redisReaderCreate();
+    connection->bev = bufferevent_socket_new(server->base, fd, BEV_OPT_CLOSE_ON_FREE);
+    bufferevent_setcb(connection->bev, read_callback, nullptr, event_callback, connection);
+    bufferevent_enable(connection->bev, EV_READ | EV_WRITE);
+}
+
+/**
+ * 停止通知回調
+ * @param fd 文件描述符
+ * @param event 事件類型
+ * @param arg 服務
+ */
+static void stop_callback(const evutil_socket_t fd, const short event, void* arg)
+{
+    (void)event; // 未使用
+
+    eventfd_t count = 0;
+    eventfd_read(fd, &count);
+    event_base_loopbreak(((fake_redis*)arg)->base);
+}
+
+/**
+ * 服務線程
+ * @param data 服務
+ * @return 未使用
+ */
+static gpointer server_thread(gpointer data)
+{
+    const fake_redis* server = data;
+    event_base_dispatch(server->base);
+    return nullptr;
+}
+
+/**
+ * 啟動模擬 Redis 服務
+ * @param n_ports 監聽的端口數量，端口由系統分配
+ * @param options 行為
+ * @return 服務，失敗時返回空
+ */
+fake_redis* fake_redis_start(const guint n_ports, const fake_redis_options* options)
+{
+    fake_redis* server = g_malloc0(sizeof(fake_redis));
+    server->options = *options;
+    server->base = event_base_new();
+    server->listeners = g_ptr_array_new_with_free_func((GDestroyNotify)evconnlistener_free);
+    server->ports = g_array_new(FALSE, FALSE, sizeof(guint16));
+    server->rand = g_rand_new();
+
+    for (guint i = 0; i < n_ports; ++i)
+    {
+        struct sockaddr_in address = {.sin_family = AF_INET, .sin_port = 0};
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        struct evconnlistener* listener = evconnlistener_new_bind(
+            server->base, accept_callback, server, LEV_OPT_CLOSE_ON_FREE | LEV_OPT_REUSEABLE, 4096,
+            (struct sockaddr*)&address, sizeof(address));
+        if (listener == nullptr)
+        {
+            g_printerr("Cannot listen for the fake Redis server: %s\n", g_strerror(errno));
+            server->thread = nullptr;
+            fake_redis_stop(server);
+            return nullptr;
+        }
+        g_ptr_array_add(server->listeners, listener);
+
+        // 讀取系統分配的端口
+        socklen_t size = sizeof(address);
+        getsockname(evconnlistener_get_fd(listener), (struct sockaddr*)&address, &size);
+        const guint16 port = ntohs(address.sin_port);
+        g_array_append_val(server->ports, port);
+    }
+
+    server->stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    server->stop_event = event_new(server->base, server->stop_fd, EV_READ | EV_PERSIST, stop_callback, server);
+    event_add(server->stop_event, nullptr);
+    server->thread = g_thread_new("fake-redis", server_thread, server);
+    return server;
+}
+
+/**
+ * 獲取監聽的端口
+ * @param server 服務
+ * @param index 端口序號
+ * @return 端口
+ */
+guint16 fake_redis_port(const fake_redis* server, const guint index)
+{
+    return g_array_index(server->ports, guint16, index % server->ports->len);
+}
+
+/**
+ * 獲取統計，可在任意線程中調用
+ * @param server 服務
+ * @param stats 輸出的統計
+ */
+void fake_redis_get_stats(fake_redis* server, fake_redis_stats* stats)
+{
+    stats->connections = atomic_load_explicit(&server->connections, memory_order_relaxed);
+    stats->commands = atomic_load_explicit(&server->commands, memory_order_relaxed);
+    stats->drops = atomic_load_explicit(&server->drops, memory_order_relaxed);
+    stats->auth_rejects = atomic_load_explicit(&server->auth_rejects, memory_order_relaxed);
+}
+
+/**
+ * 停止服務並釋放資源
+ * @param server 服務
+ */
+void fake_redis_stop(fake_redis* server)
+{
+    if (server->thread != nullptr)
+    {
+        eventfd_write(server->stop_fd, 1);
+        g_thread_join(server->thread);
+    }
+    if (server->stop_event != nullptr)
+    {
+        event_free(server->stop_event);
+        close(server->stop_fd);
+    }
+    // 仍然打開的連接隨事件循環一起釋放，進程即將退出，不逐一回收
+    g_ptr_array_free(server->listeners, TRUE);
+    g_array_free(server->ports, TRUE);
+    event_base_free(server->base);
+    g_rand_free(server->rand);
+    g_free(server);
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <glib.h>
+
+/**
+ * 模擬 Redis 服務的行為
+ */
+typedef struct fake_redis_options
+{
+    // 每個回覆的固定延遲毫秒數
+    gint latency_ms;
+    // 在固定延遲上額外增加的隨機延遲毫秒數上限
+    gint jitter_ms;
+    // 收到命令後直接斷開連接的概率
+    gdouble drop_rate;
+    // AUTH 被拒絕的概率
+    gdouble auth_reject_rate;
+} fake_redis_options;
+
+/**
+ * 模擬 Redis 服務的統計
+ */
+typedef struct fake_redis_stats
+{
+    // 接受的連接數
+    guint64 connections;
+    // 處理的命令數
+    guint64 commands;
+    // 主動斷開的連接數
+    guint64 drops;
+    // 拒絕的 AUTH 數
+    guint64 auth_rejects;
+} fake_redis_stats;
+
+/**
+ * 模擬 Redis 服務，在獨立線程中監聽本地端口，只支持 PING、AUTH 與 INFO
+ */
+typedef struct fake_redis fake_redis;
+
+/**
+ * 啟動模擬 Redis 服務
+ * @param n_ports 監聽的端口數量，端口由系統分配
+ * @param options 行為
+ * @return 服務，失敗時返回空
+ */
+fake_redis* fake_redis_start(guint n_ports, const fake_redis_options* options);
+
+/**
+ * 獲取監聽的端口
+ * @param server 服務
+ * @param index 端口序號
+ * @return 端口
+ */
+guint16 fake_redis_port(const fake_redis* server, guint index);
+
+/**
+ * 獲取統計，可在任意線程中調用
+ * @param server 服務
+ * @param stats 輸出的統計
+ */
+void fake_redis_get_stats(fake_redis* server, fake_redis_stats* stats);
+
+/**
+ * 停止服務並釋放資源
+ * @param server 服務
+ */
+void fake_redis_stop(fake_redis* server);
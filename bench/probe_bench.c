@@ -0,0 +1,591 @@
+#define _GNU_SOURCE // RUSAGE_THREAD, RTLD_NEXT
+
+#include <dlfcn.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <event2/event.h>
+
+#include "aggregator.h"
+#include "fake_redis.h"
+#include "history.h"
+#include "probe.h"
+#include "redis.h"
+#include "resp_uring.h"
+#include "rollup.h"
+#include "target.h"
+
+/**
+ * 覆蓋 malloc、calloc 與 realloc，統計每個線程的內存分配次數；
+ * 模擬服務在獨立線程中運行，探測循環線程的計數只包含探測引擎本身
+ */
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t n, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+
+// 當前線程的內存分配次數
+static _Thread_local guint64 thread_allocations = 0;
+
+void* malloc(const size_t size)
+{
+    thread_allocations++;
+    return __libc_malloc(size);
+}
+
+void* calloc(const size_t n, const size_t size)
+{
+    thread_allocations++;
+    return __libc_calloc(n, size);
+}
+
+void* realloc(void* ptr, const size_t size)
+{
+    thread_allocations++;
+    return __libc_realloc(ptr, size);
+}
+
+/**
+ * 覆蓋探測路徑上的 I/O 系統調用包裝函數，統計每個線程的調用次數；
+ * io_uring_enter 不經過這些函數，由 io_uring 統計中的提交次數補上
+ */
+
+// 當前線程的 I/O 系統調用次數
+static _Thread_local guint64 thread_syscalls = 0;
+
+ssize_t read(const int fd, void* buf, const size_t count)
+{
+    static ssize_t (*next)(int, void*, size_t) = nullptr;
+    if (next == nullptr) next = dlsym(RTLD_NEXT, "read");
+    thread_syscalls++;
+    return next(fd, buf, count);
+}
+
+ssize_t write(const int fd, const void* buf, const size_t count)
+{
+    static ssize_t (*next)(int, const void*, size_t) = nullptr;
+    if (next == nullptr) next = dlsym(RTLD_NEXT, "write");
+    thread_syscalls++;
+    return next(fd, buf, count);
+}
+
+ssize_t recv(const int fd, void* buf, const size_t len, const int flags)
+{
+    static ssize_t (*next)(int, void*, size_t, int) = nullptr;
+    if (next == nullptr) next = dlsym(RTLD_NEXT, "recv");
+    thread_syscalls++;
+    return next(fd, buf, len, flags);
+}
+
+ssize_t send(const int fd, const void* buf, const size_t len, const int flags)
+{
+    static ssize_t (*next)(int, const void*, size_t, int) = nullptr;
+    if (next == nullptr) next = dlsym(RTLD_NEXT, "send");
+    thread_syscalls++;
+    return next(fd, buf, len, flags);
+}
+
+int connect(const int fd, const struct sockaddr* addr, const socklen_t len)
+{
+    static int (*next)(int, const struct sockaddr*, socklen_t) = nullptr;
+    if (next == nullptr) next = dlsym(RTLD_NEXT, "connect");
+    thread_syscalls++;
+    return next(fd, addr, len);
+}
+
+int epoll_wait(const int epfd, struct epoll_event* events, const int maxevents, const int timeout)
+{
+    static int (*next)(int, struct epoll_event*, int, int) = nullptr;
+    if (next == nullptr) next = dlsym(RTLD_NEXT, "epoll_wait");
+    thread_syscalls++;
+    return next(epfd, events, maxevents, timeout);
+}
+
+// 模擬的目標數
+static gint n_targets = 1000;
+// 探測間隔秒數
+static gint interval = 1;
+// 預熱秒數，不計入統計
+static gint warmup = -1;
+// 統計秒數
+static gint duration = 30;
+// 模擬服務監聽的端口數
+static gint n_ports = 4;
+// 是否發送 AUTH
+static gboolean auth = FALSE;
+// 同時建立連接的上限
+static gint max_connecting = 256;
+// 是否經匯總線程寫入探測歷史與指標匯總
+static gboolean aggregate = FALSE;
+// 探測連接的實現，compare 表示依次運行 libevent 與 io_uring 並對比
+static gchar* backend = nullptr;
+// 模擬服務的行為
+static fake_redis_options server_options = {0};
+
+// 命令行選項
+static GOptionEntry entries[] = {
+    {"targets", 'n', 0, G_OPTION_ARG_INT, &n_targets, "Number of simulated targets (1-10000)", "N"},
+    {"interval", 'i', 0, G_OPTION_ARG_INT, &interval, "Probe interval in seconds", "S"},
+    {"warmup", 'w', 0, G_OPTION_ARG_INT, &warmup, "Seconds before measuring (default: 2 intervals)", "S"},
+    {"duration", 'd', 0, G_OPTION_ARG_INT, &duration, "Seconds to measure", "S"},
+    {"ports", 'p', 0, G_OPTION_ARG_INT, &n_ports, "Number of fake server ports", "N"},
+    {"auth", 'a', 0, G_OPTION_ARG_NONE, &auth, "Send AUTH on every new connection", nullptr},
+    {"max-connecting", 'c', 0, G_OPTION_ARG_INT, &max_connecting, "Concurrent connect limit", "N"},
+    {"aggregate", 0, 0, G_OPTION_ARG_NONE, &aggregate, "Write results to history and rollups via the aggregator",
+     nullptr},
+    {"backend", 'b', 0, G_OPTION_ARG_STRING, &backend, "libevent (default), io_uring, or compare to run both",
+     "NAME"},
+    {"latency", 'l', 0, G_OPTION_ARG_INT, &server_options.latency_ms, "Fake server reply latency", "MS"},
+    {"jitter", 'j', 0, G_OPTION_ARG_INT, &server_options.jitter_ms, "Extra random reply latency", "MS"},
+    {"drop-rate", 0, 0, G_OPTION_ARG_DOUBLE, &server_options.drop_rate, "Probability of dropping a connection", "P"},
+    {"auth-reject-rate", 0, 0, G_OPTION_ARG_DOUBLE, &server_options.auth_reject_rate, "Probability of rejecting AUTH",
+     "P"},
+    {nullptr}
+};
+
+/**
+ * 統計
+ */
+typedef struct bench_stats
+{
+    // 是否在統計中
+    gboolean measuring;
+    // 各結果的探測數
+    guint64 outcomes[PROBE_OUTCOME_COUNT];
+    // 調度抖動（微秒），實際探測間隔與配置的差
+    GArray* jitter;
+    // 探測耗時（微秒）
+    GArray* latency;
+    // 每個目標上一次探測的開始時間 (target* -> gint64*)
+    GHashTable* last_start;
+    // 統計開始時的單調時鐘與 CPU 時間
+    gint64 started_at;
+    struct rusage thread_usage;
+    struct rusage process_usage;
+    // 統計開始時探測循環線程的內存分配次數
+    guint64 allocations;
+    // 統計開始時的常駐內存（千字節）
+    gint64 rss_kb;
+    // 統計開始時探測分配器的擴容次數
+    guint64 arena_grows;
+    // 統計開始時探測循環線程的 I/O 系統調用次數
+    guint64 syscalls;
+    // 統計開始時的 io_uring 統計
+    resp_uring_stats uring;
+} bench_stats;
+
+/**
+ * 一次運行的結果，用於對比不同的探測連接實現
+ */
+typedef struct bench_result
+{
+    // 實際使用的實現
+    probe_backend backend;
+    // 每秒探測數
+    gdouble probes_per_sec;
+    // 失敗的探測數
+    guint64 failed;
+    // 探測耗時（微秒）
+    gint64 latency_p50;
+    gint64 latency_p99;
+    // 調度抖動（微秒）
+    gint64 jitter_p99;
+    // 每次探測的探測循環 CPU 時間（微秒）
+    gdouble cpu_us;
+    // 每次探測的內存分配次數
+    gdouble allocations;
+    // 每次探測的 I/O 系統調用次數（包括 io_uring_enter）
+    gdouble syscalls;
+} bench_result;
+
+/**
+ * 探測結果回調，記錄結果、耗時與調度抖動
+ * @param t 目標
+ * @param result 探測結果
+ * @param user_data 統計
+ */
+static void on_result(target* t, const probe_result* result, gpointer user_data)
+{
+    bench_stats* stats = user_data;
+
+    gint64* last = g_hash_table_lookup(stats->last_start, t);
+    if (last == nullptr)
+    {
+        last = g_new0(gint64, 1);
+        g_hash_table_insert(stats->last_start, t, last);
+    }
+    const gint64 previous = *last;
+    *last = result->timestamp;
+    // 預熱期間也提交，槽位與匯總在統計開始前建立
+    if (aggregate) aggregate_result(t, result);
+    if (!stats->measuring) return;
+
+    stats->outcomes[result->outcome]++;
+    if (result->outcome == PROBE_OK) g_array_append_val(stats->latency, result->total_us);
+    if (previous > 0)
+    {
+        const gint64 jitter = ABS(result->timestamp - previous - (gint64)interval * G_USEC_PER_SEC);
+        g_array_append_val(stats->jitter, jitter);
+    }
+}
+
+/**
+ * 比較兩個 gint64
+ */
+static gint compare_int64(gconstpointer a, gconstpointer b)
+{
+    const gint64 x = *(const gint64*)a;
+    const gint64 y = *(const gint64*)b;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * 排序後的分位數
+ * @param values 數值 (gint64)，會被排序
+ * @param q 分位
+ * @return 數值，為空時返回 0
+ */
+static gint64 percentile(GArray* values, const gdouble q)
+{
+    if (values->len == 0) return 0;
+    g_array_sort(values, compare_int64);
+    return g_array_index(values, gint64, (guint)(q * (values->len - 1)));
+}
+
+/**
+ * 讀取 /proc/self/status 中的內存指標
+ * @param key 指標名稱，如 VmRSS
+ * @return 千字節
+ */
+static gint64 read_memory_kb(const gchar* key)
+{
+    gchar* status = nullptr;
+    if (!g_file_get_contents("/proc/self/status", &status, nullptr, nullptr)) return -1;
+
+    gint64 value = -1;
+    const gchar* line = strstr(status, key);
+    if (line != nullptr) value = g_ascii_strtoll(line + strlen(key) + 1, nullptr, 10);
+    g_free(status);
+    return value;
+}
+
+/**
+ * CPU 時間（微秒）
+ * @param usage 資源使用
+ * @return 用戶態與內核態時間之和
+ */
+static gint64 cpu_us(const struct rusage* usage)
+{
+    return (gint64)(usage->ru_utime.tv_sec + usage->ru_stime.tv_sec) * G_USEC_PER_SEC +
+        usage->ru_utime.tv_usec + usage->ru_stime.tv_usec;
+}
+
+/**
+ * 預熱結束，開始統計
+ * @param fd 文件描述符
+ * @param event 事件類型
+ * @param arg 統計
+ */
+static void begin_callback(const evutil_socket_t fd, const short event, void* arg)
+{
+    (void)fd; // 未使用
+    (void)event; // 未使用
+
+    bench_stats* stats = arg;
+    arena_stats arenas;
+    probe_arena_stats(&arenas);
+    stats->measuring = TRUE;
+    stats->started_at = g_get_monotonic_time();
+    stats->rss_kb = read_memory_kb("VmRSS");
+    stats->arena_grows = arenas.grows;
+    resp_uring_get_stats(&stats->uring);
+    getrusage(RUSAGE_THREAD, &stats->thread_usage);
+    getrusage(RUSAGE_SELF, &stats->process_usage);
+    stats->allocations = thread_allocations;
+    stats->syscalls = thread_syscalls;
+}
+
+/**
+ * 提高文件描述符上限，每個目標需要客戶端與服務端各一個
+ */
+static void raise_file_limit()
+{
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) != 0) return;
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+
+    const rlim_t needed = (rlim_t)n_targets * 2 + 64;
+    if (limit.rlim_cur < needed)
+        g_printerr("Warning: file descriptor limit %lu is below the %lu needed for %d targets\n",
+                   (gulong)limit.rlim_cur, (gulong)needed, n_targets);
+}
+
+/**
+ * 生成目標配置，所有目標指向模擬服務的端口
+ * @param server 模擬服務
+ * @param history_path 探測歷史文件，為空字符串時不記錄
+ * @param backend_name 探測連接的實現
+ * @return 配置文件
+ */
+static GKeyFile* build_keyfile(const fake_redis* server, const gchar* history_path, const gchar* backend_name)
+{
+    GKeyFile* keyfile = g_key_file_new();
+    g_key_file_set_integer(keyfile, "General", "interval", interval);
+    g_key_file_set_integer(keyfile, "General", "connect_timeout", 5);
+    g_key_file_set_string(keyfile, "General", "redis_host", "127.0.0.1");
+    g_key_file_set_integer(keyfile, "General", "redis_port", fake_redis_port(server, 0));
+    g_key_file_set_string(keyfile, "General", "redis_username", "bench");
+    g_key_file_set_string(keyfile, "General", "redis_password", "bench");
+    g_key_file_set_boolean(keyfile, "General", "redis_auth", auth);
+    g_key_file_set_integer(keyfile, "Probe", "startup_window", interval);
+    g_key_file_set_integer(keyfile, "Probe", "max_connecting", max_connecting);
+    g_key_file_set_string(keyfile, "Probe", "backend", backend_name);
+    g_key_file_set_string(keyfile, "History", "path", history_path);
+    g_key_file_set_integer(keyfile, "History", "max_targets", n_targets);
+
+    for (gint i = 0; i < n_targets; ++i)
+    {
+        gchar group[64];
+        g_snprintf(group, sizeof(group), "Target:bench-%05d", i);
+        g_key_file_set_string(keyfile, group, "host", "127.0.0.1");
+        g_key_file_set_integer(keyfile, group, "port", fake_redis_port(server, i));
+    }
+    return keyfile;
+}
+
+
+/**
+ * 以指定的探測連接實現運行一次基準測試並輸出報告
+ * @param server 模擬服務
+ * @param backend_name 探測連接的實現
+ * @param out 輸出的結果
+ * @return 是否成功
+ */
+static gboolean run_bench(fake_redis* server, const gchar* backend_name, bench_result* out)
+{
+    // 以與主程序相同的方式讀取配置，探測歷史寫入臨時文件
+    gchar* history_path = g_build_filename(g_get_tmp_dir(), "probe_bench.history", nullptr);
+    GKeyFile* keyfile = build_keyfile(server, aggregate ? history_path : "", backend_name);
+    if (!init_redis_config(keyfile, nullptr) || !init_probe_config(keyfile, nullptr) ||
+        !init_history_config(keyfile, nullptr) || !init_rollup_config(keyfile, nullptr) ||
+        !init_aggregator_config(keyfile, nullptr) || !init_target_config(keyfile, nullptr))
+        return FALSE;
+    g_key_file_free(keyfile);
+    if (aggregate)
+    {
+        if (!open_history()) return FALSE;
+        start_rollups();
+        if (!start_aggregator()) return FALSE;
+    }
+
+    // 預留足夠的容量，統計期間不擴容，避免計入分配次數
+    const guint expected = (guint)((gint64)n_targets * (duration + interval) / interval * 2);
+    bench_stats stats = {
+        .jitter = g_array_sized_new(FALSE, FALSE, sizeof(gint64), expected),
+        .latency = g_array_sized_new(FALSE, FALSE, sizeof(gint64), expected),
+        .last_start = g_hash_table_new_full(g_direct_hash, g_direct_equal, nullptr, g_free),
+    };
+    fake_redis_stats server_before;
+    fake_redis_get_stats(server, &server_before);
+
+    struct event_base* base = event_base_new();
+    struct event* begin = evtimer_new(base, begin_callback, &stats);
+    const struct timeval warmup_tv = {.tv_sec = warmup, .tv_usec = 0};
+    evtimer_add(begin, &warmup_tv);
+    const struct timeval total_tv = {.tv_sec = warmup + duration, .tv_usec = 0};
+    event_base_loopexit(base, &total_tv);
+
+    if (!start_probes(base, on_result, &stats)) return FALSE;
+    g_print("Probing %d target(s) every %ds on %d port(s) with %s: %ds warmup, %ds measured\n", n_targets, interval,
+            n_ports, probe_backend_name(probe_active_backend()), warmup, duration);
+    event_base_dispatch(base);
+
+    // 統計結束
+    const guint64 allocations = thread_allocations - stats.allocations;
+    const guint64 syscalls = thread_syscalls - stats.syscalls;
+    struct rusage thread_usage;
+    struct rusage process_usage;
+    getrusage(RUSAGE_THREAD, &thread_usage);
+    getrusage(RUSAGE_SELF, &process_usage);
+    arena_stats arenas;
+    probe_arena_stats(&arenas);
+    resp_uring_stats uring;
+    resp_uring_get_stats(&uring);
+    const gdouble elapsed = (gdouble)(g_get_monotonic_time() - stats.started_at) / G_USEC_PER_SEC;
+    const gint64 rss_kb = read_memory_kb("VmRSS");
+    const gint64 peak_kb = read_memory_kb("VmHWM");
+    stats.measuring = FALSE;
+
+    guint64 probes = 0;
+    for (gint i = 0; i < PROBE_OUTCOME_COUNT; ++i) probes += stats.outcomes[i];
+    const gdouble per_probe = probes > 0 ? 1.0 / (gdouble)probes : 0;
+    const guint64 submits = uring.submits - stats.uring.submits;
+
+    *out = (bench_result){
+        .backend = probe_active_backend(),
+        .probes_per_sec = (gdouble)probes / elapsed,
+        .failed = probes - stats.outcomes[PROBE_OK],
+        .latency_p50 = percentile(stats.latency, 0.5),
+        .latency_p99 = percentile(stats.latency, 0.99),
+        .jitter_p99 = percentile(stats.jitter, 0.99),
+        .cpu_us = (gdouble)(cpu_us(&thread_usage) - cpu_us(&stats.thread_usage)) * per_probe,
+        .allocations = (gdouble)allocations * per_probe,
+        .syscalls = (gdouble)(syscalls + submits) * per_probe,
+    };
+
+    g_print("probes:            %lu (%.1f/s, expected %.1f/s)\n", (gulong)probes, out->probes_per_sec,
+            (gdouble)n_targets / interval);
+    for (gint i = 0; i < PROBE_OUTCOME_COUNT; ++i)
+    {
+        if (stats.outcomes[i] > 0) g_print("  %-16s %lu\n", probe_outcome_name(i), (gulong)stats.outcomes[i]);
+    }
+    g_print("latency us:        p50 %ld  p99 %ld  max %ld\n", (glong)out->latency_p50, (glong)out->latency_p99,
+            (glong)percentile(stats.latency, 1));
+    g_print("sched jitter us:   p50 %ld  p99 %ld  max %ld\n", (glong)percentile(stats.jitter, 0.5),
+            (glong)out->jitter_p99, (glong)percentile(stats.jitter, 1));
+    g_print("cpu us/probe:      %.2f probe loop, %.2f process (includes fake server)\n", out->cpu_us,
+            (gdouble)(cpu_us(&process_usage) - cpu_us(&stats.process_usage)) * per_probe);
+    g_print("allocs/probe:      %.3f probe loop (%lu total)\n", out->allocations, (gulong)allocations);
+    g_print("syscalls/probe:    %.2f probe loop I/O (%lu libc calls, %lu io_uring_enter)\n", out->syscalls,
+            (gulong)syscalls, (gulong)submits);
+    g_print("rss kB:            %ld (peak %ld, %+ld while measuring, includes fake server)\n", (glong)rss_kb,
+            (glong)peak_kb, (glong)(rss_kb - stats.rss_kb));
+    g_print("probe arenas:      %lu kB reserved, %lu B max per probe, %lu grows while measuring\n",
+            (gulong)(arenas.reserved / 1024), (gulong)arenas.high_water, (gulong)(arenas.grows - stats.arena_grows));
+    if (out->backend == PROBE_BACKEND_URING)
+    {
+        const guint64 sqes = uring.sqes - stats.uring.sqes;
+        const guint64 completions = uring.completions - stats.uring.completions;
+        const guint64 batches = uring.batches - stats.uring.batches;
+        g_print("io_uring:          %.1f sqes/submit, %.1f completions/batch, %lu fixed-buffer reads\n",
+                submits > 0 ? (gdouble)sqes / (gdouble)submits : 0,
+                batches > 0 ? (gdouble)completions / (gdouble)batches : 0,
+                (gulong)(uring.fixed_reads - stats.uring.fixed_reads));
+    }
+
+    if (aggregate)
+    {
+        aggregator_stats aggregator;
+        aggregator_get_stats(&aggregator);
+        g_print("aggregator:        %lu records, %lu batches, %lu dropped, ring high watermark %lu\n",
+                (gulong)aggregator.pushed, (gulong)aggregator.batches,
+                (gulong)(aggregator.dropped_ok + aggregator.dropped_failed), (gulong)aggregator.high_watermark);
+    }
+
+    fake_redis_stats server_stats;
+    fake_redis_get_stats(server, &server_stats);
+    g_print("fake server:       %lu connections, %lu commands, %lu drops, %lu auth rejects\n",
+            (gulong)(server_stats.connections - server_before.connections),
+            (gulong)(server_stats.commands - server_before.commands),
+            (gulong)(server_stats.drops - server_before.drops),
+            (gulong)(server_stats.auth_rejects - server_before.auth_rejects));
+
+    // 釋放資源
+    stop_probes();
+    stop_aggregator();
+    stop_rollups();
+    close_history();
+    if (aggregate) g_unlink(history_path);
+    g_free(history_path);
+    event_free(begin);
+    event_base_free(base);
+    destroy_target_config();
+    destroy_aggregator_config();
+    destroy_rollup_config();
+    destroy_history_config();
+    destroy_probe_config();
+    destroy_redis_config();
+    g_array_free(stats.jitter, TRUE);
+    g_array_free(stats.latency, TRUE);
+    g_hash_table_destroy(stats.last_start);
+    return TRUE;
+}
+
+/**
+ * 並排輸出兩次運行的結果
+ * @param results 結果
+ * @param n 結果數
+ */
+static void print_comparison(const bench_result* results, const guint n)
+{
+    g_print("\n%-20s", "");
+    for (guint i = 0; i < n; ++i) g_print("%14s", probe_backend_name(results[i].backend));
+    g_print("\n%-20s", "probes/s");
+    for (guint i = 0; i < n; ++i) g_print("%14.1f", results[i].probes_per_sec);
+    g_print("\n%-20s", "failed");
+    for (guint i = 0; i < n; ++i) g_print("%14lu", (gulong)results[i].failed);
+    g_print("\n%-20s", "latency p50 us");
+    for (guint i = 0; i < n; ++i) g_print("%14ld", (glong)results[i].latency_p50);
+    g_print("\n%-20s", "latency p99 us");
+    for (guint i = 0; i < n; ++i) g_print("%14ld", (glong)results[i].latency_p99);
+    g_print("\n%-20s", "jitter p99 us");
+    for (guint i = 0; i < n; ++i) g_print("%14ld", (glong)results[i].jitter_p99);
+    g_print("\n%-20s", "cpu us/probe");
+    for (guint i = 0; i < n; ++i) g_print("%14.2f", results[i].cpu_us);
+    g_print("\n%-20s", "allocs/probe");
+    for (guint i = 0; i < n; ++i) g_print("%14.3f", results[i].allocations);
+    g_print("\n%-20s", "syscalls/probe");
+    for (guint i = 0; i < n; ++i) g_print("%14.2f", results[i].syscalls);
+    g_print("\n");
+}
+
+int main(int argc, char* argv[])
+{
+    GError* error = nullptr;
+    GOptionContext* context = g_option_context_new("- probe engine throughput benchmark");
+    g_option_context_add_main_entries(context, entries, nullptr);
+    g_option_context_set_summary(context,
+                                 "Drives the probe engine against simulated Redis targets served by an in-process\n"
+                                 "fake RESP server, and reports probes/sec, scheduler jitter, CPU, allocations and\n"
+                                 "I/O syscalls per probe, RSS and probe arena usage. --backend compare runs the\n"
+                                 "libevent and io_uring backends one after the other and prints them side by side.");
+    if (!g_option_context_parse(context, &argc, &argv, &error))
+    {
+        g_printerr("Option parsing failed: %s\n", error->message);
+        g_error_free(error);
+        return 1;
+    }
+    g_option_context_free(context);
+    if (n_targets < 1 || n_targets > 10000 || interval < 1 || duration < 1 || n_ports < 1)
+    {
+        g_printerr("targets must be 1-10000; interval, duration and ports must be positive\n");
+        return 1;
+    }
+    const gboolean compare = g_strcmp0(backend, "compare") == 0;
+    if (backend != nullptr && !compare && g_strcmp0(backend, probe_backend_name(PROBE_BACKEND_LIBEVENT)) != 0 &&
+        g_strcmp0(backend, probe_backend_name(PROBE_BACKEND_URING)) != 0)
+    {
+        g_printerr("backend must be libevent, io_uring or compare\n");
+        return 1;
+    }
+    if (warmup < 0) warmup = interval * 2;
+
+    raise_file_limit();
+    fake_redis* server = fake_redis_start((guint)n_ports, &server_options);
+    if (server == nullptr) return 1;
+
+    bench_result results[2];
+    guint n = 0;
+    if (compare)
+    {
+        if (!run_bench(server, probe_backend_name(PROBE_BACKEND_LIBEVENT), &results[n++])) return 1;
+        g_print("\n");
+        if (!run_bench(server, probe_backend_name(PROBE_BACKEND_URING), &results[n++])) return 1;
+        print_comparison(results, n);
+    }
+    else if (!run_bench(server, backend != nullptr ? backend : probe_backend_name(PROBE_BACKEND_LIBEVENT),
+                        &results[n++]))
+    {
+        return 1;
+    }
+
+    fake_redis_stop(server);
+    g_free(backend);
+    return 0;
+}
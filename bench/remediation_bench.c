@@ -0,0 +1,202 @@
+#include <glib.h>
+#include <unistd.h>
+#include <curl/curl.h>
+
+#include "fake_docker.h"
+#include "watcher.h"
+
+// 模擬的服務數
+static gint n_services_option = 50;
+// 逗號分隔的併發數列表
+static gchar* concurrency_option = nullptr;
+// 等待所有服務完成更新的秒數上限
+static gint timeout = 60;
+// Unix socket 路徑，默認放在臨時目錄
+static gchar* socket_option = nullptr;
+// 是否輸出每個服務的重啓日誌
+static gboolean verbose = FALSE;
+// 模擬 API 的行為
+static fake_docker_options docker_options = {.converge_ms = 200};
+
+// 命令行選項
+static GOptionEntry entries[] = {
+    {"services", 'n', 0, G_OPTION_ARG_INT, &n_services_option, "Number of services to restart per round", "N"},
+    {"concurrency", 'c', 0, G_OPTION_ARG_STRING, &concurrency_option, "Restart concurrency per round (default: 1,2,4,8,16)",
+     "LIST"},
+    {"timeout", 't', 0, G_OPTION_ARG_INT, &timeout, "Seconds to wait for a round to converge", "S"},
+    {"socket", 's', 0, G_OPTION_ARG_FILENAME, &socket_option, "Unix socket path for the fake Docker API", "PATH"},
+    {"verbose", 'v', 0, G_OPTION_ARG_NONE, &verbose, "Show per-service restart logs", nullptr},
+    {"latency", 'l', 0, G_OPTION_ARG_INT, &docker_options.latency_ms, "Fake API response latency", "MS"},
+    {"jitter", 'j', 0, G_OPTION_ARG_INT, &docker_options.jitter_ms, "Extra random response latency", "MS"},
+    {"payload", 'p', 0, G_OPTION_ARG_INT, &docker_options.payload_bytes, "Padding bytes in each service spec", "BYTES"},
+    {"converge", 0, 0, G_OPTION_ARG_INT, &docker_options.converge_ms, "Time from update to running task", "MS"},
+    {"failure-rate", 0, 0, G_OPTION_ARG_DOUBLE, &docker_options.failure_rate, "Probability of a 500 response", "P"},
+    {"conflict-rate", 0, 0, G_OPTION_ARG_DOUBLE, &docker_options.conflict_rate,
+     "Probability of an out-of-sequence update", "P"},
+    {nullptr}
+};
+
+/**
+ * 丟棄輸出，用於屏蔽重啓日誌
+ * @param string 輸出內容
+ */
+static void discard_print(const gchar* string)
+{
+    (void)string; // 未使用
+}
+
+/**
+ * 重啓線程池的工作函數
+ * @param data 服務ID
+ * @param user_data 未使用
+ */
+static void restart_worker(gpointer data, gpointer user_data)
+{
+    (void)user_data; // 未使用
+    restart_docker_container(data);
+}
+
+/**
+ * 比較兩個 gint64
+ */
+static gint compare_int64(gconstpointer a, gconstpointer b)
+{
+    const gint64 x = *(const gint64*)a;
+    const gint64 y = *(const gint64*)b;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * 排序後的分位數
+ * @param values 數值 (gint64)，會被排序
+ * @param q 分位
+ * @return 數值，為空時返回 0
+ */
+static gint64 percentile(GArray* values, const gdouble q)
+{
+    if (values->len == 0) return 0;
+    g_array_sort(values, compare_int64);
+    return g_array_index(values, gint64, (guint)(q * (values->len - 1)));
+}
+
+/**
+ * 以給定併發數重啓所有服務，並等待新任務全部進入 running
+ * @param docker 模擬 API
+ * @param concurrency 併發數
+ */
+static void run_round(fake_docker* docker, const gint concurrency)
+{
+    fake_docker_stats before;
+    fake_docker_get_stats(docker, &before);
+    fake_docker_reset(docker);
+
+    // 與 watcher 相同，所有服務在檢測到故障時一次性排隊
+    GThreadPool* pool = g_thread_pool_new(restart_worker, nullptr, concurrency, FALSE, nullptr);
+    const GPrintFunc print = verbose ? nullptr : g_set_print_handler(discard_print);
+    const gint64 queued_at = g_get_monotonic_time();
+    for (gint i = 0; i < n_services_option; ++i)
+        g_thread_pool_push(pool, (gpointer)fake_docker_service_id(docker, i), nullptr);
+    g_thread_pool_free(pool, FALSE, TRUE);
+    const gint64 submitted_at = g_get_monotonic_time();
+    if (!verbose) g_set_print_handler(print);
+
+    // 等待更新完成
+    const gint64 deadline = queued_at + (gint64)timeout * G_USEC_PER_SEC;
+    GArray* elapsed = g_array_new(FALSE, FALSE, sizeof(gint64));
+    while (TRUE)
+    {
+        g_array_set_size(elapsed, 0);
+        for (gint i = 0; i < n_services_option; ++i)
+        {
+            const gint64 converged_at = fake_docker_converged_at(docker, i);
+            if (converged_at == 0) continue;
+            const gint64 us = converged_at - queued_at;
+            g_array_append_val(elapsed, us);
+        }
+        if ((gint)elapsed->len == n_services_option || g_get_monotonic_time() >= deadline) break;
+        g_usleep(5000);
+    }
+
+    fake_docker_stats after;
+    fake_docker_get_stats(docker, &after);
+    const gint failed = n_services_option - (gint)elapsed->len;
+    const gint64 wall_us = elapsed->len > 0 ? percentile(elapsed, 1) : g_get_monotonic_time() - queued_at;
+    g_print("%11d %10.1f %10.1f %10.1f %10.1f %10.1f %8d %8lu\n", concurrency,
+            (gdouble)(submitted_at - queued_at) / 1000, (gdouble)wall_us / 1000,
+            (gdouble)percentile(elapsed, 0.5) / 1000, (gdouble)percentile(elapsed, 0.99) / 1000,
+            (gdouble)n_services_option / ((gdouble)wall_us / G_USEC_PER_SEC), failed,
+            (gulong)(after.requests - before.requests));
+    g_array_free(elapsed, TRUE);
+}
+
+int main(int argc, char* argv[])
+{
+    GError* error = nullptr;
+    GOptionContext* context = g_option_context_new("- service remediation benchmark");
+    g_option_context_add_main_entries(context, entries, nullptr);
+    g_option_context_set_summary(context,
+                                 "Restarts N services through an in-process fake Docker Engine API on a Unix socket,\n"
+                                 "and reports the time from queueing until every new task is running for each\n"
+                                 "restart concurrency.");
+    if (!g_option_context_parse(context, &argc, &argv, &error))
+    {
+        g_printerr("Option parsing failed: %s\n", error->message);
+        g_error_free(error);
+        return 1;
+    }
+    g_option_context_free(context);
+    if (n_services_option < 1 || timeout < 1 || docker_options.converge_ms < 0)
+    {
+        g_printerr("services and timeout must be positive, converge must not be negative\n");
+        return 1;
+    }
+
+    gchar** levels = g_strsplit(concurrency_option != nullptr ? concurrency_option : "1,2,4,8,16", ",", -1);
+    for (gchar** level = levels; *level != nullptr; ++level)
+    {
+        if (g_ascii_strtoll(*level, nullptr, 10) < 1)
+        {
+            g_printerr("Invalid concurrency: %s\n", *level);
+            return 1;
+        }
+    }
+
+    gchar* socket_path = socket_option != nullptr
+                             ? g_strdup(socket_option)
+                             : g_strdup_printf("%s/remediation-bench-%d.sock", g_get_tmp_dir(), (gint)getpid());
+    fake_docker* docker = fake_docker_start(socket_path, (guint)n_services_option, &docker_options);
+    if (docker == nullptr) return 1;
+
+    // 以與主程序相同的方式讀取配置
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    GKeyFile* keyfile = g_key_file_new();
+    const gchar* first = fake_docker_service_id(docker, 0);
+    g_key_file_set_string_list(keyfile, "Services", "targets", &first, 1);
+    g_key_file_set_string(keyfile, "Services", "socket", socket_path);
+    if (!init_watcher_config(keyfile, nullptr)) return 1;
+    g_key_file_free(keyfile);
+
+    g_print("Restarting %d service(s): latency %dms + jitter %dms, %d byte payload, converge %dms, "
+            "failure rate %.3f, conflict rate %.3f\n", n_services_option, docker_options.latency_ms,
+            docker_options.jitter_ms, docker_options.payload_bytes, docker_options.converge_ms,
+            docker_options.failure_rate, docker_options.conflict_rate);
+    g_print("%11s %10s %10s %10s %10s %10s %8s %8s\n", "concurrency", "submit ms", "wall ms", "p50 ms", "p99 ms",
+            "svc/sec", "failed", "requests");
+    for (gchar** level = levels; *level != nullptr; ++level)
+        run_round(docker, (gint)g_ascii_strtoll(*level, nullptr, 10));
+
+    fake_docker_stats stats;
+    fake_docker_get_stats(docker, &stats);
+    g_print("fake api:    %lu requests, %lu updates, %lu injected failures, %lu conflicts\n",
+            (gulong)stats.requests, (gulong)stats.updates, (gulong)stats.failures, (gulong)stats.conflicts);
+
+    // 釋放資源
+    destroy_watcher_config();
+    curl_global_cleanup();
+    fake_docker_stop(docker);
+    g_strfreev(levels);
+    g_free(socket_path);
+    g_free(socket_option);
+    g_free(concurrency_option);
+    return 0;
+}
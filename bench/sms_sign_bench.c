@@ -0,0 +1,316 @@
+#include <glib.h>
+#include <string.h>
+#include <curl/curl.h>
+#include <openssl/core_names.h>
+#include <openssl/evp.h>
+#include <openssl/params.h>
+#include <openssl/rand.h>
+#include <openssl/sha.h>
+
+#include "sms.h"
+
+// 每種請求體大小的簽名次數
+static gint iterations = 100000;
+// 逗號分隔的請求體大小列表
+static gchar* sizes_option = nullptr;
+// 比較輸出的隨機請求數
+static gint verify = 1000;
+
+// 命令行選項
+static GOptionEntry entries[] = {
+    {"iterations", 'n', 0, G_OPTION_ARG_INT, &iterations, "Signatures per body size", "N"},
+    {"sizes", 's', 0, G_OPTION_ARG_STRING, &sizes_option, "Body sizes in bytes (default: 64,256,1024,4096)", "LIST"},
+    {"verify", 'v', 0, G_OPTION_ARG_INT, &verify, "Random requests compared against the reference signer", "N"},
+    {nullptr}
+};
+
+// 參考實現的 HMAC 上下文模板
+static EVP_MAC_CTX* reference_template = nullptr;
+
+/**
+ * 參考實現：每一步分配並返回新的字符串，逐字節格式化十六進制
+ * @param input 輸入
+ * @return SHA-256 十六進制 (需要手動釋放)
+ */
+static gchar* reference_sha256_hex(const gchar* input)
+{
+    guchar hash[SHA256_DIGEST_LENGTH];
+    SHA256((const guchar*)input, strlen(input), hash);
+    gchar* output = g_malloc0(SHA256_DIGEST_LENGTH * 2 + 1);
+    for (gint i = 0; i < SHA256_DIGEST_LENGTH; ++i) g_snprintf(output + i * 2, 3, "%02x", hash[i]);
+    return output;
+}
+
+/**
+ * 參考實現：每次複製 HMAC 模板
+ * @param message 訊息
+ * @param len 訊息長度
+ * @return 簽名十六進制 (需要手動釋放)
+ */
+static gchar* reference_hmac256(const gchar* message, const gsize len)
+{
+    guchar hmac[SHA256_DIGEST_LENGTH];
+    gsize out_len = 0;
+    EVP_MAC_CTX* ctx = EVP_MAC_CTX_dup(reference_template);
+    EVP_MAC_update(ctx, (const guchar*)message, len);
+    EVP_MAC_final(ctx, hmac, &out_len, sizeof(hmac));
+    EVP_MAC_CTX_free(ctx);
+    gchar* output = g_malloc0(SHA256_DIGEST_LENGTH * 2 + 1);
+    for (gint i = 0; i < SHA256_DIGEST_LENGTH; ++i) g_snprintf(output + i * 2, 3, "%02x", hmac[i]);
+    return output;
+}
+
+/**
+ * 參考實現：生成 UUID v4
+ * @return UUID (需要手動釋放)
+ */
+static gchar* reference_uuid()
+{
+    guchar b[16];
+    RAND_bytes(b, sizeof(b));
+    b[6] = (b[6] & 0x0F) | 0x40;
+    b[8] = (b[8] & 0x3F) | 0x80;
+    return g_strdup_printf("%02x%02x%02x%02x-%02x%02x-%02x%02x-%02x%02x-%02x%02x%02x%02x%02x%02x", b[0], b[1], b[2],
+                           b[3], b[4], b[5], b[6], b[7], b[8], b[9], b[10], b[11], b[12], b[13], b[14], b[15]);
+}
+
+/**
+ * 參考實現：按步驟分配字符串的簽名流程，用作基準與輸出的對照
+ * @param action API名稱
+ * @param body 請求體
+ * @param date x-acs-date，為空時使用當前時間
+ * @param nonce x-acs-signature-nonce，為空時隨機生成
+ * @return cURL標頭 (需要手動釋放)
+ */
+static struct curl_slist* reference_sign(const gchar* action, const gchar* body, const gchar* date, const gchar* nonce)
+{
+    gchar* x_acs_date = nullptr;
+    if (date == nullptr)
+    {
+        GDateTime* now = g_date_time_new_now_utc();
+        x_acs_date = g_date_time_format(now, "%Y-%m-%dT%H:%M:%SZ");
+        g_date_time_unref(now);
+    }
+    else
+    {
+        x_acs_date = g_strdup(date);
+    }
+    gchar* uuid = nonce != nullptr ? g_strdup(nonce) : reference_uuid();
+    gchar* hashed_payload = reference_sha256_hex(body);
+
+    gchar* canonical_headers = g_strdup_printf("host:%s\nx-acs-action:%s\nx-acs-content-sha256:%s\nx-acs-date:%s\n"
+                                               "x-acs-signature-nonce:%s\nx-acs-version:2018-05-01\n",
+                                               ali_config->endpoint, action, hashed_payload, x_acs_date, uuid);
+    gchar* canonical_request = g_strdup_printf(
+        "POST\n/\n\n%s\nhost;x-acs-action;x-acs-content-sha256;x-acs-date;x-acs-signature-nonce;x-acs-version\n%s",
+        canonical_headers, hashed_payload);
+    gchar* hashed_canonical_request = reference_sha256_hex(canonical_request);
+    gchar* string_to_sign = g_strdup_printf("%s\n%s", ali_config->algorithm, hashed_canonical_request);
+    gchar* signature = reference_hmac256(string_to_sign, strlen(string_to_sign));
+
+    struct curl_slist* headers = curl_slist_append(nullptr, "Content-Type: application/x-www-form-urlencoded");
+    gchar* header = g_strdup_printf(
+        "Authorization: %s Credential=%s,SignedHeaders=host;x-acs-action;x-acs-content-sha256;x-acs-date;"
+        "x-acs-signature-nonce;x-acs-version,Signature=%s", ali_config->algorithm, ali_config->key, signature);
+    headers = curl_slist_append(headers, header);
+    g_free(header);
+    header = g_strdup_printf("host: %s", ali_config->endpoint);
+    headers = curl_slist_append(headers, header);
+    g_free(header);
+    header = g_strdup_printf("x-acs-action: %s", action);
+    headers = curl_slist_append(headers, header);
+    g_free(header);
+    header = g_strdup_printf("x-acs-content-sha256: %s", hashed_payload);
+    headers = curl_slist_append(headers, header);
+    g_free(header);
+    header = g_strdup_printf("x-acs-date: %s", x_acs_date);
+    headers = curl_slist_append(headers, header);
+    g_free(header);
+    header = g_strdup_printf("x-acs-signature-nonce: %s", uuid);
+    headers = curl_slist_append(headers, header);
+    g_free(header);
+    headers = curl_slist_append(headers, "x-acs-version: 2018-05-01");
+
+    g_free(signature);
+    g_free(string_to_sign);
+    g_free(hashed_canonical_request);
+    g_free(canonical_request);
+    g_free(canonical_headers);
+    g_free(hashed_payload);
+    g_free(uuid);
+    g_free(x_acs_date);
+    return headers;
+}
+
+/**
+ * 建構參考實現的 HMAC 模板
+ * @return 是否成功
+ */
+static gboolean init_reference()
+{
+    EVP_MAC* mac = EVP_MAC_fetch(nullptr, "HMAC", nullptr);
+    if (mac == nullptr) return FALSE;
+    reference_template = EVP_MAC_CTX_new(mac);
+    EVP_MAC_free(mac);
+    gchar digest[] = "SHA256";
+    const OSSL_PARAM params[] = {
+        OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, digest, 0),
+        OSSL_PARAM_construct_end()
+    };
+    return reference_template != nullptr &&
+        EVP_MAC_init(reference_template, (const guchar*)ali_config->secret, strlen(ali_config->secret), params);
+}
+
+/**
+ * 生成表單格式的隨機請求體
+ * @param size 字節數
+ * @return 請求體 (需要手動釋放)
+ */
+static gchar* random_body(const gsize size)
+{
+    static const gchar alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789%-_.~";
+    gchar* body = g_malloc(size + 1);
+    for (gsize i = 0; i < size; ++i) body[i] = alphabet[g_random_int_range(0, sizeof(alphabet) - 1)];
+    if (size > 3) memcpy(body, "To=", 3);
+    body[size] = '\0';
+    return body;
+}
+
+/**
+ * 比較兩組請求標頭
+ * @return 是否相同
+ */
+static gboolean same_headers(const struct curl_slist* a, const struct curl_slist* b)
+{
+    for (; a != nullptr && b != nullptr; a = a->next, b = b->next)
+    {
+        if (strcmp(a->data, b->data) != 0)
+        {
+            g_printerr("Mismatch:\n  reference: %s\n  signer:    %s\n", a->data, b->data);
+            return FALSE;
+        }
+    }
+    return a == nullptr && b == nullptr;
+}
+
+/**
+ * 檢查簽名器自行生成的 x-acs-date 與 nonce 的格式
+ * @return 是否符合
+ */
+static gboolean verify_generated()
+{
+    struct curl_slist* headers = sms_sign_request("SendMessageToGlobe", "To=1", 4, nullptr, nullptr);
+    gint matched = 0;
+    for (const struct curl_slist* h = headers; h != nullptr; h = h->next)
+    {
+        if (g_regex_match_simple("^x-acs-date: \\d{4}-\\d{2}-\\d{2}T\\d{2}:\\d{2}:\\d{2}Z$", h->data, 0, 0) ||
+            g_regex_match_simple("^x-acs-signature-nonce: [0-9a-f]{8}-[0-9a-f]{4}-4[0-9a-f]{3}-[89ab][0-9a-f]{3}-"
+                                 "[0-9a-f]{12}$", h->data, 0, 0))
+            matched++;
+    }
+    curl_slist_free_all(headers);
+    return matched == 2;
+}
+
+/**
+ * 以固定與隨機的時間、nonce 和請求體比較兩種實現的輸出
+ * @return 是否全部相同
+ */
+static gboolean verify_output()
+{
+    for (gint i = 0; i < verify; ++i)
+    {
+        gchar* body = random_body(g_random_int_range(0, 2048));
+        gchar* nonce = reference_uuid();
+        const gchar* date = i % 2 == 0 ? "2025-01-01T00:00:00Z" : "2031-12-31T23:59:59Z";
+        const gchar* action = i % 3 == 0 ? "BatchSendMessageToGlobe" : "SendMessageToGlobe";
+
+        struct curl_slist* expected = reference_sign(action, body, date, nonce);
+        struct curl_slist* actual = sms_sign_request(action, body, strlen(body), date, nonce);
+        const gboolean same = actual != nullptr && same_headers(expected, actual);
+        curl_slist_free_all(expected);
+        curl_slist_free_all(actual);
+        g_free(nonce);
+        g_free(body);
+        if (!same) return FALSE;
+    }
+    return TRUE;
+}
+
+int main(int argc, char* argv[])
+{
+    GError* error = nullptr;
+    GOptionContext* context = g_option_context_new("- SMS request signing benchmark");
+    g_option_context_add_main_entries(context, entries, nullptr);
+    g_option_context_set_summary(context,
+                                 "Compares the SMS request signer against a reference that allocates a string\n"
+                                 "at every step, checks that both produce byte-identical headers, and reports\n"
+                                 "the time per signature for each body size.");
+    if (!g_option_context_parse(context, &argc, &argv, &error))
+    {
+        g_printerr("Option parsing failed: %s\n", error->message);
+        g_error_free(error);
+        return 1;
+    }
+    g_option_context_free(context);
+    if (iterations < 1 || verify < 0)
+    {
+        g_printerr("iterations must be positive and verify must not be negative\n");
+        return 1;
+    }
+
+    gchar** sizes = g_strsplit(sizes_option != nullptr ? sizes_option : "64,256,1024,4096", ",", -1);
+    for (gchar** size = sizes; *size != nullptr; ++size)
+    {
+        if (g_ascii_strtoll(*size, nullptr, 10) < 0)
+        {
+            g_printerr("Invalid body size: %s\n", *size);
+            return 1;
+        }
+    }
+
+    // 以與主程序相同的方式讀取配置
+    GKeyFile* keyfile = g_key_file_new();
+    g_key_file_set_string(keyfile, "Sms", "mobile", "+85200000000");
+    g_key_file_set_string(keyfile, "Sms", "endpoint", "dysmsapi.aliyuncs.com");
+    g_key_file_set_string(keyfile, "Sms", "key", "bench-access-key-id");
+    g_key_file_set_string(keyfile, "Sms", "secret", "bench-access-key-secret");
+    g_key_file_set_string(keyfile, "Sms", "algorithm", "ACS3-HMAC-SHA256");
+    if (!init_sms_config(keyfile, nullptr) || !init_reference()) return 1;
+    g_key_file_free(keyfile);
+
+    if (!verify_output() || !verify_generated())
+    {
+        g_printerr("Signer output differs from the reference\n");
+        return 1;
+    }
+    g_print("Verified %d random request(s): headers are byte-identical\n", verify);
+
+    g_print("%10s %14s %14s %8s\n", "body", "reference ns", "signer ns", "speedup");
+    for (gchar** size = sizes; *size != nullptr; ++size)
+    {
+        gchar* body = random_body((gsize)g_ascii_strtoll(*size, nullptr, 10));
+        const gsize length = strlen(body);
+
+        // 與通知路徑相同，每次生成時間與 nonce
+        gint64 started = g_get_monotonic_time();
+        for (gint i = 0; i < iterations; ++i)
+            curl_slist_free_all(reference_sign("SendMessageToGlobe", body, nullptr, nullptr));
+        const gdouble reference_ns = (gdouble)(g_get_monotonic_time() - started) * 1000 / iterations;
+
+        started = g_get_monotonic_time();
+        for (gint i = 0; i < iterations; ++i)
+            curl_slist_free_all(sms_sign_request("SendMessageToGlobe", body, length, nullptr, nullptr));
+        const gdouble signer_ns = (gdouble)(g_get_monotonic_time() - started) * 1000 / iterations;
+
+        g_print("%10lu %14.0f %14.0f %7.2fx\n", (gulong)length, reference_ns, signer_ns, reference_ns / signer_ns);
+        g_free(body);
+    }
+
+    // 釋放資源
+    EVP_MAC_CTX_free(reference_template);
+    destroy_sms_config();
+    g_strfreev(sizes);
+    g_free(sizes_option);
+    return 0;
+}
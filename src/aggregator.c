@@ -0,0 +1,496 @@
+#include "aggregator.h"
+
+#include <errno.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <event2/event.h>
+
+#include "config.h"
+#include "history.h"
+#include "rollup.h"
+
+// 匯總配置
+aggregator_config_t ag_config = nullptr;
+
+// 生產者線程數上限
+#define AGGREGATOR_MAX_RINGS 64
+
+/**
+ * 記錄類型
+ */
+typedef enum aggregate_kind
+{
+    // 探測結果
+    AGGREGATE_RESULT = 0,
+    // 目標移除
+    AGGREGATE_FORGET
+} aggregate_kind;
+
+/**
+ * 定長記錄，目標名稱與結果都按值複製，目標在匯總線程處理前被移除也不受影響
+ */
+typedef struct aggregate_record
+{
+    // 類型
+    aggregate_kind kind;
+    // 目標名稱
+    gchar name[TARGET_NAME_MAX];
+    // 探測結果
+    probe_result result;
+} aggregate_record;
+
+/**
+ * 單生產者單消費者環形緩衝區
+ *
+ * 生產者只寫 tail，消費者只寫 head，兩者與統計各佔獨立的緩存行；
+ * 生產者緩存上次讀到的 head，只在看起來將滿時重新讀取
+ */
+typedef struct result_ring
+{
+    // 記錄
+    aggregate_record* records;
+    // 容量減 1
+    gsize mask;
+    // 寫入位置，只由生產者寫
+    alignas(64) atomic_size_t tail;
+    // 生產者緩存的讀取位置
+    gsize cached_head;
+    // 讀取位置，只由消費者寫
+    alignas(64) atomic_size_t head;
+    // 寫入的記錄數
+    alignas(64) atomic_uint_least64_t pushed;
+    // 丟棄的成功結果數
+    atomic_uint_least64_t dropped_ok;
+    // 丟棄的失敗結果數
+    atomic_uint_least64_t dropped_failed;
+    // 處理前觀察到的最高佔用，只由消費者寫
+    atomic_uint_least64_t high_watermark;
+} result_ring;
+
+// 所有生產者的緩衝區，先寫入指針再發佈數量，讀者無需加鎖
+static result_ring* rings[AGGREGATOR_MAX_RINGS];
+// 已登記的緩衝區數
+static atomic_uint n_rings = 0;
+// 保護登記
+static GMutex rings_lock;
+// 緩衝區的代數，每次啟動時遞增，線程緩存的緩衝區屬於舊的代時重新申請
+static atomic_uint generation = 0;
+// 當前線程的緩衝區
+static _Thread_local result_ring* local_ring = nullptr;
+// 當前線程的緩衝區所屬的代
+static _Thread_local guint local_generation = 0;
+// 是否在運行
+static atomic_bool running = false;
+// 是否正在停止
+static atomic_bool stopping = false;
+// 匯總線程
+static GThread* worker = nullptr;
+// 匯總線程的事件循環
+static struct event_base* worker_base = nullptr;
+// 喚醒與停止通知
+static gint wake_fd = -1;
+// 喚醒事件
+static struct event* wake_event = nullptr;
+// 處理定時器
+static struct event* drain_timer = nullptr;
+// 緩衝區已滿時無法排隊的目標移除 (gchar*)，在所有緩衝區處理完後執行
+static GPtrArray* pending_forgets = nullptr;
+// 保護 pending_forgets
+static GMutex forgets_lock;
+
+// 指標
+static atomic_uint_least64_t stat_drained = 0;
+static atomic_uint_least64_t stat_batches = 0;
+
+/**
+ * 讀取匯總配置
+ * @param keyfile 配置文件
+ * @param error 錯誤對象
+ */
+gboolean init_aggregator_config(GKeyFile* keyfile, GError* error)
+{
+    (void)error; // 可選配置由 read_optional_* 自行處理錯誤
+
+    gint64 ring_size = 0;
+    gint64 reserve = 0;
+    gint64 batch = 0;
+
+    // 創建匯總配置對象
+    ag_config = g_malloc0(sizeof(aggregator_config));
+
+    // 讀取環形緩衝區容量
+    if (!read_optional_integer(keyfile, "Aggregator", "ring_size", 4096, &ring_size)) goto error;
+    if (ring_size < 64 || ring_size > 1 << 20 || (ring_size & (ring_size - 1)) != 0)
+    {
+        g_printerr("Error reading ring_size: must be a power of two between 64 and 1048576\n");
+        goto error;
+    }
+
+    // 讀取保留的容量
+    if (!read_optional_integer(keyfile, "Aggregator", "reserve", ring_size / 8, &reserve)) goto error;
+    if (reserve < 0 || reserve >= ring_size)
+    {
+        g_printerr("Error reading reserve: must be between 0 and ring_size - 1\n");
+        goto error;
+    }
+
+    // 讀取單次最多處理的條數
+    if (!read_optional_integer(keyfile, "Aggregator", "batch", 256, &batch)) goto error;
+    if (batch < 1 || batch > ring_size)
+    {
+        g_printerr("Error reading batch: must be between 1 and ring_size\n");
+        goto error;
+    }
+
+    // 讀取處理間隔
+    if (!read_optional_integer(keyfile, "Aggregator", "interval", 10, &ag_config->interval_ms)) goto error;
+    if (ag_config->interval_ms < 1 || ag_config->interval_ms > 10000)
+    {
+        g_printerr("Error reading interval: must be between 1 and 10000\n");
+        goto error;
+    }
+
+    ag_config->ring_size = (guint)ring_size;
+    ag_config->reserve = (guint)reserve;
+    ag_config->batch = (guint)batch;
+    return TRUE;
+
+error:
+    // 釋放配置
+    destroy_aggregator_config();
+    return FALSE;
+}
+
+/**
+ * 釋放匯總配置
+ */
+void destroy_aggregator_config()
+{
+    g_free(ag_config);
+    ag_config = nullptr;
+}
+
+/**
+ * 取得當前線程的緩衝區，首次調用時申請並登記
+ * @return 緩衝區，生產者線程過多時返回空
+ */
+static result_ring* acquire_ring()
+{
+    const guint current = atomic_load_explicit(&generation, memory_order_acquire);
+    if (local_ring != nullptr && local_generation == current) return local_ring;
+
+    g_mutex_lock(&rings_lock);
+    const guint n = atomic_load_explicit(&n_rings, memory_order_relaxed);
+    if (n == AGGREGATOR_MAX_RINGS)
+    {
+        g_mutex_unlock(&rings_lock);
+        g_printerr("Result aggregator supports at most %d producer threads\n", AGGREGATOR_MAX_RINGS);
+        return nullptr;
+    }
+    result_ring* ring = g_malloc0(sizeof(result_ring));
+    ring->records = g_new(aggregate_record, ag_config->ring_size);
+    ring->mask = ag_config->ring_size - 1;
+    rings[n] = ring;
+    atomic_store_explicit(&n_rings, n + 1, memory_order_release);
+    g_mutex_unlock(&rings_lock);
+
+    local_ring = ring;
+    local_generation = current;
+    return ring;
+}
+
+/**
+ * 在緩衝區中預留一條記錄
+ * @param ring 緩衝區
+ * @param essential 是否可使用保留的容量
+ * @return 記錄，緩衝區已滿時返回空
+ */
+static aggregate_record* reserve_record(result_ring* ring, const gboolean essential)
+{
+    const gsize tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    const gsize limit = ring->mask + 1 - (essential ? 0 : ag_config->reserve);
+    if (tail - ring->cached_head >= limit)
+    {
+        ring->cached_head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        if (tail - ring->cached_head >= limit) return nullptr;
+    }
+    return &ring->records[tail & ring->mask];
+}
+
+/**
+ * 發佈預留的記錄，佔用過半時提前喚醒匯總線程
+ * @param ring 緩衝區
+ */
+static void publish_record(result_ring* ring)
+{
+    const gsize tail = atomic_load_explicit(&ring->tail, memory_order_relaxed) + 1;
+    atomic_store_explicit(&ring->tail, tail, memory_order_release);
+    atomic_fetch_add_explicit(&ring->pushed, 1, memory_order_relaxed);
+
+    // 緩存的讀取位置可能已過時，看起來過半時重新讀取再判斷
+    const gsize half = (ring->mask + 1) / 2;
+    if (tail - ring->cached_head < half) return;
+    ring->cached_head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if (tail - ring->cached_head >= half) eventfd_write(wake_fd, 1);
+}
+
+/**
+ * 提交一條探測結果
+ * @param t 目標
+ * @param result 探測結果
+ * @return 是否寫入
+ */
+gboolean aggregate_result(const target* t, const probe_result* result)
+{
+    if (!atomic_load_explicit(&running, memory_order_relaxed)) return FALSE;
+
+    result_ring* ring = acquire_ring();
+    if (ring == nullptr) return FALSE;
+    const gboolean failed = result->outcome != PROBE_OK;
+    aggregate_record* record = reserve_record(ring, failed);
+    if (record == nullptr)
+    {
+        atomic_fetch_add_explicit(failed ? &ring->dropped_failed : &ring->dropped_ok, 1, memory_order_relaxed);
+        return FALSE;
+    }
+
+    record->kind = AGGREGATE_RESULT;
+    g_strlcpy(record->name, t->config->name, sizeof(record->name));
+    record->result = *result;
+    publish_record(ring);
+    return TRUE;
+}
+
+/**
+ * 提交目標移除
+ * @param name 目標名稱
+ * @return 是否寫入
+ */
+gboolean aggregate_forget(const gchar* name)
+{
+    if (!atomic_load_explicit(&running, memory_order_relaxed)) return FALSE;
+
+    result_ring* ring = acquire_ring();
+    aggregate_record* record = ring != nullptr ? reserve_record(ring, TRUE) : nullptr;
+    if (record == nullptr)
+    {
+        // 移除不能丟，改為在緩衝區處理完後執行；目標已停止探測，之後不會再有它的結果
+        g_mutex_lock(&forgets_lock);
+        g_ptr_array_add(pending_forgets, g_strdup(name));
+        g_mutex_unlock(&forgets_lock);
+        return FALSE;
+    }
+
+    record->kind = AGGREGATE_FORGET;
+    g_strlcpy(record->name, name, sizeof(record->name));
+    publish_record(ring);
+    return TRUE;
+}
+
+/**
+ * 處理一條記錄
+ * @param record 記錄
+ */
+static void apply_record(const aggregate_record* record)
+{
+    switch (record->kind)
+    {
+    case AGGREGATE_RESULT:
+        history_append(record->name, &record->result);
+        rollup_append(record->name, &record->result);
+        break;
+    case AGGREGATE_FORGET:
+        history_forget(record->name);
+        forget_rollups(record->name);
+        break;
+    }
+}
+
+/**
+ * 處理緩衝區中的一批記錄，處理完後才釋放位置，記錄在處理期間不會被覆蓋
+ * @param ring 緩衝區
+ * @return 處理的條數
+ */
+static gsize drain_ring(result_ring* ring)
+{
+    const gsize head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    const gsize tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    const gsize n = MIN(tail - head, (gsize)ag_config->batch);
+    if (n == 0) return 0;
+    if (tail - head > atomic_load_explicit(&ring->high_watermark, memory_order_relaxed))
+        atomic_store_explicit(&ring->high_watermark, tail - head, memory_order_relaxed);
+
+    for (gsize i = 0; i < n; ++i) apply_record(&ring->records[(head + i) & ring->mask]);
+    atomic_store_explicit(&ring->head, head + n, memory_order_release);
+    atomic_fetch_add_explicit(&stat_drained, n, memory_order_relaxed);
+    atomic_fetch_add_explicit(&stat_batches, 1, memory_order_relaxed);
+    return n;
+}
+
+/**
+ * 輪流處理所有緩衝區直到都為空，每輪每個緩衝區最多一批，最後執行未能排隊的目標移除
+ */
+static void drain_all()
+{
+    gboolean more = TRUE;
+    while (more)
+    {
+        more = FALSE;
+        // 緩衝區只增不減，登記後的指針在停止前有效
+        const guint n = atomic_load_explicit(&n_rings, memory_order_acquire);
+        for (guint i = 0; i < n; ++i)
+        {
+            if (drain_ring(rings[i]) == ag_config->batch) more = TRUE;
+        }
+    }
+
+    g_mutex_lock(&forgets_lock);
+    for (guint i = 0; i < pending_forgets->len; ++i)
+    {
+        const gchar* name = g_ptr_array_index(pending_forgets, i);
+        history_forget(name);
+        forget_rollups(name);
+    }
+    g_ptr_array_set_size(pending_forgets, 0);
+    g_mutex_unlock(&forgets_lock);
+}
+
+/**
+ * 處理定時器回調
+ * @param fd 文件描述符
+ * @param event 事件類型
+ * @param arg 未使用
+ */
+static void drain_callback(const evutil_socket_t fd, const short event, void* arg)
+{
+    (void)fd; // 未使用
+    (void)event; // 未使用
+    (void)arg; // 未使用
+    drain_all();
+}
+
+/**
+ * 喚醒回調，緩衝區過半或停止時觸發；停止時處理完所有記錄再退出事件循環
+ * @param fd 文件描述符
+ * @param event 事件類型
+ * @param arg 未使用
+ */
+static void wake_callback(const evutil_socket_t fd, const short event, void* arg)
+{
+    (void)event; // 未使用
+    (void)arg; // 未使用
+
+    eventfd_t count = 0;
+    eventfd_read(fd, &count);
+    drain_all();
+    if (atomic_load_explicit(&stopping, memory_order_acquire)) event_base_loopbreak(worker_base);
+}
+
+/**
+ * 匯總線程
+ * @param data 未使用
+ * @return 未使用
+ */
+static gpointer aggregator_thread(gpointer data)
+{
+    (void)data; // 未使用
+    event_base_dispatch(worker_base);
+    return nullptr;
+}
+
+/**
+ * 啟動匯總線程
+ * @return 是否成功
+ */
+gboolean start_aggregator()
+{
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd < 0)
+    {
+        g_printerr("Cannot create eventfd for the result aggregator: %s\n", g_strerror(errno));
+        return FALSE;
+    }
+
+    atomic_fetch_add_explicit(&generation, 1, memory_order_release);
+    pending_forgets = g_ptr_array_new_with_free_func(g_free);
+
+    worker_base = event_base_new();
+    wake_event = event_new(worker_base, wake_fd, EV_READ | EV_PERSIST, wake_callback, nullptr);
+    event_add(wake_event, nullptr);
+    drain_timer = event_new(worker_base, -1, EV_PERSIST, drain_callback, nullptr);
+    const struct timeval interval = {
+        .tv_sec = ag_config->interval_ms / 1000,
+        .tv_usec = ag_config->interval_ms % 1000 * 1000,
+    };
+    event_add(drain_timer, &interval);
+
+    atomic_store_explicit(&stopping, false, memory_order_relaxed);
+    atomic_store_explicit(&running, true, memory_order_release);
+    worker = g_thread_new("aggregator", aggregator_thread, nullptr);
+    return TRUE;
+}
+
+/**
+ * 處理完所有緩衝區中的記錄後停止匯總線程
+ */
+void stop_aggregator()
+{
+    if (worker == nullptr) return;
+
+    atomic_store_explicit(&running, false, memory_order_relaxed);
+    atomic_store_explicit(&stopping, true, memory_order_release);
+    eventfd_write(wake_fd, 1);
+    g_thread_join(worker);
+    worker = nullptr;
+
+    event_free(drain_timer);
+    drain_timer = nullptr;
+    event_free(wake_event);
+    wake_event = nullptr;
+    event_base_free(worker_base);
+    worker_base = nullptr;
+    close(wake_fd);
+    wake_fd = -1;
+
+    aggregator_stats stats;
+    aggregator_get_stats(&stats);
+    if (stats.dropped_ok > 0 || stats.dropped_failed > 0)
+    {
+        g_printerr("Result aggregator dropped %lu successful and %lu failed results\n", (gulong)stats.dropped_ok,
+                   (gulong)stats.dropped_failed);
+    }
+    g_ptr_array_free(pending_forgets, TRUE);
+    pending_forgets = nullptr;
+    const guint n = atomic_exchange_explicit(&n_rings, 0, memory_order_acq_rel);
+    for (guint i = 0; i < n; ++i)
+    {
+        g_free(rings[i]->records);
+        g_free(rings[i]);
+        rings[i] = nullptr;
+    }
+}
+
+/**
+ * 獲取匯總統計
+ * @param stats 輸出的統計
+ */
+void aggregator_get_stats(aggregator_stats* stats)
+{
+    *stats = (aggregator_stats){
+        .drained = atomic_load_explicit(&stat_drained, memory_order_relaxed),
+        .batches = atomic_load_explicit(&stat_batches, memory_order_relaxed),
+    };
+    const guint n = atomic_load_explicit(&n_rings, memory_order_acquire);
+    for (guint i = 0; i < n; ++i)
+    {
+        const result_ring* ring = rings[i];
+        stats->rings++;
+        stats->pushed += atomic_load_explicit(&ring->pushed, memory_order_relaxed);
+        stats->dropped_ok += atomic_load_explicit(&ring->dropped_ok, memory_order_relaxed);
+        stats->dropped_failed += atomic_load_explicit(&ring->dropped_failed, memory_order_relaxed);
+        stats->high_watermark = MAX(stats->high_watermark,
+                                    atomic_load_explicit(&ring->high_watermark, memory_order_relaxed));
+    }
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include <glib.h>
+
+#include "target.h"
+
+/**
+ * 探測結果匯總配置
+ *
+ * 探測結果經每個生產者線程各自的單生產者單消費者環形緩衝區傳給匯總線程，
+ * 由匯總線程批量寫入探測歷史與指標匯總，探測線程不等待鎖
+ *
+ * 配置:
+ *  - ring_size 每個生產者的環形緩衝區容量（條），須為 2 的冪
+ *  - reserve 為失敗結果與目標移除保留的容量，緩衝區剩餘容量不足時先丟棄成功的結果
+ *  - batch 每個緩衝區單次最多處理的條數
+ *  - interval 匯總線程處理緩衝區的間隔毫秒數，緩衝區過半時提前喚醒
+ */
+typedef struct aggregator_config
+{
+    // 環形緩衝區容量
+    guint ring_size;
+    // 保留的容量
+    guint reserve;
+    // 單次最多處理的條數
+    guint batch;
+    // 處理間隔（毫秒）
+    gint64 interval_ms;
+} aggregator_config;
+
+typedef aggregator_config* aggregator_config_t;
+
+extern aggregator_config_t ag_config;
+
+/**
+ * 匯總統計，可在任意線程中讀取
+ */
+typedef struct aggregator_stats
+{
+    // 生產者數量
+    guint rings;
+    // 寫入的記錄數
+    guint64 pushed;
+    // 已處理的記錄數
+    guint64 drained;
+    // 因緩衝區將滿而丟棄的成功結果數
+    guint64 dropped_ok;
+    // 因緩衝區已滿而丟棄的失敗結果數
+    guint64 dropped_failed;
+    // 處理的批次數
+    guint64 batches;
+    // 單個緩衝區的最高佔用
+    guint64 high_watermark;
+} aggregator_stats;
+
+/**
+ * 讀取匯總配置
+ * @param keyfile 配置文件
+ * @param error 錯誤對象
+ */
+gboolean init_aggregator_config(GKeyFile* keyfile, GError* error);
+
+/**
+ * 釋放匯總配置
+ */
+void destroy_aggregator_config();
+
+/**
+ * 啟動匯總線程，需在打開探測歷史與開始匯總之後調用
+ * @return 是否成功
+ */
+gboolean start_aggregator();
+
+/**
+ * 處理完所有緩衝區中的記錄後停止匯總線程，需在停止探測之後調用
+ */
+void stop_aggregator();
+
+/**
+ * 提交一條探測結果，寫入當前線程的環形緩衝區，不加鎖也不分配內存（線程首次提交時除外）
+ * @param t 目標
+ * @param result 探測結果
+ * @return 是否寫入，緩衝區已滿時丟棄並計入統計
+ */
+gboolean aggregate_result(const target* t, const probe_result* result);
+
+/**
+ * 提交目標移除，匯總線程處理到此記錄時丟棄目標的匯總，保證之前提交的結果不會重新建立匯總；
+ * 緩衝區已滿時改為在所有緩衝區處理完後丟棄，不會遺漏
+ * @param name 目標名稱
+ * @return 是否寫入緩衝區
+ */
+gboolean aggregate_forget(const gchar* name);
+
+/**
+ * 獲取匯總統計，可在任意線程中調用
+ * @param stats 輸出的統計
+ */
+void aggregator_get_stats(aggregator_stats* stats);
@@ -0,0 +1,896 @@
+#include "alert.h"
+
+#include "config.h"
+#include "loopmon.h"
+#include "notifier.h"
+#include "suppress.h"
+
+// 靜默分組前綴
+#define SILENCE_GROUP_PREFIX "Silence:"
+// 抑制表清理間隔秒數
+#define SUPPRESS_SWEEP_SECONDS 60
+
+// 告警配置
+alert_config_t a_config = nullptr;
+
+/**
+ * 告警條目
+ */
+typedef struct alert_entry
+{
+    // 指紋
+    guint64 fingerprint;
+    // 目標名稱
+    gchar* target;
+    // 集群名稱
+    gchar* cluster;
+    // 目標地址
+    gchar* address;
+    // 故障類型
+    gchar* kind;
+    // 告警級別
+    alert_severity severity;
+    // 投遞的通道掩碼
+    guint channels;
+    // 是否被靜默或抑制，此時觸發與恢復都不通知
+    gboolean quiet;
+    // 是否為持續中告警的再次提醒
+    gboolean reminder;
+    // 開始時間（UNIX 微秒）
+    gint64 started_at;
+    // 恢復時間（UNIX 微秒）
+    gint64 resolved_at;
+    // 觸發次數
+    guint occurrences;
+    // 最新的探測結果
+    probe_result latest;
+    // 最近一次成功的探測結果
+    probe_result last_success;
+} alert_entry;
+
+// 聚合窗口定時器
+static struct event* flush_timer = nullptr;
+// 等待發送的新告警 (fingerprint -> alert_entry)
+static GHashTable* pending_firing = nullptr;
+// 已通知且仍在持續的告警
+static GHashTable* active = nullptr;
+// 等待發送的恢復
+static GHashTable* pending_resolved = nullptr;
+// 抑制表，記錄各指紋的通知時間與靜默
+static suppress_table* suppressions = nullptr;
+// 抑制表清理定時器
+static struct event* sweep_timer = nullptr;
+// 被測量的回調
+static loop_site flush_site = LOOP_SITE("alert.flush");
+static loop_site sweep_site = LOOP_SITE("alert.sweep");
+
+/**
+ * 釋放靜默配置
+ * @param data 靜默配置
+ */
+static void free_alert_silence(gpointer data)
+{
+    alert_silence* silence = data;
+    g_free(silence->target);
+    g_free(silence->kind);
+    g_free(silence);
+}
+
+/**
+ * 讀取單個靜默分組
+ * @param keyfile 配置文件
+ * @param group 分組名稱
+ * @return 靜默配置，出錯時返回空
+ */
+static alert_silence* read_silence_group(GKeyFile* keyfile, const gchar* group)
+{
+    gchar* severity = nullptr;
+    gchar* until = nullptr;
+    gint64 duration = 0;
+    alert_silence* silence = g_malloc0(sizeof(alert_silence));
+    silence->severity = -1;
+
+    // 讀取匹配條件
+    if (!read_optional_string(keyfile, group, "target", "*", &silence->target)) goto error;
+    if (!read_optional_string(keyfile, group, "kind", nullptr, &silence->kind)) goto error;
+    if (!read_optional_string(keyfile, group, "severity", nullptr, &severity)) goto error;
+    if (severity != nullptr)
+    {
+        for (gint i = 0; i < ALERT_SEVERITY_COUNT; ++i)
+        {
+            if (g_strcmp0(severity, alert_severity_name(i)) == 0) silence->severity = i;
+        }
+        if (silence->severity < 0)
+        {
+            g_printerr("Error reading %s severity: unknown severity %s\n", group, severity);
+            goto error;
+        }
+    }
+
+    // 讀取截止時間
+    if (!read_optional_string(keyfile, group, "until", nullptr, &until)) goto error;
+    if (!read_optional_integer(keyfile, group, "duration", 0, &duration)) goto error;
+    if (until != nullptr)
+    {
+        GTimeZone* local = g_time_zone_new_local();
+        GDateTime* time = g_date_time_new_from_iso8601(until, local);
+        g_time_zone_unref(local);
+        if (time == nullptr)
+        {
+            g_printerr("Error reading %s until: invalid time %s\n", group, until);
+            goto error;
+        }
+        silence->until = g_date_time_to_unix(time) * G_USEC_PER_SEC;
+        g_date_time_unref(time);
+    }
+    else if (duration > 0)
+    {
+        silence->until = g_get_real_time() + duration * G_USEC_PER_SEC;
+    }
+    else
+    {
+        g_printerr("Error reading %s: until or a positive duration is required\n", group);
+        goto error;
+    }
+
+    g_free(severity);
+    g_free(until);
+    return silence;
+
+error:
+    g_free(severity);
+    g_free(until);
+    free_alert_silence(silence);
+    return nullptr;
+}
+
+/**
+ * 讀取告警配置，需在所有通知通道註冊之後讀取
+ * @param keyfile 配置文件
+ * @param error 錯誤對象
+ */
+gboolean init_alert_config(GKeyFile* keyfile, GError* error)
+{
+    (void)error; // 可選配置由 read_optional_* 自行處理錯誤
+
+    // 創建告警配置對象
+    a_config = g_malloc0(sizeof(alert_config));
+
+    // 讀取聚合窗口秒數
+    if (!read_optional_integer(keyfile, "Alert", "window", 10, &a_config->window_seconds)) goto error;
+    if (a_config->window_seconds < 0)
+    {
+        g_printerr("Error reading window: must not be negative\n");
+        goto error;
+    }
+
+    // 讀取短信摘要中最多列出的目標數
+    if (!read_optional_integer(keyfile, "Alert", "sms_max_targets", 5, &a_config->sms_max_targets)) goto error;
+
+    // 讀取各級別投遞的通道
+    if (!read_notify_channels(keyfile, "Alert", "warning_channels",
+                              &a_config->severity_channels[ALERT_SEVERITY_WARNING]))
+        goto error;
+    if (!read_notify_channels(keyfile, "Alert", "critical_channels",
+                              &a_config->severity_channels[ALERT_SEVERITY_CRITICAL]))
+        goto error;
+
+    // 讀取抑制時間與提醒間隔
+    if (!read_optional_integer(keyfile, "Alert", "suppress_ttl", 300, &a_config->suppress_ttl_seconds)) goto error;
+    if (!read_optional_integer(keyfile, "Alert", "renotify_interval", 3600, &a_config->renotify_interval_seconds))
+        goto error;
+    if (a_config->suppress_ttl_seconds < 0 || a_config->renotify_interval_seconds < 0)
+    {
+        g_printerr("Error reading suppress_ttl: suppress_ttl and renotify_interval must not be negative\n");
+        goto error;
+    }
+
+    // 讀取所有 [Silence:<name>] 分組
+    a_config->silences = g_ptr_array_new_with_free_func(free_alert_silence);
+    gchar** groups = g_key_file_get_groups(keyfile, nullptr);
+    for (gint i = 0; groups[i] != nullptr; ++i)
+    {
+        if (!g_str_has_prefix(groups[i], SILENCE_GROUP_PREFIX)) continue;
+        alert_silence* silence = read_silence_group(keyfile, groups[i]);
+        if (silence == nullptr)
+        {
+            g_strfreev(groups);
+            goto error;
+        }
+        g_ptr_array_add(a_config->silences, silence);
+    }
+    g_strfreev(groups);
+    return TRUE;
+
+error:
+    // 釋放配置
+    destroy_alert_config();
+    return FALSE;
+}
+
+/**
+ * 釋放告警配置
+ */
+void destroy_alert_config()
+{
+    if (a_config != nullptr && a_config->silences != nullptr) g_ptr_array_free(a_config->silences, TRUE);
+    g_free(a_config);
+    a_config = nullptr;
+}
+
+/**
+ * 獲取告警級別名稱
+ * @param severity 告警級別
+ * @return 名稱
+ */
+const gchar* alert_severity_name(const alert_severity severity)
+{
+    switch (severity)
+    {
+    case ALERT_SEVERITY_WARNING:
+        return "warning";
+    case ALERT_SEVERITY_CRITICAL:
+        return "critical";
+    default:
+        return "unknown";
+    }
+}
+
+/**
+ * 計算告警指紋（FNV-1a 64）
+ * @param target 目標名稱
+ * @param cluster 集群名稱
+ * @param kind 故障類型
+ * @param severity 告警級別
+ * @return 指紋
+ */
+guint64 alert_fingerprint(const gchar* target, const gchar* cluster, const gchar* kind, const alert_severity severity)
+{
+    const gchar* parts[] = {target, cluster, kind, alert_severity_name(severity)};
+    guint64 hash = 14695981039346656037ULL;
+
+    for (gsize i = 0; i < G_N_ELEMENTS(parts); ++i)
+    {
+        for (const guchar* p = (const guchar*)parts[i]; *p; ++p)
+        {
+            hash ^= *p;
+            hash *= 1099511628211ULL;
+        }
+        // 分隔符，避免 "ab"+"c" 與 "a"+"bc" 衝突
+        hash ^= 0x1f;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/**
+ * 釋放告警條目
+ * @param data 告警條目
+ */
+static void free_alert_entry(gpointer data)
+{
+    alert_entry* entry = data;
+    g_free(entry->target);
+    g_free(entry->cluster);
+    g_free(entry->address);
+    g_free(entry->kind);
+    g_free(entry);
+}
+
+/**
+ * 摘要中的排序：先按集群再按目標
+ */
+static gint compare_entries(gconstpointer a, gconstpointer b)
+{
+    const alert_entry* x = *(alert_entry* const*)a;
+    const alert_entry* y = *(alert_entry* const*)b;
+    const gint res = g_strcmp0(x->cluster, y->cluster);
+    return res != 0 ? res : g_strcmp0(x->target, y->target);
+}
+
+/**
+ * 格式化耗時（毫秒），未執行的階段輸出 "-"
+ * @param out 輸出
+ * @param label 標籤
+ * @param us 耗時（微秒）
+ */
+static void append_duration(GString* out, const gchar* label, const gint64 us)
+{
+    if (us < 0)
+        g_string_append_printf(out, " %s=-", label);
+    else
+        g_string_append_printf(out, " %s=%.1fms", label, (gdouble)us / 1000.0);
+}
+
+/**
+ * 格式化時間
+ * @param out 輸出
+ * @param unix_us UNIX 微秒
+ */
+static void append_time(GString* out, const gint64 unix_us)
+{
+    GDateTime* time = g_date_time_new_from_unix_local(unix_us / G_USEC_PER_SEC);
+    gchar* text = g_date_time_format(time, "%Y-%m-%d %H:%M:%S");
+    g_string_append(out, text);
+    g_free(text);
+    g_date_time_unref(time);
+}
+
+/**
+ * 輸出一個目標的詳情
+ * @param body 輸出
+ * @param entry 告警條目
+ * @param resolved 是否為恢復摘要
+ */
+static void append_entry(GString* body, const alert_entry* entry, const gboolean resolved)
+{
+    g_string_append_printf(body, "%s[%s] %s (%s) %s/%s 開始於 ", entry->reminder && !resolved ? "仍未恢復 " : "",
+                           entry->cluster, entry->target, entry->address, entry->kind,
+                           alert_severity_name(entry->severity));
+    append_time(body, entry->started_at);
+    if (resolved)
+    {
+        g_string_append_printf(body, "，持續 %ld 秒",
+                               (glong)((entry->resolved_at - entry->started_at) / G_USEC_PER_SEC));
+    }
+    else if (entry->occurrences > 1)
+    {
+        g_string_append_printf(body, "，連續 %u 次", entry->occurrences);
+    }
+    g_string_append(body, "\r\n");
+
+    // 最新的探測耗時
+    g_string_append(body, "    延遲:");
+    append_duration(body, "connect", entry->latest.connect_us);
+    append_duration(body, "auth", entry->latest.auth_us);
+    append_duration(body, "ping", entry->latest.ping_us);
+    append_duration(body, "info", entry->latest.info_us);
+    append_duration(body, "total", entry->latest.total_us);
+    if (entry->latest.outcome != PROBE_OK)
+        g_string_append_printf(body, " error=%s", entry->latest.error);
+    g_string_append(body, "\r\n");
+
+    // 最近一次取得的 INFO 指標
+    const probe_result* info_source = entry->latest.outcome == PROBE_OK ? &entry->latest : &entry->last_success;
+    if (info_source->timestamp == 0)
+    {
+        g_string_append(body, "    INFO: 尚無數據\r\n");
+        return;
+    }
+    const probe_info* info = &info_source->info;
+    g_string_append_printf(body,
+                           "    INFO: connected_clients=%ld blocked_clients=%ld used_memory=%ld ops_per_sec=%ld uptime=%lds\r\n",
+                           (glong)info->connected_clients, (glong)info->blocked_clients, (glong)info->used_memory,
+                           (glong)info->ops_per_sec, (glong)info->uptime_seconds);
+}
+
+/**
+ * 逐條發送告警，以指紋作為標識，供按標識配對觸發與恢復的通道使用
+ * @param entries 告警條目 (alert_entry*)
+ * @param channels 投遞的通道掩碼
+ * @param resolved 是否為恢復
+ */
+static void send_events(GPtrArray* entries, const guint channels, const gboolean resolved)
+{
+    for (guint i = 0; i < entries->len; ++i)
+    {
+        const alert_entry* entry = g_ptr_array_index(entries, i);
+        gchar* subject = resolved
+                             ? g_strdup_printf("Redis 恢復通知：[%s] %s %s 已恢復", entry->cluster, entry->target,
+                                               entry->kind)
+                             : g_strdup_printf("Redis 錯誤通知：[%s] %s %s/%s", entry->cluster, entry->target,
+                                               entry->kind, alert_severity_name(entry->severity));
+        GString* body = g_string_new(nullptr);
+        append_entry(body, entry, resolved);
+        gchar* key = g_strdup_printf("%016" G_GINT64_MODIFIER "x", entry->fingerprint);
+
+        const notify_message message = {
+            .subject = subject,
+            .body = body->str,
+            .summary = subject,
+            .routes = entry->cluster,
+            .severity = resolved ? "resolved" : alert_severity_name(entry->severity),
+            .key = key,
+        };
+        notify(channels, &message);
+
+        g_free(key);
+        g_string_free(body, TRUE);
+        g_free(subject);
+    }
+}
+
+/**
+ * 發送一份摘要，逐條接收告警的通道改為每條告警單獨發送
+ * @param entries 告警條目 (alert_entry*)，投遞的通道相同
+ * @param resolved 是否為恢復摘要
+ */
+static void send_digest(GPtrArray* entries, const gboolean resolved)
+{
+    if (entries->len == 0) return;
+    g_ptr_array_sort(entries, compare_entries);
+
+    const alert_entry* first = g_ptr_array_index(entries, 0);
+    const guint events = first->channels & notify_per_alert_channels();
+    if (events != 0) send_events(entries, events, resolved);
+    const guint channels = first->channels & ~events;
+    if (channels == 0) return;
+
+    // 摘要的級別取最高的告警級別
+    alert_severity severity = ALERT_SEVERITY_WARNING;
+    for (guint i = 0; i < entries->len; ++i)
+    {
+        const alert_entry* entry = g_ptr_array_index(entries, i);
+        severity = MAX(severity, entry->severity);
+    }
+
+    gchar* subject = resolved
+                         ? g_strdup_printf("Redis 恢復通知：%u 個目標已恢復", entries->len)
+                         : g_strdup_printf("Redis 錯誤通知：%u 個目標發生故障", entries->len);
+
+    // 郵件等通道使用完整摘要
+    GString* body = g_string_new(nullptr);
+    g_string_append_printf(body, "%s\r\n\r\n", subject);
+    for (guint i = 0; i < entries->len; ++i)
+    {
+        append_entry(body, g_ptr_array_index(entries, i), resolved);
+    }
+
+    // 短信只列出部分目標名稱
+    GString* summary = g_string_new(nullptr);
+    g_string_append_printf(summary, resolved ? "Redis 已恢復 %u 個：" : "Redis 故障 %u 個，請檢查：", entries->len);
+    const guint listed = MIN(entries->len, (guint)MAX(a_config->sms_max_targets, 0));
+    for (guint i = 0; i < listed; ++i)
+    {
+        const alert_entry* entry = g_ptr_array_index(entries, i);
+        g_string_append_printf(summary, "%s%s", i ? "," : "", entry->target);
+    }
+    if (listed < entries->len) g_string_append_printf(summary, " 等");
+
+    // 涉及的集群，條目已按集群排序
+    GString* routes = g_string_new(nullptr);
+    const gchar* last_cluster = nullptr;
+    for (guint i = 0; i < entries->len; ++i)
+    {
+        const alert_entry* entry = g_ptr_array_index(entries, i);
+        if (g_strcmp0(entry->cluster, last_cluster) == 0) continue;
+        g_string_append_printf(routes, "%s%s", routes->len ? ";" : "", entry->cluster);
+        last_cluster = entry->cluster;
+    }
+
+    const notify_message message = {
+        .subject = subject,
+        .body = body->str,
+        .summary = summary->str,
+        .routes = routes->str,
+        .severity = resolved ? "resolved" : alert_severity_name(severity),
+    };
+    notify(channels, &message);
+    g_string_free(routes, TRUE);
+
+    g_free(subject);
+    g_string_free(body, TRUE);
+    g_string_free(summary, TRUE);
+}
+
+/**
+ * 按投遞的通道分組發送摘要，每組通道相同的告警合併為一份
+ * @param entries 告警條目 (alert_entry*)
+ * @param resolved 是否為恢復摘要
+ */
+static void send_digests(GPtrArray* entries, const gboolean resolved)
+{
+    GHashTable* groups = g_hash_table_new_full(g_direct_hash, g_direct_equal, nullptr,
+                                               (GDestroyNotify)g_ptr_array_unref);
+    for (guint i = 0; i < entries->len; ++i)
+    {
+        alert_entry* entry = g_ptr_array_index(entries, i);
+        // 沒有可投遞的通道，只記錄在日誌中
+        if (entry->channels == 0) continue;
+
+        GPtrArray* group = g_hash_table_lookup(groups, GUINT_TO_POINTER(entry->channels));
+        if (group == nullptr)
+        {
+            group = g_ptr_array_new();
+            g_hash_table_insert(groups, GUINT_TO_POINTER(entry->channels), group);
+        }
+        g_ptr_array_add(group, entry);
+    }
+
+    GHashTableIter iter;
+    gpointer value = nullptr;
+    g_hash_table_iter_init(&iter, groups);
+    while (g_hash_table_iter_next(&iter, nullptr, &value))
+    {
+        send_digest(value, resolved);
+    }
+    g_hash_table_destroy(groups);
+}
+
+/**
+ * 聚合窗口到期，發送新告警與恢復的摘要
+ * @param fd 文件描述符
+ * @param event 事件類型
+ * @param arg 未使用
+ */
+static void flush_callback(const evutil_socket_t fd, const short event, void* arg)
+{
+    (void)fd; // 未使用
+    (void)event; // 未使用
+    (void)arg; // 未使用
+
+    const gint64 started = loop_enter();
+    GHashTableIter iter;
+    gpointer value = nullptr;
+
+    // 新告警與提醒：發送後轉入持續中的告警，並記錄通知時間
+    const gint64 now = g_get_real_time();
+    GPtrArray* firing = g_ptr_array_new();
+    g_hash_table_iter_init(&iter, pending_firing);
+    while (g_hash_table_iter_next(&iter, nullptr, &value))
+    {
+        alert_entry* entry = value;
+        g_ptr_array_add(firing, entry);
+        g_hash_table_iter_steal(&iter);
+        g_hash_table_insert(active, &entry->fingerprint, entry);
+        suppress_insert(suppressions, entry->fingerprint)->notified_at = now;
+    }
+    send_digests(firing, FALSE);
+    for (guint i = 0; i < firing->len; ++i)
+    {
+        ((alert_entry*)g_ptr_array_index(firing, i))->reminder = FALSE;
+    }
+    g_ptr_array_free(firing, TRUE);
+
+    // 恢復：發送後釋放
+    GPtrArray* resolved = g_ptr_array_new_with_free_func(free_alert_entry);
+    g_hash_table_iter_init(&iter, pending_resolved);
+    while (g_hash_table_iter_next(&iter, nullptr, &value))
+    {
+        g_ptr_array_add(resolved, value);
+        g_hash_table_iter_steal(&iter);
+    }
+    send_digests(resolved, TRUE);
+    g_ptr_array_free(resolved, TRUE);
+    loop_leave(&flush_site, started);
+}
+
+/**
+ * 延長告警表中各條目的抑制記錄，避免仍在持續的告警丟失通知時間
+ * @param table 告警表 (fingerprint -> alert_entry)
+ * @param expires_at 過期時間
+ */
+static void retain_records(GHashTable* table, const gint64 expires_at)
+{
+    GHashTableIter iter;
+    gpointer value = nullptr;
+    g_hash_table_iter_init(&iter, table);
+    while (g_hash_table_iter_next(&iter, nullptr, &value))
+    {
+        const alert_entry* entry = value;
+        suppress_record* record = suppress_lookup(suppressions, entry->fingerprint);
+        if (record != nullptr) record->expires_at = MAX(record->expires_at, expires_at);
+    }
+}
+
+/**
+ * 定期清理抑制表中已過期的記錄
+ * @param fd 文件描述符
+ * @param event 事件類型
+ * @param arg 未使用
+ */
+static void sweep_callback(const evutil_socket_t fd, const short event, void* arg)
+{
+    (void)fd; // 未使用
+    (void)event; // 未使用
+    (void)arg; // 未使用
+
+    const gint64 started = loop_enter();
+    const gint64 now = g_get_real_time();
+    retain_records(pending_firing, now + 1);
+    retain_records(active, now + 1);
+    retain_records(pending_resolved, now + 1);
+    suppress_expire(suppressions, now);
+    loop_leave(&sweep_site, started);
+}
+
+/**
+ * 安排摘要發送，窗口從第一條未發送的告警開始計算
+ */
+static void arm_flush()
+{
+    if (evtimer_pending(flush_timer, nullptr)) return;
+    const struct timeval window = {a_config->window_seconds, 0};
+    evtimer_add(flush_timer, &window);
+}
+
+/**
+ * 啟動告警聚合
+ * @param base 事件循環
+ */
+void start_alerts(struct event_base* base)
+{
+    flush_timer = evtimer_new(base, flush_callback, nullptr);
+    pending_firing = g_hash_table_new_full(g_int64_hash, g_int64_equal, nullptr, free_alert_entry);
+    active = g_hash_table_new_full(g_int64_hash, g_int64_equal, nullptr, free_alert_entry);
+    pending_resolved = g_hash_table_new_full(g_int64_hash, g_int64_equal, nullptr, free_alert_entry);
+
+    // 每個目標通常只有少數幾種故障
+    suppressions = suppress_table_new(targets->len * 4);
+    sweep_timer = event_new(base, -1, EV_PERSIST, sweep_callback, nullptr);
+    const struct timeval sweep_interval = {SUPPRESS_SWEEP_SECONDS, 0};
+    evtimer_add(sweep_timer, &sweep_interval);
+
+    // 配置中的靜默在觸發時按目標名稱匹配，這裡只提示當前沒有匹配的目標，重新載入後加入的目標同樣生效
+    for (guint i = 0; i < a_config->silences->len; ++i)
+    {
+        const alert_silence* silence = g_ptr_array_index(a_config->silences, i);
+        guint matched = 0;
+        for (guint j = 0; j < targets->len; ++j)
+        {
+            const target* t = g_ptr_array_index(targets, j);
+            if (g_strcmp0(silence->target, "*") == 0 || g_strcmp0(silence->target, t->config->name) == 0) matched++;
+        }
+        if (matched == 0) g_printerr("Silence for target %s matches no target\n", silence->target);
+    }
+}
+
+/**
+ * 停止告警聚合，立即發送尚未發出的摘要
+ */
+void stop_alerts()
+{
+    if (flush_timer == nullptr) return;
+
+    flush_callback(-1, 0, nullptr);
+    event_free(flush_timer);
+    flush_timer = nullptr;
+    event_free(sweep_timer);
+    sweep_timer = nullptr;
+    suppress_table_free(suppressions);
+    suppressions = nullptr;
+    g_hash_table_destroy(pending_firing);
+    g_hash_table_destroy(active);
+    g_hash_table_destroy(pending_resolved);
+    pending_firing = active = pending_resolved = nullptr;
+}
+
+/**
+ * 靜默告警，靜默期間觸發的告警及其恢復都不通知
+ * @param t 目標
+ * @param kind 故障類型，為空時為所有類型
+ * @param severity 告警級別，為 -1 時為所有級別
+ * @param until 截止時間（UNIX 微秒）
+ */
+void silence_alerts(const target* t, const gchar* kind, const gint severity, const gint64 until)
+{
+    for (probe_outcome outcome = PROBE_CONNECT_ERROR; outcome < PROBE_OUTCOME_COUNT; ++outcome)
+    {
+        // 指定類型時只靜默該類型，類型不限於探測結果
+        const gchar* name = kind != nullptr ? kind : probe_outcome_name(outcome);
+        for (gint i = 0; i < ALERT_SEVERITY_COUNT; ++i)
+        {
+            if (severity >= 0 && severity != i) continue;
+            const guint64 fingerprint = alert_fingerprint(t->config->name, t->config->cluster, name, i);
+            suppress_record* record = suppress_insert(suppressions, fingerprint);
+            record->silenced_until = MAX(record->silenced_until, until);
+            record->expires_at = MAX(record->expires_at, until);
+        }
+        if (kind != nullptr) break;
+    }
+}
+
+/**
+ * 判斷告警條目是否屬於指定目標
+ * @param key 未使用
+ * @param value 告警條目
+ * @param user_data 目標名稱
+ * @return 是否屬於
+ */
+static gboolean entry_of_target(gpointer key, gpointer value, gpointer user_data)
+{
+    (void)key; // 未使用
+    const alert_entry* entry = value;
+    return g_strcmp0(entry->target, user_data) == 0;
+}
+
+/**
+ * 丟棄目標尚未恢復的告警，不發送恢復通知；已排隊的恢復摘要照常發送
+ * @param name 目標名稱
+ */
+void forget_alerts(const gchar* name)
+{
+    if (pending_firing == nullptr) return;
+    const guint forgotten = g_hash_table_foreach_remove(pending_firing, entry_of_target, (gpointer)name) +
+        g_hash_table_foreach_remove(active, entry_of_target, (gpointer)name);
+    if (forgotten > 0) g_print("[%s] %u ongoing alert(s) dropped.\n", name, forgotten);
+}
+
+/**
+ * 查找配置中匹配告警的靜默
+ * @param t 目標
+ * @param kind 故障類型
+ * @param severity 告警級別
+ * @return 最晚的截止時間（UNIX 微秒），沒有匹配時返回 0
+ */
+static gint64 configured_silence(const target* t, const gchar* kind, const alert_severity severity)
+{
+    gint64 until = 0;
+    for (guint i = 0; i < a_config->silences->len; ++i)
+    {
+        const alert_silence* silence = g_ptr_array_index(a_config->silences, i);
+        if (g_strcmp0(silence->target, "*") != 0 && g_strcmp0(silence->target, t->config->name) != 0) continue;
+        if (silence->kind != nullptr && g_strcmp0(silence->kind, kind) != 0) continue;
+        if (silence->severity >= 0 && silence->severity != (gint)severity) continue;
+        until = MAX(until, silence->until);
+    }
+    return until;
+}
+
+/**
+ * 判斷告警是否需要通知
+ * @param entry 持續中的告警條目，新告警時為空
+ * @param record 抑制記錄
+ * @param now 當前時間（UNIX 微秒）
+ * @return 是否需要通知
+ */
+static gboolean notify_due(const alert_entry* entry, const suppress_record* record, const gint64 now)
+{
+    // 靜默中
+    if (record->silenced_until > now) return FALSE;
+    // 從未通知過
+    if (record->notified_at == 0) return TRUE;
+
+    // 新告警或被抑制的告警：距上次通知超過抑制時間才通知
+    const gint64 since = now - record->notified_at;
+    if (entry == nullptr || entry->quiet) return since >= a_config->suppress_ttl_seconds * G_USEC_PER_SEC;
+
+    // 已通知的持續告警：超過提醒間隔時再次通知
+    return a_config->renotify_interval_seconds > 0 && since >= a_config->renotify_interval_seconds * G_USEC_PER_SEC;
+}
+
+/**
+ * 觸發告警，同一指紋的告警只會通知一次，之後只更新最新的探測結果
+ *
+ * 在靜默中或距上次通知未超過抑制時間的告警不通知，持續超過提醒間隔時再次通知
+ * @param t 目標
+ * @param kind 故障類型
+ * @param severity 告警級別
+ * @param result 最新的探測結果
+ */
+void raise_alert(const target* t, const gchar* kind, const alert_severity severity, const probe_result* result)
+{
+    const gint64 now = result->timestamp;
+    guint64 fingerprint = alert_fingerprint(t->config->name, t->config->cluster, kind, severity);
+
+    // 每次失敗的探測都會查找抑制記錄，並延長其過期時間
+    suppress_record* record = suppress_insert(suppressions, fingerprint);
+    record->expires_at = MAX(record->expires_at, now + a_config->suppress_ttl_seconds * G_USEC_PER_SEC);
+
+    // 配置中的靜默在觸發時匹配，指紋因集群變化而改變時同樣生效
+    const gint64 silenced_until = configured_silence(t, kind, severity);
+    if (silenced_until > record->silenced_until)
+    {
+        record->silenced_until = silenced_until;
+        record->expires_at = MAX(record->expires_at, silenced_until);
+    }
+
+    // 已在佇列：只更新最新結果
+    alert_entry* entry = g_hash_table_lookup(pending_firing, &fingerprint);
+    if (entry != nullptr)
+    {
+        entry->latest = *result;
+        entry->occurrences++;
+        return;
+    }
+
+    entry = g_hash_table_lookup(active, &fingerprint);
+    if (entry == nullptr)
+    {
+        // 恢復摘要尚未發出又再次故障：撤銷恢復，視為同一次故障
+        entry = g_hash_table_lookup(pending_resolved, &fingerprint);
+        if (entry != nullptr)
+        {
+            g_hash_table_steal(pending_resolved, &fingerprint);
+            g_hash_table_insert(active, &entry->fingerprint, entry);
+            entry->resolved_at = 0;
+        }
+    }
+    if (entry != nullptr)
+    {
+        entry->latest = *result;
+        entry->occurrences++;
+
+        // 抑制或靜默到期、或需要再次提醒時重新排入摘要
+        if (notify_due(entry, record, now))
+        {
+            g_hash_table_steal(active, &fingerprint);
+            entry->reminder = !entry->quiet;
+            entry->quiet = FALSE;
+            g_hash_table_insert(pending_firing, &entry->fingerprint, entry);
+            arm_flush();
+        }
+        return;
+    }
+
+    // 新告警
+    entry = g_malloc0(sizeof(alert_entry));
+    entry->fingerprint = fingerprint;
+    entry->target = g_strdup(t->config->name);
+    entry->cluster = g_strdup(t->config->cluster);
+    entry->address = g_strdup_printf("%s:%d", t->config->host, t->config->port);
+    entry->kind = g_strdup(kind);
+    entry->severity = severity;
+    entry->channels = t->config->channels & a_config->severity_channels[severity];
+    entry->started_at = result->timestamp;
+    entry->occurrences = 1;
+    entry->latest = *result;
+    entry->last_success = t->last_success;
+
+    // 靜默中或剛通知過（反覆故障與恢復）：記為持續中但不通知
+    if (!notify_due(nullptr, record, now))
+    {
+        entry->quiet = TRUE;
+        record->suppressed++;
+        g_print("[%s] %s alert %s (suppressed %u times).\n", t->config->name, kind,
+                record->silenced_until > now ? "silenced" : "suppressed after a recent notification",
+                record->suppressed);
+        g_hash_table_insert(active, &entry->fingerprint, entry);
+        return;
+    }
+    g_hash_table_insert(pending_firing, &entry->fingerprint, entry);
+    arm_flush();
+}
+
+/**
+ * 解除告警，已通知的告警會在下一份恢復摘要中列出
+ * @param t 目標
+ * @param kind 故障類型
+ * @param severity 告警級別
+ * @param result 最新的探測結果
+ */
+void resolve_alert(const target* t, const gchar* kind, const alert_severity severity, const probe_result* result)
+{
+    guint64 fingerprint = alert_fingerprint(t->config->name, t->config->cluster, kind, severity);
+
+    // 恢復後仍保留抑制記錄，在抑制時間內再次故障不重複通知
+    suppress_record* record = suppress_lookup(suppressions, fingerprint);
+    if (record != nullptr)
+    {
+        record->expires_at = MAX(record->expires_at,
+                                 result->timestamp + a_config->suppress_ttl_seconds * G_USEC_PER_SEC);
+    }
+
+    alert_entry* entry = g_hash_table_lookup(pending_firing, &fingerprint);
+    if (entry != nullptr)
+    {
+        g_hash_table_steal(pending_firing, &fingerprint);
+        // 窗口內故障又恢復：兩者都不通知；提醒尚未發出時仍需通知恢復
+        if (!entry->reminder)
+        {
+            g_print("[%s] %s recovered within the alert window, notification suppressed.\n", t->config->name, kind);
+            free_alert_entry(entry);
+            return;
+        }
+        entry->reminder = FALSE;
+    }
+    else
+    {
+        entry = g_hash_table_lookup(active, &fingerprint);
+        if (entry == nullptr) return;
+        g_hash_table_steal(active, &fingerprint);
+    }
+
+    // 未通知過的告警，恢復也不通知
+    if (entry->quiet)
+    {
+        g_print("[%s] %s recovered while suppressed, notification suppressed.\n", t->config->name, kind);
+        free_alert_entry(entry);
+        return;
+    }
+
+    entry->resolved_at = result->timestamp;
+    entry->latest = *result;
+    g_hash_table_insert(pending_resolved, &entry->fingerprint, entry);
+    arm_flush();
+}
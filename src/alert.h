@@ -0,0 +1,146 @@
+#pragma once
+#include <glib.h>
+#include <event2/event.h>
+
+#include "target.h"
+
+/**
+ * 告警級別
+ */
+typedef enum alert_severity
+{
+    // 警告
+    ALERT_SEVERITY_WARNING = 0,
+    // 嚴重
+    ALERT_SEVERITY_CRITICAL,
+    // 級別數量
+    ALERT_SEVERITY_COUNT
+} alert_severity;
+
+/**
+ * 手動靜默
+ *
+ * 配置（[Silence:<name>] 分組）:
+ *  - target 目標名稱，* 表示所有目標
+ *  - kind 故障類型，缺省時為所有類型
+ *  - severity 告警級別，缺省時為所有級別
+ *  - until 截止時間 (ISO 8601，缺省為本地時區)
+ *  - duration 自啟動起的靜默秒數，與 until 二選一
+ */
+typedef struct alert_silence
+{
+    // 目標名稱
+    gchar* target;
+    // 故障類型，為空時為所有類型
+    gchar* kind;
+    // 告警級別，為 -1 時為所有級別
+    gint severity;
+    // 截止時間（UNIX 微秒）
+    gint64 until;
+} alert_silence;
+
+/**
+ * 告警聚合配置
+ *
+ * 配置:
+ *  - window_seconds 聚合窗口秒數，窗口內的告警合併為一份摘要
+ *  - sms_max_targets 短信摘要中最多列出的目標數
+ *  - warning_channels / critical_channels 各級別告警投遞的通知通道，與目標的通道取交集，缺省時為所有通道
+ *  - suppress_ttl 抑制秒數，告警通知後在此期間內再次觸發不重複通知，用於抑制反覆故障與恢復的目標
+ *  - renotify_interval 持續中的告警再次提醒的間隔秒數，0 表示不再提醒
+ *  - [Silence:<name>] 分組定義手動靜默，到期後自動失效
+ */
+typedef struct alert_config
+{
+    // 聚合窗口秒數
+    gint64 window_seconds;
+    // 短信摘要中最多列出的目標數
+    gint64 sms_max_targets;
+    // 各級別告警投遞的通道掩碼
+    guint severity_channels[ALERT_SEVERITY_COUNT];
+    // 抑制秒數
+    gint64 suppress_ttl_seconds;
+    // 再次提醒的間隔秒數
+    gint64 renotify_interval_seconds;
+    // 配置中的靜默 (alert_silence*)
+    GPtrArray* silences;
+} alert_config;
+
+typedef alert_config* alert_config_t;
+
+extern alert_config_t a_config;
+
+/**
+ * 讀取告警配置，需在所有通知通道註冊之後讀取
+ * @param keyfile 配置文件
+ * @param error 錯誤對象
+ */
+gboolean init_alert_config(GKeyFile* keyfile, GError* error);
+
+/**
+ * 釋放告警配置
+ */
+void destroy_alert_config();
+
+/**
+ * 啟動告警聚合，配置中的靜默在觸發時按目標匹配，需在讀取探測目標之後調用
+ * @param base 事件循環
+ */
+void start_alerts(struct event_base* base);
+
+/**
+ * 停止告警聚合，立即發送尚未發出的摘要
+ */
+void stop_alerts();
+
+/**
+ * 計算告警指紋
+ * @param target 目標名稱
+ * @param cluster 集群名稱
+ * @param kind 故障類型
+ * @param severity 告警級別
+ * @return 指紋
+ */
+guint64 alert_fingerprint(const gchar* target, const gchar* cluster, const gchar* kind, alert_severity severity);
+
+/**
+ * 靜默告警，靜默期間觸發的告警及其恢復都不通知
+ * @param t 目標
+ * @param kind 故障類型，為空時為所有類型
+ * @param severity 告警級別，為 -1 時為所有級別
+ * @param until 截止時間（UNIX 微秒）
+ */
+void silence_alerts(const target* t, const gchar* kind, gint severity, gint64 until);
+
+/**
+ * 觸發告警，同一指紋的告警只會通知一次，之後只更新最新的探測結果
+ *
+ * 在靜默中或距上次通知未超過抑制時間的告警不通知，持續超過提醒間隔時再次通知
+ * @param t 目標
+ * @param kind 故障類型
+ * @param severity 告警級別
+ * @param result 最新的探測結果
+ */
+void raise_alert(const target* t, const gchar* kind, alert_severity severity, const probe_result* result);
+
+/**
+ * 解除告警，已通知的告警會在下一份恢復摘要中列出
+ * @param t 目標
+ * @param kind 故障類型
+ * @param severity 告警級別
+ * @param result 最新的探測結果
+ */
+void resolve_alert(const target* t, const gchar* kind, alert_severity severity, const probe_result* result);
+
+/**
+ * 丟棄目標尚未恢復的告警，不發送恢復通知，用於目標被移除或更換集群
+ * @param name 目標名稱
+ */
+void forget_alerts(const gchar* name);
+
+/**
+ * 獲取告警級別名稱
+ * @param severity 告警級別
+ * @return 名稱
+ */
+const gchar* alert_severity_name(alert_severity severity);
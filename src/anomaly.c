@@ -0,0 +1,234 @@
+#include "anomaly.h"
+
+#include <math.h>
+
+#include "alert.h"
+#include "config.h"
+#include "loopmon.h"
+#include "rollup.h"
+
+// 耗時異常檢測配置
+anomaly_config_t an_config = nullptr;
+
+/**
+ * 目標的基線
+ */
+typedef struct anomaly_state
+{
+    // 基線耗時（微秒）
+    gdouble baseline;
+    // 基線建立的時間（單調時鐘）
+    gint64 since;
+    // 是否處於異常
+    gboolean anomalous;
+} anomaly_state;
+
+// 目標名稱到基線的映射 (gchar* -> anomaly_state*)
+static GHashTable* states = nullptr;
+// 檢測定時器
+static struct event* evaluate_timer = nullptr;
+// 每次檢測的 EWMA 權重
+static gdouble alpha = 0;
+// 被測量的回調
+static loop_site evaluate_site = LOOP_SITE("anomaly.evaluate");
+
+/**
+ * 讀取耗時異常檢測配置
+ * @param keyfile 配置文件
+ * @param error 錯誤對象
+ */
+gboolean init_anomaly_config(GKeyFile* keyfile, GError* error)
+{
+    (void)error; // 可選配置由 read_optional_* 自行處理錯誤
+
+    // 創建耗時異常檢測配置對象
+    an_config = g_malloc0(sizeof(anomaly_config));
+
+    // 讀取是否啟用
+    if (!read_optional_boolean(keyfile, "Anomaly", "enabled", TRUE, &an_config->enabled)) goto error;
+
+    // 讀取檢測間隔與窗口
+    if (!read_optional_integer(keyfile, "Anomaly", "interval", 30, &an_config->interval_seconds)) goto error;
+    if (!read_optional_integer(keyfile, "Anomaly", "window", 300, &an_config->window_seconds)) goto error;
+    if (an_config->interval_seconds <= 0 || an_config->window_seconds < an_config->interval_seconds)
+    {
+        g_printerr("Error reading interval/window: interval must be positive and not longer than window\n");
+        goto error;
+    }
+
+    // 讀取分位數
+    if (!read_optional_double(keyfile, "Anomaly", "quantile", 0.99, &an_config->quantile)) goto error;
+    if (an_config->quantile <= 0 || an_config->quantile >= 1)
+    {
+        g_printerr("Error reading quantile: must be between 0 and 1\n");
+        goto error;
+    }
+
+    // 讀取基線半衰期與預熱時間
+    if (!read_optional_integer(keyfile, "Anomaly", "baseline_half_life", 86400,
+                               &an_config->baseline_half_life_seconds))
+        goto error;
+    if (!read_optional_integer(keyfile, "Anomaly", "warmup", 600, &an_config->warmup_seconds)) goto error;
+    if (an_config->baseline_half_life_seconds <= 0 || an_config->warmup_seconds < 0)
+    {
+        g_printerr("Error reading baseline_half_life/warmup: must not be negative\n");
+        goto error;
+    }
+
+    // 讀取觸發倍數與恢復比例
+    if (!read_optional_double(keyfile, "Anomaly", "threshold", 3.0, &an_config->threshold)) goto error;
+    if (!read_optional_double(keyfile, "Anomaly", "recover_ratio", 0.8, &an_config->recover_ratio)) goto error;
+    if (an_config->threshold <= 1 || an_config->recover_ratio <= 0 || an_config->recover_ratio > 1)
+    {
+        g_printerr("Error reading threshold/recover_ratio: threshold must exceed 1, recover_ratio in (0, 1]\n");
+        goto error;
+    }
+
+    // 讀取最少樣本數與最低耗時
+    gint64 min_latency_ms = 0;
+    if (!read_optional_integer(keyfile, "Anomaly", "min_samples", 20, &an_config->min_samples)) goto error;
+    if (!read_optional_integer(keyfile, "Anomaly", "min_latency", 5, &min_latency_ms)) goto error;
+    an_config->min_latency_us = min_latency_ms * 1000;
+    return TRUE;
+
+error:
+    // 釋放配置
+    destroy_anomaly_config();
+    return FALSE;
+}
+
+/**
+ * 釋放耗時異常檢測配置
+ */
+void destroy_anomaly_config()
+{
+    g_free(an_config);
+    an_config = nullptr;
+}
+
+/**
+ * 檢測一個目標
+ * @param t 目標
+ * @param tier 匯總層級
+ * @param since 窗口開始時間（UNIX 微秒）
+ */
+static void evaluate_target(const target* t, const rollup_tier tier, const gint64 since)
+{
+    rollup_bucket summary;
+    rollup_summarize(t->config->name, tier, since, &summary);
+    const gint64 count = summary.count;
+    const gint64 current = rollup_quantile(&summary, an_config->quantile);
+    rollup_clear(&summary);
+    // 樣本不足時不判斷，也不更新基線，連接失敗由探測本身告警
+    if (count < an_config->min_samples) return;
+
+    anomaly_state* state = g_hash_table_lookup(states, t->config->name);
+    if (state == nullptr)
+    {
+        state = g_malloc0(sizeof(anomaly_state));
+        state->baseline = (gdouble)current;
+        state->since = g_get_monotonic_time();
+        g_hash_table_insert(states, g_strdup(t->config->name), state);
+        return;
+    }
+
+    const gdouble limit = MAX(state->baseline * an_config->threshold, (gdouble)an_config->min_latency_us);
+    const gboolean warmed = g_get_monotonic_time() - state->since >= an_config->warmup_seconds * G_USEC_PER_SEC;
+    if (!state->anomalous && warmed && current > limit)
+    {
+        state->anomalous = TRUE;
+        g_printerr("[%s] Latency p%g %.2fms exceeds %.1fx baseline %.2fms\n", t->config->name,
+                   an_config->quantile * 100, (gdouble)current / 1000, an_config->threshold, state->baseline / 1000);
+    }
+    else if (state->anomalous && current < limit * an_config->recover_ratio)
+    {
+        state->anomalous = FALSE;
+        g_print("[%s] Latency p%g back to %.2fms (baseline %.2fms)\n", t->config->name, an_config->quantile * 100,
+                (gdouble)current / 1000, state->baseline / 1000);
+        resolve_alert(t, ANOMALY_KIND, ALERT_SEVERITY_WARNING, &t->last_result);
+    }
+
+    // 異常期間持續交由告警聚合，由抑制表決定是否再次提醒；基線不吸收異常值
+    if (state->anomalous)
+    {
+        raise_alert(t, ANOMALY_KIND, ALERT_SEVERITY_WARNING, &t->last_result);
+        return;
+    }
+    state->baseline += alpha * ((gdouble)current - state->baseline);
+}
+
+/**
+ * 檢測定時器回調
+ * @param fd 文件描述符
+ * @param event 事件類型
+ * @param arg 未使用
+ */
+static void evaluate_callback(const evutil_socket_t fd, const short event, void* arg)
+{
+    (void)fd; // 未使用
+    (void)event; // 未使用
+    (void)arg; // 未使用
+
+    const gint64 started = loop_enter();
+    const rollup_tier tier = rollup_pick_tier(an_config->window_seconds);
+    const gint64 since = g_get_real_time() - an_config->window_seconds * G_USEC_PER_SEC;
+    for (guint i = 0; i < targets->len; ++i) evaluate_target(g_ptr_array_index(targets, i), tier, since);
+    loop_leave(&evaluate_site, started);
+}
+
+/**
+ * 啟動耗時異常檢測，需在啟動匯總與告警之後調用
+ * @param base 事件循環
+ */
+void start_anomalies(struct event_base* base)
+{
+    if (!an_config->enabled) return;
+
+    // 每次檢測的權重使基線按配置的半衰期衰減
+    alpha = 1 - exp(-G_LN2 * (gdouble)an_config->interval_seconds / (gdouble)an_config->baseline_half_life_seconds);
+    states = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+
+    evaluate_timer = event_new(base, -1, EV_PERSIST, evaluate_callback, nullptr);
+    const struct timeval interval = {.tv_sec = an_config->interval_seconds, .tv_usec = 0};
+    event_add(evaluate_timer, &interval);
+}
+
+/**
+ * 停止耗時異常檢測
+ */
+void stop_anomalies()
+{
+    if (evaluate_timer != nullptr)
+    {
+        event_free(evaluate_timer);
+        evaluate_timer = nullptr;
+    }
+    if (states != nullptr)
+    {
+        g_hash_table_destroy(states);
+        states = nullptr;
+    }
+}
+
+/**
+ * 丟棄目標的基線與異常狀態，不發送恢復通知，用於目標被移除或更換集群
+ * @param name 目標名稱
+ */
+void forget_anomalies(const gchar* name)
+{
+    if (states == nullptr) return;
+    g_hash_table_remove(states, name);
+}
+
+/**
+ * 獲取目標的基線
+ * @param name 目標名稱
+ * @param baseline 輸出的基線耗時（微秒），尚未建立時為 -1
+ * @param anomalous 輸出的是否處於異常
+ */
+void anomaly_baseline(const gchar* name, gint64* baseline, gboolean* anomalous)
+{
+    const anomaly_state* state = states != nullptr ? g_hash_table_lookup(states, name) : nullptr;
+    *baseline = state != nullptr ? (gint64)state->baseline : -1;
+    *anomalous = state != nullptr && state->anomalous;
+}
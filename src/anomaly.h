@@ -0,0 +1,91 @@
+#pragma once
+#include <glib.h>
+#include <event2/event.h>
+
+#include "target.h"
+
+// 耗時異常的故障類型
+#define ANOMALY_KIND "latency"
+
+/**
+ * 耗時異常檢測配置
+ *
+ * 定期從匯總的分位數草圖中取出每個目標最近窗口的分位數，與其指數加權移動平均 (EWMA) 基線比較，
+ * 超過基線的倍數時以警告級別進入告警流程，回落到倍數的 recover_ratio 以下時恢復；異常期間基線不更新
+ *
+ * 配置:
+ *  - enabled 是否啟用
+ *  - interval 檢測間隔秒數
+ *  - window 計算當前分位數的窗口秒數
+ *  - quantile 比較的分位數
+ *  - baseline_half_life 基線的半衰期秒數，越長越能發現緩慢劣化
+ *  - warmup 基線建立後開始檢測的秒數
+ *  - threshold 觸發異常的基線倍數
+ *  - recover_ratio 恢復時的倍數比例，避免在閾值附近反覆觸發
+ *  - min_samples 窗口內最少的成功探測數
+ *  - min_latency 觸發異常的最低耗時毫秒數，避免亞毫秒級的波動觸發
+ */
+typedef struct anomaly_config
+{
+    // 是否啟用
+    gboolean enabled;
+    // 檢測間隔秒數
+    gint64 interval_seconds;
+    // 窗口秒數
+    gint64 window_seconds;
+    // 分位數
+    gdouble quantile;
+    // 基線半衰期秒數
+    gint64 baseline_half_life_seconds;
+    // 預熱秒數
+    gint64 warmup_seconds;
+    // 觸發倍數
+    gdouble threshold;
+    // 恢復比例
+    gdouble recover_ratio;
+    // 最少樣本數
+    gint64 min_samples;
+    // 最低耗時（微秒）
+    gint64 min_latency_us;
+} anomaly_config;
+
+typedef anomaly_config* anomaly_config_t;
+
+extern anomaly_config_t an_config;
+
+/**
+ * 讀取耗時異常檢測配置
+ * @param keyfile 配置文件
+ * @param error 錯誤對象
+ */
+gboolean init_anomaly_config(GKeyFile* keyfile, GError* error);
+
+/**
+ * 釋放耗時異常檢測配置
+ */
+void destroy_anomaly_config();
+
+/**
+ * 啟動耗時異常檢測，需在啟動匯總與告警之後調用
+ * @param base 事件循環
+ */
+void start_anomalies(struct event_base* base);
+
+/**
+ * 停止耗時異常檢測
+ */
+void stop_anomalies();
+
+/**
+ * 丟棄目標的基線與異常狀態，不發送恢復通知，用於目標被移除或更換集群
+ * @param name 目標名稱
+ */
+void forget_anomalies(const gchar* name);
+
+/**
+ * 獲取目標的基線
+ * @param name 目標名稱
+ * @param baseline 輸出的基線耗時（微秒），尚未建立時為 -1
+ * @param anomalous 輸出的是否處於異常
+ */
+void anomaly_baseline(const gchar* name, gint64* baseline, gboolean* anomalous);
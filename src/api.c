@@ -0,0 +1,1046 @@
+#include "api.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <event2/buffer.h>
+#include <event2/http.h>
+#include <event2/keyvalq_struct.h>
+#include <jansson.h>
+
+#include "aggregator.h"
+#include "anomaly.h"
+#include "config.h"
+#include "history.h"
+#include "loopmon.h"
+#include "probe.h"
+#include "rollup.h"
+#include "shard.h"
+#include "target.h"
+#include "trace.h"
+#include "watcher.h"
+
+// 查詢接口配置
+api_config_t ap_config = nullptr;
+
+// 默認的查詢窗口秒數
+#define API_DEFAULT_WINDOW 300
+// 默認的分位數
+#define API_DEFAULT_QUANTILES "0.5,0.9,0.99"
+// 默認返回的歷史記錄數
+#define API_DEFAULT_HISTORY_LIMIT 1000
+
+/**
+ * 目標狀態快照
+ */
+typedef struct target_snapshot
+{
+    // 目標名稱
+    gchar* name;
+    // 所屬集群
+    gchar* cluster;
+    // Redis 連接地址
+    gchar* host;
+    // Redis 連接端口
+    gint port;
+    // 錯誤是否在持續中
+    gboolean error_ongoing;
+    // 觸發本次錯誤的探測結果
+    probe_outcome error_outcome;
+    // 最近一次探測結果
+    probe_result last_result;
+    // 最近一次成功的時間（UNIX 微秒），未成功過時為 0
+    gint64 last_success;
+    // φ 值
+    gdouble phi;
+    // 耗時基線（微秒），尚未建立時為 -1
+    gint64 baseline;
+    // 耗時是否異常
+    gboolean anomalous;
+} target_snapshot;
+
+/**
+ * 不可變快照，由事件循環發佈，接口線程持有引用期間不會被釋放
+ */
+typedef struct api_snapshot
+{
+    // 引用計數
+    gint ref;
+    // 快照時間（UNIX 微秒）
+    gint64 taken_at;
+    // 是否所有目標都已完成首次探測
+    gboolean ready;
+    // 目標狀態 (target_snapshot)
+    GArray* targets;
+    // 事件循環的調度延遲
+    loop_histogram lag;
+    // 事件循環各回調的耗時 (loop_site)
+    GArray* loop_sites;
+} api_snapshot;
+
+// 當前快照
+static api_snapshot* current = nullptr;
+// 保護 current
+static GMutex snapshot_lock;
+// 發佈快照的定時器
+static struct event* snapshot_timer = nullptr;
+// 接口線程
+static GThread* server = nullptr;
+// 接口線程的事件循環
+static struct event_base* server_base = nullptr;
+// HTTP 服務
+static struct evhttp* http = nullptr;
+// 停止通知
+static gint stop_fd = -1;
+// 停止事件
+static struct event* stop_event = nullptr;
+// 被測量的回調
+static loop_site snapshot_site = LOOP_SITE("api.snapshot");
+
+/**
+ * 讀取查詢接口配置
+ * @param keyfile 配置文件
+ * @param error 錯誤對象
+ */
+gboolean init_api_config(GKeyFile* keyfile, GError* error)
+{
+    (void)error; // 可選配置由 read_optional_* 自行處理錯誤
+
+    // 創建查詢接口配置對象
+    ap_config = g_malloc0(sizeof(api_config));
+
+    // 讀取監聽地址
+    if (!read_optional_string(keyfile, "Api", "listen", nullptr, &ap_config->listen)) goto error;
+
+    // 讀取監聽端口
+    if (!read_optional_integer(keyfile, "Api", "port", 9121, &ap_config->port)) goto error;
+    if (ap_config->port <= 0 || ap_config->port > 65535)
+    {
+        g_printerr("Error reading port: must be between 1 and 65535\n");
+        goto error;
+    }
+
+    // 讀取快照間隔
+    if (!read_optional_integer(keyfile, "Api", "snapshot_interval", 1000, &ap_config->snapshot_interval_ms))
+        goto error;
+    if (ap_config->snapshot_interval_ms < 100)
+    {
+        g_printerr("Error reading snapshot_interval: must be at least 100 milliseconds\n");
+        goto error;
+    }
+    return TRUE;
+
+error:
+    // 釋放配置
+    destroy_api_config();
+    return FALSE;
+}
+
+/**
+ * 釋放查詢接口配置
+ */
+void destroy_api_config()
+{
+    if (ap_config == nullptr) return;
+    g_free(ap_config->listen);
+    g_free(ap_config);
+    ap_config = nullptr;
+}
+
+/**
+ * 釋放目標狀態快照
+ * @param data 目標狀態快照
+ */
+static void clear_target_snapshot(gpointer data)
+{
+    target_snapshot* snapshot = data;
+    g_free(snapshot->name);
+    g_free(snapshot->cluster);
+    g_free(snapshot->host);
+}
+
+/**
+ * 釋放快照的引用
+ * @param snapshot 快照
+ */
+static void release_snapshot(api_snapshot* snapshot)
+{
+    if (snapshot == nullptr || !g_atomic_int_dec_and_test(&snapshot->ref)) return;
+    g_array_free(snapshot->targets, TRUE);
+    g_array_free(snapshot->loop_sites, TRUE);
+    g_free(snapshot);
+}
+
+/**
+ * 獲取當前快照的引用
+ * @return 快照，使用後需調用 release_snapshot
+ */
+static api_snapshot* acquire_snapshot()
+{
+    g_mutex_lock(&snapshot_lock);
+    api_snapshot* snapshot = current;
+    g_atomic_int_inc(&snapshot->ref);
+    g_mutex_unlock(&snapshot_lock);
+    return snapshot;
+}
+
+/**
+ * 在事件循環中複製目標狀態並發佈快照
+ */
+static void publish_snapshot()
+{
+    api_snapshot* snapshot = g_malloc0(sizeof(api_snapshot));
+    snapshot->ref = 1;
+    snapshot->taken_at = g_get_real_time();
+    snapshot->ready = probes_ready();
+    snapshot->targets = g_array_sized_new(FALSE, TRUE, sizeof(target_snapshot), targets->len);
+    g_array_set_clear_func(snapshot->targets, clear_target_snapshot);
+    for (guint i = 0; i < targets->len; ++i)
+    {
+        const target* t = g_ptr_array_index(targets, i);
+        target_snapshot copy = {
+            .name = g_strdup(t->config->name),
+            .cluster = g_strdup(t->config->cluster),
+            .host = g_strdup(t->config->host),
+            .port = t->config->port,
+            .error_ongoing = t->error_ongoing,
+            .error_outcome = t->error_outcome,
+            .last_result = t->last_result,
+            .last_success = t->last_success.timestamp,
+            .phi = probe_phi(t),
+        };
+        anomaly_baseline(t->config->name, &copy.baseline, &copy.anomalous);
+        g_array_append_val(snapshot->targets, copy);
+    }
+    snapshot->loop_sites = g_array_new(FALSE, FALSE, sizeof(loop_site));
+    loop_collect(&snapshot->lag, snapshot->loop_sites);
+
+    g_mutex_lock(&snapshot_lock);
+    api_snapshot* previous = current;
+    current = snapshot;
+    g_mutex_unlock(&snapshot_lock);
+    release_snapshot(previous);
+}
+
+/**
+ * 快照定時器回調
+ * @param fd 文件描述符
+ * @param event 事件類型
+ * @param arg 未使用
+ */
+static void snapshot_callback(const evutil_socket_t fd, const short event, void* arg)
+{
+    (void)fd; // 未使用
+    (void)event; // 未使用
+    (void)arg; // 未使用
+    const gint64 started = loop_enter();
+    publish_snapshot();
+    loop_leave(&snapshot_site, started);
+}
+
+/**
+ * 在快照中查找目標
+ * @param snapshot 快照
+ * @param name 目標名稱
+ * @return 目標狀態，不存在時返回空
+ */
+static const target_snapshot* find_target(const api_snapshot* snapshot, const gchar* name)
+{
+    for (guint i = 0; i < snapshot->targets->len; ++i)
+    {
+        const target_snapshot* t = &g_array_index(snapshot->targets, target_snapshot, i);
+        if (g_str_equal(t->name, name)) return t;
+    }
+    return nullptr;
+}
+
+/**
+ * 微秒轉為毫秒的 JSON 數值，未執行的階段為 null
+ * @param us 微秒
+ * @return JSON 數值
+ */
+static json_t* json_ms(const gint64 us)
+{
+    return us < 0 ? json_null() : json_real((gdouble)us / 1000);
+}
+
+/**
+ * 目標狀態轉為 JSON
+ * @param t 目標狀態
+ * @return JSON 對象
+ */
+static json_t* target_to_json(const target_snapshot* t)
+{
+    const probe_result* r = &t->last_result;
+    json_t* object = json_object();
+    json_object_set_new(object, "name", json_string(t->name));
+    json_object_set_new(object, "cluster", t->cluster ? json_string(t->cluster) : json_null());
+    json_object_set_new(object, "host", json_string(t->host));
+    json_object_set_new(object, "port", json_integer(t->port));
+    json_object_set_new(object, "status", json_string(t->error_ongoing ? "error" : "ok"));
+    if (t->error_ongoing)
+        json_object_set_new(object, "error_outcome", json_string(probe_outcome_name(t->error_outcome)));
+    json_object_set_new(object, "phi", json_real(t->phi));
+    json_object_set_new(object, "latency_baseline_ms", json_ms(t->baseline));
+    json_object_set_new(object, "latency_anomaly", json_boolean(t->anomalous));
+    json_object_set_new(object, "last_success_ms",
+                        t->last_success > 0 ? json_integer(t->last_success / 1000) : json_null());
+
+    json_t* last = json_object();
+    json_object_set_new(last, "timestamp_ms", r->timestamp > 0 ? json_integer(r->timestamp / 1000) : json_null());
+    json_object_set_new(last, "outcome", json_string(probe_outcome_name(r->outcome)));
+    if (r->outcome != PROBE_OK) json_object_set_new(last, "error", json_string(r->error));
+    json_object_set_new(last, "total_ms", json_ms(r->total_us));
+    json_object_set_new(last, "connect_ms", json_ms(r->connect_us));
+    json_object_set_new(last, "auth_ms", json_ms(r->auth_us));
+    json_object_set_new(last, "ping_ms", json_ms(r->ping_us));
+    json_object_set_new(last, "info_ms", json_ms(r->info_us));
+    json_object_set_new(last, "network_rtt_ms", json_ms(r->tcp.rtt_us));
+    json_object_set_new(last, "network_rttvar_ms", json_ms(r->tcp.rttvar_us));
+    json_object_set_new(last, "server_ms", json_ms(r->tcp.server_us));
+    json_object_set_new(last, "tcp_retransmits",
+                        r->tcp.retransmits >= 0 ? json_integer(r->tcp.retransmits) : json_null());
+    json_object_set_new(last, "tcp_cwnd", r->tcp.cwnd >= 0 ? json_integer(r->tcp.cwnd) : json_null());
+    json_object_set_new(object, "last_probe", last);
+    return object;
+}
+
+/**
+ * 發送 JSON 響應
+ * @param req 請求
+ * @param code 狀態碼
+ * @param body 響應內容（所有權轉移）
+ */
+static void send_json(struct evhttp_request* req, const gint code, json_t* body)
+{
+    gchar* text = json_dumps(body, JSON_COMPACT);
+    json_decref(body);
+
+    struct evbuffer* buffer = evbuffer_new();
+    evbuffer_add(buffer, text, strlen(text));
+    evbuffer_add(buffer, "\n", 1);
+    free(text);
+
+    evhttp_add_header(evhttp_request_get_output_headers(req), "Content-Type", "application/json");
+    evhttp_send_reply(req, code, code == HTTP_OK ? "OK" : "Error", buffer);
+    evbuffer_free(buffer);
+}
+
+/**
+ * 發送錯誤響應
+ * @param req 請求
+ * @param code 狀態碼
+ * @param message 錯誤信息
+ */
+static void send_error(struct evhttp_request* req, const gint code, const gchar* message)
+{
+    send_json(req, code, json_pack("{s:s}", "error", message));
+}
+
+/**
+ * 解析時間窗口，支持 s、m、h、d 後綴，無後綴時為秒
+ * @param text 文本，為空時使用默認值
+ * @param seconds 輸出的秒數
+ * @return 是否有效
+ */
+static gboolean parse_window(const gchar* text, gint64* seconds)
+{
+    if (text == nullptr)
+    {
+        *seconds = API_DEFAULT_WINDOW;
+        return TRUE;
+    }
+
+    gchar* end = nullptr;
+    const gint64 value = g_ascii_strtoll(text, &end, 10);
+    gint64 unit = 1;
+    if (g_str_equal(end, "m")) unit = 60;
+    else if (g_str_equal(end, "h")) unit = 3600;
+    else if (g_str_equal(end, "d")) unit = 86400;
+    else if (*end != '\0' && !g_str_equal(end, "s")) return FALSE;
+    if (end == text || value <= 0 || value > G_MAXINT32) return FALSE;
+
+    *seconds = value * unit;
+    return TRUE;
+}
+
+/**
+ * 解析分位數列表
+ * @param text 逗號分隔的分位數，為空時使用默認值
+ * @param quantiles 輸出的分位數 (gdouble)
+ * @return 是否有效
+ */
+static gboolean parse_quantiles(const gchar* text, GArray* quantiles)
+{
+    gchar** parts = g_strsplit(text != nullptr ? text : API_DEFAULT_QUANTILES, ",", -1);
+    gboolean valid = parts[0] != nullptr;
+    for (gint i = 0; valid && parts[i] != nullptr; ++i)
+    {
+        gchar* end = nullptr;
+        const gdouble q = g_ascii_strtod(parts[i], &end);
+        valid = end != parts[i] && *end == '\0' && q >= 0 && q <= 1;
+        g_array_append_val(quantiles, q);
+    }
+    g_strfreev(parts);
+    return valid;
+}
+
+/**
+ * 匯總轉為 JSON，耗時單位為毫秒
+ * @param summary 匯總
+ * @param quantiles 分位數 (gdouble)
+ * @return JSON 對象
+ */
+static json_t* summary_to_json(const rollup_bucket* summary, const GArray* quantiles)
+{
+    json_t* object = json_object();
+    json_object_set_new(object, "count", json_integer(summary->count));
+    json_object_set_new(object, "failures", json_integer(summary->failures));
+    if (summary->count == 0)
+    {
+        json_object_set_new(object, "min_ms", json_null());
+        json_object_set_new(object, "max_ms", json_null());
+        json_object_set_new(object, "mean_ms", json_null());
+    }
+    else
+    {
+        json_object_set_new(object, "min_ms", json_ms(summary->min_us));
+        json_object_set_new(object, "max_ms", json_ms(summary->max_us));
+        json_object_set_new(object, "mean_ms", json_real((gdouble)summary->sum_us / summary->count / 1000));
+    }
+
+    json_t* values = json_object();
+    for (guint i = 0; i < quantiles->len; ++i)
+    {
+        const gdouble q = g_array_index(quantiles, gdouble, i);
+        gchar key[G_ASCII_DTOSTR_BUF_SIZE];
+        g_ascii_formatd(key, sizeof(key), "%g", q);
+        json_object_set_new(values, key, json_ms(rollup_quantile(summary, q)));
+    }
+    json_object_set_new(object, "quantiles_ms", values);
+    return object;
+}
+
+/**
+ * GET /api/targets
+ * @param req 請求
+ * @param snapshot 快照
+ */
+static void handle_targets(struct evhttp_request* req, const api_snapshot* snapshot)
+{
+    json_t* list = json_array();
+    for (guint i = 0; i < snapshot->targets->len; ++i)
+        json_array_append_new(list, target_to_json(&g_array_index(snapshot->targets, target_snapshot, i)));
+
+    json_t* body = json_object();
+    json_object_set_new(body, "taken_at_ms", json_integer(snapshot->taken_at / 1000));
+    json_object_set_new(body, "ready", json_boolean(snapshot->ready));
+    json_object_set_new(body, "targets", list);
+    send_json(req, HTTP_OK, body);
+}
+
+/**
+ * GET /api/targets/<name>
+ * @param req 請求
+ * @param t 目標狀態
+ * @param query 查詢參數
+ */
+static void handle_target(struct evhttp_request* req, const target_snapshot* t, const struct evkeyvalq* query)
+{
+    gint64 window = 0;
+    GArray* quantiles = g_array_new(FALSE, FALSE, sizeof(gdouble));
+    if (!parse_window(evhttp_find_header(query, "window"), &window) ||
+        !parse_quantiles(evhttp_find_header(query, "quantiles"), quantiles))
+    {
+        g_array_free(quantiles, TRUE);
+        send_error(req, HTTP_BADREQUEST, "invalid window or quantiles");
+        return;
+    }
+
+    const rollup_tier tier = rollup_pick_tier(window);
+    rollup_bucket summary;
+    rollup_summarize(t->name, tier, g_get_real_time() - window * G_USEC_PER_SEC, &summary);
+
+    json_t* latency = summary_to_json(&summary, quantiles);
+    json_object_set_new(latency, "window_seconds", json_integer(window));
+    json_object_set_new(latency, "resolution", json_string(rollup_tier_name(tier)));
+    rollup_clear(&summary);
+    g_array_free(quantiles, TRUE);
+
+    json_t* body = target_to_json(t);
+    json_object_set_new(body, "latency", latency);
+    send_json(req, HTTP_OK, body);
+}
+
+/**
+ * 收集歷史記錄的回調
+ * @param record 記錄
+ * @param user_data 記錄列表 (history_record)
+ * @return 繼續讀取
+ */
+static gboolean collect_record(const history_record* record, const gpointer user_data)
+{
+    g_array_append_val((GArray*)user_data, *record);
+    return TRUE;
+}
+
+/**
+ * GET /api/targets/<name>/history
+ * @param req 請求
+ * @param name 目標名稱
+ * @param query 查詢參數
+ */
+static void handle_history(struct evhttp_request* req, const gchar* name, const struct evkeyvalq* query)
+{
+    const gchar* since_text = evhttp_find_header(query, "since");
+    const gchar* limit_text = evhttp_find_header(query, "limit");
+    const gint64 since = since_text != nullptr ? g_ascii_strtoll(since_text, nullptr, 10) * G_USEC_PER_SEC : 0;
+    const gint64 limit = limit_text != nullptr ? g_ascii_strtoll(limit_text, nullptr, 10) : API_DEFAULT_HISTORY_LIMIT;
+    if (since < 0 || limit <= 0)
+    {
+        send_error(req, HTTP_BADREQUEST, "invalid since or limit");
+        return;
+    }
+
+    GArray* records = g_array_new(FALSE, FALSE, sizeof(history_record));
+    history_query(name, since, collect_record, records);
+
+    // 只返回最新的 limit 條
+    json_t* list = json_array();
+    const guint first = records->len > limit ? records->len - (guint)limit : 0;
+    for (guint i = first; i < records->len; ++i)
+    {
+        const history_record* r = &g_array_index(records, history_record, i);
+        json_t* item = json_object();
+        json_object_set_new(item, "timestamp_ms", json_integer(r->timestamp / 1000));
+        json_object_set_new(item, "outcome", json_string(probe_outcome_name(r->outcome)));
+        json_object_set_new(item, "total_ms", json_ms(r->total_us));
+        json_object_set_new(item, "connect_ms", json_ms(r->connect_us));
+        json_object_set_new(item, "auth_ms", json_ms(r->auth_us));
+        json_object_set_new(item, "ping_ms", json_ms(r->ping_us));
+        json_object_set_new(item, "info_ms", json_ms(r->info_us));
+        json_object_set_new(item, "connected_clients", json_integer(r->connected_clients));
+        json_object_set_new(item, "used_memory", json_integer(r->used_memory));
+        json_object_set_new(item, "ops_per_sec", json_integer(r->ops_per_sec));
+        json_array_append_new(list, item);
+    }
+    g_array_free(records, TRUE);
+
+    send_json(req, HTTP_OK, json_pack("{s:s,s:o}", "name", name, "records", list));
+}
+
+/**
+ * GET /api/restarts
+ * @param req 請求
+ */
+static void handle_restarts(struct evhttp_request* req)
+{
+    GPtrArray* restarts = outstanding_restarts();
+    json_t* list = json_array();
+    for (guint i = 0; i < restarts->len; ++i)
+    {
+        const restart_job* job = g_ptr_array_index(restarts, i);
+        json_array_append_new(list, json_pack("{s:s,s:s,s:s,s:I,s:o}", "service", job->service_id, "target",
+                                              job->target, "state", job->started_at > 0 ? "running" : "queued",
+                                              "queued_at_ms", (json_int_t)(job->queued_at / 1000), "started_at_ms",
+                                              job->started_at > 0
+                                                  ? json_integer(job->started_at / 1000)
+                                                  : json_null()));
+    }
+    g_ptr_array_free(restarts, TRUE);
+    send_json(req, HTTP_OK, json_pack("{s:o}", "restarts", list));
+}
+
+/**
+ * GET /api/trace?format=chrome|otlp，導出所有線程緩衝區中的 span
+ * @param req 請求
+ * @param query 查詢參數
+ */
+static void handle_trace(struct evhttp_request* req, const struct evkeyvalq* query)
+{
+    const gchar* format = evhttp_find_header(query, "format");
+    if (!tracing()) send_error(req, HTTP_NOTFOUND, "tracing is disabled");
+    else if (format == nullptr || g_str_equal(format, "chrome")) send_json(req, HTTP_OK, trace_export_chrome());
+    else if (g_str_equal(format, "otlp")) send_json(req, HTTP_OK, trace_export_otlp());
+    else send_error(req, HTTP_BADREQUEST, "format must be chrome or otlp");
+}
+
+/**
+ * GET /api/latency，合併符合條件的目標在窗口內的耗時
+ * @param req 請求
+ * @param snapshot 快照
+ * @param query 查詢參數
+ */
+static void handle_latency(struct evhttp_request* req, const api_snapshot* snapshot, const struct evkeyvalq* query)
+{
+    const gchar* cluster = evhttp_find_header(query, "cluster");
+    const gchar* name = evhttp_find_header(query, "target");
+    gint64 window = 0;
+    GArray* quantiles = g_array_new(FALSE, FALSE, sizeof(gdouble));
+    if (!parse_window(evhttp_find_header(query, "window"), &window) ||
+        !parse_quantiles(evhttp_find_header(query, "quantiles"), quantiles))
+    {
+        g_array_free(quantiles, TRUE);
+        send_error(req, HTTP_BADREQUEST, "invalid window or quantiles");
+        return;
+    }
+
+    const rollup_tier tier = rollup_pick_tier(window);
+    const gint64 since = g_get_real_time() - window * G_USEC_PER_SEC;
+    rollup_bucket total = {0};
+    guint matched = 0;
+    for (guint i = 0; i < snapshot->targets->len; ++i)
+    {
+        const target_snapshot* t = &g_array_index(snapshot->targets, target_snapshot, i);
+        if (cluster != nullptr && g_strcmp0(t->cluster, cluster) != 0) continue;
+        if (name != nullptr && !g_str_equal(t->name, name)) continue;
+
+        rollup_bucket summary;
+        rollup_summarize(t->name, tier, since, &summary);
+        rollup_merge(&total, &summary);
+        rollup_clear(&summary);
+        matched++;
+    }
+
+    json_t* body = summary_to_json(&total, quantiles);
+    json_object_set_new(body, "targets", json_integer(matched));
+    json_object_set_new(body, "window_seconds", json_integer(window));
+    json_object_set_new(body, "resolution", json_string(rollup_tier_name(tier)));
+    rollup_clear(&total);
+    g_array_free(quantiles, TRUE);
+    send_json(req, HTTP_OK, body);
+}
+
+/**
+ * 寫入 Prometheus 標籤值，轉義反斜杠、引號與換行
+ * @param buffer 輸出
+ * @param value 標籤值
+ */
+static void append_label(struct evbuffer* buffer, const gchar* value)
+{
+    for (const gchar* p = value != nullptr ? value : ""; *p; ++p)
+    {
+        if (*p == '\\' || *p == '"') evbuffer_add_printf(buffer, "\\%c", *p);
+        else if (*p == '\n') evbuffer_add(buffer, "\\n", 2);
+        else evbuffer_add(buffer, p, 1);
+    }
+}
+
+/**
+ * 寫入一個目標的指標
+ * @param buffer 輸出
+ * @param metric 指標名稱
+ * @param t 目標狀態
+ * @param extra 額外的標籤，可為空
+ * @param value 指標值
+ */
+static void append_metric(struct evbuffer* buffer, const gchar* metric, const target_snapshot* t,
+                          const gchar* extra, const gdouble value)
+{
+    evbuffer_add_printf(buffer, "%s{target=\"", metric);
+    append_label(buffer, t->name);
+    evbuffer_add_printf(buffer, "\",cluster=\"");
+    append_label(buffer, t->cluster);
+    evbuffer_add_printf(buffer, "\"%s%s} %.6g\n", extra ? "," : "", extra ? extra : "", value);
+}
+
+/**
+ * 寫入一個直方圖的累計桶、總和與樣本數
+ * @param buffer 輸出
+ * @param metric 指標名稱
+ * @param label 額外的標籤，可為空
+ * @param histogram 直方圖
+ */
+static void append_histogram(struct evbuffer* buffer, const gchar* metric, const gchar* label,
+                             const loop_histogram* histogram)
+{
+    guint64 cumulative = 0;
+    for (guint i = 0; i < LOOP_BUCKETS; ++i)
+    {
+        cumulative += histogram->buckets[i];
+        evbuffer_add_printf(buffer, "%s_bucket{%s%sle=\"", metric, label ? label : "", label ? "," : "");
+        if (i < LOOP_BUCKETS - 1) evbuffer_add_printf(buffer, "%g", (gdouble)loop_bucket_bounds[i] / G_USEC_PER_SEC);
+        else evbuffer_add_printf(buffer, "+Inf");
+        evbuffer_add_printf(buffer, "\"} %lu\n", (gulong)cumulative);
+    }
+    const gchar* open = label ? "{" : "";
+    const gchar* close = label ? "}" : "";
+    evbuffer_add_printf(buffer, "%s_sum%s%s%s %.6f\n", metric, open, label ? label : "", close,
+                        (gdouble)histogram->sum_us / G_USEC_PER_SEC);
+    evbuffer_add_printf(buffer, "%s_count%s%s%s %lu\n", metric, open, label ? label : "", close,
+                        (gulong)histogram->count);
+}
+
+/**
+ * GET /metrics
+ * @param req 請求
+ * @param snapshot 快照
+ */
+static void handle_metrics(struct evhttp_request* req, const api_snapshot* snapshot)
+{
+    static const gdouble quantiles[] = {0.5, 0.9, 0.99};
+    struct evbuffer* buffer = evbuffer_new();
+    const GArray* list = snapshot->targets;
+
+    evbuffer_add_printf(buffer, "# HELP redis_watcher_up Whether the target is not in an ongoing error.\n"
+                        "# TYPE redis_watcher_up gauge\n");
+    for (guint i = 0; i < list->len; ++i)
+    {
+        const target_snapshot* t = &g_array_index(list, target_snapshot, i);
+        append_metric(buffer, "redis_watcher_up", t, nullptr, t->error_ongoing ? 0 : 1);
+    }
+
+    evbuffer_add_printf(buffer, "# HELP redis_watcher_probe_duration_seconds Duration of the last probe.\n"
+                        "# TYPE redis_watcher_probe_duration_seconds gauge\n");
+    for (guint i = 0; i < list->len; ++i)
+    {
+        const target_snapshot* t = &g_array_index(list, target_snapshot, i);
+        append_metric(buffer, "redis_watcher_probe_duration_seconds", t, nullptr,
+                      (gdouble)t->last_result.total_us / G_USEC_PER_SEC);
+    }
+
+    // 內核 TCP_INFO，僅在最近一次探測取得時輸出
+    evbuffer_add_printf(buffer, "# HELP redis_watcher_network_rtt_seconds "
+                        "Smoothed TCP round-trip time of the probe connection.\n"
+                        "# TYPE redis_watcher_network_rtt_seconds gauge\n");
+    for (guint i = 0; i < list->len; ++i)
+    {
+        const target_snapshot* t = &g_array_index(list, target_snapshot, i);
+        if (t->last_result.tcp.rtt_us >= 0)
+            append_metric(buffer, "redis_watcher_network_rtt_seconds", t, nullptr,
+                          (gdouble)t->last_result.tcp.rtt_us / G_USEC_PER_SEC);
+    }
+
+    evbuffer_add_printf(buffer, "# HELP redis_watcher_network_rttvar_seconds "
+                        "Mean deviation of the TCP round-trip time of the probe connection.\n"
+                        "# TYPE redis_watcher_network_rttvar_seconds gauge\n");
+    for (guint i = 0; i < list->len; ++i)
+    {
+        const target_snapshot* t = &g_array_index(list, target_snapshot, i);
+        if (t->last_result.tcp.rttvar_us >= 0)
+            append_metric(buffer, "redis_watcher_network_rttvar_seconds", t, nullptr,
+                          (gdouble)t->last_result.tcp.rttvar_us / G_USEC_PER_SEC);
+    }
+
+    evbuffer_add_printf(buffer, "# HELP redis_watcher_server_seconds "
+                        "Time from sending PING to its reply minus the network round-trip time; with the "
+                        "io_uring backend and AUTH pipelined ahead of PING it also includes AUTH.\n"
+                        "# TYPE redis_watcher_server_seconds gauge\n");
+    for (guint i = 0; i < list->len; ++i)
+    {
+        const target_snapshot* t = &g_array_index(list, target_snapshot, i);
+        if (t->last_result.tcp.server_us >= 0)
+            append_metric(buffer, "redis_watcher_server_seconds", t, nullptr,
+                          (gdouble)t->last_result.tcp.server_us / G_USEC_PER_SEC);
+    }
+
+    evbuffer_add_printf(buffer, "# HELP redis_watcher_tcp_retransmits "
+                        "Segments retransmitted over the lifetime of the probe connection.\n"
+                        "# TYPE redis_watcher_tcp_retransmits gauge\n");
+    for (guint i = 0; i < list->len; ++i)
+    {
+        const target_snapshot* t = &g_array_index(list, target_snapshot, i);
+        if (t->last_result.tcp.retransmits >= 0)
+            append_metric(buffer, "redis_watcher_tcp_retransmits", t, nullptr,
+                          (gdouble)t->last_result.tcp.retransmits);
+    }
+
+    evbuffer_add_printf(buffer, "# HELP redis_watcher_tcp_cwnd_segments "
+                        "Congestion window of the probe connection.\n"
+                        "# TYPE redis_watcher_tcp_cwnd_segments gauge\n");
+    for (guint i = 0; i < list->len; ++i)
+    {
+        const target_snapshot* t = &g_array_index(list, target_snapshot, i);
+        if (t->last_result.tcp.cwnd >= 0)
+            append_metric(buffer, "redis_watcher_tcp_cwnd_segments", t, nullptr, (gdouble)t->last_result.tcp.cwnd);
+    }
+
+    evbuffer_add_printf(buffer, "# HELP redis_watcher_last_success_timestamp_seconds "
+                        "Time of the last successful probe.\n"
+                        "# TYPE redis_watcher_last_success_timestamp_seconds gauge\n");
+    for (guint i = 0; i < list->len; ++i)
+    {
+        const target_snapshot* t = &g_array_index(list, target_snapshot, i);
+        append_metric(buffer, "redis_watcher_last_success_timestamp_seconds", t, nullptr,
+                      (gdouble)t->last_success / G_USEC_PER_SEC);
+    }
+
+    evbuffer_add_printf(buffer, "# HELP redis_watcher_phi Phi accrual suspicion level of the target.\n"
+                        "# TYPE redis_watcher_phi gauge\n");
+    for (guint i = 0; i < list->len; ++i)
+    {
+        const target_snapshot* t = &g_array_index(list, target_snapshot, i);
+        append_metric(buffer, "redis_watcher_phi", t, nullptr, t->phi);
+    }
+
+    evbuffer_add_printf(buffer, "# HELP redis_watcher_latency_baseline_seconds "
+                        "EWMA baseline of the probe latency quantile used for anomaly detection.\n"
+                        "# TYPE redis_watcher_latency_baseline_seconds gauge\n");
+    for (guint i = 0; i < list->len; ++i)
+    {
+        const target_snapshot* t = &g_array_index(list, target_snapshot, i);
+        if (t->baseline >= 0)
+            append_metric(buffer, "redis_watcher_latency_baseline_seconds", t, nullptr,
+                          (gdouble)t->baseline / G_USEC_PER_SEC);
+    }
+
+    // 最近 5 分鐘的耗時分位數
+    evbuffer_add_printf(buffer, "# HELP redis_watcher_probe_latency_5m_seconds "
+                        "Probe latency quantiles over the last 5 minutes.\n"
+                        "# TYPE redis_watcher_probe_latency_5m_seconds gauge\n");
+    const rollup_tier tier = rollup_pick_tier(API_DEFAULT_WINDOW);
+    const gint64 since = g_get_real_time() - API_DEFAULT_WINDOW * G_USEC_PER_SEC;
+    for (guint i = 0; i < list->len; ++i)
+    {
+        const target_snapshot* t = &g_array_index(list, target_snapshot, i);
+        rollup_bucket summary;
+        rollup_summarize(t->name, tier, since, &summary);
+        for (gsize j = 0; summary.count > 0 && j < G_N_ELEMENTS(quantiles); ++j)
+        {
+            gchar label[32];
+            g_snprintf(label, sizeof(label), "quantile=\"%g\"", quantiles[j]);
+            append_metric(buffer, "redis_watcher_probe_latency_5m_seconds", t, label,
+                          (gdouble)rollup_quantile(&summary, quantiles[j]) / G_USEC_PER_SEC);
+        }
+        rollup_clear(&summary);
+    }
+
+    GPtrArray* restarts = outstanding_restarts();
+    evbuffer_add_printf(buffer, "# HELP redis_watcher_restarts_outstanding Service restarts queued or running.\n"
+                        "# TYPE redis_watcher_restarts_outstanding gauge\n"
+                        "redis_watcher_restarts_outstanding %u\n", restarts->len);
+    g_ptr_array_free(restarts, TRUE);
+
+    evbuffer_add_printf(buffer, "# HELP redis_watcher_ready Whether every target has been probed at least once.\n"
+                        "# TYPE redis_watcher_ready gauge\n"
+                        "redis_watcher_ready %d\n", snapshot->ready ? 1 : 0);
+
+    // 事件循環的健康狀況
+    evbuffer_add_printf(buffer, "# HELP redis_watcher_loop_lag_seconds "
+                        "Delay between when an event loop timer was due and when it ran.\n"
+                        "# TYPE redis_watcher_loop_lag_seconds histogram\n");
+    append_histogram(buffer, "redis_watcher_loop_lag_seconds", nullptr, &snapshot->lag);
+    evbuffer_add_printf(buffer, "# HELP redis_watcher_loop_callback_seconds Time spent in event loop callbacks.\n"
+                        "# TYPE redis_watcher_loop_callback_seconds histogram\n");
+    for (guint i = 0; i < snapshot->loop_sites->len; ++i)
+    {
+        const loop_site* site = &g_array_index(snapshot->loop_sites, loop_site, i);
+        gchar* label = g_strdup_printf("callback=\"%s\"", site->name);
+        append_histogram(buffer, "redis_watcher_loop_callback_seconds", label, &site->histogram);
+        g_free(label);
+    }
+
+    // 探測結果到匯總線程的通道，統計為原子計數，直接讀取
+    aggregator_stats aggregator;
+    aggregator_get_stats(&aggregator);
+    evbuffer_add_printf(buffer, "# HELP redis_watcher_aggregator_records_total "
+                        "Probe results handed to the aggregator.\n"
+                        "# TYPE redis_watcher_aggregator_records_total counter\n"
+                        "redis_watcher_aggregator_records_total %lu\n"
+                        "# HELP redis_watcher_aggregator_drained_total Records written to history and rollups.\n"
+                        "# TYPE redis_watcher_aggregator_drained_total counter\n"
+                        "redis_watcher_aggregator_drained_total %lu\n"
+                        "# HELP redis_watcher_aggregator_dropped_total Records dropped because a ring was full.\n"
+                        "# TYPE redis_watcher_aggregator_dropped_total counter\n"
+                        "redis_watcher_aggregator_dropped_total{outcome=\"ok\"} %lu\n"
+                        "redis_watcher_aggregator_dropped_total{outcome=\"failed\"} %lu\n"
+                        "# HELP redis_watcher_aggregator_ring_high_watermark Highest ring occupancy seen.\n"
+                        "# TYPE redis_watcher_aggregator_ring_high_watermark gauge\n"
+                        "redis_watcher_aggregator_ring_high_watermark %lu\n",
+                        (gulong)aggregator.pushed, (gulong)aggregator.drained, (gulong)aggregator.dropped_ok,
+                        (gulong)aggregator.dropped_failed, (gulong)aggregator.high_watermark);
+
+    // 分片狀態，僅在啟用時輸出
+    if (sh_config != nullptr && sh_config->enabled)
+    {
+        shard_stats shard;
+        shard_get_stats(&shard);
+        evbuffer_add_printf(buffer, "# HELP redis_watcher_shard_members Replicas currently in the shard.\n"
+                            "# TYPE redis_watcher_shard_members gauge\n"
+                            "redis_watcher_shard_members %u\n"
+                            "# HELP redis_watcher_shard_targets Targets configured and owned by this replica.\n"
+                            "# TYPE redis_watcher_shard_targets gauge\n"
+                            "redis_watcher_shard_targets{state=\"owned\"} %u\n"
+                            "redis_watcher_shard_targets{state=\"total\"} %u\n"
+                            "# HELP redis_watcher_shard_degraded "
+                            "Whether all targets are probed because the coordination store is unavailable.\n"
+                            "# TYPE redis_watcher_shard_degraded gauge\n"
+                            "redis_watcher_shard_degraded %d\n"
+                            "# HELP redis_watcher_shard_rebalances_total Times the owned targets were recomputed.\n"
+                            "# TYPE redis_watcher_shard_rebalances_total counter\n"
+                            "redis_watcher_shard_rebalances_total %lu\n",
+                            shard.members, shard.owned, shard.total, shard.degraded ? 1 : 0,
+                            (gulong)shard.rebalances);
+    }
+
+    evhttp_add_header(evhttp_request_get_output_headers(req), "Content-Type", "text/plain; version=0.0.4");
+    evhttp_send_reply(req, HTTP_OK, "OK", buffer);
+    evbuffer_free(buffer);
+}
+
+/**
+ * 請求回調，在接口線程中調用
+ * @param req 請求
+ * @param arg 未使用
+ */
+static void request_callback(struct evhttp_request* req, void* arg)
+{
+    (void)arg; // 未使用
+
+    const struct evhttp_uri* uri = evhttp_request_get_evhttp_uri(req);
+    const gchar* path = evhttp_uri_get_path(uri);
+    const gchar* query_text = evhttp_uri_get_query(uri);
+    struct evkeyvalq query;
+    evhttp_parse_query_str(query_text != nullptr ? query_text : "", &query);
+
+    // 整個請求使用同一份快照
+    api_snapshot* snapshot = acquire_snapshot();
+    if (g_strcmp0(path, "/metrics") == 0)
+    {
+        handle_metrics(req, snapshot);
+    }
+    else if (g_strcmp0(path, "/api/targets") == 0)
+    {
+        handle_targets(req, snapshot);
+    }
+    else if (g_strcmp0(path, "/api/restarts") == 0)
+    {
+        handle_restarts(req);
+    }
+    else if (g_strcmp0(path, "/api/latency") == 0)
+    {
+        handle_latency(req, snapshot, &query);
+    }
+    else if (g_strcmp0(path, "/api/trace") == 0)
+    {
+        handle_trace(req, &query);
+    }
+    else if (path != nullptr && g_str_has_prefix(path, "/api/targets/"))
+    {
+        // 目標名稱可能經過 URL 編碼
+        gchar* name = evhttp_uridecode(path + strlen("/api/targets/"), 0, nullptr);
+        gchar* suffix = strchr(name, '/');
+        if (suffix != nullptr) *suffix++ = '\0';
+
+        const target_snapshot* t = find_target(snapshot, name);
+        if (t == nullptr) send_error(req, HTTP_NOTFOUND, "unknown target");
+        else if (suffix == nullptr) handle_target(req, t, &query);
+        else if (g_str_equal(suffix, "history")) handle_history(req, t->name, &query);
+        else send_error(req, HTTP_NOTFOUND, "not found");
+        free(name);
+    }
+    else
+    {
+        send_error(req, HTTP_NOTFOUND, "not found");
+    }
+    release_snapshot(snapshot);
+    evhttp_clear_headers(&query);
+}
+
+/**
+ * 停止通知回調，在接口線程中退出事件循環
+ * @param fd 文件描述符
+ * @param event 事件類型
+ * @param arg 未使用
+ */
+static void stop_callback(const evutil_socket_t fd, const short event, void* arg)
+{
+    (void)event; // 未使用
+    (void)arg; // 未使用
+
+    eventfd_t count = 0;
+    eventfd_read(fd, &count);
+    event_base_loopbreak(server_base);
+}
+
+/**
+ * 接口線程
+ * @param data 未使用
+ * @return 未使用
+ */
+static gpointer server_thread(gpointer data)
+{
+    (void)data; // 未使用
+    event_base_dispatch(server_base);
+    return nullptr;
+}
+
+/**
+ * 發佈首個快照並啟動接口線程，需在啟動探測之後調用
+ * @param base 事件循環
+ * @return 是否成功，未啟用時返回 TRUE
+ */
+gboolean start_api(struct event_base* base)
+{
+    if (ap_config->listen == nullptr || *ap_config->listen == '\0') return TRUE;
+
+    // 接口線程使用獨立的事件循環，與探測互不阻塞
+    server_base = event_base_new();
+    http = evhttp_new(server_base);
+    // 只提供查詢，其他方法由 libevent 返回 405
+    evhttp_set_allowed_methods(http, EVHTTP_REQ_GET);
+    evhttp_set_gencb(http, request_callback, nullptr);
+    if (evhttp_bind_socket_with_handle(http, ap_config->listen, (guint16)ap_config->port) == nullptr)
+    {
+        g_printerr("Cannot listen on %s:%ld for the query API: %s\n", ap_config->listen, (glong)ap_config->port,
+                   g_strerror(errno));
+        evhttp_free(http);
+        http = nullptr;
+        event_base_free(server_base);
+        server_base = nullptr;
+        return FALSE;
+    }
+
+    stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    stop_event = event_new(server_base, stop_fd, EV_READ | EV_PERSIST, stop_callback, nullptr);
+    event_add(stop_event, nullptr);
+
+    // 先發佈快照再接受請求
+    publish_snapshot();
+    snapshot_timer = event_new(base, -1, EV_PERSIST, snapshot_callback, nullptr);
+    const struct timeval interval = {
+        .tv_sec = ap_config->snapshot_interval_ms / 1000,
+        .tv_usec = ap_config->snapshot_interval_ms % 1000 * 1000,
+    };
+    event_add(snapshot_timer, &interval);
+
+    server = g_thread_new("api", server_thread, nullptr);
+    g_print("Query API listening on %s:%ld.\n", ap_config->listen, (glong)ap_config->port);
+    return TRUE;
+}
+
+/**
+ * 停止接口線程並釋放快照
+ */
+void stop_api()
+{
+    if (server != nullptr)
+    {
+        eventfd_write(stop_fd, 1);
+        g_thread_join(server);
+        server = nullptr;
+    }
+    if (stop_event != nullptr)
+    {
+        event_free(stop_event);
+        stop_event = nullptr;
+        close(stop_fd);
+        stop_fd = -1;
+    }
+    if (http != nullptr)
+    {
+        evhttp_free(http);
+        http = nullptr;
+        event_base_free(server_base);
+        server_base = nullptr;
+    }
+    if (snapshot_timer != nullptr)
+    {
+        event_free(snapshot_timer);
+        snapshot_timer = nullptr;
+    }
+    release_snapshot(current);
+    current = nullptr;
+}
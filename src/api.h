@@ -0,0 +1,61 @@
+#pragma once
+#include <glib.h>
+#include <event2/event.h>
+
+/**
+ * HTTP 查詢接口配置
+ *
+ * 接口在獨立線程中運行，只讀取事件循環定期發佈的不可變快照與線程安全的歷史和匯總，
+ * 耗時的查詢不會阻塞探測定時器
+ *
+ * 配置:
+ *  - listen 監聽地址，為空時不啟動
+ *  - port 監聽端口
+ *  - snapshot_interval 發佈目標狀態快照的間隔毫秒數
+ *
+ * 接口:
+ *  - GET /metrics Prometheus 文本格式的指標
+ *  - GET /api/targets 所有目標的當前狀態
+ *  - GET /api/targets/<name>?window=5m 單個目標的狀態與窗口內的耗時分位數
+ *  - GET /api/targets/<name>/history?since=<UNIX 秒>&limit=1000 單個目標的原始探測記錄
+ *  - GET /api/restarts 排隊中與執行中的服務重啓
+ *  - GET /api/latency?window=5m&cluster=<集群>&target=<目標>&quantiles=0.5,0.99 窗口內的耗時分位數（毫秒）
+ *  - GET /api/trace?format=chrome|otlp 追蹤緩衝區中的 span，格式為 Chrome trace-event 或 OTLP/HTTP JSON
+ */
+typedef struct api_config
+{
+    // 監聽地址
+    gchar* listen;
+    // 監聽端口
+    gint64 port;
+    // 快照間隔毫秒數
+    gint64 snapshot_interval_ms;
+} api_config;
+
+typedef api_config* api_config_t;
+
+extern api_config_t ap_config;
+
+/**
+ * 讀取查詢接口配置
+ * @param keyfile 配置文件
+ * @param error 錯誤對象
+ */
+gboolean init_api_config(GKeyFile* keyfile, GError* error);
+
+/**
+ * 釋放查詢接口配置
+ */
+void destroy_api_config();
+
+/**
+ * 發佈首個快照並啟動接口線程，需在啟動探測之後調用
+ * @param base 事件循環
+ * @return 是否成功，未啟用時返回 TRUE
+ */
+gboolean start_api(struct event_base* base);
+
+/**
+ * 停止接口線程並釋放快照
+ */
+void stop_api();
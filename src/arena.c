@@ -0,0 +1,320 @@
+#include "arena.h"
+
+#include <stdalign.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <hiredis/hiredis.h>
+
+// 分配的對齊字節數
+#define ARENA_ALIGN 16
+
+/**
+ * 內存塊
+ */
+typedef struct arena_chunk
+{
+    // 上一個塊
+    struct arena_chunk* next;
+    // 容量
+    gsize size;
+    // 已使用的字節數
+    gsize used;
+    // 數據
+    alignas(ARENA_ALIGN) guint8 data[];
+} arena_chunk;
+
+/**
+ * 線性分配器
+ */
+struct arena
+{
+    // 當前塊，之前的塊通過 next 連接
+    arena_chunk* head;
+    // 新塊的最小容量
+    gsize chunk_size;
+    // 本週期已分配的字節數
+    gsize used;
+    // 重置之間的最高用量
+    gsize high_water;
+    // 追加或合併塊的次數
+    guint64 grows;
+};
+
+/**
+ * 向上取整到對齊字節數
+ * @param size 字節數
+ * @return 對齊後的字節數
+ */
+static gsize align_up(const gsize size)
+{
+    return (size + ARENA_ALIGN - 1) & ~(gsize)(ARENA_ALIGN - 1);
+}
+
+/**
+ * 申請新塊
+ * @param size 容量
+ * @param next 上一個塊
+ * @return 塊
+ */
+static arena_chunk* new_chunk(const gsize size, arena_chunk* next)
+{
+    arena_chunk* chunk = g_malloc(sizeof(arena_chunk) + size);
+    chunk->next = next;
+    chunk->size = size;
+    chunk->used = 0;
+    return chunk;
+}
+
+/**
+ * 釋放塊鏈表
+ * @param chunk 當前塊
+ */
+static void free_chunks(arena_chunk* chunk)
+{
+    while (chunk != nullptr)
+    {
+        arena_chunk* next = chunk->next;
+        g_free(chunk);
+        chunk = next;
+    }
+}
+
+/**
+ * 創建分配器
+ * @param size 首個塊的容量
+ * @return 分配器
+ */
+arena* arena_new(const gsize size)
+{
+    arena* a = g_malloc0(sizeof(arena));
+    a->chunk_size = align_up(MAX(size, ARENA_ALIGN));
+    a->head = new_chunk(a->chunk_size, nullptr);
+    return a;
+}
+
+/**
+ * 釋放分配器與其中的所有對象
+ * @param a 分配器
+ */
+void arena_free(arena* a)
+{
+    if (a == nullptr) return;
+    free_chunks(a->head);
+    g_free(a);
+}
+
+/**
+ * 分配內存，按 16 字節對齊
+ * @param a 分配器
+ * @param size 字節數
+ * @return 內存
+ */
+gpointer arena_alloc(arena* a, const gsize size)
+{
+    const gsize aligned = align_up(MAX(size, 1));
+    if (a->head->size - a->head->used < aligned)
+    {
+        a->head = new_chunk(MAX(a->chunk_size, aligned), a->head);
+        a->grows++;
+    }
+    gpointer memory = a->head->data + a->head->used;
+    a->head->used += aligned;
+    a->used += aligned;
+    if (a->used > a->high_water) a->high_water = a->used;
+    return memory;
+}
+
+/**
+ * 分配並清零內存
+ * @param a 分配器
+ * @param size 字節數
+ * @return 內存
+ */
+gpointer arena_alloc0(arena* a, const gsize size)
+{
+    gpointer memory = arena_alloc(a, size);
+    memset(memory, 0, size);
+    return memory;
+}
+
+/**
+ * 複製字符串的前 n 個字節並補上結尾的 \0
+ * @param a 分配器
+ * @param str 字符串
+ * @param n 字節數
+ * @return 副本
+ */
+gchar* arena_strndup(arena* a, const gchar* str, const gsize n)
+{
+    gchar* copy = arena_alloc(a, n + 1);
+    memcpy(copy, str, n);
+    copy[n] = '\0';
+    return copy;
+}
+
+/**
+ * 格式化字符串，先嘗試寫入當前塊的剩餘空間，放不下時按實際長度分配
+ * @param a 分配器
+ * @param length 輸出的長度，可為空
+ * @param format 格式
+ * @return 字符串
+ */
+gchar* arena_printf(arena* a, gsize* length, const gchar* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    gchar* free_space = (gchar*)a->head->data + a->head->used;
+    const gsize available = a->head->size - a->head->used;
+    const gint needed = vsnprintf(free_space, available, format, args);
+    va_end(args);
+
+    // 放得下時分配到的正是已寫入的剩餘空間；放不下時分配到新塊，重新格式化
+    gchar* str = arena_alloc(a, (gsize)needed + 1);
+    if ((gsize)needed >= available)
+    {
+        va_start(args, format);
+        vsnprintf(str, (gsize)needed + 1, format, args);
+        va_end(args);
+    }
+    if (length != nullptr) *length = (gsize)needed;
+    return str;
+}
+
+/**
+ * 釋放所有對象；使用過多個塊時合併為一個容納最高用量的塊
+ * @param a 分配器
+ */
+void arena_reset(arena* a)
+{
+    if (a->head->next != nullptr)
+    {
+        free_chunks(a->head);
+        a->chunk_size = MAX(a->chunk_size, a->high_water);
+        a->head = new_chunk(a->chunk_size, nullptr);
+        a->grows++;
+    }
+    a->head->used = 0;
+    a->used = 0;
+}
+
+/**
+ * 獲取分配器統計
+ * @param a 分配器
+ * @param stats 輸出的統計
+ */
+void arena_get_stats(const arena* a, arena_stats* stats)
+{
+    stats->reserved = 0;
+    for (const arena_chunk* chunk = a->head; chunk != nullptr; chunk = chunk->next) stats->reserved += chunk->size;
+    stats->high_water = a->high_water;
+    stats->grows = a->grows;
+}
+
+/**
+ * 在分配器中創建響應，並掛到父響應上
+ * @param task 解析任務
+ * @return 響應
+ */
+static redisReply* create_reply(const redisReadTask* task)
+{
+    redisReply* reply = arena_alloc0(task->privdata, sizeof(redisReply));
+    reply->type = task->type;
+    if (task->parent != nullptr)
+    {
+        redisReply* parent = task->parent->obj;
+        parent->element[task->idx] = reply;
+    }
+    return reply;
+}
+
+/**
+ * 創建字符串響應，VERB 類型去掉 "txt:" 前綴並保存到 vtype
+ */
+static void* create_string(const redisReadTask* task, char* str, const size_t len)
+{
+    redisReply* reply = create_reply(task);
+    if (task->type == REDIS_REPLY_VERB)
+    {
+        memcpy(reply->vtype, str, 3);
+        reply->vtype[3] = '\0';
+        reply->str = arena_strndup(task->privdata, str + 4, len - 4);
+        reply->len = len - 4;
+    }
+    else
+    {
+        reply->str = arena_strndup(task->privdata, str, len);
+        reply->len = len;
+    }
+    return reply;
+}
+
+/**
+ * 創建數組、MAP、SET 與 PUSH 響應
+ */
+static void* create_array(const redisReadTask* task, const size_t elements)
+{
+    redisReply* reply = create_reply(task);
+    if (elements > 0) reply->element = arena_alloc0(task->privdata, elements * sizeof(redisReply*));
+    reply->elements = elements;
+    return reply;
+}
+
+/**
+ * 創建整數響應
+ */
+static void* create_integer(const redisReadTask* task, const long long value)
+{
+    redisReply* reply = create_reply(task);
+    reply->integer = value;
+    return reply;
+}
+
+/**
+ * 創建浮點數響應，同時保留原始文本
+ */
+static void* create_double(const redisReadTask* task, const double value, char* str, const size_t len)
+{
+    redisReply* reply = create_reply(task);
+    reply->dval = value;
+    reply->str = arena_strndup(task->privdata, str, len);
+    reply->len = len;
+    return reply;
+}
+
+/**
+ * 創建空響應
+ */
+static void* create_nil(const redisReadTask* task)
+{
+    return create_reply(task);
+}
+
+/**
+ * 創建布爾響應
+ */
+static void* create_bool(const redisReadTask* task, const int value)
+{
+    redisReply* reply = create_reply(task);
+    reply->integer = value != 0;
+    return reply;
+}
+
+/**
+ * 響應隨分配器重置釋放，不逐個釋放
+ */
+static void free_reply(void* reply)
+{
+    (void)reply; // 未使用
+}
+
+// 在分配器中創建 redisReply 的函數表
+redisReplyObjectFunctions arena_reply_functions = {
+    .createString = create_string,
+    .createArray = create_array,
+    .createInteger = create_integer,
+    .createDouble = create_double,
+    .createNil = create_nil,
+    .createBool = create_bool,
+    .freeObject = free_reply,
+};
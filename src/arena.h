@@ -0,0 +1,91 @@
+#pragma once
+#include <glib.h>
+#include <hiredis/read.h>
+
+/**
+ * 線性分配器，存放生命週期相同的臨時對象，整體重置而不逐個釋放
+ *
+ * 分配只移動塊內的偏移；當前塊放不下時追加新塊，重置時若使用過多個塊，
+ * 則合併為一個容納最高用量的塊，穩定後每個週期不再向系統申請內存；
+ * 不是線程安全的，每個分配器只在一個線程中使用
+ */
+typedef struct arena arena;
+
+/**
+ * 分配器統計
+ */
+typedef struct arena_stats
+{
+    // 保留的字節數（所有塊的容量）
+    gsize reserved;
+    // 重置之間的最高用量
+    gsize high_water;
+    // 追加或合併塊的次數
+    guint64 grows;
+} arena_stats;
+
+/**
+ * 創建分配器
+ * @param size 首個塊的容量，之後的塊不小於此值
+ * @return 分配器
+ */
+arena* arena_new(gsize size);
+
+/**
+ * 釋放分配器與其中的所有對象
+ * @param a 分配器，可為空
+ */
+void arena_free(arena* a);
+
+/**
+ * 分配內存，按 16 字節對齊，內容未初始化
+ * @param a 分配器
+ * @param size 字節數
+ * @return 內存，在下一次重置前有效
+ */
+gpointer arena_alloc(arena* a, gsize size);
+
+/**
+ * 分配並清零內存
+ * @param a 分配器
+ * @param size 字節數
+ * @return 內存，在下一次重置前有效
+ */
+gpointer arena_alloc0(arena* a, gsize size);
+
+/**
+ * 複製字符串的前 n 個字節並補上結尾的 \0
+ * @param a 分配器
+ * @param str 字符串，可含 \0
+ * @param n 字節數
+ * @return 副本，在下一次重置前有效
+ */
+gchar* arena_strndup(arena* a, const gchar* str, gsize n);
+
+/**
+ * 格式化字符串
+ * @param a 分配器
+ * @param length 輸出的長度（不含結尾的 \0），可為空
+ * @param format 格式
+ * @return 字符串，在下一次重置前有效
+ */
+gchar* arena_printf(arena* a, gsize* length, const gchar* format, ...) G_GNUC_PRINTF(3, 4);
+
+/**
+ * 釋放所有對象，保留內存供下一個週期使用
+ * @param a 分配器
+ */
+void arena_reset(arena* a);
+
+/**
+ * 獲取分配器統計
+ * @param a 分配器
+ * @param stats 輸出的統計
+ */
+void arena_get_stats(const arena* a, arena_stats* stats);
+
+/**
+ * 在分配器中創建 redisReply 的函數表，reader->privdata 須設為分配器；
+ * 釋放函數不做任何事，響應在分配器重置時一併釋放
+ */
+extern redisReplyObjectFunctions arena_reply_functions;
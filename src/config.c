@@ -0,0 +1,125 @@
+#include "config.h"
+
+/**
+ * 讀取可選的整數配置，缺省時使用默認值
+ * @param keyfile 配置文件
+ * @param group 配置分組
+ * @param key 配置鍵
+ * @param fallback 默認值
+ * @param value 輸出值
+ * @return 配置存在但格式錯誤時返回 FALSE
+ */
+gboolean read_optional_integer(GKeyFile* keyfile, const gchar* group, const gchar* key, const gint64 fallback,
+                               gint64* value)
+{
+    GError* error = nullptr;
+
+    // 未配置時使用默認值
+    if (!g_key_file_has_key(keyfile, group, key, nullptr))
+    {
+        *value = fallback;
+        return TRUE;
+    }
+
+    *value = g_key_file_get_int64(keyfile, group, key, &error);
+    if (error != nullptr)
+    {
+        g_printerr("Error reading %s: %s\n", key, error->message);
+        g_error_free(error);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/**
+ * 讀取可選的浮點數配置，缺省時使用默認值
+ * @param keyfile 配置文件
+ * @param group 配置分組
+ * @param key 配置鍵
+ * @param fallback 默認值
+ * @param value 輸出值
+ * @return 配置存在但格式錯誤時返回 FALSE
+ */
+gboolean read_optional_double(GKeyFile* keyfile, const gchar* group, const gchar* key, const gdouble fallback,
+                              gdouble* value)
+{
+    GError* error = nullptr;
+
+    // 未配置時使用默認值
+    if (!g_key_file_has_key(keyfile, group, key, nullptr))
+    {
+        *value = fallback;
+        return TRUE;
+    }
+
+    *value = g_key_file_get_double(keyfile, group, key, &error);
+    if (error != nullptr)
+    {
+        g_printerr("Error reading %s: %s\n", key, error->message);
+        g_error_free(error);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/**
+ * 讀取可選的布爾配置，缺省時使用默認值
+ * @param keyfile 配置文件
+ * @param group 配置分組
+ * @param key 配置鍵
+ * @param fallback 默認值
+ * @param value 輸出值
+ * @return 配置存在但格式錯誤時返回 FALSE
+ */
+gboolean read_optional_boolean(GKeyFile* keyfile, const gchar* group, const gchar* key, const gboolean fallback,
+                               gboolean* value)
+{
+    GError* error = nullptr;
+
+    // 未配置時使用默認值
+    if (!g_key_file_has_key(keyfile, group, key, nullptr))
+    {
+        *value = fallback;
+        return TRUE;
+    }
+
+    *value = g_key_file_get_boolean(keyfile, group, key, &error);
+    if (error != nullptr)
+    {
+        g_printerr("Error reading %s: %s\n", key, error->message);
+        g_error_free(error);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/**
+ * 讀取可選的字符串配置，缺省時複製默認值
+ * @param keyfile 配置文件
+ * @param group 配置分組
+ * @param key 配置鍵
+ * @param fallback 默認值 (可為空)
+ * @param value 輸出值 (需要手動釋放)
+ * @return 配置存在但格式錯誤時返回 FALSE
+ */
+gboolean read_optional_string(GKeyFile* keyfile, const gchar* group, const gchar* key, const gchar* fallback,
+                              gchar** value)
+{
+    GError* error = nullptr;
+
+    // 未配置時使用默認值
+    if (!g_key_file_has_key(keyfile, group, key, nullptr))
+    {
+        *value = g_strdup(fallback);
+        return TRUE;
+    }
+
+    *value = g_key_file_get_string(keyfile, group, key, &error);
+    if (error != nullptr)
+    {
+        g_printerr("Error reading %s: %s\n", key, error->message);
+        g_error_free(error);
+        return FALSE;
+    }
+    return TRUE;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <glib.h>
+
+/**
+ * 讀取可選的整數配置，缺省時使用默認值
+ * @param keyfile 配置文件
+ * @param group 配置分組
+ * @param key 配置鍵
+ * @param fallback 默認值
+ * @param value 輸出值
+ * @return 配置存在但格式錯誤時返回 FALSE
+ */
+gboolean read_optional_integer(GKeyFile* keyfile, const gchar* group, const gchar* key, gint64 fallback, gint64* value);
+
+/**
+ * 讀取可選的浮點數配置，缺省時使用默認值
+ * @param keyfile 配置文件
+ * @param group 配置分組
+ * @param key 配置鍵
+ * @param fallback 默認值
+ * @param value 輸出值
+ * @return 配置存在但格式錯誤時返回 FALSE
+ */
+gboolean read_optional_double(GKeyFile* keyfile, const gchar* group, const gchar* key, gdouble fallback, gdouble* value);
+
+/**
+ * 讀取可選的布爾配置，缺省時使用默認值
+ * @param keyfile 配置文件
+ * @param group 配置分組
+ * @param key 配置鍵
+ * @param fallback 默認值
+ * @param value 輸出值
+ * @return 配置存在但格式錯誤時返回 FALSE
+ */
+gboolean read_optional_boolean(GKeyFile* keyfile, const gchar* group, const gchar* key, gboolean fallback, gboolean* value);
+
+/**
+ * 讀取可選的字符串配置，缺省時複製默認值
+ * @param keyfile 配置文件
+ * @param group 配置分組
+ * @param key 配置鍵
+ * @param fallback 默認值 (可為空)
+ * @param value 輸出值 (需要手動釋放)
+ * @return 配置存在但格式錯誤時返回 FALSE
+ */
+gboolean read_optional_string(GKeyFile* keyfile, const gchar* group, const gchar* key, const gchar* fallback,
+                              gchar** value);
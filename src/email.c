@@ -2,9 +2,66 @@
 
 #include <curl/curl.h>
 
+#include "config.h"
+
+// 路由分組前綴
+#define ROUTE_GROUP_PREFIX "EmailRoute:"
+
 // email 配置
 email_config_t e_config = nullptr;
 
+/**
+ * 釋放路由
+ * @param data 路由
+ */
+static void free_email_route(gpointer data)
+{
+    email_route* route = data;
+    g_free(route->name);
+    g_strfreev(route->clusters);
+    g_strfreev(route->receivers);
+    g_free(route);
+}
+
+/**
+ * 讀取 [EmailRoute:<name>] 分組
+ * @param keyfile 配置文件
+ * @return 是否成功
+ */
+static gboolean read_email_routes(GKeyFile* keyfile)
+{
+    GError* error = nullptr;
+    gchar** groups = g_key_file_get_groups(keyfile, nullptr);
+    for (gint i = 0; groups[i] != nullptr; ++i)
+    {
+        if (!g_str_has_prefix(groups[i], ROUTE_GROUP_PREFIX)) continue;
+
+        email_route* route = g_malloc0(sizeof(email_route));
+        route->name = g_strdup(groups[i] + strlen(ROUTE_GROUP_PREFIX));
+        g_ptr_array_add(e_config->routes, route);
+
+        route->clusters = g_key_file_get_string_list(keyfile, groups[i], "clusters", nullptr, &error);
+        if (error != nullptr)
+        {
+            g_printerr("Error reading %s clusters: %s\n", groups[i], error->message);
+            goto error;
+        }
+        route->receivers = g_key_file_get_string_list(keyfile, groups[i], "receivers", nullptr, &error);
+        if (error != nullptr)
+        {
+            g_printerr("Error reading %s receivers: %s\n", groups[i], error->message);
+            goto error;
+        }
+    }
+    g_strfreev(groups);
+    return TRUE;
+
+error:
+    g_error_free(error);
+    g_strfreev(groups);
+    return FALSE;
+}
+
 /**
  * 讀取email配置
  * @param keyfile 配置文件
@@ -17,7 +74,8 @@ gboolean init_email_config(GKeyFile* keyfile, GError* error)
     e_config->smtp_url = nullptr;
     e_config->smtp_user = nullptr;
     e_config->smtp_password = nullptr;
-    e_config->receiver = nullptr;
+    e_config->receivers = nullptr;
+    e_config->routes = g_ptr_array_new_with_free_func(free_email_route);
 
     // 讀取 SMTP 伺服器地址
     error = nullptr;
@@ -64,14 +122,20 @@ gboolean init_email_config(GKeyFile* keyfile, GError* error)
         goto error;
     }
 
-    // 讀取 收件人地址
+    // 讀取 默認收件人列表
     error = nullptr;
-    e_config->receiver = g_key_file_get_string(keyfile, "Email", "receiver", &error);
+    e_config->receivers = g_key_file_get_string_list(keyfile, "Email", "receiver", nullptr, &error);
     if (error != nullptr)
     {
         g_printerr("Error reading receiver: %s\n", error->message);
         goto error;
     }
+
+    // 讀取 SMTP 連接閒置上限
+    if (!read_optional_integer(keyfile, "Email", "idle_timeout", 60, &e_config->idle_timeout_seconds)) goto error;
+
+    // 讀取 收件人路由
+    if (!read_email_routes(keyfile)) goto error;
     return TRUE;
 error:
     // 釋放配置
@@ -88,14 +152,87 @@ void destroy_email_config()
     // 釋放配置結構體
     if (e_config)
     {
+        if (e_config->smtp_url) g_free(e_config->smtp_url);
         if (e_config->smtp_user) g_free(e_config->smtp_user);
         if (e_config->smtp_password) g_free(e_config->smtp_password);
         if (e_config->sender) g_free(e_config->sender);
-        if (e_config->receiver) g_free(e_config->receiver);
+        if (e_config->receivers) g_strfreev(e_config->receivers);
+        if (e_config->routes) g_ptr_array_free(e_config->routes, TRUE);
         g_free(e_config);
+        e_config = nullptr;
     }
 }
 
+/**
+ * 根據告警涉及的集群解析收件人，去除重複地址
+ *
+ * 沒有路由匹配的集群發送給默認收件人
+ * @param routes 涉及的集群（分號分隔），為空時使用默認收件人
+ * @return 收件人列表 (需要用 curl_slist_free_all 釋放)
+ */
+static struct curl_slist* resolve_recipients(const gchar* routes)
+{
+    struct curl_slist* recipients = nullptr;
+    GHashTable* seen = g_hash_table_new(g_str_hash, g_str_equal);
+    gboolean use_default = routes == nullptr || *routes == '\0';
+
+    gchar** clusters = use_default ? nullptr : g_strsplit(routes, ";", -1);
+    for (gint i = 0; clusters != nullptr && clusters[i] != nullptr; ++i)
+    {
+        gboolean matched = FALSE;
+        for (guint r = 0; r < e_config->routes->len; ++r)
+        {
+            const email_route* route = g_ptr_array_index(e_config->routes, r);
+            if (!g_strv_contains((const gchar* const*)route->clusters, clusters[i])) continue;
+            matched = TRUE;
+            for (gint k = 0; route->receivers[k] != nullptr; ++k)
+            {
+                if (!g_hash_table_add(seen, route->receivers[k])) continue;
+                recipients = curl_slist_append(recipients, route->receivers[k]);
+            }
+        }
+        if (!matched) use_default = TRUE;
+    }
+
+    if (use_default)
+    {
+        for (gint k = 0; e_config->receivers[k] != nullptr; ++k)
+        {
+            if (!g_hash_table_add(seen, e_config->receivers[k])) continue;
+            recipients = curl_slist_append(recipients, e_config->receivers[k]);
+        }
+    }
+
+    g_strfreev(clusters);
+    g_hash_table_destroy(seen);
+    return recipients;
+}
+
+/**
+ * 郵件發送狀態
+ */
+typedef struct email_payload
+{
+    // 郵件內容
+    GString* payload;
+    // 已傳送的長度
+    gsize offset;
+    // 收件人列表
+    struct curl_slist* recipients;
+} email_payload;
+
+/**
+ * 釋放郵件發送狀態
+ * @param data 郵件發送狀態
+ */
+static void free_email_payload(gpointer data)
+{
+    email_payload* state = data;
+    g_string_free(state->payload, TRUE);
+    curl_slist_free_all(state->recipients);
+    g_free(state);
+}
+
 /**
  * 傳送內容的資料來源
  * @param ptr 資料指針
@@ -106,77 +243,106 @@ void destroy_email_config()
  */
 static size_t payload_source(char* ptr, size_t size, size_t nmemb, void* userp)
 {
-    // 需要發送的内容指針
-    const auto payload_text = (const char**)userp;
-    // 如果有内容
-    if (*payload_text)
+    // 需要發送的内容
+    const auto state = (email_payload*)userp;
+    // 剩餘未發送的長度，每次最多傳送緩衝區大小
+    const size_t remaining = state->payload->len - state->offset;
+    const size_t len = MIN(remaining, size * nmemb);
+    if (len == 0)
     {
-        // 複製内容到指針
-        const size_t len = strlen(*payload_text);
-        memcpy(ptr, *payload_text, len);
-        *payload_text = nullptr; // 傳完一次就結束
-        return len;
+        return 0; // 結束傳送
     }
-    return 0; // 結束傳送
+    memcpy(ptr, state->payload->str + state->offset, len);
+    state->offset += len;
+    return len;
 }
 
 
 /**
- * 發送電子郵件通知
+ * 建構電子郵件發送請求，由通知工作線程執行
+ * @param request 請求對象
+ * @param message 通知內容
+ * @param config 未使用
+ * @return 是否成功
  */
-void send_email_notification()
+static gboolean prepare_email_request(notify_request* request, const notify_message* message, gpointer config)
 {
-    CURLcode res = CURLE_OK;
-    GString* payload = g_string_new(nullptr);
+    (void)config; // 使用全局郵件配置
 
-    g_string_append_printf(payload, "To: %s\r\n", e_config->receiver);
-    g_string_append_printf(payload, "From: %s\r\n", e_config->sender);
-    g_string_append(payload, "Subject: Redis 錯誤通知\r\n");
-    g_string_append(payload, "\r\n"); // 分隔 header 與 body
-    g_string_append(payload, "Redis 的連接發生了問題，請檢查！\r\n");
+    const gchar* subject = message->subject;
+    const gchar* body = message->body;
+    struct curl_slist* recipients = resolve_recipients(message->routes);
+    if (recipients == nullptr)
+    {
+        g_printerr("No email recipients configured\n");
+        return FALSE;
+    }
 
-    const char* payload_text = payload->str;
+    const auto curl = acquire_curl_handle();
+    if (curl == nullptr)
+    {
+        g_printerr("Failed to initialize CURL\n");
+        curl_slist_free_all(recipients);
+        return FALSE;
+    }
 
+    email_payload* state = g_malloc0(sizeof(email_payload));
+    state->payload = g_string_new(nullptr);
+    state->recipients = recipients;
 
-    const auto curl = curl_easy_init();
-    if (curl)
+    // 所有收件人寫在同一個 To 頭中
+    g_string_append(state->payload, "To: ");
+    for (const struct curl_slist* it = recipients; it != nullptr; it = it->next)
     {
-        struct curl_slist* recipients = nullptr;
-        // SMTP 伺服器（587 是 TLS 明文起始的 port）
-        curl_easy_setopt(curl, CURLOPT_URL, e_config->smtp_url);
+        g_string_append_printf(state->payload, "%s%s", it == recipients ? "" : ", ", it->data);
+    }
+    g_string_append(state->payload, "\r\n");
+    g_string_append_printf(state->payload, "From: %s\r\n", e_config->sender);
+    g_string_append_printf(state->payload, "Subject: %s\r\n", subject);
+    g_string_append(state->payload, "\r\n"); // 分隔 header 與 body
+    g_string_append(state->payload, body);
+    g_string_append(state->payload, "\r\n");
+
+    // SMTP 伺服器（587 是 TLS 明文起始的 port）
+    curl_easy_setopt(curl, CURLOPT_URL, e_config->smtp_url);
 
-        // Gmail 要求 STARTTLS
-        if (e_config->smtp_tls)
+    // Gmail 要求 STARTTLS
+    if (e_config->smtp_tls)
         curl_easy_setopt(curl, CURLOPT_USE_SSL, (long)CURLUSESSL_ALL);
 
-        // 登入帳號與密碼（最好用 App Password）
-        curl_easy_setopt(curl, CURLOPT_LOGIN_OPTIONS, "AUTH=LOGIN");
-        curl_easy_setopt(curl, CURLOPT_USERNAME, e_config->smtp_user);
-        curl_easy_setopt(curl, CURLOPT_PASSWORD, e_config->smtp_password);
+    // 登入帳號與密碼（最好用 App Password）
+    curl_easy_setopt(curl, CURLOPT_LOGIN_OPTIONS, "AUTH=LOGIN");
+    curl_easy_setopt(curl, CURLOPT_USERNAME, e_config->smtp_user);
+    curl_easy_setopt(curl, CURLOPT_PASSWORD, e_config->smtp_password);
 
-        // 寄件人
-        curl_easy_setopt(curl, CURLOPT_MAIL_FROM, e_config->sender);
+    // 寄件人
+    curl_easy_setopt(curl, CURLOPT_MAIL_FROM, e_config->sender);
 
-        // 收件人
-        recipients = curl_slist_append(recipients, e_config->receiver);
-        curl_easy_setopt(curl, CURLOPT_MAIL_RCPT, recipients);
+    // 收件人，所有收件人在同一次 MAIL 事務中發送
+    curl_easy_setopt(curl, CURLOPT_MAIL_RCPT, state->recipients);
+#if LIBCURL_VERSION_NUM >= 0x080200
+    // 個別收件人被拒絕時仍投遞給其他收件人
+    curl_easy_setopt(curl, CURLOPT_MAIL_RCPT_ALLOWFAILS, 1L);
+#endif
 
-        // 傳送內容的資料來源
-        curl_easy_setopt(curl, CURLOPT_READFUNCTION, payload_source);
-        curl_easy_setopt(curl, CURLOPT_READDATA, &payload_text);
-        curl_easy_setopt(curl, CURLOPT_UPLOAD, 1L);
-        // curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);
+    // 連接復用：保持連接並限制閒置時間
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(curl, CURLOPT_MAXAGE_CONN, (long)e_config->idle_timeout_seconds);
 
-        // 執行發送
-        res = curl_easy_perform(curl);
-        if (res != CURLE_OK)
-            g_printerr("curl_easy_perform() failed: %s\n", curl_easy_strerror(res));
-        else
-            printf("Email sent successfully!\n");
+    // 傳送內容的資料來源
+    curl_easy_setopt(curl, CURLOPT_READFUNCTION, payload_source);
+    curl_easy_setopt(curl, CURLOPT_READDATA, state);
+    curl_easy_setopt(curl, CURLOPT_UPLOAD, 1L);
+    // curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);
 
-        // 清理
-        curl_slist_free_all(recipients);
-        curl_easy_cleanup(curl);
-        g_string_free(payload, TRUE);
-    }
+    request->curl = curl;
+    request->data = state;
+    request->free_data = free_email_payload;
+    return TRUE;
 }
+
+// 電子郵件通知後端
+const notify_backend email_backend = {
+    .kind = "email",
+    .prepare = prepare_email_request,
+};
@@ -1,6 +1,8 @@
 #pragma once
 #include <glib.h>
 
+#include "notifier.h"
+
 /**
  * 郵件配置
  *
@@ -10,7 +12,12 @@
  *  - smtp_user SMTP 用戶名
  *  - smtp_password SMTP 密碼
  *  - sender 寄件人地址
- *  - receiver 收件人地址
+ *  - receiver 默認收件人列表（分號分隔）
+ *  - idle_timeout SMTP 連接的最長閒置秒數，超過後重新建立連接
+ *
+ * 路由（[EmailRoute:<name>] 分組）:
+ *  - clusters 匹配的集群列表
+ *  - receivers 收件人列表
  */
 typedef struct email_config
 {
@@ -19,9 +26,25 @@ typedef struct email_config
     gchar* smtp_user;
     gchar* smtp_password;
     gchar* sender;
-    gchar* receiver;
+    gchar** receivers;
+    gint64 idle_timeout_seconds;
+    // 收件人路由 (email_route*)
+    GPtrArray* routes;
 } email_config;
 
+/**
+ * 收件人路由，告警涉及的集群匹配時使用該路由的收件人
+ */
+typedef struct email_route
+{
+    // 路由名稱
+    gchar* name;
+    // 匹配的集群
+    gchar** clusters;
+    // 收件人
+    gchar** receivers;
+} email_route;
+
 typedef email_config* email_config_t;
 
 extern email_config_t e_config;
@@ -39,6 +62,6 @@ gboolean init_email_config(GKeyFile* keyfile, GError* error);
 void destroy_email_config();
 
 /**
- * 發送電子郵件通知
+ * 電子郵件通知後端，按通知涉及的集群選擇收件人，SMTP 連接與 TLS 會話在多封郵件之間復用
  */
-void send_email_notification();
+extern const notify_backend email_backend;
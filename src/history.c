@@ -0,0 +1,467 @@
+#include "history.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "config.h"
+
+// 歷史配置
+history_config_t h_config = nullptr;
+
+// 文件頭大小
+#define HISTORY_HEADER_SIZE 4096
+// 頁大小，記錄區按此對齊
+#define HISTORY_PAGE_SIZE 4096
+
+G_STATIC_ASSERT(sizeof(history_header) <= HISTORY_HEADER_SIZE);
+G_STATIC_ASSERT(sizeof(history_slot) == 128);
+G_STATIC_ASSERT(sizeof(history_record) == 64);
+
+// 映射地址
+static guint8* map = nullptr;
+// 映射大小
+static gsize map_size = 0;
+// 文件頭
+static history_header* header = nullptr;
+// 槽位
+static history_slot* slots = nullptr;
+// 目標名稱到槽位序號的緩存，僅在匯總線程中修改 (gchar* -> index + 1)
+static GHashTable* slot_index = nullptr;
+// 保護 slot_index，供其他線程查詢
+static GRWLock index_lock;
+// 各槽位是否屬於打開時配置中的目標或本次運行中寫入過，僅在匯總線程中使用
+static gboolean* slot_live = nullptr;
+
+/**
+ * 讀取歷史配置
+ * @param keyfile 配置文件
+ * @param error 錯誤對象
+ */
+gboolean init_history_config(GKeyFile* keyfile, GError* error)
+{
+    (void)error; // 可選配置由 read_optional_* 自行處理錯誤
+
+    // 創建歷史配置對象
+    h_config = g_malloc0(sizeof(history_config));
+
+    // 讀取歷史文件路徑
+    if (!read_optional_string(keyfile, "History", "path", nullptr, &h_config->path)) goto error;
+
+    // 讀取每個目標保留的記錄數
+    if (!read_optional_integer(keyfile, "History", "records_per_target", 1024, &h_config->records_per_target))
+        goto error;
+    if (h_config->records_per_target < 16 || h_config->records_per_target > 1 << 24)
+    {
+        g_printerr("Error reading records_per_target: must be between 16 and 16777216\n");
+        goto error;
+    }
+
+    // 讀取可容納的目標數
+    if (!read_optional_integer(keyfile, "History", "max_targets", 256, &h_config->max_targets)) goto error;
+    if (h_config->max_targets < 1 || h_config->max_targets > 1 << 20)
+    {
+        g_printerr("Error reading max_targets: must be between 1 and 1048576\n");
+        goto error;
+    }
+    return TRUE;
+
+error:
+    // 釋放配置
+    destroy_history_config();
+    return FALSE;
+}
+
+/**
+ * 釋放歷史配置
+ */
+void destroy_history_config()
+{
+    if (h_config == nullptr) return;
+    g_free(h_config->path);
+    g_free(h_config);
+    h_config = nullptr;
+}
+
+/**
+ * 記錄區的偏移
+ * @return 偏移
+ */
+static gsize data_offset()
+{
+    const gsize end = HISTORY_HEADER_SIZE + (gsize)h_config->max_targets * sizeof(history_slot);
+    return (end + HISTORY_PAGE_SIZE - 1) & ~(gsize)(HISTORY_PAGE_SIZE - 1);
+}
+
+/**
+ * 槽位的第一條記錄
+ * @param index 槽位序號
+ * @return 記錄
+ */
+static history_record* slot_records(const gsize index)
+{
+    return (history_record*)(map + header->data_offset) + index * header->records_per_target;
+}
+
+/**
+ * 判斷已有文件的佈局是否與配置一致
+ * @param existing 已有文件的文件頭
+ * @param size 文件大小
+ * @return 是否一致
+ */
+static gboolean layout_matches(const history_header* existing, const gsize size)
+{
+    return existing->magic == HISTORY_MAGIC && existing->version == HISTORY_VERSION &&
+        existing->record_size == sizeof(history_record) && existing->max_targets == (guint32)h_config->max_targets
+        && existing->records_per_target == (guint32)h_config->records_per_target &&
+        existing->data_offset == data_offset() && size == map_size;
+}
+
+/**
+ * 打開並映射歷史文件，佈局與配置不符時重建，需在讀取探測目標之後調用
+ * @return 是否成功，未啟用時返回 TRUE
+ */
+gboolean open_history()
+{
+    if (h_config->path == nullptr || *h_config->path == '\0') return TRUE;
+
+    map_size = data_offset() + (gsize)h_config->max_targets * h_config->records_per_target * sizeof(history_record);
+
+    const gint fd = open(h_config->path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        g_printerr("Cannot open history file %s: %s\n", h_config->path, g_strerror(errno));
+        return FALSE;
+    }
+
+    // 檢查已有文件，佈局不同時清空重建
+    struct stat st;
+    history_header existing = {0};
+    gboolean reuse = fstat(fd, &st) == 0 && pread(fd, &existing, sizeof(existing), 0) == sizeof(existing) &&
+        layout_matches(&existing, (gsize)st.st_size);
+    if (!reuse)
+    {
+        if (st.st_size > 0) g_print("History file %s has a different layout, recreating it\n", h_config->path);
+        if (ftruncate(fd, 0) != 0 || ftruncate(fd, (off_t)map_size) != 0)
+        {
+            g_printerr("Cannot allocate history file %s: %s\n", h_config->path, g_strerror(errno));
+            close(fd);
+            return FALSE;
+        }
+    }
+
+    map = mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    // 映射後不再需要文件描述符
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        g_printerr("Cannot map history file %s: %s\n", h_config->path, g_strerror(errno));
+        map = nullptr;
+        return FALSE;
+    }
+
+    header = (history_header*)map;
+    slots = (history_slot*)(map + HISTORY_HEADER_SIZE);
+    if (!reuse)
+    {
+        header->version = HISTORY_VERSION;
+        header->record_size = sizeof(history_record);
+        header->max_targets = (guint32)h_config->max_targets;
+        header->records_per_target = (guint32)h_config->records_per_target;
+        header->data_offset = data_offset();
+        // 魔數最後寫入，中途退出的文件下次會被重建
+        atomic_thread_fence(memory_order_release);
+        header->magic = HISTORY_MAGIC;
+    }
+
+    // 載入已有的槽位
+    slot_index = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, nullptr);
+    slot_live = g_new0(gboolean, header->max_targets);
+    guint used = 0;
+    for (gsize i = 0; i < header->max_targets; ++i)
+    {
+        if (slots[i].name[0] == '\0') continue;
+        slots[i].name[HISTORY_NAME_MAX - 1] = '\0';
+        g_hash_table_insert(slot_index, g_strdup(slots[i].name), GSIZE_TO_POINTER(i + 1));
+        used++;
+    }
+
+    // 配置中的目標即使尚未探測也保留槽位，之後移除時由 history_forget 釋放
+    for (guint i = 0; targets != nullptr && i < targets->len; ++i)
+    {
+        const target* t = g_ptr_array_index(targets, i);
+        const gsize found = GPOINTER_TO_SIZE(g_hash_table_lookup(slot_index, t->config->name));
+        if (found > 0) slot_live[found - 1] = TRUE;
+    }
+
+    g_print("History file %s mapped (%lu bytes, %u target(s) with history).\n", h_config->path, (gulong)map_size,
+            used);
+    return TRUE;
+}
+
+/**
+ * 解除映射並關閉歷史文件
+ */
+void close_history()
+{
+    if (map == nullptr) return;
+
+    // 異步寫回，不阻塞退出
+    msync(map, map_size, MS_ASYNC);
+    munmap(map, map_size);
+    map = nullptr;
+    header = nullptr;
+    slots = nullptr;
+    g_rw_lock_writer_lock(&index_lock);
+    g_hash_table_destroy(slot_index);
+    slot_index = nullptr;
+    g_rw_lock_writer_unlock(&index_lock);
+    g_free(slot_live);
+    slot_live = nullptr;
+}
+
+/**
+ * 判斷緩存項是否為未分配槽位的目標
+ * @param key 未使用
+ * @param value 槽位序號加一
+ * @param user_data 未使用
+ * @return 是否未分配
+ */
+static gboolean slot_unassigned(gpointer key, gpointer value, gpointer user_data)
+{
+    (void)key; // 未使用
+    (void)user_data; // 未使用
+    return value == nullptr;
+}
+
+/**
+ * 釋放槽位，之前因槽位已滿而未記錄的目標在下次寫入時重新分配
+ * @param index 槽位序號
+ */
+static void free_slot(const gsize index)
+{
+    g_rw_lock_writer_lock(&index_lock);
+    g_hash_table_remove(slot_index, slots[index].name);
+    g_hash_table_foreach_remove(slot_index, slot_unassigned, nullptr);
+    slots[index].name[0] = '\0';
+    g_rw_lock_writer_unlock(&index_lock);
+    slot_live[index] = FALSE;
+}
+
+/**
+ * 槽位最後一條記錄的時間，沒有記錄時為分配時間
+ * @param index 槽位序號
+ * @return 時間（UNIX 微秒）
+ */
+static gint64 slot_last_write(const gsize index)
+{
+    const guint64 written = atomic_load_explicit(&slots[index].written, memory_order_relaxed);
+    if (written == 0) return slots[index].created_at;
+    return slot_records(index)[(written - 1) % header->records_per_target].timestamp;
+}
+
+/**
+ * 查找可復用的槽位：打開時已不在配置中、本次運行中也未寫入過的目標中最後寫入最早的槽位
+ * @return 槽位序號，沒有時返回 -1
+ */
+static gssize find_stale_slot()
+{
+    gssize stale = -1;
+    for (gsize i = 0; i < header->max_targets; ++i)
+    {
+        if (slot_live[i]) continue;
+        if (stale < 0 || slot_last_write(i) < slot_last_write((gsize)stale)) stale = (gssize)i;
+    }
+    return stale;
+}
+
+/**
+ * 查找或分配目標的槽位
+ * @param name 目標名稱
+ * @return 槽位序號，槽位已滿時返回 -1
+ */
+static gssize find_slot(const gchar* name)
+{
+    const gsize found = GPOINTER_TO_SIZE(g_hash_table_lookup(slot_index, name));
+    if (found > 0) return (gssize)found - 1;
+
+    // 名稱過長時無法在重啟後找回槽位，不記錄
+    if (strlen(name) >= HISTORY_NAME_MAX)
+    {
+        g_printerr("Target name %s is longer than %d bytes, history is not recorded\n", name, HISTORY_NAME_MAX - 1);
+        goto skip;
+    }
+
+    // 沒有空槽位時復用已不在配置中的目標的槽位
+    gssize free_index = -1;
+    for (gsize i = 0; i < header->max_targets && free_index < 0; ++i)
+    {
+        if (slots[i].name[0] == '\0') free_index = (gssize)i;
+    }
+    if (free_index < 0 && (free_index = find_stale_slot()) >= 0)
+    {
+        g_print("History file is full, reusing the slot of %s for %s\n", slots[free_index].name, name);
+        free_slot((gsize)free_index);
+    }
+
+    if (free_index >= 0)
+    {
+        const gsize i = (gsize)free_index;
+
+        // 先清空記錄再發佈名稱
+        memset(slot_records(i), 0, header->records_per_target * sizeof(history_record));
+        atomic_store_explicit(&slots[i].written, 0, memory_order_relaxed);
+        slots[i].created_at = g_get_real_time();
+        g_strlcpy(slots[i].name, name, HISTORY_NAME_MAX);
+        slot_live[i] = TRUE;
+
+        g_rw_lock_writer_lock(&index_lock);
+        g_hash_table_insert(slot_index, g_strdup(name), GSIZE_TO_POINTER(i + 1));
+        g_rw_lock_writer_unlock(&index_lock);
+        return (gssize)i;
+    }
+
+    g_printerr("History file is full (%u targets), %s is not recorded\n", header->max_targets, name);
+
+skip:
+    // 記為 0，每個目標只提示一次
+    g_rw_lock_writer_lock(&index_lock);
+    g_hash_table_insert(slot_index, g_strdup(name), GSIZE_TO_POINTER(0));
+    g_rw_lock_writer_unlock(&index_lock);
+    return -1;
+}
+
+/**
+ * 將耗時限制在 gint32 範圍內
+ * @param us 耗時（微秒）
+ * @return 耗時
+ */
+static gint32 clamp32(const gint64 us)
+{
+    return (gint32)CLAMP(us, G_MININT32, G_MAXINT32);
+}
+
+/**
+ * 寫入一條探測結果，僅在匯總線程中調用，不加鎖
+ * @param name 目標名稱
+ * @param result 探測結果
+ */
+void history_append(const gchar* name, const probe_result* result)
+{
+    if (map == nullptr) return;
+
+    // 槽位已滿的目標也記在緩存中，值為 0
+    gpointer cached = nullptr;
+    if (g_hash_table_lookup_extended(slot_index, name, nullptr, &cached) && cached == nullptr) return;
+    const gssize index = find_slot(name);
+    if (index < 0) return;
+    slot_live[index] = TRUE;
+
+    history_slot* slot = &slots[index];
+    const guint64 n = atomic_load_explicit(&slot->written, memory_order_relaxed);
+    history_record* record = slot_records(index) + n % header->records_per_target;
+
+    // 序號變為奇數，讀者會跳過正在寫入的記錄
+    const guint32 seq = atomic_load_explicit(&record->seq, memory_order_relaxed);
+    atomic_store_explicit(&record->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    record->outcome = (guint16)result->outcome;
+    record->flags = 0;
+    record->timestamp = result->timestamp;
+    record->connect_us = clamp32(result->connect_us);
+    record->auth_us = clamp32(result->auth_us);
+    record->ping_us = clamp32(result->ping_us);
+    record->info_us = clamp32(result->info_us);
+    record->total_us = clamp32(result->total_us);
+    record->connected_clients = clamp32(result->info.connected_clients);
+    record->blocked_clients = clamp32(result->info.blocked_clients);
+    record->ops_per_sec = clamp32(result->info.ops_per_sec);
+    record->used_memory = result->info.used_memory;
+    record->uptime_seconds = result->info.uptime_seconds;
+
+    // 序號變回偶數後再發佈記錄數
+    atomic_store_explicit(&record->seq, seq + 2, memory_order_release);
+    atomic_store_explicit(&slot->written, n + 1, memory_order_release);
+}
+
+/**
+ * 釋放已移除目標的槽位與記錄，僅在匯總線程中調用
+ * @param name 目標名稱
+ */
+void history_forget(const gchar* name)
+{
+    if (map == nullptr) return;
+
+    gpointer cached = nullptr;
+    if (!g_hash_table_lookup_extended(slot_index, name, nullptr, &cached)) return;
+    if (cached == nullptr)
+    {
+        // 未分配槽位的目標只需移除緩存
+        g_rw_lock_writer_lock(&index_lock);
+        g_hash_table_remove(slot_index, name);
+        g_rw_lock_writer_unlock(&index_lock);
+        return;
+    }
+    free_slot(GPOINTER_TO_SIZE(cached) - 1);
+}
+
+/**
+ * 以序號鎖讀取一條記錄
+ * @param record 記錄
+ * @param copy 輸出的副本
+ * @return 記錄是否一致
+ */
+static gboolean read_record(const history_record* record, history_record* copy)
+{
+    for (gint attempt = 0; attempt < 4; ++attempt)
+    {
+        const guint32 before = atomic_load_explicit(&record->seq, memory_order_acquire);
+        if (before & 1) continue;
+        memcpy(copy, (const void*)record, sizeof(history_record));
+        atomic_thread_fence(memory_order_acquire);
+        const guint32 after = atomic_load_explicit(&record->seq, memory_order_relaxed);
+        if (before == after) return TRUE;
+    }
+    return FALSE;
+}
+
+/**
+ * 讀取目標在某時間之後的記錄，可在任意線程中調用
+ * @param name 目標名稱
+ * @param since 起始時間（UNIX 微秒）
+ * @param visit 回調
+ * @param user_data 用戶數據
+ * @return 讀取的記錄數
+ */
+guint history_query(const gchar* name, const gint64 since, const history_visit_fn visit, const gpointer user_data)
+{
+    g_rw_lock_reader_lock(&index_lock);
+    const gsize found = slot_index != nullptr ? GPOINTER_TO_SIZE(g_hash_table_lookup(slot_index, name)) : 0;
+    if (found == 0)
+    {
+        g_rw_lock_reader_unlock(&index_lock);
+        return 0;
+    }
+
+    const history_slot* slot = &slots[found - 1];
+    const history_record* records = slot_records(found - 1);
+    const guint64 capacity = header->records_per_target;
+    const guint64 written = atomic_load_explicit(&slot->written, memory_order_acquire);
+    const guint64 first = written > capacity ? written - capacity : 0;
+
+    guint visited = 0;
+    for (guint64 n = first; n < written; ++n)
+    {
+        history_record copy;
+        // 讀取期間被覆蓋的舊記錄時間會晚於後續記錄，以時間過濾
+        if (!read_record(&records[n % capacity], &copy) || copy.timestamp < since) continue;
+        visited++;
+        if (!visit(&copy, user_data)) break;
+    }
+    g_rw_lock_reader_unlock(&index_lock);
+    return visited;
+}
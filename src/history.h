@@ -0,0 +1,157 @@
+#pragma once
+#include <glib.h>
+#include <stdatomic.h>
+
+#include "target.h"
+
+/**
+ * 探測歷史配置
+ *
+ * 配置:
+ *  - path 歷史文件路徑，為空時不記錄
+ *  - records_per_target 每個目標保留的記錄數，寫滿後覆蓋最舊的記錄
+ *  - max_targets 文件可容納的目標數，移除的目標釋放槽位；已滿時復用已不在配置中的目標的槽位，最舊的優先
+ *
+ * 文件大小固定為 4KiB + max_targets * 128 (按 4KiB 對齊) + max_targets * records_per_target * 64 字節
+ */
+typedef struct history_config
+{
+    // 歷史文件路徑
+    gchar* path;
+    // 每個目標保留的記錄數
+    gint64 records_per_target;
+    // 可容納的目標數
+    gint64 max_targets;
+} history_config;
+
+typedef history_config* history_config_t;
+
+extern history_config_t h_config;
+
+// 文件魔數 "RWHIST01"
+#define HISTORY_MAGIC 0x3130545349485752ULL
+// 文件格式版本
+#define HISTORY_VERSION 1
+// 目標名稱的最大長度（含結尾的 0）
+#define HISTORY_NAME_MAX 96
+
+/**
+ * 文件頭，位於文件開頭，佔 4KiB；所有整數為本機字節序
+ */
+typedef struct history_header
+{
+    // 魔數
+    guint64 magic;
+    // 格式版本
+    guint32 version;
+    // 記錄大小
+    guint32 record_size;
+    // 目標槽位數
+    guint32 max_targets;
+    // 每個目標的記錄數
+    guint32 records_per_target;
+    // 記錄區的偏移
+    guint64 data_offset;
+} history_header;
+
+/**
+ * 目標槽位，緊接文件頭；name 為空表示未使用
+ *
+ * 目標 i 的記錄位於 data_offset + i * records_per_target * 64，
+ * 第 n 條記錄（從 0 開始計數）存放在 n % records_per_target
+ */
+typedef struct history_slot
+{
+    // 目標名稱
+    gchar name[HISTORY_NAME_MAX];
+    // 已寫入的記錄總數，寫入者以 release 語義更新
+    _Atomic guint64 written;
+    // 槽位分配時間（UNIX 微秒）
+    gint64 created_at;
+    // 保留
+    guint8 reserved[16];
+} history_slot;
+
+/**
+ * 探測記錄，固定 64 字節
+ *
+ * 單一寫入者以序號鎖保護：寫入前 seq 加一（奇數），寫完再加一（偶數）；
+ * 讀者在複製前後讀取 seq，兩次相等且為偶數時記錄有效，否則重讀或跳過
+ */
+typedef struct history_record
+{
+    // 序號
+    _Atomic guint32 seq;
+    // 探測結果 (probe_outcome)
+    guint16 outcome;
+    // 保留
+    guint16 flags;
+    // 探測時間（UNIX 微秒）
+    gint64 timestamp;
+    // 各階段耗時（微秒），未執行時為 -1
+    gint32 connect_us;
+    gint32 auth_us;
+    gint32 ping_us;
+    gint32 info_us;
+    gint32 total_us;
+    // INFO 指標，未取得時為 -1
+    gint32 connected_clients;
+    gint32 blocked_clients;
+    gint32 ops_per_sec;
+    gint64 used_memory;
+    gint64 uptime_seconds;
+} history_record;
+
+/**
+ * 讀取歷史記錄的回調，記錄按時間從舊到新
+ * @param record 記錄副本
+ * @param user_data 用戶數據
+ * @return 返回 FALSE 停止讀取
+ */
+typedef gboolean (*history_visit_fn)(const history_record* record, gpointer user_data);
+
+/**
+ * 讀取歷史配置
+ * @param keyfile 配置文件
+ * @param error 錯誤對象
+ */
+gboolean init_history_config(GKeyFile* keyfile, GError* error);
+
+/**
+ * 釋放歷史配置
+ */
+void destroy_history_config();
+
+/**
+ * 打開並映射歷史文件，佈局與配置不符時重建，需在讀取探測目標之後調用
+ * @return 是否成功，未啟用時返回 TRUE
+ */
+gboolean open_history();
+
+/**
+ * 解除映射並關閉歷史文件
+ */
+void close_history();
+
+/**
+ * 寫入一條探測結果，僅在匯總線程中調用，不加鎖
+ * @param name 目標名稱
+ * @param result 探測結果
+ */
+void history_append(const gchar* name, const probe_result* result);
+
+/**
+ * 釋放已移除目標的槽位與記錄，僅在匯總線程中調用
+ * @param name 目標名稱
+ */
+void history_forget(const gchar* name);
+
+/**
+ * 讀取目標在某時間之後的記錄，可在任意線程中調用
+ * @param name 目標名稱
+ * @param since 起始時間（UNIX 微秒）
+ * @param visit 回調
+ * @param user_data 用戶數據
+ * @return 讀取的記錄數
+ */
+guint history_query(const gchar* name, gint64 since, history_visit_fn visit, gpointer user_data);
@@ -0,0 +1,1002 @@
+#include "logger.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <event2/event.h>
+
+#include "config.h"
+
+// 日誌配置
+log_config_t lg_config = nullptr;
+
+// 生產者線程數上限，線程退出後緩衝區可由新線程復用
+#define LOG_MAX_RINGS 64
+// 字符串值的最大字節數，超出時截斷
+#define LOG_STRING_MAX 1024
+// 字段名的最大字節數
+#define LOG_KEY_MAX 64
+// 每條記錄的最大字段數
+#define LOG_FIELDS_MAX 16
+// 記錄頭部字節數
+#define LOG_HEADER_SIZE 16
+// 目標名稱缺省時的長度標記
+#define LOG_NO_TARGET 0xFFFF
+// 填充記錄的級別，只出現在緩衝區中，不會寫出
+#define LOG_PAD 0xFF
+
+/**
+ * 記錄格式（本機字節序，緩衝區與二進制文件相同）:
+ *  - u32 記錄字節數，含頭部與對齊到 8 字節的填充
+ *  - u8 級別，u8 字段數，u16 保留
+ *  - i64 時間（UNIX 微秒）
+ *  - 目標名稱與事件名稱：u16 長度加字節，目標缺省時長度為 0xFFFF
+ *  - 每個字段：u8 類型，u8 字段名長度加字節，值為 i64、f64 或 u16 長度加字節
+ */
+typedef struct log_header
+{
+    guint32 size;
+    guint8 level;
+    guint8 n_fields;
+    guint16 reserved;
+    gint64 timestamp;
+} log_header;
+
+G_STATIC_ASSERT(sizeof(log_header) == LOG_HEADER_SIZE);
+
+/**
+ * 單生產者單消費者的字節環形緩衝區
+ *
+ * 記錄不跨越緩衝區末尾，放不下時先寫一條填充記錄佔滿剩餘部分再從頭寫；
+ * 生產者只寫 tail，日誌線程只寫 head，兩者與統計各佔獨立的緩存行
+ */
+typedef struct log_ring
+{
+    // 數據
+    guint8* data;
+    // 容量減 1
+    gsize mask;
+    // 寫入位置，只由生產者寫
+    alignas(64) atomic_size_t tail;
+    // 生產者緩存的讀取位置
+    gsize cached_head;
+    // 讀取位置，只由日誌線程寫
+    alignas(64) atomic_size_t head;
+    // 因緩衝區已滿丟棄的記錄數
+    alignas(64) atomic_uint_least64_t dropped;
+    // 是否有線程持有
+    atomic_bool owned;
+} log_ring;
+
+// 所有生產者的緩衝區，先寫入指針再發佈數量
+static log_ring* rings[LOG_MAX_RINGS];
+// 已登記的緩衝區數
+static atomic_uint n_rings = 0;
+// 保護登記與歸還
+static GMutex rings_lock;
+// 緩衝區的代數，每次啟動時遞增
+static atomic_uint generation = 0;
+// 當前線程的緩衝區
+static _Thread_local log_ring* local_ring = nullptr;
+// 當前線程的緩衝區所屬的代
+static _Thread_local guint local_generation = 0;
+// 線程退出時歸還緩衝區，值為 (代 << 8 | 序號) + 1
+static void release_ring(gpointer data);
+static GPrivate ring_owner = G_PRIVATE_INIT(release_ring);
+// 是否在運行
+static atomic_bool running = false;
+// 是否正在停止
+static atomic_bool stopping = false;
+// 日誌線程
+static GThread* worker = nullptr;
+// 日誌線程的事件循環
+static struct event_base* worker_base = nullptr;
+// 喚醒與停止通知
+static gint wake_fd = -1;
+// 喚醒事件
+static struct event* wake_event = nullptr;
+// 寫出定時器
+static struct event* flush_timer = nullptr;
+// 輸出的文件描述符
+static gint output_fd = STDOUT_FILENO;
+// 保護輸出，同步寫出與日誌線程的寫出不交錯
+static GMutex output_lock;
+// 日誌線程的輸出緩衝
+static GString* pending = nullptr;
+// 已報告的丟棄數
+static guint64 reported_dropped = 0;
+// 接管前的 g_print 與 g_printerr 處理函數
+static GPrintFunc previous_print = nullptr;
+static GPrintFunc previous_printerr = nullptr;
+
+static const gchar* const level_names[] = {"debug", "info", "warn", "error"};
+
+/**
+ * 解析級別名稱
+ * @param name 名稱
+ * @param level 輸出的級別
+ * @return 是否有效
+ */
+static gboolean parse_level(const gchar* name, log_level* level)
+{
+    for (guint i = 0; i < G_N_ELEMENTS(level_names); ++i)
+    {
+        if (g_strcmp0(name, level_names[i]) == 0)
+        {
+            *level = (log_level)i;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/**
+ * 讀取日誌配置
+ * @param keyfile 配置文件
+ * @param error 錯誤對象
+ */
+gboolean init_log_config(GKeyFile* keyfile, GError* error)
+{
+    (void)error; // 可選配置由 read_optional_* 自行處理錯誤
+
+    gchar* level = nullptr;
+    gchar* format = nullptr;
+    gint64 ring_size = 0;
+    gint64 success_sample = 0;
+
+    // 創建日誌配置對象
+    lg_config = g_malloc0(sizeof(log_config));
+
+    // 讀取最低輸出級別
+    if (!read_optional_string(keyfile, "Log", "level", "info", &level)) goto error;
+    if (!parse_level(level, &lg_config->level))
+    {
+        g_printerr("Error reading level: unknown log level %s, expected debug, info, warn or error\n", level);
+        goto error;
+    }
+
+    // 讀取輸出格式與文件
+    if (!read_optional_string(keyfile, "Log", "format", "json", &format)) goto error;
+    if (g_strcmp0(format, "json") == 0) lg_config->format = LOG_FORMAT_JSON;
+    else if (g_strcmp0(format, "binary") == 0) lg_config->format = LOG_FORMAT_BINARY;
+    else
+    {
+        g_printerr("Error reading format: unknown log format %s, expected json or binary\n", format);
+        goto error;
+    }
+    if (!read_optional_string(keyfile, "Log", "path", nullptr, &lg_config->path)) goto error;
+    if (lg_config->path != nullptr && lg_config->path[0] == '\0') g_clear_pointer(&lg_config->path, g_free);
+
+    // 讀取緩衝區字節數，須能放下兩條最大的記錄
+    if (!read_optional_integer(keyfile, "Log", "ring_size", 262144, &ring_size)) goto error;
+    if (ring_size < 65536 || ring_size > 1 << 26 || (ring_size & (ring_size - 1)) != 0)
+    {
+        g_printerr("Error reading ring_size: must be a power of two between 65536 and 67108864\n");
+        goto error;
+    }
+
+    // 讀取成功探測的採樣間隔
+    if (!read_optional_integer(keyfile, "Log", "success_sample", 1, &success_sample)) goto error;
+    if (success_sample < 1 || success_sample > G_MAXUINT32)
+    {
+        g_printerr("Error reading success_sample: must be positive\n");
+        goto error;
+    }
+
+    // 讀取寫出間隔
+    if (!read_optional_integer(keyfile, "Log", "interval", 50, &lg_config->interval_ms)) goto error;
+    if (lg_config->interval_ms < 1 || lg_config->interval_ms > 10000)
+    {
+        g_printerr("Error reading interval: must be between 1 and 10000\n");
+        goto error;
+    }
+
+    lg_config->ring_size = (gsize)ring_size;
+    lg_config->success_sample = (guint)success_sample;
+    g_free(level);
+    g_free(format);
+    return TRUE;
+
+error:
+    // 釋放配置
+    g_free(level);
+    g_free(format);
+    destroy_log_config();
+    return FALSE;
+}
+
+/**
+ * 釋放日誌配置
+ */
+void destroy_log_config()
+{
+    if (lg_config == nullptr) return;
+    g_free(lg_config->path);
+    g_free(lg_config);
+    lg_config = nullptr;
+}
+
+/**
+ * 級別名稱
+ * @param level 級別
+ * @return 名稱
+ */
+const gchar* log_level_name(const log_level level)
+{
+    return level < G_N_ELEMENTS(level_names) ? level_names[level] : "unknown";
+}
+
+/**
+ * 級別是否會輸出
+ * @param level 級別
+ * @return 是否輸出
+ */
+gboolean log_enabled(const log_level level)
+{
+    return level >= (lg_config != nullptr ? lg_config->level : LOG_LEVEL_INFO);
+}
+
+/**
+ * 按目標採樣成功探測的日誌
+ * @param counter 目標的採樣計數
+ * @return 本次是否輸出
+ */
+gboolean log_sample(guint* counter)
+{
+    const guint rate = lg_config != nullptr ? lg_config->success_sample : 1;
+    const gboolean emit = *counter == 0;
+    *counter = (*counter + 1) % rate;
+    return emit;
+}
+
+/**
+ * 字符串截斷後的長度
+ * @param s 字符串，可為空
+ * @param limit 最大字節數
+ * @return 字節數
+ */
+static gsize clamp_length(const gchar* s, const gsize limit)
+{
+    return s != nullptr ? strnlen(s, limit) : 0;
+}
+
+/**
+ * 計算記錄編碼後的字節數（對齊前）
+ * @param target 目標名稱，可為空
+ * @param event 事件名稱
+ * @param fields 字段
+ * @param n_fields 字段數
+ * @return 字節數
+ */
+static gsize record_size(const gchar* target, const gchar* event, const log_field* fields, const guint n_fields)
+{
+    gsize size = LOG_HEADER_SIZE + 2 + clamp_length(target, LOG_STRING_MAX) + 2 + clamp_length(event, LOG_STRING_MAX);
+    for (guint i = 0; i < n_fields; ++i)
+    {
+        size += 2 + clamp_length(fields[i].key, LOG_KEY_MAX);
+        size += fields[i].type == LOG_FIELD_STRING ? 2 + clamp_length(fields[i].s, LOG_STRING_MAX) : 8;
+    }
+    return size;
+}
+
+/**
+ * 寫入帶 u16 長度的字符串
+ * @param p 寫入位置
+ * @param s 字符串
+ * @param length 字節數
+ * @return 下一個寫入位置
+ */
+static guint8* put_string(guint8* p, const gchar* s, const gsize length)
+{
+    const guint16 n = (guint16)length;
+    memcpy(p, &n, sizeof(n));
+    if (length > 0) memcpy(p + 2, s, length);
+    return p + 2 + length;
+}
+
+/**
+ * 編碼一條記錄
+ * @param out 輸出，容量不小於對齊後的字節數
+ * @param size 對齊後的字節數
+ * @param level 級別
+ * @param target 目標名稱，可為空
+ * @param event 事件名稱
+ * @param fields 字段
+ * @param n_fields 字段數
+ */
+static void encode_record(guint8* out, const gsize size, const log_level level, const gchar* target,
+                          const gchar* event, const log_field* fields, const guint n_fields)
+{
+    const log_header header = {
+        .size = (guint32)size,
+        .level = (guint8)level,
+        .n_fields = (guint8)n_fields,
+        .timestamp = g_get_real_time(),
+    };
+    memcpy(out, &header, sizeof(header));
+
+    guint8* p = out + LOG_HEADER_SIZE;
+    if (target != nullptr) p = put_string(p, target, clamp_length(target, LOG_STRING_MAX));
+    else
+    {
+        const guint16 none = LOG_NO_TARGET;
+        memcpy(p, &none, sizeof(none));
+        p += 2;
+    }
+    p = put_string(p, event, clamp_length(event, LOG_STRING_MAX));
+
+    for (guint i = 0; i < n_fields; ++i)
+    {
+        const log_field* field = &fields[i];
+        const gsize key_length = clamp_length(field->key, LOG_KEY_MAX);
+        *p++ = (guint8)field->type;
+        *p++ = (guint8)key_length;
+        memcpy(p, field->key, key_length);
+        p += key_length;
+        switch (field->type)
+        {
+        case LOG_FIELD_STRING:
+            p = put_string(p, field->s, clamp_length(field->s, LOG_STRING_MAX));
+            break;
+        case LOG_FIELD_INT:
+            memcpy(p, &field->i, 8);
+            p += 8;
+            break;
+        case LOG_FIELD_DOUBLE:
+            memcpy(p, &field->d, 8);
+            p += 8;
+            break;
+        }
+    }
+    memset(p, 0, out + size - p);
+}
+
+/**
+ * 二進制記錄的讀取游標
+ */
+typedef struct record_cursor
+{
+    const guint8* p;
+    const guint8* end;
+} record_cursor;
+
+/**
+ * 讀取帶 u16 長度的字符串
+ * @param cursor 游標
+ * @param s 輸出字符串起點
+ * @param length 輸出字節數，缺省標記時為 LOG_NO_TARGET
+ * @return 是否完整
+ */
+static gboolean take_string(record_cursor* cursor, const gchar** s, guint16* length)
+{
+    if (cursor->end - cursor->p < 2) return FALSE;
+    memcpy(length, cursor->p, 2);
+    cursor->p += 2;
+    if (*length == LOG_NO_TARGET)
+    {
+        *s = nullptr;
+        return TRUE;
+    }
+    if (cursor->end - cursor->p < *length) return FALSE;
+    *s = (const gchar*)cursor->p;
+    cursor->p += *length;
+    return TRUE;
+}
+
+/**
+ * 寫入 JSON 字符串
+ * @param out 輸出
+ * @param s 字符串
+ * @param length 字節數
+ */
+static void append_json_string(GString* out, const gchar* s, const gsize length)
+{
+    g_string_append_c(out, '"');
+    for (gsize i = 0; i < length; ++i)
+    {
+        const guchar c = (guchar)s[i];
+        switch (c)
+        {
+        case '"':
+            g_string_append(out, "\\\"");
+            break;
+        case '\\':
+            g_string_append(out, "\\\\");
+            break;
+        case '\n':
+            g_string_append(out, "\\n");
+            break;
+        case '\r':
+            g_string_append(out, "\\r");
+            break;
+        case '\t':
+            g_string_append(out, "\\t");
+            break;
+        default:
+            if (c < 0x20) g_string_append_printf(out, "\\u%04x", c);
+            else g_string_append_c(out, (gchar)c);
+        }
+    }
+    g_string_append_c(out, '"');
+}
+
+/**
+ * 遍歷一條記錄，校驗其完整性並可同時轉為 JSON
+ * @param record 記錄
+ * @param size 記錄字節數
+ * @param out JSON 輸出，為空時只校驗
+ * @return 是否有效
+ */
+static gboolean walk_record(const guint8* record, const gsize size, GString* out)
+{
+    log_header header;
+    if (size < LOG_HEADER_SIZE) return FALSE;
+    memcpy(&header, record, sizeof(header));
+    if (header.level > LOG_LEVEL_ERROR) return FALSE;
+
+    record_cursor cursor = {record + LOG_HEADER_SIZE, record + size};
+    const gchar* target = nullptr;
+    const gchar* event = nullptr;
+    guint16 target_length = 0;
+    guint16 event_length = 0;
+    if (!take_string(&cursor, &target, &target_length)) return FALSE;
+    if (!take_string(&cursor, &event, &event_length) || event == nullptr) return FALSE;
+
+    if (out != nullptr)
+    {
+        // 時間按 UTC 輸出到微秒
+        const time_t seconds = (time_t)(header.timestamp / G_USEC_PER_SEC);
+        struct tm tm;
+        gmtime_r(&seconds, &tm);
+        g_string_append_printf(out, "{\"time\":\"%04d-%02d-%02dT%02d:%02d:%02d.%06dZ\",\"level\":\"%s\"",
+                               tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec,
+                               (gint)(header.timestamp % G_USEC_PER_SEC), level_names[header.level]);
+        if (target != nullptr)
+        {
+            g_string_append(out, ",\"target\":");
+            append_json_string(out, target, target_length);
+        }
+        g_string_append(out, ",\"event\":");
+        append_json_string(out, event, event_length);
+    }
+
+    for (guint i = 0; i < header.n_fields; ++i)
+    {
+        if (cursor.end - cursor.p < 2) return FALSE;
+        const guint8 type = *cursor.p++;
+        const guint8 key_length = *cursor.p++;
+        if (cursor.end - cursor.p < key_length) return FALSE;
+        const gchar* key = (const gchar*)cursor.p;
+        cursor.p += key_length;
+        if (out != nullptr)
+        {
+            g_string_append_c(out, ',');
+            append_json_string(out, key, key_length);
+            g_string_append_c(out, ':');
+        }
+
+        switch (type)
+        {
+        case LOG_FIELD_STRING:
+        {
+            const gchar* s = nullptr;
+            guint16 length = 0;
+            if (!take_string(&cursor, &s, &length) || s == nullptr) return FALSE;
+            if (out != nullptr) append_json_string(out, s, length);
+            break;
+        }
+        case LOG_FIELD_INT:
+        {
+            gint64 value = 0;
+            if (cursor.end - cursor.p < 8) return FALSE;
+            memcpy(&value, cursor.p, 8);
+            cursor.p += 8;
+            if (out != nullptr) g_string_append_printf(out, "%" G_GINT64_FORMAT, value);
+            break;
+        }
+        case LOG_FIELD_DOUBLE:
+        {
+            gdouble value = 0;
+            if (cursor.end - cursor.p < 8) return FALSE;
+            memcpy(&value, cursor.p, 8);
+            cursor.p += 8;
+            // JSON 不能表示非有限數
+            if (out != nullptr && isfinite(value)) g_string_append_printf(out, "%.6g", value);
+            else if (out != nullptr) g_string_append(out, "null");
+            break;
+        }
+        default:
+            return FALSE;
+        }
+    }
+
+    if (out != nullptr) g_string_append(out, "}\n");
+    return TRUE;
+}
+
+/**
+ * 從二進制日誌中取出下一條記錄
+ * @param data 數據
+ * @param length 剩餘字節數
+ * @param size 輸出記錄字節數
+ * @return 記錄是否完整有效
+ */
+gboolean log_record_next(const guint8* data, const gsize length, gsize* size)
+{
+    guint32 declared = 0;
+    if (length < LOG_HEADER_SIZE) return FALSE;
+    memcpy(&declared, data, sizeof(declared));
+    if (declared < LOG_HEADER_SIZE || declared % 8 != 0 || declared > length) return FALSE;
+    if (!walk_record(data, declared, nullptr)) return FALSE;
+    *size = declared;
+    return TRUE;
+}
+
+/**
+ * 二進制記錄轉為一行 JSON
+ * @param record 記錄
+ * @param size 記錄字節數
+ * @param out 輸出
+ */
+void log_record_json(const guint8* record, const gsize size, GString* out)
+{
+    const gsize start = out->len;
+    if (!walk_record(record, size, out)) g_string_truncate(out, start);
+}
+
+/**
+ * 寫出全部數據，被信號中斷時重試；失敗時丟棄
+ * @param data 數據
+ * @param length 字節數
+ */
+static void write_all(const gchar* data, gsize length)
+{
+    while (length > 0)
+    {
+        const gssize n = write(output_fd, data, length);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        data += n;
+        length -= (gsize)n;
+    }
+}
+
+/**
+ * 把記錄按配置的格式追加到輸出
+ * @param record 記錄
+ * @param out 輸出
+ */
+static void append_output(const guint8* record, GString* out)
+{
+    guint32 size = 0;
+    memcpy(&size, record, sizeof(size));
+    if (lg_config != nullptr && lg_config->format == LOG_FORMAT_BINARY)
+        g_string_append_len(out, (const gchar*)record, size);
+    else log_record_json(record, size, out);
+}
+
+/**
+ * 同步寫出一條日誌，用於日誌線程未運行或當前線程沒有緩衝區時
+ * @param level 級別
+ * @param target 目標名稱
+ * @param event 事件名稱
+ * @param fields 字段
+ * @param n_fields 字段數
+ */
+static void write_sync(const log_level level, const gchar* target, const gchar* event, const log_field* fields,
+                       const guint n_fields)
+{
+    const gsize size = (record_size(target, event, fields, n_fields) + 7) & ~(gsize)7;
+    guint8* record = g_malloc(size);
+    encode_record(record, size, level, target, event, fields, n_fields);
+    GString* out = g_string_sized_new(size * 2);
+    append_output(record, out);
+
+    g_mutex_lock(&output_lock);
+    write_all(out->str, out->len);
+    g_mutex_unlock(&output_lock);
+    g_string_free(out, TRUE);
+    g_free(record);
+}
+
+/**
+ * 線程退出時歸還緩衝區，屬於已停止的代時忽略
+ * @param data (代 << 8 | 序號) + 1
+ */
+static void release_ring(const gpointer data)
+{
+    const guint value = GPOINTER_TO_UINT(data) - 1;
+    g_mutex_lock(&rings_lock);
+    if (value >> 8 == atomic_load_explicit(&generation, memory_order_relaxed) &&
+        (value & 0xFF) < atomic_load_explicit(&n_rings, memory_order_relaxed))
+        atomic_store_explicit(&rings[value & 0xFF]->owned, false, memory_order_release);
+    g_mutex_unlock(&rings_lock);
+}
+
+/**
+ * 取得當前線程的緩衝區，首次調用時復用已退出線程的緩衝區或申請新的
+ * @return 緩衝區，生產者線程過多時返回空
+ */
+static log_ring* acquire_ring()
+{
+    const guint current = atomic_load_explicit(&generation, memory_order_acquire);
+    if (local_ring != nullptr && local_generation == current) return local_ring;
+
+    g_mutex_lock(&rings_lock);
+    const guint n = atomic_load_explicit(&n_rings, memory_order_relaxed);
+    guint index = 0;
+    while (index < n && atomic_load_explicit(&rings[index]->owned, memory_order_acquire)) ++index;
+    if (index == LOG_MAX_RINGS)
+    {
+        g_mutex_unlock(&rings_lock);
+        return nullptr;
+    }
+    if (index == n)
+    {
+        log_ring* ring = g_malloc0(sizeof(log_ring));
+        ring->data = g_malloc(lg_config->ring_size);
+        ring->mask = lg_config->ring_size - 1;
+        rings[n] = ring;
+        atomic_store_explicit(&n_rings, n + 1, memory_order_release);
+    }
+    // 前一個持有者已退出，它寫入的位置由鎖保證可見
+    log_ring* ring = rings[index];
+    ring->cached_head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    atomic_store_explicit(&ring->owned, true, memory_order_relaxed);
+    g_private_set(&ring_owner, GUINT_TO_POINTER((current << 8 | index) + 1));
+    g_mutex_unlock(&rings_lock);
+
+    local_ring = ring;
+    local_generation = current;
+    return ring;
+}
+
+/**
+ * 在緩衝區中預留連續的空間，放不下時用填充記錄跳到緩衝區開頭
+ * @param ring 緩衝區
+ * @param size 對齊後的字節數
+ * @param essential 是否可使用為警告與錯誤保留的最後 1/8
+ * @return 寫入位置，緩衝區已滿時返回空
+ */
+static guint8* reserve_space(log_ring* ring, const gsize size, const gboolean essential)
+{
+    const gsize capacity = ring->mask + 1;
+    const gsize limit = capacity - (essential ? 0 : capacity / 8);
+    const gsize tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    const gsize offset = tail & ring->mask;
+    const gsize padding = capacity - offset < size ? capacity - offset : 0;
+
+    if (tail + padding + size - ring->cached_head > limit)
+    {
+        ring->cached_head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        if (tail + padding + size - ring->cached_head > limit) return nullptr;
+    }
+    if (padding > 0)
+    {
+        // 記錄只對齊到 8 字節，剩餘部分可能小於頭部，填充記錄只寫字節數與級別
+        const guint32 pad_size = (guint32)padding;
+        const guint8 pad_level = LOG_PAD;
+        memcpy(ring->data + offset + offsetof(log_header, size), &pad_size, sizeof(pad_size));
+        memcpy(ring->data + offset + offsetof(log_header, level), &pad_level, sizeof(pad_level));
+        atomic_store_explicit(&ring->tail, tail + padding, memory_order_release);
+        return ring->data;
+    }
+    return ring->data + offset;
+}
+
+/**
+ * 發佈預留的記錄，佔用過半時提前喚醒日誌線程
+ * @param ring 緩衝區
+ * @param size 對齊後的字節數
+ */
+static void publish_space(log_ring* ring, const gsize size)
+{
+    const gsize tail = atomic_load_explicit(&ring->tail, memory_order_relaxed) + size;
+    atomic_store_explicit(&ring->tail, tail, memory_order_release);
+
+    const gsize half = (ring->mask + 1) / 2;
+    if (tail - ring->cached_head < half) return;
+    ring->cached_head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if (tail - ring->cached_head >= half) eventfd_write(wake_fd, 1);
+}
+
+/**
+ * 輸出一條日誌
+ * @param level 級別
+ * @param target 目標名稱，可為空
+ * @param event 事件名稱
+ * @param fields 字段
+ * @param n_fields 字段數
+ */
+void log_event(const log_level level, const gchar* target, const gchar* event, const log_field* fields,
+               guint n_fields)
+{
+    if (!log_enabled(level)) return;
+    n_fields = MIN(n_fields, LOG_FIELDS_MAX);
+    const gsize size = (record_size(target, event, fields, n_fields) + 7) & ~(gsize)7;
+
+    log_ring* ring = atomic_load_explicit(&running, memory_order_acquire) ? acquire_ring() : nullptr;
+    if (ring == nullptr)
+    {
+        write_sync(level, target, event, fields, n_fields);
+        return;
+    }
+
+    guint8* out = reserve_space(ring, size, level >= LOG_LEVEL_WARN);
+    if (out == nullptr)
+    {
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+        return;
+    }
+    encode_record(out, size, level, target, event, fields, n_fields);
+    publish_space(ring, size);
+}
+
+/**
+ * g_print 與 g_printerr 的文本轉為日誌，"[目標] " 前綴作為目標名稱
+ * @param level 級別
+ * @param text 文本
+ */
+static void log_text(const log_level level, const gchar* text)
+{
+    if (!log_enabled(level)) return;
+
+    gsize length = strlen(text);
+    while (length > 0 && (text[length - 1] == '\n' || text[length - 1] == '\r')) --length;
+    if (length == 0) return;
+
+    gchar target[LOG_STRING_MAX];
+    const gchar* name = nullptr;
+    const gchar* close = text[0] == '[' ? memchr(text, ']', MIN(length, sizeof(target))) : nullptr;
+    if (close != nullptr && close + 1 < text + length && close[1] == ' ')
+    {
+        memcpy(target, text + 1, close - text - 1);
+        target[close - text - 1] = '\0';
+        name = target;
+        length -= close + 2 - text;
+        text = close + 2;
+    }
+
+    gchar* message = g_strndup(text, length);
+    LOG_EVENT(level, name, "message", LOG_STRING("message", message));
+    g_free(message);
+}
+
+/**
+ * g_print 處理函數
+ * @param text 已格式化的文本
+ */
+static void print_handler(const gchar* text)
+{
+    log_text(LOG_LEVEL_INFO, text);
+}
+
+/**
+ * g_printerr 處理函數
+ * @param text 已格式化的文本
+ */
+static void printerr_handler(const gchar* text)
+{
+    log_text(LOG_LEVEL_ERROR, text);
+}
+
+/**
+ * 取出緩衝區中的記錄追加到輸出，寫出後才釋放位置
+ * @param ring 緩衝區
+ * @return 取出的字節數
+ */
+static gsize drain_ring(log_ring* ring)
+{
+    const gsize head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    const gsize tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    gsize position = head;
+    while (position != tail)
+    {
+        // 只讀字節數與級別，末尾的填充記錄可能不足一個頭部
+        const guint8* record = ring->data + (position & ring->mask);
+        guint32 size = 0;
+        guint8 level = 0;
+        memcpy(&size, record + offsetof(log_header, size), sizeof(size));
+        memcpy(&level, record + offsetof(log_header, level), sizeof(level));
+        if (level != LOG_PAD) append_output(record, pending);
+        position += size;
+    }
+    return position - head;
+}
+
+/**
+ * 取出所有緩衝區中的記錄並一次寫出，報告新增的丟棄數
+ */
+static void flush_all()
+{
+    const guint n = atomic_load_explicit(&n_rings, memory_order_acquire);
+    gsize drained[LOG_MAX_RINGS];
+    guint64 dropped = 0;
+    for (guint i = 0; i < n; ++i)
+    {
+        drained[i] = drain_ring(rings[i]);
+        dropped += atomic_load_explicit(&rings[i]->dropped, memory_order_relaxed);
+    }
+
+    if (dropped > reported_dropped)
+    {
+        const log_field field = LOG_INT("dropped", dropped - reported_dropped);
+        const gsize size = (record_size(nullptr, "log_dropped", &field, 1) + 7) & ~(gsize)7;
+        guint8 record[64];
+        encode_record(record, size, LOG_LEVEL_WARN, nullptr, "log_dropped", &field, 1);
+        append_output(record, pending);
+        reported_dropped = dropped;
+    }
+
+    if (pending->len > 0)
+    {
+        g_mutex_lock(&output_lock);
+        write_all(pending->str, pending->len);
+        g_mutex_unlock(&output_lock);
+        g_string_truncate(pending, 0);
+    }
+    for (guint i = 0; i < n; ++i)
+    {
+        const gsize head = atomic_load_explicit(&rings[i]->head, memory_order_relaxed);
+        atomic_store_explicit(&rings[i]->head, head + drained[i], memory_order_release);
+    }
+}
+
+/**
+ * 寫出定時器回調
+ * @param fd 文件描述符
+ * @param event 事件類型
+ * @param arg 未使用
+ */
+static void flush_callback(const evutil_socket_t fd, const short event, void* arg)
+{
+    (void)fd; // 未使用
+    (void)event; // 未使用
+    (void)arg; // 未使用
+    flush_all();
+}
+
+/**
+ * 喚醒回調，緩衝區過半或停止時觸發；停止時寫出所有記錄再退出事件循環
+ * @param fd 文件描述符
+ * @param event 事件類型
+ * @param arg 未使用
+ */
+static void wake_callback(const evutil_socket_t fd, const short event, void* arg)
+{
+    (void)event; // 未使用
+    (void)arg; // 未使用
+
+    eventfd_t count = 0;
+    eventfd_read(fd, &count);
+    flush_all();
+    if (atomic_load_explicit(&stopping, memory_order_acquire)) event_base_loopbreak(worker_base);
+}
+
+/**
+ * 日誌線程
+ * @param data 未使用
+ * @return 未使用
+ */
+static gpointer logger_thread(gpointer data)
+{
+    (void)data; // 未使用
+    event_base_dispatch(worker_base);
+    return nullptr;
+}
+
+/**
+ * 打開輸出，二進制格式的新文件先寫入文件頭
+ * @return 是否成功
+ */
+static gboolean open_output()
+{
+    output_fd = STDOUT_FILENO;
+    if (lg_config->path != nullptr)
+    {
+        output_fd = open(lg_config->path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (output_fd < 0)
+        {
+            g_printerr("Cannot open log file %s: %s\n", lg_config->path, g_strerror(errno));
+            output_fd = STDOUT_FILENO;
+            return FALSE;
+        }
+    }
+    if (lg_config->format == LOG_FORMAT_BINARY && (lg_config->path == nullptr || lseek(output_fd, 0, SEEK_END) == 0))
+        write_all(LOG_BINARY_MAGIC, LOG_BINARY_MAGIC_SIZE);
+    return TRUE;
+}
+
+/**
+ * 打開輸出並啟動日誌線程
+ * @return 是否成功
+ */
+gboolean start_logger()
+{
+    // 接管前經 stdio 輸出的內容先寫出，保持順序
+    fflush(stdout);
+    fflush(stderr);
+    if (!open_output()) return FALSE;
+
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd < 0)
+    {
+        g_printerr("Cannot create eventfd for the logger: %s\n", g_strerror(errno));
+        goto error;
+    }
+
+    atomic_fetch_add_explicit(&generation, 1, memory_order_release);
+    pending = g_string_sized_new(lg_config->ring_size);
+    reported_dropped = 0;
+
+    worker_base = event_base_new();
+    wake_event = event_new(worker_base, wake_fd, EV_READ | EV_PERSIST, wake_callback, nullptr);
+    event_add(wake_event, nullptr);
+    flush_timer = event_new(worker_base, -1, EV_PERSIST, flush_callback, nullptr);
+    const struct timeval interval = {
+        .tv_sec = lg_config->interval_ms / 1000,
+        .tv_usec = lg_config->interval_ms % 1000 * 1000,
+    };
+    event_add(flush_timer, &interval);
+
+    atomic_store_explicit(&stopping, false, memory_order_relaxed);
+    atomic_store_explicit(&running, true, memory_order_release);
+    worker = g_thread_new("logger", logger_thread, nullptr);
+    previous_print = g_set_print_handler(print_handler);
+    previous_printerr = g_set_printerr_handler(printerr_handler);
+    return TRUE;
+
+error:
+    if (output_fd != STDOUT_FILENO) close(output_fd);
+    output_fd = STDOUT_FILENO;
+    return FALSE;
+}
+
+/**
+ * 寫出所有緩衝區中的日誌後停止日誌線程
+ */
+void stop_logger()
+{
+    if (worker == nullptr) return;
+
+    g_set_print_handler(previous_print);
+    g_set_printerr_handler(previous_printerr);
+    atomic_store_explicit(&running, false, memory_order_relaxed);
+    atomic_store_explicit(&stopping, true, memory_order_release);
+    eventfd_write(wake_fd, 1);
+    g_thread_join(worker);
+    worker = nullptr;
+
+    event_free(flush_timer);
+    flush_timer = nullptr;
+    event_free(wake_event);
+    wake_event = nullptr;
+    event_base_free(worker_base);
+    worker_base = nullptr;
+    close(wake_fd);
+    wake_fd = -1;
+
+    // 停止後仍在寫入的線程改為同步寫出；緩衝區在鎖內摘下，線程退出時不再歸還
+    g_mutex_lock(&rings_lock);
+    const guint n = atomic_exchange_explicit(&n_rings, 0, memory_order_acq_rel);
+    for (guint i = 0; i < n; ++i)
+    {
+        g_free(rings[i]->data);
+        g_free(rings[i]);
+        rings[i] = nullptr;
+    }
+    g_mutex_unlock(&rings_lock);
+    g_string_free(pending, TRUE);
+    pending = nullptr;
+
+    if (output_fd != STDOUT_FILENO) close(output_fd);
+    output_fd = STDOUT_FILENO;
+}
@@ -0,0 +1,174 @@
+#pragma once
+#include <glib.h>
+
+/**
+ * 日誌級別
+ */
+typedef enum log_level
+{
+    LOG_LEVEL_DEBUG = 0,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_ERROR
+} log_level;
+
+/**
+ * 輸出格式
+ */
+typedef enum log_format
+{
+    // 每條一行 JSON
+    LOG_FORMAT_JSON = 0,
+    // 文件頭加原樣的二進制記錄
+    LOG_FORMAT_BINARY
+} log_format;
+
+/**
+ * 結構化日誌配置
+ *
+ * 每個線程把日誌編碼為定長頭部加字段的二進制記錄，寫入各自的單生產者單消費者環形緩衝區，
+ * 由日誌線程批量取出後寫為 JSON 行或原樣寫出二進制記錄（可用 log_decode 轉為 JSON 行），
+ * 產生日誌的線程不格式化文本也不做系統調用。啟動後 g_print 與 g_printerr 也經由緩衝區輸出
+ *
+ * 配置:
+ *  - level 最低輸出級別：debug、info、warn 或 error
+ *  - format 輸出格式：json 或 binary
+ *  - path 輸出文件，為空時寫到標準輸出
+ *  - ring_size 每個線程的緩衝區字節數，須為 2 的冪
+ *  - success_sample 每個目標每 N 次成功探測輸出一條，失敗與恢復總是輸出
+ *  - interval 日誌線程寫出的間隔毫秒數，緩衝區過半時提前喚醒
+ */
+typedef struct log_config
+{
+    // 最低輸出級別
+    log_level level;
+    // 輸出格式
+    log_format format;
+    // 輸出文件，為空時寫到標準輸出
+    gchar* path;
+    // 每個線程的緩衝區字節數
+    gsize ring_size;
+    // 成功探測的採樣間隔
+    guint success_sample;
+    // 寫出間隔（毫秒）
+    gint64 interval_ms;
+} log_config;
+
+typedef log_config* log_config_t;
+
+extern log_config_t lg_config;
+
+/**
+ * 字段類型
+ */
+typedef enum log_field_type
+{
+    LOG_FIELD_STRING = 0,
+    LOG_FIELD_INT,
+    LOG_FIELD_DOUBLE
+} log_field_type;
+
+/**
+ * 日誌字段，字符串在調用期間有效即可
+ */
+typedef struct log_field
+{
+    // 字段名
+    const gchar* key;
+    // 類型
+    log_field_type type;
+    // 值
+    union
+    {
+        const gchar* s;
+        gint64 i;
+        gdouble d;
+    };
+} log_field;
+
+#define LOG_STRING(k, v) ((log_field){.key = (k), .type = LOG_FIELD_STRING, .s = (v)})
+#define LOG_INT(k, v) ((log_field){.key = (k), .type = LOG_FIELD_INT, .i = (gint64)(v)})
+#define LOG_DOUBLE(k, v) ((log_field){.key = (k), .type = LOG_FIELD_DOUBLE, .d = (gdouble)(v)})
+
+/**
+ * 輸出一條帶字段的日誌，至少一個字段
+ * 用法: LOG_EVENT(LOG_LEVEL_INFO, name, "probe_ok", LOG_DOUBLE("ping_ms", ping), LOG_INT("sample_rate", n));
+ */
+#define LOG_EVENT(level, target, event, ...)                                                          \
+    log_event((level), (target), (event), (const log_field[]){__VA_ARGS__},                          \
+              sizeof((const log_field[]){__VA_ARGS__}) / sizeof(log_field))
+
+// 二進制日誌文件的文件頭
+#define LOG_BINARY_MAGIC "RWLOG\x00\x01\n"
+#define LOG_BINARY_MAGIC_SIZE 8
+
+/**
+ * 讀取日誌配置
+ * @param keyfile 配置文件
+ * @param error 錯誤對象
+ */
+gboolean init_log_config(GKeyFile* keyfile, GError* error);
+
+/**
+ * 釋放日誌配置
+ */
+void destroy_log_config();
+
+/**
+ * 打開輸出並啟動日誌線程，接管 g_print 與 g_printerr
+ * @return 是否成功
+ */
+gboolean start_logger();
+
+/**
+ * 寫出所有緩衝區中的日誌後停止日誌線程，恢復 g_print 與 g_printerr
+ */
+void stop_logger();
+
+/**
+ * 級別是否會輸出，可在構造字段前判斷
+ * @param level 級別
+ * @return 是否輸出
+ */
+gboolean log_enabled(log_level level);
+
+/**
+ * 輸出一條日誌，寫入當前線程的緩衝區；日誌線程未運行時同步寫出
+ * @param level 級別
+ * @param target 目標名稱，可為空
+ * @param event 事件名稱
+ * @param fields 字段
+ * @param n_fields 字段數
+ */
+void log_event(log_level level, const gchar* target, const gchar* event, const log_field* fields, guint n_fields);
+
+/**
+ * 按目標採樣成功探測的日誌
+ * @param counter 目標的採樣計數
+ * @return 本次是否輸出
+ */
+gboolean log_sample(guint* counter);
+
+/**
+ * 級別名稱
+ * @param level 級別
+ * @return 名稱
+ */
+const gchar* log_level_name(log_level level);
+
+/**
+ * 從二進制日誌中取出下一條記錄
+ * @param data 數據
+ * @param length 剩餘字節數
+ * @param size 輸出記錄字節數
+ * @return 記錄是否完整有效，數據不足或損壞時返回 FALSE
+ */
+gboolean log_record_next(const guint8* data, gsize length, gsize* size);
+
+/**
+ * 二進制記錄轉為一行 JSON（含換行符）
+ * @param record 記錄
+ * @param size 記錄字節數
+ * @param out 輸出
+ */
+void log_record_json(const guint8* record, gsize size, GString* out);
@@ -0,0 +1,242 @@
+#include "loopmon.h"
+
+#include "config.h"
+#include "logger.h"
+
+// 事件循環自我監控配置
+loop_config_t lm_config = nullptr;
+
+// 各桶的上限（微秒）
+const gint64 loop_bucket_bounds[LOOP_BUCKETS - 1] = {
+    100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 2500000, 5000000
+};
+
+// 調度延遲
+static loop_histogram lag_histogram;
+// 已登記的回調 (loop_site*)
+static GPtrArray* sites = nullptr;
+// 心跳定時器
+static struct event* heartbeat_timer = nullptr;
+// 下一次心跳的預定時間（單調時鐘）
+static gint64 heartbeat_due = 0;
+// 上次心跳以來最慢的回調
+static const loop_site* slowest = nullptr;
+// 上次心跳以來最慢的回調耗時（微秒）
+static gint64 slowest_us = 0;
+// 上次調度延遲警告的時間（單調時鐘）
+static gint64 lag_warned_at = 0;
+// 上次調度延遲警告後被忽略的警告數
+static guint lag_suppressed = 0;
+
+/**
+ * 讀取事件循環自我監控配置
+ * @param keyfile 配置文件
+ * @param error 錯誤對象
+ */
+gboolean init_loop_config(GKeyFile* keyfile, GError* error)
+{
+    (void)error; // 可選配置由 read_optional_* 自行處理錯誤
+
+    // 創建事件循環自我監控配置對象
+    lm_config = g_malloc0(sizeof(loop_config));
+
+    // 讀取心跳間隔與閾值
+    gint64 heartbeat_ms = 0;
+    gint64 lag_warning_ms = 0;
+    gint64 callback_warning_ms = 0;
+    gint64 warning_interval = 0;
+    if (!read_optional_integer(keyfile, "Loop", "heartbeat", 100, &heartbeat_ms)) goto error;
+    if (!read_optional_integer(keyfile, "Loop", "lag_warning", 250, &lag_warning_ms)) goto error;
+    if (!read_optional_integer(keyfile, "Loop", "callback_warning", 100, &callback_warning_ms)) goto error;
+    if (!read_optional_integer(keyfile, "Loop", "warning_interval", 60, &warning_interval)) goto error;
+    if (heartbeat_ms < 10 || lag_warning_ms <= 0 || callback_warning_ms <= 0 || warning_interval < 0)
+    {
+        g_printerr("Error reading heartbeat/lag_warning/callback_warning: heartbeat must be at least 10 "
+                   "milliseconds and thresholds must be positive\n");
+        goto error;
+    }
+    lm_config->heartbeat_us = heartbeat_ms * 1000;
+    lm_config->lag_warning_us = lag_warning_ms * 1000;
+    lm_config->callback_warning_us = callback_warning_ms * 1000;
+    lm_config->warning_interval_us = warning_interval * G_USEC_PER_SEC;
+    return TRUE;
+
+error:
+    // 釋放配置
+    destroy_loop_config();
+    return FALSE;
+}
+
+/**
+ * 釋放事件循環自我監控配置
+ */
+void destroy_loop_config()
+{
+    g_free(lm_config);
+    lm_config = nullptr;
+}
+
+/**
+ * 記錄一個樣本
+ * @param histogram 直方圖
+ * @param us 耗時（微秒）
+ */
+static void histogram_add(loop_histogram* histogram, const gint64 us)
+{
+    guint bucket = 0;
+    while (bucket < LOOP_BUCKETS - 1 && us > loop_bucket_bounds[bucket]) bucket++;
+    histogram->buckets[bucket]++;
+    histogram->count++;
+    histogram->sum_us += us;
+    histogram->max_us = MAX(histogram->max_us, us);
+}
+
+/**
+ * 判斷是否輸出警告，間隔內的警告只計數
+ * @param warned_at 上次警告的時間
+ * @param suppressed 被忽略的警告數
+ * @param now 當前時間
+ * @return 是否輸出
+ */
+static gboolean should_warn(gint64* warned_at, guint* suppressed, const gint64 now)
+{
+    if (*warned_at > 0 && now - *warned_at < lm_config->warning_interval_us)
+    {
+        (*suppressed)++;
+        return FALSE;
+    }
+    *warned_at = now;
+    return TRUE;
+}
+
+/**
+ * 回調結束，記錄耗時（包括其中嵌套的回調），超過閾值時警告；只在事件循環線程中調用，未啟動時忽略
+ * @param site 回調
+ * @param started loop_enter 返回的開始時間
+ */
+void loop_leave(loop_site* site, const gint64 started)
+{
+    if (sites == nullptr) return;
+
+    const gint64 now = g_get_monotonic_time();
+    const gint64 elapsed = now - started;
+    if (!site->registered)
+    {
+        site->registered = TRUE;
+        g_ptr_array_add(sites, site);
+    }
+    histogram_add(&site->histogram, elapsed);
+    if (elapsed > slowest_us)
+    {
+        slowest = site;
+        slowest_us = elapsed;
+    }
+
+    if (elapsed <= lm_config->callback_warning_us || !should_warn(&site->warned_at, &site->suppressed, now)) return;
+    // 一條事件帶全部字段，日誌線程不會把一次警告拆成多條
+    LOG_EVENT(LOG_LEVEL_WARN, nullptr, "loop_slow_callback", LOG_STRING("callback", site->name),
+              LOG_DOUBLE("elapsed_ms", (gdouble)elapsed / 1000), LOG_INT("suppressed", site->suppressed));
+    site->suppressed = 0;
+}
+
+/**
+ * 記錄一次定時器的調度延遲；只在事件循環線程中調用
+ * @param intended 預定的觸發時間（單調時鐘）
+ */
+void loop_lag(const gint64 intended)
+{
+    if (sites == nullptr) return;
+    histogram_add(&lag_histogram, MAX(g_get_monotonic_time() - intended, 0));
+}
+
+/**
+ * 安排下一次心跳
+ */
+static void schedule_heartbeat()
+{
+    heartbeat_due = g_get_monotonic_time() + lm_config->heartbeat_us;
+    const struct timeval interval = {
+        .tv_sec = lm_config->heartbeat_us / G_USEC_PER_SEC, .tv_usec = lm_config->heartbeat_us % G_USEC_PER_SEC
+    };
+    evtimer_add(heartbeat_timer, &interval);
+}
+
+/**
+ * 心跳回調，測量調度延遲，超過閾值時指出心跳之間最慢的回調
+ * @param fd 文件描述符
+ * @param event 事件類型
+ * @param arg 未使用
+ */
+static void heartbeat_callback(const evutil_socket_t fd, const short event, void* arg)
+{
+    (void)fd; // 未使用
+    (void)event; // 未使用
+    (void)arg; // 未使用
+
+    const gint64 now = g_get_monotonic_time();
+    const gint64 lag = MAX(now - heartbeat_due, 0);
+    histogram_add(&lag_histogram, lag);
+
+    if (lag > lm_config->lag_warning_us && should_warn(&lag_warned_at, &lag_suppressed, now))
+    {
+        if (slowest != nullptr)
+        {
+            LOG_EVENT(LOG_LEVEL_WARN, nullptr, "loop_lag", LOG_DOUBLE("lag_ms", (gdouble)lag / 1000),
+                      LOG_STRING("slowest_callback", slowest->name),
+                      LOG_DOUBLE("slowest_ms", (gdouble)slowest_us / 1000), LOG_INT("suppressed", lag_suppressed));
+        }
+        else
+        {
+            LOG_EVENT(LOG_LEVEL_WARN, nullptr, "loop_lag", LOG_DOUBLE("lag_ms", (gdouble)lag / 1000),
+                      LOG_INT("suppressed", lag_suppressed));
+        }
+        lag_suppressed = 0;
+    }
+    slowest = nullptr;
+    slowest_us = 0;
+    schedule_heartbeat();
+}
+
+/**
+ * 啟動心跳定時器
+ * @param base 事件循環
+ */
+void start_loop_monitor(struct event_base* base)
+{
+    sites = g_ptr_array_new();
+    heartbeat_timer = evtimer_new(base, heartbeat_callback, nullptr);
+    schedule_heartbeat();
+}
+
+/**
+ * 停止心跳定時器
+ */
+void stop_loop_monitor()
+{
+    if (heartbeat_timer != nullptr)
+    {
+        event_free(heartbeat_timer);
+        heartbeat_timer = nullptr;
+    }
+    if (sites != nullptr)
+    {
+        // 回調是靜態變量，重新啟動時重新登記
+        for (guint i = 0; i < sites->len; ++i) ((loop_site*)g_ptr_array_index(sites, i))->registered = FALSE;
+        g_ptr_array_free(sites, TRUE);
+        sites = nullptr;
+    }
+    slowest = nullptr;
+    slowest_us = 0;
+}
+
+/**
+ * 複製調度延遲與各回調的直方圖；只在事件循環線程中調用
+ * @param lag 輸出的調度延遲
+ * @param copies 輸出的回調 (loop_site)，按登記順序追加
+ */
+void loop_collect(loop_histogram* lag, GArray* copies)
+{
+    *lag = lag_histogram;
+    for (guint i = 0; sites != nullptr && i < sites->len; ++i)
+        g_array_append_vals(copies, g_ptr_array_index(sites, i), 1);
+}
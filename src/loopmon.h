@@ -0,0 +1,124 @@
+#pragma once
+#include <glib.h>
+#include <event2/event.h>
+
+/**
+ * 事件循環自我監控配置
+ *
+ * 以心跳定時器測量事件循環的調度延遲（實際觸發時間減去預定時間），並記錄各回調的耗時；
+ * 延遲或回調耗時超過閾值時輸出警告，指出心跳之間最慢的回調
+ *
+ * 配置:
+ *  - heartbeat 心跳間隔毫秒數
+ *  - lag_warning 調度延遲的警告閾值毫秒數
+ *  - callback_warning 回調耗時的警告閾值毫秒數
+ *  - warning_interval 同一類警告的最短間隔秒數，期間的警告只計數
+ */
+typedef struct loop_config
+{
+    // 心跳間隔（微秒）
+    gint64 heartbeat_us;
+    // 調度延遲的警告閾值（微秒）
+    gint64 lag_warning_us;
+    // 回調耗時的警告閾值（微秒）
+    gint64 callback_warning_us;
+    // 警告的最短間隔（微秒）
+    gint64 warning_interval_us;
+} loop_config;
+
+typedef loop_config* loop_config_t;
+
+extern loop_config_t lm_config;
+
+// 直方圖的桶數，最後一個桶沒有上限
+#define LOOP_BUCKETS 16
+
+// 各桶的上限（微秒），依次為 100us 到 5s
+extern const gint64 loop_bucket_bounds[LOOP_BUCKETS - 1];
+
+/**
+ * 耗時直方圖
+ */
+typedef struct loop_histogram
+{
+    // 樣本數
+    guint64 count;
+    // 總和（微秒）
+    gint64 sum_us;
+    // 最大值（微秒）
+    gint64 max_us;
+    // 各桶的樣本數（非累計）
+    guint64 buckets[LOOP_BUCKETS];
+} loop_histogram;
+
+/**
+ * 被測量的回調，定義為靜態變量，首次記錄時登記
+ */
+typedef struct loop_site
+{
+    // 名稱，必須是靜態字符串
+    const gchar* name;
+    // 耗時
+    loop_histogram histogram;
+    // 是否已登記
+    gboolean registered;
+    // 上次警告的時間（單調時鐘）
+    gint64 warned_at;
+    // 上次警告後被忽略的警告數
+    guint suppressed;
+} loop_site;
+
+// 定義被測量的回調
+#define LOOP_SITE(site_name) {.name = (site_name)}
+
+/**
+ * 讀取事件循環自我監控配置
+ * @param keyfile 配置文件
+ * @param error 錯誤對象
+ */
+gboolean init_loop_config(GKeyFile* keyfile, GError* error);
+
+/**
+ * 釋放事件循環自我監控配置
+ */
+void destroy_loop_config();
+
+/**
+ * 啟動心跳定時器
+ * @param base 事件循環
+ */
+void start_loop_monitor(struct event_base* base);
+
+/**
+ * 停止心跳定時器
+ */
+void stop_loop_monitor();
+
+/**
+ * 回調開始
+ * @return 開始時間（單調時鐘）
+ */
+static inline gint64 loop_enter()
+{
+    return g_get_monotonic_time();
+}
+
+/**
+ * 回調結束，記錄耗時（包括其中嵌套的回調），超過閾值時警告；只在事件循環線程中調用，未啟動時忽略
+ * @param site 回調
+ * @param started loop_enter 返回的開始時間
+ */
+void loop_leave(loop_site* site, gint64 started);
+
+/**
+ * 記錄一次定時器的調度延遲；只在事件循環線程中調用
+ * @param intended 預定的觸發時間（單調時鐘）
+ */
+void loop_lag(gint64 intended);
+
+/**
+ * 複製調度延遲與各回調的直方圖；只在事件循環線程中調用
+ * @param lag 輸出的調度延遲
+ * @param copies 輸出的回調 (loop_site)，按登記順序追加
+ */
+void loop_collect(loop_histogram* lag, GArray* copies);
@@ -1,9 +1,25 @@
 #include <glib.h>
+#include <curl/curl.h>
 
 #include "redis.h"
 #include "email.h"
 #include "watcher.h"
 #include "sms.h"
+#include "notifier.h"
+#include "target.h"
+#include "alert.h"
+#include "outbox.h"
+#include "probe.h"
+#include "webhook.h"
+#include "history.h"
+#include "rollup.h"
+#include "api.h"
+#include "anomaly.h"
+#include "trace.h"
+#include "loopmon.h"
+#include "aggregator.h"
+#include "logger.h"
+#include "shard.h"
 
 // 配置文件路徑
 gchar* config_file = nullptr;
@@ -88,6 +104,51 @@ void read_config()
     // 讀取 Sms 配置
     if (!init_sms_config(keyfile, error)) goto error;
 
+    // 讀取 Notifier 配置
+    if (!init_notifier_config(keyfile, error)) goto error;
+
+    // 讀取 Webhook 通道，需在 Notifier 之後註冊
+    if (!init_webhook_config(keyfile, error)) goto error;
+
+    // 讀取 Alert 配置
+    if (!init_alert_config(keyfile, error)) goto error;
+
+    // 讀取 Outbox 配置
+    if (!init_outbox_config(keyfile, error)) goto error;
+
+    // 讀取 Probe 配置
+    if (!init_probe_config(keyfile, error)) goto error;
+
+    // 讀取 History 配置
+    if (!init_history_config(keyfile, error)) goto error;
+
+    // 讀取 Rollup 配置
+    if (!init_rollup_config(keyfile, error)) goto error;
+
+    // 讀取 Anomaly 配置
+    if (!init_anomaly_config(keyfile, error)) goto error;
+
+    // 讀取 Api 配置
+    if (!init_api_config(keyfile, error)) goto error;
+
+    // 讀取 Trace 配置
+    if (!init_trace_config(keyfile, error)) goto error;
+
+    // 讀取 Loop 配置
+    if (!init_loop_config(keyfile, error)) goto error;
+
+    // 讀取 Aggregator 配置
+    if (!init_aggregator_config(keyfile, error)) goto error;
+
+    // 讀取 Log 配置
+    if (!init_log_config(keyfile, error)) goto error;
+
+    // 讀取 Shard 配置
+    if (!init_shard_config(keyfile, error)) goto error;
+
+    // 讀取探測目標，依賴 Redis、Watcher 與通知通道配置
+    if (!init_target_config(keyfile, error)) goto error;
+
     goto success;
 
 error:
@@ -99,6 +160,36 @@ error:
     destroy_watcher_config();
     // 釋放 sms 配置
     destroy_sms_config();
+    // 釋放 notifier 配置
+    destroy_notifier_config();
+    // 釋放 webhook 配置
+    destroy_webhook_config();
+    // 釋放 alert 配置
+    destroy_alert_config();
+    // 釋放 outbox 配置
+    destroy_outbox_config();
+    // 釋放 probe 配置
+    destroy_probe_config();
+    // 釋放 history 配置
+    destroy_history_config();
+    // 釋放 rollup 配置
+    destroy_rollup_config();
+    // 釋放 anomaly 配置
+    destroy_anomaly_config();
+    // 釋放 api 配置
+    destroy_api_config();
+    // 釋放 trace 配置
+    destroy_trace_config();
+    // 釋放 loop 配置
+    destroy_loop_config();
+    // 釋放 aggregator 配置
+    destroy_aggregator_config();
+    // 釋放 log 配置
+    destroy_log_config();
+    // 釋放 shard 配置
+    destroy_shard_config();
+    // 釋放 探測目標
+    destroy_target_config();
     // 釋放 配置文件
     if (error != nullptr) g_error_free(error);;
     g_key_file_free(keyfile);
@@ -118,8 +209,23 @@ int main(int argc, char* argv[])
     init_global_params(argc, argv);
     // 讀取配置文件
     read_config();
+    // 初始化 curl，必須在啟動任何線程之前
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    // 啟動日誌線程，之後的輸出都經由日誌緩衝區
+    if (!start_logger()) exit(1);
+    // 啟動通知工作線程
+    if (!start_notifier()) exit(1);
+    // 映射探測歷史文件
+    if (!open_history()) exit(1);
     // 運行事件循環
-    const int res = run_loop();
+    const int res = run_loop(config_file);
+    // 關閉探測歷史文件
+    close_history();
+    // 停止通知工作線程，等待已提交的通知發送完畢
+    stop_notifier();
+    curl_global_cleanup();
+    // 寫出剩餘日誌並停止日誌線程
+    stop_logger();
     // 釋放資源
     g_free(config_file);
     // 釋放redis配置
@@ -130,5 +236,35 @@ int main(int argc, char* argv[])
     destroy_watcher_config();
     // 釋放 sms 配置
     destroy_sms_config();
+    // 釋放 notifier 配置
+    destroy_notifier_config();
+    // 釋放 webhook 配置
+    destroy_webhook_config();
+    // 釋放 alert 配置
+    destroy_alert_config();
+    // 釋放 outbox 配置
+    destroy_outbox_config();
+    // 釋放 probe 配置
+    destroy_probe_config();
+    // 釋放 history 配置
+    destroy_history_config();
+    // 釋放 rollup 配置
+    destroy_rollup_config();
+    // 釋放 anomaly 配置
+    destroy_anomaly_config();
+    // 釋放 api 配置
+    destroy_api_config();
+    // 釋放 trace 配置
+    destroy_trace_config();
+    // 釋放 loop 配置
+    destroy_loop_config();
+    // 釋放 aggregator 配置
+    destroy_aggregator_config();
+    // 釋放 log 配置
+    destroy_log_config();
+    // 釋放 shard 配置
+    destroy_shard_config();
+    // 釋放 探測目標
+    destroy_target_config();
     return res;
 }
@@ -0,0 +1,1099 @@
+#include "notifier.h"
+
+#include <stdalign.h>
+#include <stdatomic.h>
+
+#include "config.h"
+#include "email.h"
+#include "outbox.h"
+#include "sms.h"
+
+// 通知器配置
+notifier_config_t nt_config = nullptr;
+
+/**
+ * 已註冊的通道
+ */
+typedef struct channel_entry
+{
+    // 通道名稱
+    gchar* name;
+    // 後端
+    const notify_backend* backend;
+    // 通道配置
+    gpointer config;
+    // 單次發送的超時毫秒數
+    glong timeout_ms;
+    // 併發上限
+    guint concurrency;
+} channel_entry;
+
+// 已註冊的通道，僅在啟動前修改
+static channel_entry channels[NOTIFY_MAX_CHANNELS];
+// 通道數量
+static guint n_channels = 0;
+
+/**
+ * 佇列中的通知
+ */
+typedef struct notification
+{
+    // 主題
+    gchar* subject;
+    // 內容
+    gchar* body;
+    // 簡短內容
+    gchar* summary;
+    // 涉及的集群（分號分隔），用於收件人路由
+    gchar* routes;
+    // 嚴重程度
+    gchar* severity;
+    // 單條告警的標識
+    gchar* key;
+    // 入隊時間
+    gint64 queued_at;
+    // 發件箱記錄ID，未啟用發件箱時為 0
+    guint64 outbox_id;
+    // 尚未投遞成功的通道位掩碼
+    guint pending;
+    // 各通道已嘗試次數
+    guint attempts[NOTIFY_MAX_CHANNELS];
+    // 發送中或等待通道空閒的請求數
+    guint in_flight;
+    // 下次重試時間（單調時鐘，微秒）
+    gint64 due_at;
+} notification;
+
+/**
+ * 佇列單元，sequence 用於判斷單元是否可寫或可讀
+ */
+typedef struct queue_cell
+{
+    atomic_size_t sequence;
+    notification* data;
+} queue_cell;
+
+/**
+ * 有界無鎖佇列（多生產者多消費者）
+ *
+ * 入隊與出隊位置分別放在獨立的緩存行，避免生產者與工作線程互相干擾
+ */
+typedef struct notify_queue
+{
+    queue_cell* cells;
+    gsize mask;
+    alignas(64) atomic_size_t enqueue_pos;
+    alignas(64) atomic_size_t dequeue_pos;
+} notify_queue;
+
+// 通知佇列
+static notify_queue queue;
+// 工作線程
+static GThread* worker = nullptr;
+// curl multi 句柄，僅由工作線程操作（curl_multi_wakeup 除外）
+static CURLM* multi = nullptr;
+// 是否正在停止
+static atomic_bool stopping = false;
+// 等待重試的通知，按重試時間排序，僅由工作線程操作（啟動前的重放除外）
+static GQueue retry_queue = G_QUEUE_INIT;
+// 各通道發送中的請求數，僅由工作線程操作
+static guint channel_in_flight[NOTIFY_MAX_CHANNELS];
+// 各通道等待空閒的通知，僅由工作線程操作
+static GQueue channel_backlog[NOTIFY_MAX_CHANNELS];
+// 共享 TLS 會話與 DNS 緩存，連接斷開後重連可恢復會話
+static CURLSH* share = nullptr;
+// 閒置的 curl 句柄，僅由工作線程操作
+static GPtrArray* handle_pool = nullptr;
+
+// 指標
+static atomic_uint_least64_t stat_submitted = 0;
+static atomic_uint_least64_t stat_dropped = 0;
+static atomic_uint_least64_t stat_high_watermark = 0;
+static atomic_uint_least64_t stat_in_flight = 0;
+static atomic_uint_least64_t stat_retried = 0;
+static atomic_uint_least64_t stat_abandoned = 0;
+static atomic_uint_least64_t stat_replayed = 0;
+static atomic_uint_least64_t stat_delivered[NOTIFY_MAX_CHANNELS];
+static atomic_uint_least64_t stat_failed[NOTIFY_MAX_CHANNELS];
+static atomic_uint_least64_t stat_timed_out[NOTIFY_MAX_CHANNELS];
+static atomic_int_least64_t stat_last_latency_us[NOTIFY_MAX_CHANNELS];
+
+/**
+ * 讀取通知器配置
+ * @param keyfile 配置文件
+ * @param error 錯誤對象
+ */
+gboolean init_notifier_config(GKeyFile* keyfile, GError* error)
+{
+    (void)error; // 可選配置由 read_optional_* 自行處理錯誤
+
+    gint64 queue_size = 0;
+    gint64 email_timeout = 0;
+    gint64 sms_timeout = 0;
+    gint64 retry_base = 0;
+    gint64 retry_max = 0;
+    gint64 max_attempts = 0;
+    gint64 email_concurrency = 0;
+    gint64 sms_concurrency = 0;
+    gint64 handle_pool_size = 0;
+    gint64 max_host_connections = 0;
+
+    // 創建通知器配置對象
+    nt_config = g_malloc0(sizeof(notifier_config));
+
+    // 讀取佇列容量
+    if (!read_optional_integer(keyfile, "Notifier", "queue_size", 256, &queue_size)) goto error;
+    if (queue_size <= 0 || queue_size > 65536)
+    {
+        g_printerr("Error reading queue_size: must be between 1 and 65536\n");
+        goto error;
+    }
+
+    // 讀取郵件發送超時秒數
+    if (!read_optional_integer(keyfile, "Notifier", "email_timeout", 30, &email_timeout)) goto error;
+    if (email_timeout <= 0)
+    {
+        g_printerr("Error reading email_timeout: must be positive\n");
+        goto error;
+    }
+
+    // 讀取短信發送超時秒數
+    if (!read_optional_integer(keyfile, "Notifier", "sms_timeout", 10, &sms_timeout)) goto error;
+    if (sms_timeout <= 0)
+    {
+        g_printerr("Error reading sms_timeout: must be positive\n");
+        goto error;
+    }
+
+    // 讀取重試退避的初始與最大秒數
+    if (!read_optional_integer(keyfile, "Notifier", "retry_base", 5, &retry_base)) goto error;
+    if (!read_optional_integer(keyfile, "Notifier", "retry_max", 300, &retry_max)) goto error;
+    if (retry_base <= 0 || retry_max < retry_base)
+    {
+        g_printerr("Error reading retry_base: must be positive and not greater than retry_max\n");
+        goto error;
+    }
+
+    // 讀取單個通道的最大嘗試次數
+    if (!read_optional_integer(keyfile, "Notifier", "max_attempts", 8, &max_attempts)) goto error;
+    if (max_attempts <= 0 || max_attempts > 64)
+    {
+        g_printerr("Error reading max_attempts: must be between 1 and 64\n");
+        goto error;
+    }
+
+    // 讀取各通道的併發上限，郵件默認串行以復用同一個 SMTP 連接
+    if (!read_optional_integer(keyfile, "Notifier", "email_concurrency", 1, &email_concurrency)) goto error;
+    if (!read_optional_integer(keyfile, "Notifier", "sms_concurrency", 0, &sms_concurrency)) goto error;
+    if (email_concurrency < 0 || sms_concurrency < 0)
+    {
+        g_printerr("Error reading email_concurrency: must not be negative\n");
+        goto error;
+    }
+
+    // 讀取保留的 curl 句柄數量
+    if (!read_optional_integer(keyfile, "Notifier", "handle_pool_size", 8, &handle_pool_size)) goto error;
+    if (handle_pool_size < 0 || handle_pool_size > 1024)
+    {
+        g_printerr("Error reading handle_pool_size: must be between 0 and 1024\n");
+        goto error;
+    }
+
+    // 讀取每個主機的最大連接數，HTTP/2 請求在同一連接上多路復用
+    if (!read_optional_integer(keyfile, "Notifier", "max_host_connections", 1, &max_host_connections)) goto error;
+    if (max_host_connections < 0)
+    {
+        g_printerr("Error reading max_host_connections: must not be negative\n");
+        goto error;
+    }
+
+    nt_config->queue_size = (guint)queue_size;
+    nt_config->retry_base_ms = retry_base * 1000;
+    nt_config->retry_max_ms = retry_max * 1000;
+    nt_config->max_attempts = (guint)max_attempts;
+    nt_config->handle_pool_size = (guint)handle_pool_size;
+    nt_config->max_host_connections = (glong)max_host_connections;
+
+    // 註冊內置通道
+    if (!register_notify_channel("email", &email_backend, nullptr, (glong)(email_timeout * 1000),
+                                 (guint)email_concurrency))
+        goto error;
+    if (!register_notify_channel("sms", &sms_backend, nullptr, (glong)(sms_timeout * 1000), (guint)sms_concurrency))
+        goto error;
+    return TRUE;
+
+error:
+    // 釋放配置
+    destroy_notifier_config();
+    return FALSE;
+}
+
+/**
+ * 釋放通知器配置
+ */
+void destroy_notifier_config()
+{
+    for (guint i = 0; i < n_channels; ++i)
+    {
+        g_free(channels[i].name);
+    }
+    memset(channels, 0, sizeof(channels));
+    n_channels = 0;
+    g_free(nt_config);
+    nt_config = nullptr;
+}
+
+/**
+ * 註冊通道，需在啟動通知器之前調用
+ * @param name 通道名稱
+ * @param backend 後端
+ * @param config 通道配置，由註冊者負責釋放
+ * @param timeout_ms 單次發送的超時毫秒數
+ * @param concurrency 同時發送的請求上限，0 表示不限制
+ * @return 名稱重複或通道數量已達上限時返回 FALSE
+ */
+gboolean register_notify_channel(const gchar* name, const notify_backend* backend, const gpointer config,
+                                 const glong timeout_ms, const guint concurrency)
+{
+    if (n_channels >= NOTIFY_MAX_CHANNELS)
+    {
+        g_printerr("Error registering channel %s: at most %d channels are supported\n", name, NOTIFY_MAX_CHANNELS);
+        return FALSE;
+    }
+    for (guint i = 0; i < n_channels; ++i)
+    {
+        if (g_strcmp0(channels[i].name, name) != 0) continue;
+        g_printerr("Error registering channel %s: name already in use\n", name);
+        return FALSE;
+    }
+
+    channel_entry* entry = &channels[n_channels++];
+    entry->name = g_strdup(name);
+    entry->backend = backend;
+    entry->config = config;
+    entry->timeout_ms = timeout_ms;
+    entry->concurrency = concurrency;
+    return TRUE;
+}
+
+/**
+ * 根據名稱列表計算通道掩碼
+ * @param names 通道名稱列表
+ * @param mask 輸出的掩碼
+ * @return 存在未知的通道名稱時返回 FALSE
+ */
+gboolean notify_channel_mask(gchar** names, guint* mask)
+{
+    *mask = 0;
+    for (gint i = 0; names != nullptr && names[i] != nullptr; ++i)
+    {
+        guint channel = 0;
+        while (channel < n_channels && g_strcmp0(channels[channel].name, names[i]) != 0) channel++;
+        if (channel == n_channels)
+        {
+            g_printerr("Unknown notification channel: %s\n", names[i]);
+            return FALSE;
+        }
+        *mask |= 1u << channel;
+    }
+    return TRUE;
+}
+
+/**
+ * 讀取可選的通道列表配置，缺省時選擇所有通道，需在所有通道註冊之後調用
+ * @param keyfile 配置文件
+ * @param group 配置分組
+ * @param key 配置鍵
+ * @param mask 輸出的掩碼
+ * @return 配置格式錯誤或存在未知的通道名稱時返回 FALSE
+ */
+gboolean read_notify_channels(GKeyFile* keyfile, const gchar* group, const gchar* key, guint* mask)
+{
+    if (!g_key_file_has_key(keyfile, group, key, nullptr))
+    {
+        *mask = notify_all_channels();
+        return TRUE;
+    }
+
+    GError* error = nullptr;
+    gchar** names = g_key_file_get_string_list(keyfile, group, key, nullptr, &error);
+    if (error != nullptr)
+    {
+        g_printerr("Error reading %s %s: %s\n", group, key, error->message);
+        g_error_free(error);
+        return FALSE;
+    }
+    const gboolean ok = notify_channel_mask(names, mask);
+    g_strfreev(names);
+    if (!ok) g_printerr("Error reading %s %s: unknown channel\n", group, key);
+    return ok;
+}
+
+/**
+ * 所有通道的掩碼
+ * @return 掩碼
+ */
+guint notify_all_channels()
+{
+    return (1u << n_channels) - 1;
+}
+
+/**
+ * 逐條接收告警的通道掩碼
+ * @return 掩碼
+ */
+guint notify_per_alert_channels()
+{
+    guint mask = 0;
+    for (guint i = 0; i < n_channels; ++i)
+    {
+        if (channels[i].backend->per_alert) mask |= 1u << i;
+    }
+    return mask;
+}
+
+/**
+ * 獲取通道名稱
+ * @param channel 通道
+ * @return 名稱
+ */
+const gchar* notify_channel_name(const guint channel)
+{
+    return channel < n_channels ? channels[channel].name : "unknown";
+}
+
+/**
+ * 釋放通知
+ * @param n 通知
+ */
+static void free_notification(notification* n)
+{
+    g_free(n->subject);
+    g_free(n->body);
+    g_free(n->summary);
+    g_free(n->routes);
+    g_free(n->severity);
+    g_free(n->key);
+    g_free(n);
+}
+
+/**
+ * 從句柄池取得 curl 句柄，僅在通知工作線程中調用
+ * @return 句柄，失敗時返回空
+ */
+CURL* acquire_curl_handle()
+{
+    CURL* curl = handle_pool->len > 0
+                     ? g_ptr_array_steal_index_fast(handle_pool, handle_pool->len - 1)
+                     : curl_easy_init();
+    if (curl != nullptr) curl_easy_setopt(curl, CURLOPT_SHARE, share);
+    return curl;
+}
+
+/**
+ * 歸還句柄，重置選項但保留連接與會話緩存
+ * @param curl 句柄
+ */
+static void release_curl_handle(CURL* curl)
+{
+    if (handle_pool->len >= nt_config->handle_pool_size)
+    {
+        curl_easy_cleanup(curl);
+        return;
+    }
+    curl_easy_reset(curl);
+    g_ptr_array_add(handle_pool, curl);
+}
+
+/**
+ * 創建句柄池與共享對象
+ * @return 是否成功
+ */
+static gboolean init_handle_pool()
+{
+    share = curl_share_init();
+    if (share == nullptr)
+    {
+        g_printerr("Failed to initialize CURL share\n");
+        return FALSE;
+    }
+    // 句柄只在通知工作線程中使用，無需加鎖回調
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    handle_pool = g_ptr_array_new_with_free_func((GDestroyNotify)curl_easy_cleanup);
+    return TRUE;
+}
+
+/**
+ * 釋放句柄池與共享對象，句柄需在共享對象之前釋放
+ */
+static void destroy_handle_pool()
+{
+    if (handle_pool != nullptr)
+    {
+        g_ptr_array_free(handle_pool, TRUE);
+        handle_pool = nullptr;
+    }
+    if (share != nullptr)
+    {
+        curl_share_cleanup(share);
+        share = nullptr;
+    }
+}
+
+/**
+ * 釋放請求
+ * @param request 請求
+ */
+static void free_request(notify_request* request)
+{
+    if (request->curl) release_curl_handle(request->curl);
+    if (request->free_data && request->data) request->free_data(request->data);
+    if (request->response) g_string_free(request->response, TRUE);
+    g_free(request);
+}
+
+/**
+ * 初始化佇列，容量向上取整為 2 的冪
+ * @param capacity 容量
+ */
+static void queue_init(const guint capacity)
+{
+    gsize size = 1;
+    while (size < capacity) size <<= 1;
+
+    queue.cells = g_malloc0_n(size, sizeof(queue_cell));
+    queue.mask = size - 1;
+    for (gsize i = 0; i < size; ++i)
+    {
+        atomic_init(&queue.cells[i].sequence, i);
+    }
+    atomic_init(&queue.enqueue_pos, 0);
+    atomic_init(&queue.dequeue_pos, 0);
+}
+
+/**
+ * 入隊
+ * @param n 通知
+ * @return 佇列已滿時返回 FALSE
+ */
+static gboolean queue_push(notification* n)
+{
+    gsize pos = atomic_load_explicit(&queue.enqueue_pos, memory_order_relaxed);
+    for (;;)
+    {
+        queue_cell* cell = &queue.cells[pos & queue.mask];
+        const gsize seq = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        const gintptr diff = (gintptr)seq - (gintptr)pos;
+        if (diff == 0)
+        {
+            // 單元可寫，嘗試佔用該位置
+            if (atomic_compare_exchange_weak_explicit(&queue.enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+            {
+                cell->data = n;
+                atomic_store_explicit(&cell->sequence, pos + 1, memory_order_release);
+                return TRUE;
+            }
+        }
+        else if (diff < 0)
+        {
+            // 佇列已滿
+            return FALSE;
+        }
+        else
+        {
+            pos = atomic_load_explicit(&queue.enqueue_pos, memory_order_relaxed);
+        }
+    }
+}
+
+/**
+ * 出隊
+ * @return 通知，佇列為空時返回空
+ */
+static notification* queue_pop()
+{
+    gsize pos = atomic_load_explicit(&queue.dequeue_pos, memory_order_relaxed);
+    for (;;)
+    {
+        queue_cell* cell = &queue.cells[pos & queue.mask];
+        const gsize seq = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        const gintptr diff = (gintptr)seq - (gintptr)(pos + 1);
+        if (diff == 0)
+        {
+            // 單元可讀，嘗試取出
+            if (atomic_compare_exchange_weak_explicit(&queue.dequeue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+            {
+                notification* n = cell->data;
+                atomic_store_explicit(&cell->sequence, pos + queue.mask + 1, memory_order_release);
+                return n;
+            }
+        }
+        else if (diff < 0)
+        {
+            // 佇列為空
+            return nullptr;
+        }
+        else
+        {
+            pos = atomic_load_explicit(&queue.dequeue_pos, memory_order_relaxed);
+        }
+    }
+}
+
+/**
+ * 當前佇列深度（近似值）
+ * @return 深度
+ */
+static guint64 queue_depth()
+{
+    const gsize enqueued = atomic_load_explicit(&queue.enqueue_pos, memory_order_relaxed);
+    const gsize dequeued = atomic_load_explicit(&queue.dequeue_pos, memory_order_relaxed);
+    return enqueued > dequeued ? enqueued - dequeued : 0;
+}
+
+// 寫入 callback：將回傳的資料塞入 string
+static size_t write_callback(void* contents, size_t size, size_t nmemb, void* userp)
+{
+    const size_t realsize = size * nmemb;
+    const auto mem = (GString*)userp;
+    // 響應僅用於記錄錯誤，只保留開頭部分
+    if (mem->len < 4096)
+    {
+        g_string_append_len(mem, (const gchar*)contents, (gssize)MIN(realsize, 4096 - mem->len));
+    }
+    return realsize;
+}
+
+/**
+ * 將通知加入重試佇列，按重試時間排序
+ * @param n 通知
+ */
+static void schedule_retry(notification* n)
+{
+    GList* it = retry_queue.tail;
+    while (it != nullptr && ((notification*)it->data)->due_at > n->due_at) it = it->prev;
+    if (it == nullptr) g_queue_push_head(&retry_queue, n);
+    else g_queue_insert_after(&retry_queue, it, n);
+}
+
+/**
+ * 計算下次重試的延遲：指數退避加上均勻抖動（取退避值的後一半），避免多個告警同時重試
+ * @param attempts 已嘗試次數
+ * @return 延遲毫秒數
+ */
+static gint64 backoff_ms(const guint attempts)
+{
+    gint64 delay = nt_config->retry_base_ms;
+    for (guint i = 1; i < attempts && delay < nt_config->retry_max_ms; ++i) delay <<= 1;
+    delay = MIN(delay, nt_config->retry_max_ms);
+    return delay / 2 + (gint64)g_random_double_range(0, (gdouble)(delay / 2 + 1));
+}
+
+/**
+ * 某個通道放棄投遞
+ * @param n 通知
+ * @param channel 通道
+ */
+static void abandon_channel(notification* n, const guint channel)
+{
+    g_printerr("Giving up %s notification \"%s\" after %u attempts\n",
+               notify_channel_name(channel), n->subject, n->attempts[channel]);
+    atomic_fetch_add(&stat_abandoned, 1);
+    n->pending &= ~(1u << channel);
+    outbox_ack(n->outbox_id, channel);
+}
+
+/**
+ * 通知的所有請求結束後，全部成功則釋放，否則按退避時間重新排隊
+ * @param n 通知
+ */
+static void settle_notification(notification* n)
+{
+    if (n->in_flight > 0) return;
+    if (n->pending == 0)
+    {
+        free_notification(n);
+        return;
+    }
+
+    // 以尚未成功的通道中嘗試次數最多者計算退避
+    guint attempts = 0;
+    for (guint channel = 0; channel < n_channels; ++channel)
+    {
+        if (n->pending & (1u << channel)) attempts = MAX(attempts, n->attempts[channel]);
+    }
+    const gint64 delay = backoff_ms(attempts);
+    n->due_at = g_get_monotonic_time() + delay * 1000;
+    g_print("Retrying notification \"%s\" in %ld ms\n", n->subject, (glong)delay);
+    atomic_fetch_add(&stat_retried, 1);
+    schedule_retry(n);
+}
+
+/**
+ * 某個通道的請求失敗，計入嘗試次數，達到上限時放棄
+ * @param n 通知
+ * @param channel 通道
+ */
+static void channel_failed(notification* n, const guint channel)
+{
+    atomic_fetch_add(&stat_failed[channel], 1);
+    if (n->attempts[channel] >= nt_config->max_attempts) abandon_channel(n, channel);
+}
+
+/**
+ * 建構一個通道的請求並加入 multi 句柄
+ * @param n 通知
+ * @param channel 通道
+ * @return 是否已發出
+ */
+static gboolean start_request(notification* n, const guint channel)
+{
+    n->attempts[channel]++;
+
+    notify_request* request = g_malloc0(sizeof(notify_request));
+    request->channel = channel;
+    request->queued_at = n->queued_at;
+    request->response = g_string_new(nullptr);
+    request->owner = n;
+    trace_begin(&request->trace, "notify", nullptr);
+
+    // 交由通道後端建構 curl 句柄
+    const channel_entry* entry = &channels[channel];
+    const notify_message message = {n->subject, n->body, n->summary, n->routes, n->severity, n->key};
+    if (!entry->backend->prepare(request, &message, entry->config))
+    {
+        g_printerr("Failed to prepare %s notification\n", notify_channel_name(request->channel));
+        trace_end(&request->trace, TRUE, "%s prepare failed", notify_channel_name(channel));
+        free_request(request);
+        channel_failed(n, channel);
+        return FALSE;
+    }
+
+    // 通用選項：通道超時、禁止信號（多線程）、收集響應
+    curl_easy_setopt(request->curl, CURLOPT_PRIVATE, request);
+    curl_easy_setopt(request->curl, CURLOPT_TIMEOUT_MS, entry->timeout_ms);
+    curl_easy_setopt(request->curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(request->curl, CURLOPT_WRITEFUNCTION, write_callback);
+    curl_easy_setopt(request->curl, CURLOPT_WRITEDATA, request->response);
+
+    const CURLMcode res = curl_multi_add_handle(multi, request->curl);
+    if (res != CURLM_OK)
+    {
+        g_printerr("curl_multi_add_handle() failed: %s\n", curl_multi_strerror(res));
+        trace_end(&request->trace, TRUE, "%s not started", notify_channel_name(channel));
+        free_request(request);
+        channel_failed(n, channel);
+        return FALSE;
+    }
+    channel_in_flight[channel]++;
+    atomic_fetch_add(&stat_in_flight, 1);
+    return TRUE;
+}
+
+/**
+ * 通道未達併發上限時立即發出，否則排隊等待
+ * @param n 通知
+ * @param channel 通道
+ */
+static void submit_request(notification* n, const guint channel)
+{
+    n->in_flight++;
+    const guint limit = channels[channel].concurrency;
+    if (limit > 0 && channel_in_flight[channel] >= limit)
+    {
+        g_queue_push_tail(&channel_backlog[channel], n);
+        return;
+    }
+    if (!start_request(n, channel)) n->in_flight--;
+}
+
+/**
+ * 通道有空閒時發出排隊中的請求
+ *
+ * 郵件通道串行時，一批郵件在同一個 SMTP 連接上依次發送
+ * @param channel 通道
+ */
+static void drain_backlog(const guint channel)
+{
+    const guint limit = channels[channel].concurrency;
+    notification* n = nullptr;
+    while ((limit == 0 || channel_in_flight[channel] < limit) &&
+        (n = g_queue_pop_head(&channel_backlog[channel])) != nullptr)
+    {
+        if (start_request(n, channel)) continue;
+        n->in_flight--;
+        settle_notification(n);
+    }
+}
+
+/**
+ * 為一條通知建構尚未成功的各通道請求
+ * @param n 通知
+ */
+static void dispatch_notification(notification* n)
+{
+    for (guint channel = 0; channel < n_channels; ++channel)
+    {
+        if (n->pending & (1u << channel)) submit_request(n, channel);
+    }
+
+    // 沒有任何請求發出時直接進入重試或釋放
+    settle_notification(n);
+}
+
+/**
+ * 處理已完成的請求
+ */
+static void collect_finished()
+{
+    CURLMsg* msg = nullptr;
+    gint left = 0;
+
+    while ((msg = curl_multi_info_read(multi, &left)) != nullptr)
+    {
+        if (msg->msg != CURLMSG_DONE) continue;
+
+        notify_request* request = nullptr;
+        curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char**)&request);
+
+        notification* n = request->owner;
+        const guint channel = request->channel;
+        const CURLcode res = msg->data.result;
+        const gint64 latency_us = g_get_monotonic_time() - request->queued_at;
+        glong code = 0;
+        curl_easy_getinfo(msg->easy_handle, CURLINFO_RESPONSE_CODE, &code);
+
+        if (res != CURLE_OK)
+        {
+            g_printerr("%s notification failed: %s\n", notify_channel_name(channel), curl_easy_strerror(res));
+            if (res == CURLE_OPERATION_TIMEDOUT) atomic_fetch_add(&stat_timed_out[channel], 1);
+            channel_failed(n, channel);
+        }
+        else if (code >= 400)
+        {
+            g_printerr("%s notification rejected: status=%ld, response=%s\n",
+                       notify_channel_name(channel), code, request->response->str);
+            channel_failed(n, channel);
+        }
+        else
+        {
+            g_print("%s notification sent in %ld ms\n", notify_channel_name(channel), (glong)(latency_us / 1000));
+            atomic_fetch_add(&stat_delivered[channel], 1);
+            n->pending &= ~(1u << channel);
+            outbox_ack(n->outbox_id, channel);
+        }
+        atomic_store(&stat_last_latency_us[channel], latency_us);
+        trace_curl(&request->trace, msg->easy_handle);
+        trace_end(&request->trace, res != CURLE_OK || code >= 400, "%s attempt %u status %ld",
+                  notify_channel_name(channel), n->attempts[channel], code);
+
+        curl_multi_remove_handle(multi, request->curl);
+        atomic_fetch_sub(&stat_in_flight, 1);
+        free_request(request);
+        channel_in_flight[channel]--;
+
+        n->in_flight--;
+        settle_notification(n);
+        drain_backlog(channel);
+    }
+}
+
+/**
+ * 是否沒有發送中或等待通道空閒的請求
+ *
+ * 不能只看 curl_multi_perform 返回的傳輸數：處理完成的請求時會從等待佇列發出新的請求
+ * @return 所有通道均空閒時返回 TRUE
+ */
+static gboolean requests_idle()
+{
+    for (guint channel = 0; channel < n_channels; ++channel)
+    {
+        if (channel_in_flight[channel] > 0 || !g_queue_is_empty(&channel_backlog[channel])) return FALSE;
+    }
+    return TRUE;
+}
+
+/**
+ * 發出已到期的重試
+ * @return 距下一個重試到期的毫秒數，沒有等待中的重試時返回 -1
+ */
+static gint dispatch_due_retries()
+{
+    const gint64 now = g_get_monotonic_time();
+    notification* n = nullptr;
+    while ((n = g_queue_peek_head(&retry_queue)) != nullptr && n->due_at <= now)
+    {
+        g_queue_pop_head(&retry_queue);
+        dispatch_notification(n);
+    }
+    n = g_queue_peek_head(&retry_queue);
+    if (n == nullptr) return -1;
+    return (gint)MIN((n->due_at - g_get_monotonic_time()) / 1000 + 1, G_MAXINT);
+}
+
+/**
+ * 通知工作線程
+ *
+ * 所有通道的請求都在同一個 multi 句柄上併發執行，任何一個通道慢都不會阻塞其他通道或探測
+ * @param data 未使用
+ * @return 空
+ */
+static gpointer notifier_worker(gpointer data)
+{
+    (void)data; // 未使用
+    gint running = 0;
+
+    for (;;)
+    {
+        // 取出佇列中的全部通知
+        notification* n = nullptr;
+        while ((n = queue_pop()) != nullptr)
+        {
+            dispatch_notification(n);
+        }
+
+        // 發出到期的重試
+        const gint next_retry_ms = dispatch_due_retries();
+
+        // 推進所有傳輸並處理完成的請求
+        curl_multi_perform(multi, &running);
+        collect_finished();
+
+        // 組提交發件箱
+        outbox_sync(FALSE);
+
+        // 停止時等待佇列、發送中與等待通道空閒的請求全部完成，未完成的重試留在發件箱中待下次啟動重放
+        if (atomic_load(&stopping) && queue_depth() == 0 && requests_idle()) break;
+
+        // 等待網絡事件、新通知喚醒或下一個重試到期
+        gint timeout_ms = 1000;
+        if (next_retry_ms >= 0) timeout_ms = MIN(timeout_ms, next_retry_ms);
+        if (outbox_enabled()) timeout_ms = MIN(timeout_ms, (gint)o_config->sync_interval_ms);
+        curl_multi_poll(multi, nullptr, 0, timeout_ms, nullptr);
+    }
+
+    // 退出判斷之後才入隊的通知與等待中的重試一併釋放，已寫入發件箱的會在下次啟動時重放
+    notification* n = nullptr;
+    while ((n = queue_pop()) != nullptr) g_queue_push_tail(&retry_queue, n);
+    if (!g_queue_is_empty(&retry_queue))
+    {
+        g_print("%u undelivered notification(s) %s\n", g_queue_get_length(&retry_queue),
+                outbox_enabled() ? "are kept in the outbox" : "are dropped");
+    }
+    g_queue_clear_full(&retry_queue, (GDestroyNotify)free_notification);
+    return nullptr;
+}
+
+/**
+ * 重放發件箱中未確認的告警，在工作線程啟動前調用
+ */
+static void replay_notification(const guint64 id, const guint pending, const notify_message* message,
+                                gpointer user_data)
+{
+    (void)user_data; // 未使用
+
+    notification* n = g_malloc0(sizeof(notification));
+    n->subject = g_strdup(message->subject);
+    n->body = g_strdup(message->body);
+    n->summary = g_strdup(message->summary);
+    n->routes = g_strdup(message->routes);
+    n->severity = g_strdup(message->severity);
+    n->key = g_strdup(message->key);
+    n->queued_at = g_get_monotonic_time();
+    n->outbox_id = id;
+    n->pending = pending & notify_all_channels();
+    n->due_at = n->queued_at;
+    if (n->pending == 0)
+    {
+        free_notification(n);
+        return;
+    }
+    g_queue_push_tail(&retry_queue, n);
+    atomic_fetch_add(&stat_replayed, 1);
+}
+
+/**
+ * 啟動通知工作線程
+ * @return 是否成功
+ */
+gboolean start_notifier()
+{
+    queue_init(nt_config->queue_size);
+    for (gint i = 0; i < NOTIFY_MAX_CHANNELS; ++i)
+    {
+        channel_in_flight[i] = 0;
+        g_queue_init(&channel_backlog[i]);
+    }
+
+    // 創建句柄池
+    if (!init_handle_pool())
+    {
+        g_free(queue.cells);
+        queue.cells = nullptr;
+        return FALSE;
+    }
+
+    // 打開發件箱，未確認的告警立即重試
+    if (!open_outbox(replay_notification, nullptr))
+    {
+        g_printerr("Failed to open alert outbox\n");
+        g_queue_clear_full(&retry_queue, (GDestroyNotify)free_notification);
+        destroy_handle_pool();
+        g_free(queue.cells);
+        queue.cells = nullptr;
+        return FALSE;
+    }
+
+    multi = curl_multi_init();
+    if (multi == nullptr)
+    {
+        g_printerr("Failed to initialize CURL multi\n");
+        g_queue_clear_full(&retry_queue, (GDestroyNotify)free_notification);
+        close_outbox();
+        destroy_handle_pool();
+        g_free(queue.cells);
+        queue.cells = nullptr;
+        return FALSE;
+    }
+    // 所有通道共用一個 multi 句柄：HTTP/2 請求多路復用，同一主機的請求共用連接
+    curl_multi_setopt(multi, CURLMOPT_PIPELINING, (long)CURLPIPE_MULTIPLEX);
+    curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, nt_config->max_host_connections);
+
+    atomic_store(&stopping, false);
+    worker = g_thread_new("notifier", notifier_worker, nullptr);
+    g_print("Notifier started with queue size %lu and %u channel(s).\n", (gulong)(queue.mask + 1), n_channels);
+    return TRUE;
+}
+
+/**
+ * 停止通知工作線程，等待佇列中的通知發送完畢
+ */
+void stop_notifier()
+{
+    if (worker == nullptr) return;
+
+    // 通知工作線程退出
+    atomic_store(&stopping, true);
+    curl_multi_wakeup(multi);
+    g_thread_join(worker);
+    worker = nullptr;
+
+    // 輸出最終指標
+    log_notifier_stats();
+
+    // 落盤並關閉發件箱
+    close_outbox();
+
+    // 釋放資源
+    curl_multi_cleanup(multi);
+    multi = nullptr;
+    destroy_handle_pool();
+    g_free(queue.cells);
+    queue.cells = nullptr;
+}
+
+/**
+ * 提交通知，僅入隊不做任何網絡操作
+ * @param channels 需要投遞的通道掩碼
+ * @param message 通知內容，summary 為空時使用 body，routes 為空時使用默認收件人
+ * @return 佇列已滿時返回 FALSE
+ */
+gboolean notify(const guint channels, const notify_message* message)
+{
+    if (worker == nullptr)
+    {
+        g_printerr("Notifier is not running, notification dropped\n");
+        return FALSE;
+    }
+    if ((channels & notify_all_channels()) == 0) return TRUE;
+
+    notification* n = g_malloc0(sizeof(notification));
+    n->subject = g_strdup(message->subject);
+    n->body = g_strdup(message->body);
+    n->summary = g_strdup(message->summary);
+    n->routes = g_strdup(message->routes);
+    n->severity = g_strdup(message->severity);
+    n->key = g_strdup(message->key);
+    n->queued_at = g_get_monotonic_time();
+    n->pending = channels & notify_all_channels();
+
+    // 先寫入發件箱再投遞，僅做內存拷貝，由工作線程組提交落盤
+    n->outbox_id = outbox_append(n->pending, message);
+
+    // 佇列已滿時丟棄，不阻塞調用者；已寫入發件箱的告警會在下次啟動時重放
+    if (!queue_push(n))
+    {
+        const guint64 dropped = atomic_fetch_add(&stat_dropped, 1) + 1;
+        if (dropped == 1 || dropped % 100 == 0)
+        {
+            g_printerr("Notification queue is full, %lu notifications dropped so far%s\n", (gulong)dropped,
+                       outbox_enabled() ? " (kept in the outbox for replay)" : "");
+        }
+        free_notification(n);
+        return FALSE;
+    }
+    atomic_fetch_add(&stat_submitted, 1);
+
+    // 更新最高水位
+    const guint64 depth = queue_depth();
+    guint64 high = atomic_load(&stat_high_watermark);
+    while (depth > high && !atomic_compare_exchange_weak(&stat_high_watermark, &high, depth))
+    {
+    }
+
+    // 喚醒工作線程
+    curl_multi_wakeup(multi);
+    return TRUE;
+}
+
+/**
+ * 獲取通知器指標快照
+ * @param stats 輸出的指標
+ */
+void get_notifier_stats(notifier_stats* stats)
+{
+    stats->submitted = atomic_load(&stat_submitted);
+    stats->dropped = atomic_load(&stat_dropped);
+    stats->queue_depth = queue.cells ? queue_depth() : 0;
+    stats->queue_high_watermark = atomic_load(&stat_high_watermark);
+    stats->in_flight = atomic_load(&stat_in_flight);
+    stats->retried = atomic_load(&stat_retried);
+    stats->abandoned = atomic_load(&stat_abandoned);
+    stats->replayed = atomic_load(&stat_replayed);
+    stats->n_channels = n_channels;
+    for (guint i = 0; i < n_channels; ++i)
+    {
+        stats->delivered[i] = atomic_load(&stat_delivered[i]);
+        stats->failed[i] = atomic_load(&stat_failed[i]);
+        stats->timed_out[i] = atomic_load(&stat_timed_out[i]);
+        stats->last_latency_us[i] = atomic_load(&stat_last_latency_us[i]);
+    }
+}
+
+/**
+ * 輸出通知器指標
+ */
+void log_notifier_stats()
+{
+    notifier_stats stats;
+    get_notifier_stats(&stats);
+
+    GString* line = g_string_new(nullptr);
+    g_string_append_printf(line, "Notifier stats: submitted=%lu dropped=%lu depth=%lu high_watermark=%lu in_flight=%lu"
+                           " retried=%lu abandoned=%lu replayed=%lu",
+                           (gulong)stats.submitted, (gulong)stats.dropped, (gulong)stats.queue_depth,
+                           (gulong)stats.queue_high_watermark, (gulong)stats.in_flight,
+                           (gulong)stats.retried, (gulong)stats.abandoned, (gulong)stats.replayed);
+    for (guint i = 0; i < stats.n_channels; ++i)
+    {
+        g_string_append_printf(line, " %s(delivered=%lu failed=%lu timed_out=%lu last_latency_ms=%ld)",
+                               notify_channel_name(i),
+                               (gulong)stats.delivered[i], (gulong)stats.failed[i], (gulong)stats.timed_out[i],
+                               (glong)(stats.last_latency_us[i] / 1000));
+    }
+    g_print("%s\n", line->str);
+    g_string_free(line, TRUE);
+}
@@ -0,0 +1,238 @@
+#pragma once
+#include <glib.h>
+#include <curl/curl.h>
+
+#include "trace.h"
+
+// 通道數量上限，發件箱以 16 位掩碼記錄待投遞的通道
+#define NOTIFY_MAX_CHANNELS 16
+
+/**
+ * 通知器配置
+ *
+ * 配置:
+ *  - queue_size 通知佇列容量，佇列滿時新通知會被丟棄並計入指標
+ *  - email_timeout / sms_timeout 郵件與短信通道單次發送的超時秒數
+ *  - email_concurrency / sms_concurrency 郵件與短信通道同時發送的請求上限，0 表示不限制
+ *  - retry_base / retry_max 失敗重試的初始與最大退避秒數，實際延遲帶隨機抖動
+ *  - max_attempts 單個通道的最大嘗試次數，超過後放棄並從發件箱確認
+ *  - handle_pool_size 保留的 curl 句柄數量
+ *  - max_host_connections 每個主機的最大連接數，HTTP/2 請求在同一連接上多路復用，0 表示不限制
+ */
+typedef struct notifier_config
+{
+    // 通知佇列容量
+    guint queue_size;
+    // 初始退避毫秒數
+    gint64 retry_base_ms;
+    // 最大退避毫秒數
+    gint64 retry_max_ms;
+    // 單個通道最大嘗試次數
+    guint max_attempts;
+    // 保留的 curl 句柄數量
+    guint handle_pool_size;
+    // 每個主機的最大連接數
+    glong max_host_connections;
+} notifier_config;
+
+typedef notifier_config* notifier_config_t;
+
+extern notifier_config_t nt_config;
+
+/**
+ * 待發送的通知內容
+ */
+typedef struct notify_message
+{
+    // 主題
+    const gchar* subject;
+    // 內容
+    const gchar* body;
+    // 簡短內容，供短信等有長度限制的通道使用，可為空
+    const gchar* summary;
+    // 涉及的集群（分號分隔），可為空
+    const gchar* routes;
+    // 嚴重程度 (warning、critical 或 resolved)，可為空
+    const gchar* severity;
+    // 單條告警的穩定標識，逐條發送時設定，摘要為空
+    const gchar* key;
+} notify_message;
+
+/**
+ * 待發送的請求
+ *
+ * 由各通道建構，curl 句柄與私有資料在請求完成後由通知器統一釋放
+ */
+typedef struct notify_request
+{
+    // 所屬通道
+    guint channel;
+    // curl 句柄，由 acquire_curl_handle 取得
+    CURL* curl;
+    // 通道私有資料
+    gpointer data;
+    // 私有資料的釋放函數
+    GDestroyNotify free_data;
+    // 響應內容
+    GString* response;
+    // 通知入隊時間（單調時鐘，微秒）
+    gint64 queued_at;
+    // 所屬通知，由通知器使用
+    gpointer owner;
+    // 本次發送的 span，由通知器使用
+    trace_scope trace;
+} notify_request;
+
+/**
+ * 通知後端
+ *
+ * 每個通道由一個後端與該通道的配置組成，後端只負責建構請求，發送、超時與重試由通知器統一處理
+ */
+typedef struct notify_backend
+{
+    // 後端類型
+    const gchar* kind;
+    // 是否逐條接收告警而非摘要，外部系統以 key 去重並配對觸發與恢復
+    gboolean per_alert;
+
+    /**
+     * 建構請求，設定 request 的 curl、data 與 free_data，在通知工作線程中調用
+     * @param request 請求對象
+     * @param message 通知內容
+     * @param config 通道配置
+     * @return 是否成功
+     */
+    gboolean (*prepare)(notify_request* request, const notify_message* message, gpointer config);
+} notify_backend;
+
+/**
+ * 通知器指標快照
+ */
+typedef struct notifier_stats
+{
+    // 已入隊的通知數
+    guint64 submitted;
+    // 佇列已滿而丟棄的通知數
+    guint64 dropped;
+    // 當前佇列深度
+    guint64 queue_depth;
+    // 佇列深度的最高水位
+    guint64 queue_high_watermark;
+    // 正在發送中的請求數
+    guint64 in_flight;
+    // 重新排隊等待重試的次數
+    guint64 retried;
+    // 達到最大嘗試次數而放棄的通道投遞數
+    guint64 abandoned;
+    // 啟動時從發件箱重放的通知數
+    guint64 replayed;
+    // 通道數量
+    guint n_channels;
+    // 各通道發送成功數
+    guint64 delivered[NOTIFY_MAX_CHANNELS];
+    // 各通道發送失敗數（含超時）
+    guint64 failed[NOTIFY_MAX_CHANNELS];
+    // 各通道發送超時數
+    guint64 timed_out[NOTIFY_MAX_CHANNELS];
+    // 各通道最近一次從入隊到完成的耗時（微秒）
+    gint64 last_latency_us[NOTIFY_MAX_CHANNELS];
+} notifier_stats;
+
+/**
+ * 讀取通知器配置，並註冊內置的 email 與 sms 通道，需在 email 與 sms 配置之後讀取
+ * @param keyfile 配置文件
+ * @param error 錯誤對象
+ */
+gboolean init_notifier_config(GKeyFile* keyfile, GError* error);
+
+/**
+ * 釋放通知器配置與已註冊的通道
+ */
+void destroy_notifier_config();
+
+/**
+ * 註冊通道，需在啟動通知器之前調用
+ * @param name 通道名稱
+ * @param backend 後端
+ * @param config 通道配置，由註冊者負責釋放
+ * @param timeout_ms 單次發送的超時毫秒數
+ * @param concurrency 同時發送的請求上限，0 表示不限制
+ * @return 名稱重複或通道數量已達上限時返回 FALSE
+ */
+gboolean register_notify_channel(const gchar* name, const notify_backend* backend, gpointer config,
+                                 glong timeout_ms, guint concurrency);
+
+/**
+ * 根據名稱列表計算通道掩碼
+ * @param names 通道名稱列表
+ * @param mask 輸出的掩碼
+ * @return 存在未知的通道名稱時返回 FALSE
+ */
+gboolean notify_channel_mask(gchar** names, guint* mask);
+
+/**
+ * 讀取可選的通道列表配置，缺省時選擇所有通道，需在所有通道註冊之後調用
+ * @param keyfile 配置文件
+ * @param group 配置分組
+ * @param key 配置鍵
+ * @param mask 輸出的掩碼
+ * @return 配置格式錯誤或存在未知的通道名稱時返回 FALSE
+ */
+gboolean read_notify_channels(GKeyFile* keyfile, const gchar* group, const gchar* key, guint* mask);
+
+/**
+ * 所有通道的掩碼
+ * @return 掩碼
+ */
+guint notify_all_channels();
+
+/**
+ * 逐條接收告警的通道掩碼
+ * @return 掩碼
+ */
+guint notify_per_alert_channels();
+
+/**
+ * 啟動通知工作線程，打開發件箱並重放未確認的告警
+ * @return 是否成功
+ */
+gboolean start_notifier();
+
+/**
+ * 停止通知工作線程，等待佇列中的通知發送完畢，等待重試的通知留在發件箱中
+ */
+void stop_notifier();
+
+/**
+ * 提交通知，僅入隊不做任何網絡操作
+ * @param channels 需要投遞的通道掩碼
+ * @param message 通知內容，summary 為空時使用 body，routes 為空時使用默認收件人
+ * @return 佇列已滿時返回 FALSE
+ */
+gboolean notify(guint channels, const notify_message* message);
+
+/**
+ * 從句柄池取得 curl 句柄，僅在通知工作線程中調用
+ *
+ * 句柄共享 TLS 會話與 DNS 緩存，歸還時重置選項但保留連接
+ * @return 句柄，失敗時返回空
+ */
+CURL* acquire_curl_handle();
+
+/**
+ * 獲取通知器指標快照
+ * @param stats 輸出的指標
+ */
+void get_notifier_stats(notifier_stats* stats);
+
+/**
+ * 輸出通知器指標
+ */
+void log_notifier_stats();
+
+/**
+ * 獲取通道名稱
+ * @param channel 通道
+ * @return 名稱
+ */
+const gchar* notify_channel_name(guint channel);
@@ -0,0 +1,760 @@
+#include "outbox.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "config.h"
+
+// 發件箱配置
+outbox_config_t o_config = nullptr;
+
+// 記錄魔數 "OBX1"
+#define OUTBOX_MAGIC 0x3158424fu
+// 告警記錄
+#define RECORD_ALERT 1
+// 確認記錄
+#define RECORD_ACK 2
+// 段文件名
+#define SEGMENT_PREFIX "outbox-"
+#define SEGMENT_SUFFIX ".seg"
+
+/**
+ * 記錄頭，magic 最後寫入，未寫完的記錄在重放時被視為段結尾
+ *
+ * crc 覆蓋 type、channels、id 與記錄內容
+ */
+typedef struct record_header
+{
+    // 魔數
+    guint32 magic;
+    // 內容長度
+    guint32 length;
+    // 校驗和
+    guint32 crc;
+    // 記錄類型
+    guint16 type;
+    // 告警記錄為通道位掩碼，確認記錄為通道序號
+    guint16 channels;
+    // 記錄ID
+    guint64 id;
+} record_header;
+
+/**
+ * 段文件
+ */
+typedef struct segment
+{
+    // 序號
+    guint64 seq;
+    // 文件路徑
+    gchar* path;
+    // 文件描述符
+    gint fd;
+    // 映射地址
+    guint8* map;
+    // 段大小
+    gsize size;
+    // 已寫入長度
+    gsize used;
+    // 已落盤長度
+    gsize synced;
+    // 未完全確認的告警數
+    guint outstanding;
+    // 正在落盤的引用數
+    guint busy;
+    // 落盤結束後需要刪除
+    gboolean doomed;
+} segment;
+
+/**
+ * 未完全確認的告警
+ */
+typedef struct outbox_entry
+{
+    // 記錄ID
+    guint64 id;
+    // 所在段
+    segment* seg;
+    // 尚未確認的通道位掩碼
+    guint pending;
+} outbox_entry;
+
+/**
+ * 重放時收集的告警
+ */
+typedef struct recovered_alert
+{
+    guint64 id;
+    gchar* subject;
+    gchar* body;
+    gchar* summary;
+    gchar* routes;
+    gchar* severity;
+    gchar* key;
+} recovered_alert;
+
+// 保護以下狀態，追加只在鎖內做內存拷貝
+static GMutex lock;
+// 段文件，由舊到新
+static GQueue segments = G_QUEUE_INIT;
+// 當前寫入的段
+static segment* active_segment = nullptr;
+// 未完全確認的告警 (id -> outbox_entry)
+static GHashTable* entries = nullptr;
+// 下一個記錄ID
+static guint64 next_id = 1;
+// 上次落盤時間
+static gint64 last_sync = 0;
+// 是否已打開
+static gboolean opened = FALSE;
+// CRC32 查表
+static guint32 crc_table[256];
+
+/**
+ * 讀取發件箱配置
+ * @param keyfile 配置文件
+ * @param error 錯誤對象
+ */
+gboolean init_outbox_config(GKeyFile* keyfile, GError* error)
+{
+    (void)error; // 可選配置由 read_optional_* 自行處理錯誤
+
+    // 創建發件箱配置對象
+    o_config = g_malloc0(sizeof(outbox_config));
+
+    // 讀取段文件目錄
+    if (!read_optional_string(keyfile, "Outbox", "path", nullptr, &o_config->path)) goto error;
+
+    // 讀取段文件大小
+    if (!read_optional_integer(keyfile, "Outbox", "segment_size", 4 * 1024 * 1024, &o_config->segment_size))
+        goto error;
+    if (o_config->segment_size < 64 * 1024 || o_config->segment_size > G_MAXUINT32)
+    {
+        g_printerr("Error reading segment_size: must be between 64KiB and 4GiB\n");
+        goto error;
+    }
+
+    // 讀取組提交間隔
+    if (!read_optional_integer(keyfile, "Outbox", "sync_interval_ms", 1000, &o_config->sync_interval_ms))
+        goto error;
+    return TRUE;
+
+error:
+    // 釋放配置
+    destroy_outbox_config();
+    return FALSE;
+}
+
+/**
+ * 釋放發件箱配置
+ */
+void destroy_outbox_config()
+{
+    if (o_config == nullptr) return;
+    g_free(o_config->path);
+    g_free(o_config);
+    o_config = nullptr;
+}
+
+/**
+ * 初始化 CRC32 查表（IEEE 多項式）
+ */
+static void crc32_init()
+{
+    for (guint32 i = 0; i < 256; ++i)
+    {
+        guint32 c = i;
+        for (gint k = 0; k < 8; ++k)
+        {
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        crc_table[i] = c;
+    }
+}
+
+/**
+ * 計算 CRC32
+ * @param crc 初始值
+ * @param data 數據
+ * @param len 長度
+ * @return CRC32
+ */
+static guint32 crc32_update(guint32 crc, const guint8* data, gsize len)
+{
+    crc = ~crc;
+    while (len--)
+    {
+        crc = crc_table[(crc ^ *data++) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+/**
+ * 計算記錄的校驗和
+ * @param header 記錄頭
+ * @param payload 記錄內容
+ * @return 校驗和
+ */
+static guint32 record_crc(const record_header* header, const guint8* payload)
+{
+    const gsize covered = sizeof(record_header) - offsetof(record_header, type);
+    const guint32 crc = crc32_update(0, (const guint8*)header + offsetof(record_header, type), covered);
+    return crc32_update(crc, payload, header->length);
+}
+
+/**
+ * 按 8 字節對齊
+ */
+static gsize align8(const gsize n)
+{
+    return (n + 7) & ~(gsize)7;
+}
+
+/**
+ * 映射段文件
+ * @param path 文件路徑
+ * @param seq 序號
+ * @param fd 已打開的文件
+ * @return 段，失敗時返回空
+ */
+static segment* map_segment(gchar* path, const guint64 seq, const gint fd)
+{
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        g_printerr("Cannot stat outbox segment %s: %s\n", path, g_strerror(errno));
+        close(fd);
+        g_free(path);
+        return nullptr;
+    }
+
+    guint8* map = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED)
+    {
+        g_printerr("Cannot map outbox segment %s: %s\n", path, g_strerror(errno));
+        close(fd);
+        g_free(path);
+        return nullptr;
+    }
+
+    segment* seg = g_malloc0(sizeof(segment));
+    seg->seq = seq;
+    seg->path = path;
+    seg->fd = fd;
+    seg->map = map;
+    seg->size = st.st_size;
+    return seg;
+}
+
+/**
+ * 創建新的段文件
+ * @param seq 序號
+ * @return 段，失敗時返回空
+ */
+static segment* create_segment(const guint64 seq)
+{
+    gchar* path = g_strdup_printf("%s/" SEGMENT_PREFIX "%020lu" SEGMENT_SUFFIX, o_config->path, (gulong)seq);
+    const gint fd = open(path, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (fd < 0)
+    {
+        g_printerr("Cannot create outbox segment %s: %s\n", path, g_strerror(errno));
+        g_free(path);
+        return nullptr;
+    }
+
+    // 預先分配，新文件內容為零，未寫入的位置不會被誤認為記錄
+    if (ftruncate(fd, o_config->segment_size) != 0)
+    {
+        g_printerr("Cannot allocate outbox segment %s: %s\n", path, g_strerror(errno));
+        close(fd);
+        unlink(path);
+        g_free(path);
+        return nullptr;
+    }
+    fsync(fd);
+    return map_segment(path, seq, fd);
+}
+
+/**
+ * 釋放段的映射與文件
+ * @param seg 段
+ * @param remove 是否刪除文件
+ */
+static void release_segment(segment* seg, const gboolean remove)
+{
+    munmap(seg->map, seg->size);
+    close(seg->fd);
+    if (remove) unlink(seg->path);
+    g_free(seg->path);
+    g_free(seg);
+}
+
+/**
+ * 刪除段，正在落盤時延遲到落盤結束
+ * @param seg 段
+ */
+static void delete_segment(segment* seg)
+{
+    if (seg->busy > 0)
+    {
+        seg->doomed = TRUE;
+        return;
+    }
+    release_segment(seg, TRUE);
+}
+
+/**
+ * 回收最舊的已完全確認的段
+ *
+ * 確認記錄總是寫在告警之後的段中，因此只按順序回收前綴，保證重放時不會丟失確認
+ */
+static void reclaim_segments()
+{
+    segment* head = nullptr;
+    while ((head = g_queue_peek_head(&segments)) != nullptr && head != active_segment && head->outstanding == 0)
+    {
+        g_queue_pop_head(&segments);
+        delete_segment(head);
+    }
+}
+
+/**
+ * 寫入一條記錄，調用者需持有鎖
+ * @param type 記錄類型
+ * @param channels 通道
+ * @param id 記錄ID
+ * @param parts 記錄內容（以 NUL 結尾的字符串）
+ * @param n_parts 內容數量
+ * @return 是否成功
+ */
+static gboolean write_record(const guint16 type, const guint16 channels, const guint64 id,
+                             const gchar* const* parts, const gsize n_parts)
+{
+    gsize length = 0;
+    for (gsize i = 0; i < n_parts; ++i)
+    {
+        length += strlen(parts[i]) + 1;
+    }
+
+    const gsize total = align8(sizeof(record_header) + length);
+    if (total > active_segment->size)
+    {
+        g_printerr("Outbox record of %lu bytes does not fit in a segment\n", (gulong)total);
+        return FALSE;
+    }
+
+    // 當前段已滿，切換到新段
+    if (active_segment->used + total > active_segment->size)
+    {
+        segment* next = create_segment(active_segment->seq + 1);
+        if (next == nullptr) return FALSE;
+        g_queue_push_tail(&segments, next);
+        active_segment = next;
+        reclaim_segments();
+    }
+
+    guint8* dst = active_segment->map + active_segment->used;
+
+    // 先寫內容
+    guint8* p = dst + sizeof(record_header);
+    for (gsize i = 0; i < n_parts; ++i)
+    {
+        const gsize len = strlen(parts[i]) + 1;
+        memcpy(p, parts[i], len);
+        p += len;
+    }
+
+    // 再寫除魔數外的記錄頭
+    record_header header = {0, (guint32)length, 0, type, channels, id};
+    header.crc = record_crc(&header, dst + sizeof(record_header));
+    memcpy(dst + sizeof(guint32), (const guint8*)&header + sizeof(guint32), sizeof(record_header) - sizeof(guint32));
+
+    // 最後寫魔數，記錄生效
+    atomic_thread_fence(memory_order_release);
+    header.magic = OUTBOX_MAGIC;
+    memcpy(dst, &header.magic, sizeof(guint32));
+
+    active_segment->used += total;
+    return TRUE;
+}
+
+/**
+ * 釋放重放時收集的告警
+ * @param data 告警
+ */
+static void free_recovered_alert(gpointer data)
+{
+    recovered_alert* alert = data;
+    g_free(alert->subject);
+    g_free(alert->body);
+    g_free(alert->summary);
+    g_free(alert->routes);
+    g_free(alert->severity);
+    g_free(alert->key);
+    g_free(alert);
+}
+
+/**
+ * 從記錄內容中讀取下一個字符串
+ * @param p 當前位置
+ * @param end 內容結尾
+ * @return 字符串，格式錯誤時返回空
+ */
+static const gchar* next_string(const guint8** p, const guint8* end)
+{
+    const guint8* nul = memchr(*p, '\0', end - *p);
+    if (nul == nullptr) return nullptr;
+    const gchar* s = (const gchar*)*p;
+    *p = nul + 1;
+    return s;
+}
+
+/**
+ * 掃描段內的記錄，重建未確認的告警
+ * @param seg 段
+ * @param recovered 收集的告警 (recovered_alert*)
+ */
+static void scan_segment(segment* seg, GPtrArray* recovered)
+{
+    gsize off = 0;
+    while (off + sizeof(record_header) <= seg->size)
+    {
+        record_header header;
+        memcpy(&header, seg->map + off, sizeof(record_header));
+        if (header.magic != OUTBOX_MAGIC) break;
+
+        const gsize total = align8(sizeof(record_header) + header.length);
+        const guint8* payload = seg->map + off + sizeof(record_header);
+        if (off + total > seg->size || record_crc(&header, payload) != header.crc)
+        {
+            g_printerr("Outbox segment %s is corrupt at offset %lu, ignoring the rest\n", seg->path, (gulong)off);
+            break;
+        }
+
+        if (header.type == RECORD_ALERT)
+        {
+            const guint8* p = payload;
+            const guint8* end = payload + header.length;
+            const gchar* subject = next_string(&p, end);
+            const gchar* body = subject ? next_string(&p, end) : nullptr;
+            const gchar* summary = body ? next_string(&p, end) : nullptr;
+            // 較早的記錄沒有路由、嚴重程度與告警標識
+            const gchar* routes = summary ? next_string(&p, end) : nullptr;
+            const gchar* severity = routes ? next_string(&p, end) : nullptr;
+            const gchar* key = severity ? next_string(&p, end) : nullptr;
+            if (summary != nullptr)
+            {
+                recovered_alert* alert = g_malloc0(sizeof(recovered_alert));
+                alert->id = header.id;
+                alert->subject = g_strdup(subject);
+                alert->body = g_strdup(body);
+                alert->summary = *summary ? g_strdup(summary) : nullptr;
+                alert->routes = routes && *routes ? g_strdup(routes) : nullptr;
+                alert->severity = severity && *severity ? g_strdup(severity) : nullptr;
+                alert->key = key && *key ? g_strdup(key) : nullptr;
+                g_ptr_array_add(recovered, alert);
+
+                outbox_entry* entry = g_malloc0(sizeof(outbox_entry));
+                entry->id = header.id;
+                entry->seg = seg;
+                entry->pending = header.channels;
+                g_hash_table_insert(entries, &entry->id, entry);
+                seg->outstanding++;
+            }
+        }
+        else if (header.type == RECORD_ACK)
+        {
+            outbox_entry* entry = g_hash_table_lookup(entries, &header.id);
+            if (entry != nullptr)
+            {
+                entry->pending &= ~(1u << header.channels);
+                if (entry->pending == 0)
+                {
+                    entry->seg->outstanding--;
+                    g_hash_table_remove(entries, &header.id);
+                }
+            }
+        }
+
+        next_id = MAX(next_id, header.id + 1);
+        off += total;
+    }
+    seg->used = seg->synced = off;
+}
+
+/**
+ * 比較段序號
+ */
+static gint compare_seq(gconstpointer a, gconstpointer b)
+{
+    const guint64 x = *(const guint64*)a;
+    const guint64 y = *(const guint64*)b;
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+/**
+ * 打開發件箱並重放未確認的告警
+ * @param replay 重放回調
+ * @param user_data 用戶數據
+ * @return 是否成功，未啟用時返回 TRUE
+ */
+gboolean open_outbox(const outbox_replay_fn replay, const gpointer user_data)
+{
+    GError* error = nullptr;
+
+    // 未配置目錄時不啟用
+    if (o_config == nullptr || o_config->path == nullptr || *o_config->path == '\0') return TRUE;
+
+    crc32_init();
+    if (g_mkdir_with_parents(o_config->path, 0700) != 0)
+    {
+        g_printerr("Cannot create outbox directory %s: %s\n", o_config->path, g_strerror(errno));
+        return FALSE;
+    }
+
+    // 列出已有的段文件
+    GDir* dir = g_dir_open(o_config->path, 0, &error);
+    if (dir == nullptr)
+    {
+        g_printerr("Cannot open outbox directory: %s\n", error->message);
+        g_error_free(error);
+        return FALSE;
+    }
+    GArray* seqs = g_array_new(FALSE, FALSE, sizeof(guint64));
+    const gchar* name = nullptr;
+    while ((name = g_dir_read_name(dir)) != nullptr)
+    {
+        if (!g_str_has_prefix(name, SEGMENT_PREFIX) || !g_str_has_suffix(name, SEGMENT_SUFFIX)) continue;
+        const guint64 seq = g_ascii_strtoull(name + strlen(SEGMENT_PREFIX), nullptr, 10);
+        g_array_append_val(seqs, seq);
+    }
+    g_dir_close(dir);
+    g_array_sort(seqs, compare_seq);
+
+    // 按順序重建狀態
+    entries = g_hash_table_new_full(g_int64_hash, g_int64_equal, nullptr, g_free);
+    GPtrArray* recovered = g_ptr_array_new_with_free_func(free_recovered_alert);
+    guint64 max_seq = 0;
+    for (guint i = 0; i < seqs->len; ++i)
+    {
+        const guint64 seq = g_array_index(seqs, guint64, i);
+        gchar* path = g_strdup_printf("%s/" SEGMENT_PREFIX "%020lu" SEGMENT_SUFFIX, o_config->path, (gulong)seq);
+        const gint fd = open(path, O_RDWR | O_CLOEXEC);
+        if (fd < 0)
+        {
+            g_printerr("Cannot open outbox segment %s: %s\n", path, g_strerror(errno));
+            g_free(path);
+            continue;
+        }
+        segment* seg = map_segment(path, seq, fd);
+        if (seg == nullptr) continue;
+        g_queue_push_tail(&segments, seg);
+        scan_segment(seg, recovered);
+        max_seq = MAX(max_seq, seq);
+    }
+    g_array_free(seqs, TRUE);
+
+    // 新的寫入總是從新段開始
+    active_segment = create_segment(max_seq + 1);
+    if (active_segment == nullptr)
+    {
+        g_ptr_array_free(recovered, TRUE);
+        close_outbox();
+        return FALSE;
+    }
+    g_queue_push_tail(&segments, active_segment);
+    last_sync = g_get_monotonic_time();
+    opened = TRUE;
+
+    // 重放未確認的告警
+    guint replayed = 0;
+    for (guint i = 0; i < recovered->len; ++i)
+    {
+        const recovered_alert* alert = g_ptr_array_index(recovered, i);
+        const outbox_entry* entry = g_hash_table_lookup(entries, &alert->id);
+        if (entry == nullptr) continue;
+        const notify_message message = {
+            .subject = alert->subject,
+            .body = alert->body,
+            .summary = alert->summary,
+            .routes = alert->routes,
+            .severity = alert->severity,
+            .key = alert->key,
+        };
+        replay(alert->id, entry->pending, &message, user_data);
+        replayed++;
+    }
+    g_ptr_array_free(recovered, TRUE);
+    reclaim_segments();
+
+    g_print("Outbox opened at %s, %u pending alert(s) replayed.\n", o_config->path, replayed);
+    return TRUE;
+}
+
+/**
+ * 關閉發件箱，落盤後釋放映射
+ */
+void close_outbox()
+{
+    if (opened) outbox_sync(TRUE);
+    opened = FALSE;
+
+    segment* seg = nullptr;
+    while ((seg = g_queue_pop_head(&segments)) != nullptr)
+    {
+        release_segment(seg, FALSE);
+    }
+    active_segment = nullptr;
+    if (entries != nullptr)
+    {
+        g_hash_table_destroy(entries);
+        entries = nullptr;
+    }
+}
+
+/**
+ * 發件箱是否已啟用
+ * @return 是否啟用
+ */
+gboolean outbox_enabled()
+{
+    return opened;
+}
+
+/**
+ * 追加一條告警，只寫入映射內存，不落盤
+ * @param channels 需要投遞的通道位掩碼
+ * @param message 告警內容
+ * @return 記錄ID，未啟用或寫入失敗時返回 0
+ */
+guint64 outbox_append(const guint channels, const notify_message* message)
+{
+    if (!opened) return 0;
+
+    const gchar* parts[] = {
+        message->subject,
+        message->body,
+        message->summary ? message->summary : "",
+        message->routes ? message->routes : "",
+        message->severity ? message->severity : "",
+        message->key ? message->key : "",
+    };
+
+    g_mutex_lock(&lock);
+    const guint64 id = next_id;
+    if (!write_record(RECORD_ALERT, (guint16)channels, id, parts, G_N_ELEMENTS(parts)))
+    {
+        g_mutex_unlock(&lock);
+        return 0;
+    }
+    next_id++;
+
+    outbox_entry* entry = g_malloc0(sizeof(outbox_entry));
+    entry->id = id;
+    entry->seg = active_segment;
+    entry->pending = channels;
+    g_hash_table_insert(entries, &entry->id, entry);
+    active_segment->outstanding++;
+    g_mutex_unlock(&lock);
+
+    return id;
+}
+
+/**
+ * 確認某個通道已投遞，所有通道確認後記錄可被回收
+ * @param id 記錄ID
+ * @param channel 通道
+ */
+void outbox_ack(guint64 id, const guint channel)
+{
+    if (!opened || id == 0) return;
+
+    g_mutex_lock(&lock);
+    outbox_entry* entry = g_hash_table_lookup(entries, &id);
+    if (entry == nullptr || !(entry->pending & (1u << channel)))
+    {
+        g_mutex_unlock(&lock);
+        return;
+    }
+
+    if (!write_record(RECORD_ACK, (guint16)channel, id, nullptr, 0))
+    {
+        g_printerr("Cannot record outbox acknowledgement for %lu, it may be delivered again after restart\n",
+                   (gulong)id);
+    }
+
+    entry->pending &= ~(1u << channel);
+    if (entry->pending == 0)
+    {
+        entry->seg->outstanding--;
+        g_hash_table_remove(entries, &id);
+        reclaim_segments();
+    }
+    g_mutex_unlock(&lock);
+}
+
+/**
+ * 組提交：距上次落盤超過間隔時將新寫入的記錄落盤
+ *
+ * msync 在鎖外執行，落盤期間追加不受影響
+ * @param force 是否忽略間隔立即落盤
+ */
+void outbox_sync(const gboolean force)
+{
+    if (!opened) return;
+
+    const gint64 now = g_get_monotonic_time();
+    const gsize page = (gsize)sysconf(_SC_PAGESIZE);
+
+    g_mutex_lock(&lock);
+    if (!force && now - last_sync < o_config->sync_interval_ms * 1000)
+    {
+        g_mutex_unlock(&lock);
+        return;
+    }
+    last_sync = now;
+
+    // 收集有新寫入的段
+    GPtrArray* dirty = g_ptr_array_new();
+    GArray* targets_used = g_array_new(FALSE, FALSE, sizeof(gsize));
+    for (GList* it = segments.head; it != nullptr; it = it->next)
+    {
+        segment* seg = it->data;
+        if (seg->used <= seg->synced) continue;
+        seg->busy++;
+        g_ptr_array_add(dirty, seg);
+        g_array_append_val(targets_used, seg->used);
+    }
+    g_mutex_unlock(&lock);
+
+    // 落盤
+    for (guint i = 0; i < dirty->len; ++i)
+    {
+        const segment* seg = g_ptr_array_index(dirty, i);
+        const gsize from = seg->synced / page * page;
+        const gsize to = g_array_index(targets_used, gsize, i);
+        if (msync(seg->map + from, to - from, MS_SYNC) != 0)
+        {
+            g_printerr("Cannot sync outbox segment %s: %s\n", seg->path, g_strerror(errno));
+        }
+    }
+
+    // 更新落盤位置，處理落盤期間被回收的段
+    g_mutex_lock(&lock);
+    for (guint i = 0; i < dirty->len; ++i)
+    {
+        segment* seg = g_ptr_array_index(dirty, i);
+        seg->synced = MAX(seg->synced, g_array_index(targets_used, gsize, i));
+        seg->busy--;
+        if (seg->doomed && seg->busy == 0) release_segment(seg, TRUE);
+    }
+    g_mutex_unlock(&lock);
+
+    g_ptr_array_free(dirty, TRUE);
+    g_array_free(targets_used, TRUE);
+}
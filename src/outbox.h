@@ -0,0 +1,87 @@
+#pragma once
+#include <glib.h>
+
+#include "notifier.h"
+
+/**
+ * 告警發件箱配置
+ *
+ * 配置:
+ *  - path 段文件目錄，為空時不啟用發件箱
+ *  - segment_size 單個段文件大小（字節）
+ *  - sync_interval_ms 組提交間隔毫秒數，寫入不逐條落盤
+ */
+typedef struct outbox_config
+{
+    // 段文件目錄
+    gchar* path;
+    // 單個段文件大小
+    gint64 segment_size;
+    // 組提交間隔毫秒數
+    gint64 sync_interval_ms;
+} outbox_config;
+
+typedef outbox_config* outbox_config_t;
+
+extern outbox_config_t o_config;
+
+/**
+ * 重放回調，每條未確認的告警調用一次
+ * @param id 記錄ID
+ * @param pending 尚未確認的通道位掩碼
+ * @param message 告警內容
+ * @param user_data 用戶數據
+ */
+typedef void (*outbox_replay_fn)(guint64 id, guint pending, const notify_message* message, gpointer user_data);
+
+/**
+ * 讀取發件箱配置
+ * @param keyfile 配置文件
+ * @param error 錯誤對象
+ */
+gboolean init_outbox_config(GKeyFile* keyfile, GError* error);
+
+/**
+ * 釋放發件箱配置
+ */
+void destroy_outbox_config();
+
+/**
+ * 打開發件箱並重放未確認的告警
+ * @param replay 重放回調
+ * @param user_data 用戶數據
+ * @return 是否成功，未啟用時返回 TRUE
+ */
+gboolean open_outbox(outbox_replay_fn replay, gpointer user_data);
+
+/**
+ * 關閉發件箱，落盤後釋放映射
+ */
+void close_outbox();
+
+/**
+ * 發件箱是否已啟用
+ * @return 是否啟用
+ */
+gboolean outbox_enabled();
+
+/**
+ * 追加一條告警，只寫入映射內存，不落盤
+ * @param channels 需要投遞的通道位掩碼
+ * @param message 告警內容
+ * @return 記錄ID，未啟用或寫入失敗時返回 0
+ */
+guint64 outbox_append(guint channels, const notify_message* message);
+
+/**
+ * 確認某個通道已投遞，所有通道確認後記錄可被回收
+ * @param id 記錄ID
+ * @param channel 通道
+ */
+void outbox_ack(guint64 id, guint channel);
+
+/**
+ * 組提交：距上次落盤超過間隔時將新寫入的記錄落盤
+ * @param force 是否忽略間隔立即落盤
+ */
+void outbox_sync(gboolean force);
@@ -0,0 +1,1137 @@
+#include "probe.h"
+
+#include <errno.h>
+#include <math.h>
+#include <netdb.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <hiredis/hiredis.h>
+#include <hiredis/async.h>
+#include <hiredis/adapters/libevent.h>
+
+#include "arena.h"
+#include "config.h"
+#include "loopmon.h"
+#include "resp_uring.h"
+#include "trace.h"
+
+// 探測配置
+probe_config_t pr_config = nullptr;
+
+// φ 值採用的成功間隔數
+#define PHI_WINDOW 64
+// 探測分配器首個塊的容量，足以容納常見的 INFO 響應
+#define PROBE_ARENA_SIZE 8192
+
+// 預先編碼的命令，發送時不再格式化
+#define PING_COMMAND "*1\r\n$4\r\nPING\r\n"
+#define INFO_COMMAND "*1\r\n$4\r\nINFO\r\n"
+static const gchar ping_command[] = PING_COMMAND;
+static const gchar info_command[] = INFO_COMMAND;
+// io_uring 以流水線一次寫入
+static const gchar ping_info_commands[] = PING_COMMAND INFO_COMMAND;
+
+/**
+ * 探測階段
+ */
+typedef enum probe_phase
+{
+    // 空閒，等待下一次定時器
+    PHASE_IDLE = 0,
+    // 建立連接
+    PHASE_CONNECT,
+    // 發送 AUTH
+    PHASE_AUTH,
+    // 發送 PING
+    PHASE_PING,
+    // 發送 INFO
+    PHASE_INFO
+} probe_phase;
+
+// 各階段的 span 名稱
+static const gchar* const phase_spans[] = {"probe.idle", "probe.connect", "probe.auth", "probe.ping", "probe.info"};
+
+/**
+ * 探測器私有狀態
+ */
+struct probe_state
+{
+    // 所屬目標
+    target* owner;
+    // 定時器
+    struct event* timer;
+    // 定時器預定的觸發時間（單調時鐘）
+    gint64 due;
+    // 常駐連接
+    redisAsyncContext* ctx;
+    // 常駐連接 (io_uring)
+    resp_conn* conn;
+    // 當前連接是否已認證
+    gboolean authenticated;
+    // 當前階段
+    probe_phase phase;
+    // 探測開始時間（單調時鐘）
+    gint64 started;
+    // 當前階段開始時間（單調時鐘）
+    gint64 phase_started;
+    // PING 的發送時間（單調時鐘），流水線中為整批命令的發送時間
+    gint64 ping_sent;
+    // 當前探測結果
+    probe_result result;
+    // 本次探測的 span
+    trace_scope trace;
+    // 本次探測的臨時對象（響應、命令），探測結束時重置
+    arena* scratch;
+    // 是否佔用連接名額
+    gboolean connecting;
+    // 是否在等待連接名額
+    gboolean waiting;
+    // 是否已完成過一次探測
+    gboolean probed;
+    // 最近一次成功的時間（單調時鐘），未成功過時為 0
+    gint64 last_success;
+    // 最近的成功間隔（微秒），環形保存
+    gdouble intervals[PHI_WINDOW];
+    // 已保存的間隔數
+    guint n_intervals;
+    // 下一個間隔的位置
+    guint next_interval;
+    // 間隔總和
+    gdouble interval_sum;
+    // 間隔平方和
+    gdouble interval_square_sum;
+};
+
+// 事件循環
+static struct event_base* probe_base = nullptr;
+// 探測結果回調
+static probe_result_fn result_callback = nullptr;
+// 回調的用戶數據
+static gpointer result_user_data = nullptr;
+// 是否正在停止
+static gboolean stopping = FALSE;
+// 是否使用 io_uring
+static gboolean uring = FALSE;
+// 正在建立的連接數
+static guint connecting = 0;
+// 等待連接名額的探測器
+static GQueue connect_waiters = G_QUEUE_INIT;
+// 尚未完成首次探測的目標數
+static guint unprobed = 0;
+// 是否所有目標都已完成首次探測
+static gboolean ready = FALSE;
+// 開始探測的時間（單調時鐘）
+static gint64 probes_started_at = 0;
+// 被測量的回調
+static loop_site timer_site = LOOP_SITE("probe.timer");
+static loop_site connect_site = LOOP_SITE("probe.connect");
+static loop_site result_site = LOOP_SITE("probe.result");
+
+/**
+ * 讀取探測配置
+ * @param keyfile 配置文件
+ * @param error 錯誤對象
+ */
+gboolean init_probe_config(GKeyFile* keyfile, GError* error)
+{
+    (void)error; // 可選配置由 read_optional_* 自行處理錯誤
+
+    gint64 startup_window = 0;
+    gint64 max_connecting = 0;
+    gchar* backend = nullptr;
+    gboolean tcp_info = FALSE;
+    gint64 uring_entries = 0;
+    gint64 uring_connections = 0;
+    gint64 uring_buffer = 0;
+
+    // 創建探測配置對象
+    pr_config = g_malloc0(sizeof(probe_config));
+
+    // 讀取啟動窗口秒數
+    if (!read_optional_integer(keyfile, "Probe", "startup_window", 5, &startup_window)) goto error;
+    // 讀取同時建立連接的上限
+    if (!read_optional_integer(keyfile, "Probe", "max_connecting", 32, &max_connecting)) goto error;
+    if (startup_window < 0 || max_connecting < 0)
+    {
+        g_printerr("Error reading startup_window: startup_window and max_connecting must not be negative\n");
+        goto error;
+    }
+
+    pr_config->startup_window_ms = startup_window * 1000;
+    pr_config->max_connecting = (guint)max_connecting;
+
+    // 讀取探測連接的實現
+    if (!read_optional_string(keyfile, "Probe", "backend", probe_backend_name(PROBE_BACKEND_LIBEVENT), &backend))
+        goto error;
+    if (g_strcmp0(backend, probe_backend_name(PROBE_BACKEND_LIBEVENT)) == 0)
+        pr_config->backend = PROBE_BACKEND_LIBEVENT;
+    else if (g_strcmp0(backend, probe_backend_name(PROBE_BACKEND_URING)) == 0)
+        pr_config->backend = PROBE_BACKEND_URING;
+    else
+    {
+        g_printerr("Error reading backend: unknown probe backend %s, expected libevent or io_uring\n", backend);
+        goto error;
+    }
+    // 讀取 io_uring 的隊列、連接與緩衝區大小
+    if (!read_optional_integer(keyfile, "Probe", "uring_entries", 1024, &uring_entries)) goto error;
+    if (!read_optional_integer(keyfile, "Probe", "uring_connections", 16384, &uring_connections)) goto error;
+    if (!read_optional_integer(keyfile, "Probe", "uring_buffer", 8192, &uring_buffer)) goto error;
+    if (uring_entries < 1 || uring_entries > 32768 || uring_connections < 1 || uring_connections > 1 << 24 ||
+        uring_buffer < 512 || uring_buffer > 1 << 20)
+    {
+        g_printerr("Error reading uring_entries: uring_entries must be 1-32768, uring_connections 1-16777216 "
+                   "and uring_buffer 512-1048576\n");
+        goto error;
+    }
+
+    pr_config->uring_entries = (guint)uring_entries;
+    pr_config->uring_connections = (guint)uring_connections;
+    pr_config->uring_buffer = (gsize)uring_buffer;
+
+    // 讀取是否採集 TCP_INFO
+    if (!read_optional_boolean(keyfile, "Probe", "tcp_info", TRUE, &tcp_info)) goto error;
+    pr_config->tcp_info = tcp_info;
+    g_free(backend);
+    return TRUE;
+
+error:
+    // 釋放配置
+    g_free(backend);
+    destroy_probe_config();
+    return FALSE;
+}
+
+/**
+ * 釋放探測配置
+ */
+void destroy_probe_config()
+{
+    g_free(pr_config);
+    pr_config = nullptr;
+}
+
+/**
+ * 探測連接實現的名稱
+ * @param backend 實現
+ * @return 名稱
+ */
+const gchar* probe_backend_name(const probe_backend backend)
+{
+    return backend == PROBE_BACKEND_URING ? "io_uring" : "libevent";
+}
+
+static void send_auth(probe_state* state);
+static void send_ping(probe_state* state);
+static void send_info(probe_state* state);
+
+/**
+ * 安排下一次探測
+ * @param state 探測器狀態
+ */
+static void schedule_next(probe_state* state)
+{
+    const struct timeval interval = {state->owner->config->interval_seconds, 0};
+    state->due = g_get_monotonic_time() + state->owner->config->interval_seconds * G_USEC_PER_SEC;
+    evtimer_add(state->timer, &interval);
+}
+
+/**
+ * 安排首次探測，在啟動窗口內隨機分佈，避免所有目標同時連接
+ * @param state 探測器狀態
+ */
+static void schedule_first(probe_state* state)
+{
+    const gint64 window_us = MIN(pr_config->startup_window_ms * 1000,
+                                 state->owner->config->interval_seconds * G_USEC_PER_SEC);
+    const gint64 delay_us = window_us > 0 ? (gint64)(g_random_double() * (gdouble)window_us) : 0;
+    const struct timeval delay = {delay_us / G_USEC_PER_SEC, delay_us % G_USEC_PER_SEC};
+    state->due = g_get_monotonic_time() + delay_us;
+    evtimer_add(state->timer, &delay);
+}
+
+/**
+ * 記錄目標已完成首次探測，所有目標都完成時報告就緒
+ * @param state 探測器狀態
+ */
+static void mark_probed(probe_state* state)
+{
+    if (state->probed) return;
+    state->probed = TRUE;
+    if (ready || --unprobed > 0) return;
+
+    ready = TRUE;
+    g_print("Ready: all %u target(s) probed in %.1fs.\n", targets->len,
+            (gdouble)(g_get_monotonic_time() - probes_started_at) / G_USEC_PER_SEC);
+}
+
+/**
+ * 記錄一次成功的探測，更新 φ 值所需的間隔分佈
+ * @param state 探測器狀態
+ */
+static void record_success(probe_state* state)
+{
+    const gint64 now = g_get_monotonic_time();
+    if (state->last_success > 0)
+    {
+        const gdouble interval = (gdouble)(now - state->last_success);
+        if (state->n_intervals == PHI_WINDOW)
+        {
+            const gdouble oldest = state->intervals[state->next_interval];
+            state->interval_sum -= oldest;
+            state->interval_square_sum -= oldest * oldest;
+        }
+        else
+        {
+            state->n_intervals++;
+        }
+        state->intervals[state->next_interval] = interval;
+        state->next_interval = (state->next_interval + 1) % PHI_WINDOW;
+        state->interval_sum += interval;
+        state->interval_square_sum += interval * interval;
+    }
+    state->last_success = now;
+}
+
+/**
+ * 結束當前階段並返回耗時
+ * @param state 探測器狀態
+ * @return 當前階段耗時（微秒）
+ */
+static gint64 end_phase(probe_state* state)
+{
+    const gint64 now = g_get_monotonic_time();
+    const gint64 elapsed = now - state->phase_started;
+    if (state->trace.context.span_id != 0)
+    {
+        trace_record(&state->trace.context, phase_spans[state->phase],
+                     state->trace.start_us + (state->phase_started - state->trace.started), elapsed, FALSE, nullptr);
+    }
+    state->phase_started = now;
+    return elapsed;
+}
+
+/**
+ * 關閉 io_uring 連接，在下一次探測時重新連接
+ * @param state 探測器狀態
+ */
+static void close_uring_connection(probe_state* state)
+{
+    resp_conn_close(state->conn);
+    state->conn = nullptr;
+    state->authenticated = FALSE;
+}
+
+/**
+ * 結束本次探測，回報結果並安排下一次探測
+ * @param state 探測器狀態
+ * @param outcome 探測結果
+ * @param format 錯誤信息格式，成功時為空
+ */
+static void finish_probe(probe_state* state, const probe_outcome outcome, const gchar* format, ...)
+{
+    if (state->phase == PHASE_IDLE) return;
+
+    probe_result* result = &state->result;
+    result->outcome = outcome;
+    result->total_us = g_get_monotonic_time() - state->started;
+    if (format != nullptr)
+    {
+        va_list args;
+        va_start(args, format);
+        g_vsnprintf(result->error, sizeof(result->error), format, args);
+        va_end(args);
+    }
+    target* t = state->owner;
+    const trace_context context = state->trace.context;
+    if (context.span_id != 0)
+    {
+        // 未完成的階段記為失敗
+        if (outcome != PROBE_OK)
+        {
+            const gint64 now = g_get_monotonic_time();
+            trace_record(&context, phase_spans[state->phase],
+                         state->trace.start_us + (state->phase_started - state->trace.started),
+                         now - state->phase_started, TRUE, result->error);
+        }
+        trace_end(&state->trace, outcome != PROBE_OK, "%s %s", t->config->name, probe_outcome_name(outcome));
+    }
+    state->phase = PHASE_IDLE;
+    // 流水線中還有未到達的響應（如 AUTH 失敗）時關閉連接，避免錯配到下一次探測
+    if (state->conn != nullptr && resp_conn_pending(state->conn) > 0) close_uring_connection(state);
+
+    // 保存結果
+    t->last_result = *result;
+    if (outcome == PROBE_OK)
+    {
+        t->last_success = *result;
+        record_success(state);
+    }
+
+    if (stopping)
+    {
+        arena_reset(state->scratch);
+        return;
+    }
+    mark_probed(state);
+
+    // 結果處理（告警、重啓等）記為探測的子 span，在其中排隊的重啓會關聯到本次探測
+    trace_scope handle;
+    trace_enter(&handle, "probe.handle", &context);
+    const gint64 started = loop_enter();
+    result_callback(t, result, result_user_data);
+    loop_leave(&result_site, started);
+    trace_end(&handle, FALSE, nullptr);
+    schedule_next(state);
+
+    // 響應與錯誤信息都已處理完，釋放本次探測的臨時對象
+    arena_reset(state->scratch);
+}
+
+/**
+ * 命令沒有響應時，根據連接錯誤判斷失敗類型
+ * @param state 探測器狀態
+ * @param c 連接
+ */
+static void fail_without_reply(probe_state* state, const redisAsyncContext* c)
+{
+    if (c->c.err == REDIS_ERR_TIMEOUT)
+    {
+        finish_probe(state, PROBE_TIMEOUT, "%s", c->c.errstr);
+    }
+    else
+    {
+        finish_probe(state, PROBE_CONNECT_ERROR, "%s", c->c.err ? c->c.errstr : "connection lost");
+    }
+}
+
+/**
+ * 比較 INFO 鍵名
+ * @param key 鍵名起始
+ * @param len 鍵名長度
+ * @param expected 預期鍵名
+ * @return 是否相等
+ */
+static gboolean info_key_equals(const gchar* key, const gsize len, const gchar* expected)
+{
+    return strlen(expected) == len && memcmp(key, expected, len) == 0;
+}
+
+/**
+ * 解析 INFO 響應中的關鍵指標
+ * @param text INFO 響應
+ * @param len 響應長度
+ * @param info 輸出的指標
+ */
+static void parse_info(const gchar* text, const gsize len, probe_info* info)
+{
+    const gchar* p = text;
+    const gchar* end = text + len;
+
+    while (p < end)
+    {
+        const gchar* eol = memchr(p, '\n', end - p);
+        if (eol == nullptr) eol = end;
+
+        // 跳過分組標題 "# Server"
+        const gchar* colon = *p == '#' ? nullptr : memchr(p, ':', eol - p);
+        if (colon != nullptr)
+        {
+            const gsize key_len = colon - p;
+            const gint64 value = g_ascii_strtoll(colon + 1, nullptr, 10);
+            if (info_key_equals(p, key_len, "connected_clients")) info->connected_clients = value;
+            else if (info_key_equals(p, key_len, "blocked_clients")) info->blocked_clients = value;
+            else if (info_key_equals(p, key_len, "used_memory")) info->used_memory = value;
+            else if (info_key_equals(p, key_len, "instantaneous_ops_per_sec")) info->ops_per_sec = value;
+            else if (info_key_equals(p, key_len, "uptime_in_seconds")) info->uptime_seconds = value;
+        }
+        p = eol + 1;
+    }
+}
+
+/**
+ * 處理 INFO 響應
+ * @param state 探測器狀態
+ * @param reply 響應
+ */
+static void handle_info(probe_state* state, const redisReply* reply)
+{
+    state->result.info_us = end_phase(state);
+
+    if (reply->type != REDIS_REPLY_STRING && reply->type != REDIS_REPLY_VERB)
+    {
+        finish_probe(state, PROBE_BAD_REPLY, "unexpected INFO reply: type=%d", reply->type);
+        return;
+    }
+    parse_info(reply->str, reply->len, &state->result.info);
+    finish_probe(state, PROBE_OK, nullptr);
+}
+
+/**
+ * 讀取常駐連接的 TCP_INFO，並以 PING 從發送到響應的耗時減去網絡往返時間估計服務端耗時；
+ * io_uring 的 PING 階段從 AUTH 響應到達時開始計時，因此不使用階段耗時
+ * @param state 探測器狀態，在 PING 響應到達時調用
+ */
+static void read_tcp_info(probe_state* state)
+{
+    if (!pr_config->tcp_info) return;
+    const gint fd = state->conn != nullptr ? resp_conn_fd(state->conn) : state->ctx->c.fd;
+
+    struct tcp_info info;
+    socklen_t length = sizeof(info);
+    if (getsockopt(fd, IPPROTO_TCP, TCP_INFO, &info, &length) != 0) return;
+    // Unix 套接字等不支持 TCP_INFO 時沒有往返時間
+    if (length < offsetof(struct tcp_info, tcpi_total_retrans) + sizeof(info.tcpi_total_retrans) ||
+        info.tcpi_rtt == 0)
+        return;
+
+    probe_tcp* tcp = &state->result.tcp;
+    tcp->rtt_us = info.tcpi_rtt;
+    tcp->rttvar_us = info.tcpi_rttvar;
+    tcp->retransmits = info.tcpi_total_retrans;
+    tcp->cwnd = info.tcpi_snd_cwnd;
+    tcp->server_us = MAX(state->phase_started - state->ping_sent - tcp->rtt_us, 0);
+}
+
+/**
+ * 處理 PING 響應
+ * @param state 探測器狀態
+ * @param reply 響應
+ */
+static void handle_ping(probe_state* state, const redisReply* reply)
+{
+    state->result.ping_us = end_phase(state);
+
+    // 檢查回應
+    if (reply->type != REDIS_REPLY_STATUS || strcmp(reply->str, "PONG") != 0)
+    {
+        finish_probe(state, PROBE_BAD_REPLY, "Redis responds to exceptions: type=%d, str=%s",
+                     reply->type, reply->str ? reply->str : "");
+        return;
+    }
+    read_tcp_info(state);
+    send_info(state);
+}
+
+/**
+ * 處理 AUTH 響應
+ * @param state 探測器狀態
+ * @param reply 響應
+ */
+static void handle_auth(probe_state* state, const redisReply* reply)
+{
+    state->result.auth_us = end_phase(state);
+
+    if (reply->type == REDIS_REPLY_ERROR)
+    {
+        finish_probe(state, PROBE_AUTH_ERROR, "%s", reply->str);
+        return;
+    }
+    state->authenticated = TRUE;
+    send_ping(state);
+}
+
+/**
+ * INFO 響應回調
+ * @param c 連接
+ * @param r 響應
+ * @param privdata 探測器狀態
+ */
+static void on_info(redisAsyncContext* c, void* r, void* privdata)
+{
+    if (r == nullptr) fail_without_reply(privdata, c);
+    else handle_info(privdata, r);
+}
+
+/**
+ * PING 響應回調
+ * @param c 連接
+ * @param r 響應
+ * @param privdata 探測器狀態
+ */
+static void on_ping(redisAsyncContext* c, void* r, void* privdata)
+{
+    if (r == nullptr) fail_without_reply(privdata, c);
+    else handle_ping(privdata, r);
+}
+
+/**
+ * AUTH 響應回調
+ * @param c 連接
+ * @param r 響應
+ * @param privdata 探測器狀態
+ */
+static void on_auth(redisAsyncContext* c, void* r, void* privdata)
+{
+    if (r == nullptr) fail_without_reply(privdata, c);
+    else handle_auth(privdata, r);
+}
+
+/**
+ * 在探測分配器中編碼 AUTH
+ * @param state 探測器狀態
+ * @param suffix 附加在其後的命令
+ * @param length 輸出的長度
+ * @return 命令
+ */
+static const gchar* encode_auth(probe_state* state, const gchar* suffix, gsize* length)
+{
+    const target_config* config = state->owner->config;
+    if (config->username != nullptr && *config->username != '\0')
+        return arena_printf(state->scratch, length, "*3\r\n$4\r\nAUTH\r\n$%zu\r\n%s\r\n$%zu\r\n%s\r\n%s",
+                            strlen(config->username), config->username, strlen(config->password),
+                            config->password, suffix);
+    return arena_printf(state->scratch, length, "*2\r\n$4\r\nAUTH\r\n$%zu\r\n%s\r\n%s",
+                        strlen(config->password), config->password, suffix);
+}
+
+/**
+ * 發送 AUTH
+ * @param state 探測器狀態
+ */
+static void send_auth(probe_state* state)
+{
+    state->phase = PHASE_AUTH;
+
+    gsize length;
+    const gchar* command = encode_auth(state, "", &length);
+    if (redisAsyncFormattedCommand(state->ctx, on_auth, state, command, length) != REDIS_OK)
+        finish_probe(state, PROBE_CONNECT_ERROR, "Sending AUTH failed");
+}
+
+/**
+ * 發送 PING；使用 io_uring 時命令已隨流水線發出，只進入下一階段
+ * @param state 探測器狀態
+ */
+static void send_ping(probe_state* state)
+{
+    state->phase = PHASE_PING;
+    if (state->conn != nullptr) return;
+    state->ping_sent = state->phase_started;
+    if (redisAsyncFormattedCommand(state->ctx, on_ping, state, ping_command, sizeof(ping_command) - 1) != REDIS_OK)
+        finish_probe(state, PROBE_CONNECT_ERROR, "Sending PING failed");
+}
+
+/**
+ * 發送 INFO；使用 io_uring 時命令已隨流水線發出，只進入下一階段
+ * @param state 探測器狀態
+ */
+static void send_info(probe_state* state)
+{
+    state->phase = PHASE_INFO;
+    if (state->conn != nullptr) return;
+    if (redisAsyncFormattedCommand(state->ctx, on_info, state, info_command, sizeof(info_command) - 1) != REDIS_OK)
+        finish_probe(state, PROBE_CONNECT_ERROR, "Sending INFO failed");
+}
+
+/**
+ * 以流水線一次寫入本次探測的所有命令 (io_uring)，響應按 AUTH、PING、INFO 的順序到達
+ * @param state 探測器狀態
+ */
+static void send_pipeline(probe_state* state)
+{
+    const target_config* config = state->owner->config;
+    const gboolean auth = config->auth && !state->authenticated;
+    state->phase = auth ? PHASE_AUTH : PHASE_PING;
+    state->ping_sent = state->phase_started;
+
+    gsize length = sizeof(ping_info_commands) - 1;
+    const gchar* commands = auth ? encode_auth(state, ping_info_commands, &length) : ping_info_commands;
+    if (!resp_conn_send(state->conn, commands, length, auth ? 3 : 2, config->connect_timeout_seconds * 1000))
+        finish_probe(state, PROBE_CONNECT_ERROR, "Sending commands failed");
+}
+
+/**
+ * 發送本次探測的命令，連接尚未認證時先發送 AUTH
+ * @param state 探測器狀態
+ */
+static void start_commands(probe_state* state)
+{
+    if (state->conn != nullptr) send_pipeline(state);
+    else if (state->owner->config->auth && !state->authenticated) send_auth(state);
+    else send_ping(state);
+}
+
+static void open_connection(probe_state* state);
+
+/**
+ * 歸還連接名額，並讓等待中的探測器開始連接
+ * @param state 探測器狀態
+ */
+static void release_connect_slot(probe_state* state)
+{
+    if (!state->connecting) return;
+    state->connecting = FALSE;
+    connecting--;
+
+    while (!stopping && !g_queue_is_empty(&connect_waiters) &&
+        (pr_config->max_connecting == 0 || connecting < pr_config->max_connecting))
+    {
+        probe_state* waiter = g_queue_pop_head(&connect_waiters);
+        waiter->waiting = FALSE;
+        open_connection(waiter);
+    }
+}
+
+/**
+ * 連接完成回調
+ * @param c 連接
+ * @param status 連接狀態
+ */
+static void on_connect(const redisAsyncContext* c, const int status)
+{
+    const gint64 started = loop_enter();
+    probe_state* state = c->data;
+    release_connect_slot(state);
+
+    // 連接失敗時 hiredis 會自動釋放連接
+    if (status != REDIS_OK)
+    {
+        state->ctx = nullptr;
+        finish_probe(state, PROBE_CONNECT_ERROR, "%s", c->c.errstr);
+    }
+    else
+    {
+        state->result.connect_us = end_phase(state);
+        start_commands(state);
+    }
+    loop_leave(&connect_site, started);
+}
+
+/**
+ * 連接斷開回調
+ * @param c 連接
+ * @param status 斷開狀態
+ */
+static void on_disconnect(const redisAsyncContext* c, const int status)
+{
+    probe_state* state = c->data;
+    state->ctx = nullptr;
+    state->authenticated = FALSE;
+
+    if (status != REDIS_OK && !stopping)
+    {
+        g_printerr("[%s] Redis connection lost: %s\n", state->owner->config->name, c->c.errstr);
+    }
+    finish_probe(state, PROBE_CONNECT_ERROR, "%s", c->c.err ? c->c.errstr : "connection lost");
+}
+
+/**
+ * io_uring 連接完成回調
+ * @param owner 探測器狀態
+ * @param error 0 表示成功，否則為負的 errno
+ */
+static void on_uring_connected(const gpointer owner, const gint error)
+{
+    const gint64 started = loop_enter();
+    probe_state* state = owner;
+    release_connect_slot(state);
+
+    // 連接失敗時連接已關閉
+    if (error != 0)
+    {
+        state->conn = nullptr;
+        finish_probe(state, PROBE_CONNECT_ERROR, "%s", error == -ETIMEDOUT ? "Timeout" : g_strerror(-error));
+    }
+    else
+    {
+        state->result.connect_us = end_phase(state);
+        start_commands(state);
+    }
+    loop_leave(&connect_site, started);
+}
+
+/**
+ * io_uring 響應回調，按當前階段處理
+ * @param owner 探測器狀態
+ * @param reply 響應
+ */
+static void on_uring_reply(const gpointer owner, const redisReply* reply)
+{
+    probe_state* state = owner;
+    switch (state->phase)
+    {
+    case PHASE_AUTH:
+        handle_auth(state, reply);
+        break;
+    case PHASE_PING:
+        handle_ping(state, reply);
+        break;
+    case PHASE_INFO:
+        handle_info(state, reply);
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * io_uring 連接失敗回調，連接已關閉
+ * @param owner 探測器狀態
+ * @param error 負的 errno，對端關閉時為 0
+ */
+static void on_uring_failed(const gpointer owner, const gint error)
+{
+    probe_state* state = owner;
+    state->conn = nullptr;
+    state->authenticated = FALSE;
+
+    const gchar* reason = error == 0 ? "Server closed the connection"
+                          : error == -ETIMEDOUT ? "Timeout"
+                          : g_strerror(-error);
+    if (!stopping)
+    {
+        g_printerr("[%s] Redis connection lost: %s\n", state->owner->config->name, reason);
+    }
+    finish_probe(state, error == -ETIMEDOUT ? PROBE_TIMEOUT : PROBE_CONNECT_ERROR, "%s", reason);
+}
+
+/**
+ * 建立 io_uring 連接，佔用一個連接名額直到連接完成
+ * @param state 探測器狀態
+ */
+static void open_uring_connection(probe_state* state)
+{
+    const target_config* config = state->owner->config;
+    gchar port[16];
+    g_snprintf(port, sizeof(port), "%d", config->port);
+    const struct addrinfo hints = {.ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM};
+    struct addrinfo* addresses = nullptr;
+
+    // 與 hiredis 相同，在這裡同步解析地址
+    const gint64 resolve_started = g_get_monotonic_time();
+    const gint resolved = getaddrinfo(config->host, port, &hints, &addresses);
+    if (state->trace.context.span_id != 0)
+    {
+        trace_record(&state->trace.context, "probe.resolve",
+                     state->trace.start_us + (resolve_started - state->trace.started),
+                     g_get_monotonic_time() - resolve_started, resolved != 0, nullptr);
+    }
+    if (resolved != 0)
+    {
+        finish_probe(state, PROBE_CONNECT_ERROR, "%s", gai_strerror(resolved));
+        return;
+    }
+
+    gint error = 0;
+    state->conn = resp_conn_open(state, state->scratch, addresses->ai_addr, addresses->ai_addrlen,
+                                 config->connect_timeout_seconds * 1000, &error);
+    freeaddrinfo(addresses);
+    if (state->conn == nullptr)
+    {
+        finish_probe(state, PROBE_CONNECT_ERROR, "%s", g_strerror(-error));
+        return;
+    }
+    state->connecting = TRUE;
+    connecting++;
+}
+
+/**
+ * 建立連接，佔用一個連接名額直到連接完成
+ * @param state 探測器狀態
+ */
+static void open_connection(probe_state* state)
+{
+    if (uring)
+    {
+        open_uring_connection(state);
+        return;
+    }
+
+    const target_config* config = state->owner->config;
+    const struct timeval timeout = {config->connect_timeout_seconds, 0};
+
+    redisOptions options = {0};
+    REDIS_OPTIONS_SET_TCP(&options, config->host, config->port);
+    options.connect_timeout = &timeout;
+    options.command_timeout = &timeout;
+
+    // hiredis 在這裡同步解析地址並發起非阻塞連接
+    const gint64 resolve_started = g_get_monotonic_time();
+    redisAsyncContext* ctx = redisAsyncConnectWithOptions(&options);
+    if (state->trace.context.span_id != 0)
+    {
+        trace_record(&state->trace.context, "probe.resolve",
+                     state->trace.start_us + (resolve_started - state->trace.started),
+                     g_get_monotonic_time() - resolve_started, ctx == nullptr || ctx->err, nullptr);
+    }
+    if (ctx == nullptr)
+    {
+        finish_probe(state, PROBE_CONNECT_ERROR, "can't allocate redis context");
+        return;
+    }
+    if (ctx->err)
+    {
+        finish_probe(state, PROBE_CONNECT_ERROR, "%s", ctx->errstr);
+        redisAsyncFree(ctx);
+        return;
+    }
+
+    ctx->data = state;
+    // 響應在探測分配器中創建，隨探測結束一併釋放
+    ctx->c.reader->fn = &arena_reply_functions;
+    ctx->c.reader->privdata = state->scratch;
+    redisLibeventAttach(ctx, probe_base);
+    redisAsyncSetConnectCallback(ctx, on_connect);
+    redisAsyncSetDisconnectCallback(ctx, on_disconnect);
+    state->ctx = ctx;
+    state->connecting = TRUE;
+    connecting++;
+}
+
+/**
+ * 開始連接，同時建立的連接數達到上限時排隊等待，等待時間計入連接耗時
+ * @param state 探測器狀態
+ */
+static void start_connect(probe_state* state)
+{
+    state->phase = PHASE_CONNECT;
+    if (pr_config->max_connecting > 0 && connecting >= pr_config->max_connecting)
+    {
+        state->waiting = TRUE;
+        g_queue_push_tail(&connect_waiters, state);
+        return;
+    }
+    open_connection(state);
+}
+
+/**
+ * 定时器回调函数，開始一次探測
+ * @param fd 文件描述符
+ * @param event 事件类型
+ * @param arg 探測器狀態
+ */
+static void timer_callback(const evutil_socket_t fd, const short event, void* arg)
+{
+    (void)fd; // 未使用
+    (void)event; // 未使用
+    probe_state* state = arg;
+    const gint64 started = loop_enter();
+    loop_lag(state->due);
+
+    // 上一次探測尚未結束（各階段都有超時，正常不會發生）
+    if (state->phase != PHASE_IDLE)
+    {
+        schedule_next(state);
+        loop_leave(&timer_site, started);
+        return;
+    }
+
+    // 初始化本次結果
+    probe_result* result = &state->result;
+    memset(result, 0, sizeof(probe_result));
+    result->timestamp = g_get_real_time();
+    result->connect_us = result->auth_us = result->ping_us = result->info_us = -1;
+    result->info = (probe_info){-1, -1, -1, -1, -1};
+    result->tcp = (probe_tcp){-1, -1, -1, -1, -1};
+    state->started = state->phase_started = g_get_monotonic_time();
+    trace_begin(&state->trace, "probe", nullptr);
+
+    // 復用常駐連接，斷開時重新連接；建立連接時同步解析地址
+    if (state->ctx == nullptr && state->conn == nullptr)
+        start_connect(state);
+    else
+        start_commands(state);
+    loop_leave(&timer_site, started);
+}
+
+/**
+ * 為目標創建定時器並開始探測
+ * @param t 目標
+ * @return 是否成功
+ */
+gboolean start_probe(target* t)
+{
+    probe_state* state = g_malloc0(sizeof(probe_state));
+    state->owner = t;
+    state->timer = evtimer_new(probe_base, timer_callback, state);
+    if (state->timer == nullptr)
+    {
+        g_printerr("Cannot create timer event for %s!\n", t->config->name);
+        g_free(state);
+        return FALSE;
+    }
+    state->scratch = arena_new(PROBE_ARENA_SIZE);
+    t->probe = state;
+    if (!ready) unprobed++;
+    schedule_first(state);
+    return TRUE;
+}
+
+/**
+ * 中止進行中的探測並關閉連接，不回報結果
+ * @param state 探測器狀態
+ */
+static void close_probe(probe_state* state)
+{
+    // 先回到空閒階段，釋放連接時以空響應調用的回調不會回報結果
+    state->phase = PHASE_IDLE;
+    if (state->waiting)
+    {
+        g_queue_remove(&connect_waiters, state);
+        state->waiting = FALSE;
+    }
+    if (state->ctx != nullptr) redisAsyncFree(state->ctx);
+    state->ctx = nullptr;
+    if (state->conn != nullptr) resp_conn_close(state->conn);
+    state->conn = nullptr;
+    state->authenticated = FALSE;
+    release_connect_slot(state);
+}
+
+/**
+ * 停止目標的探測並關閉連接
+ * @param t 目標
+ */
+void stop_probe(target* t)
+{
+    probe_state* state = t->probe;
+    if (state == nullptr) return;
+
+    close_probe(state);
+    // 尚未探測過的目標被移除，不再等待它就緒
+    if (!stopping) mark_probed(state);
+    event_free(state->timer);
+    arena_free(state->scratch);
+    g_free(state);
+    t->probe = nullptr;
+}
+
+/**
+ * 關閉目標的連接，在下一次探測時以當前配置重新連接
+ * @param t 目標
+ */
+void reconnect_probe(target* t)
+{
+    probe_state* state = t->probe;
+    if (state == nullptr) return;
+
+    const gboolean busy = state->phase != PHASE_IDLE;
+    close_probe(state);
+
+    // 中止的探測不會安排下一次探測
+    if (busy)
+    {
+        evtimer_del(state->timer);
+        schedule_next(state);
+    }
+}
+
+/**
+ * 為所有目標創建定時器並開始探測
+ *
+ * 每個目標持有一條常駐的異步連接，連接斷開後在下一次探測時重連
+ * @param base 事件循環
+ * @param callback 探測結果回調
+ * @param user_data 用戶數據
+ * @return 是否成功
+ */
+gboolean start_probes(struct event_base* base, const probe_result_fn callback, const gpointer user_data)
+{
+    probe_base = base;
+    result_callback = callback;
+    result_user_data = user_data;
+    stopping = FALSE;
+    ready = FALSE;
+    unprobed = 0;
+    probes_started_at = g_get_monotonic_time();
+
+    // io_uring 不可用（內核過舊、被禁用或未編譯支持）時回退到 libevent
+    uring = FALSE;
+    if (pr_config->backend == PROBE_BACKEND_URING)
+    {
+        const resp_conn_callbacks callbacks = {
+            .connected = on_uring_connected,
+            .reply = on_uring_reply,
+            .failed = on_uring_failed,
+        };
+        uring = start_resp_uring(base, pr_config->uring_entries, pr_config->uring_connections,
+                                 pr_config->uring_buffer, &callbacks);
+        if (!uring) g_printerr("Warning: io_uring is unavailable, probing with libevent\n");
+    }
+
+    for (guint i = 0; i < targets->len; ++i)
+    {
+        if (!start_probe(g_ptr_array_index(targets, i))) return FALSE;
+    }
+
+    g_print("Probing %u target(s) with %s, first probes spread over %ld ms.\n", targets->len,
+            probe_backend_name(probe_active_backend()), (glong)pr_config->startup_window_ms);
+    return TRUE;
+}
+
+/**
+ * 計算目標的 φ 值 (phi accrual)
+ * @param t 目標
+ * @return φ 值，間隔樣本不足時返回 0
+ */
+gdouble probe_phi(const target* t)
+{
+    const probe_state* state = t->probe;
+    if (state == nullptr || state->n_intervals < 2) return 0;
+
+    // 以正態分佈近似成功間隔，標準差不小於均值的 10%，避免間隔穩定時 φ 值過於敏感
+    const gdouble mean = state->interval_sum / state->n_intervals;
+    const gdouble variance = state->interval_square_sum / state->n_intervals - mean * mean;
+    const gdouble deviation = MAX(sqrt(MAX(variance, 0)), mean * 0.1);
+    const gdouble elapsed = (gdouble)(g_get_monotonic_time() - state->last_success);
+
+    // 正態分佈尾部概率的 logistic 近似
+    const gdouble y = (elapsed - mean) / deviation;
+    const gdouble e = exp(-y * (1.5976 + 0.070566 * y * y));
+    const gdouble phi = elapsed > mean ? -log10(e / (1 + e)) : -log10(1 - 1 / (1 + e));
+    return isfinite(phi) ? phi : 1e3;
+}
+
+/**
+ * 是否所有目標都已完成首次探測
+ * @return 是否就緒
+ */
+gboolean probes_ready()
+{
+    return ready;
+}
+
+/**
+ * 匯總所有目標的探測分配器統計
+ * @param stats 輸出的統計，high_water 為單個目標的最大值
+ */
+void probe_arena_stats(arena_stats* stats)
+{
+    *stats = (arena_stats){0};
+    for (guint i = 0; targets != nullptr && i < targets->len; ++i)
+    {
+        const target* t = g_ptr_array_index(targets, i);
+        if (t->probe == nullptr) continue;
+
+        arena_stats target_stats;
+        arena_get_stats(t->probe->scratch, &target_stats);
+        stats->reserved += target_stats.reserved;
+        stats->high_water = MAX(stats->high_water, target_stats.high_water);
+        stats->grows += target_stats.grows;
+    }
+}
+
+/**
+ * 實際使用的探測連接實現
+ * @return 實現
+ */
+probe_backend probe_active_backend()
+{
+    return uring ? PROBE_BACKEND_URING : PROBE_BACKEND_LIBEVENT;
+}
+
+/**
+ * 停止所有探測並關閉連接
+ */
+void stop_probes()
+{
+    stopping = TRUE;
+    for (guint i = 0; targets != nullptr && i < targets->len; ++i)
+    {
+        stop_probe(g_ptr_array_index(targets, i));
+    }
+    if (uring) stop_resp_uring();
+    uring = FALSE;
+}
@@ -0,0 +1,138 @@
+#pragma once
+#include <glib.h>
+#include <event2/event.h>
+
+#include "arena.h"
+#include "target.h"
+
+/**
+ * 探測配置
+ *
+ * 配置:
+ *  - startup_window 啟動窗口秒數，首次探測在窗口內隨機分佈，不超過目標的探測間隔
+ *  - max_connecting 同時建立連接的上限，超過時排隊等待，0 表示不限制
+ *  - backend 探測連接的實現，libevent 或 io_uring，啟動時選定；io_uring 不可用時回退到 libevent
+ *  - uring_entries io_uring 提交隊列的容量
+ *  - uring_connections io_uring 連接數上限，不小於目標數
+ *  - uring_buffer io_uring 每個連接的讀取緩衝區字節數
+ */
+typedef enum probe_backend
+{
+    // hiredis 異步連接
+    PROBE_BACKEND_LIBEVENT = 0,
+    // io_uring，連接、寫入與讀取批量提交，命令流水線發送
+    PROBE_BACKEND_URING
+} probe_backend;
+
+typedef struct probe_config
+{
+    // 啟動窗口毫秒數
+    gint64 startup_window_ms;
+    // 同時建立連接的上限
+    guint max_connecting;
+    // 探測連接的實現
+    probe_backend backend;
+    // io_uring 提交隊列的容量
+    guint uring_entries;
+    // io_uring 連接數上限
+    guint uring_connections;
+    // io_uring 讀取緩衝區字節數
+    gsize uring_buffer;
+    // 是否在每次 PING 後讀取 TCP_INFO
+    gboolean tcp_info;
+} probe_config;
+
+typedef probe_config* probe_config_t;
+
+extern probe_config_t pr_config;
+
+/**
+ * 讀取探測配置
+ * @param keyfile 配置文件
+ * @param error 錯誤對象
+ */
+gboolean init_probe_config(GKeyFile* keyfile, GError* error);
+
+/**
+ * 釋放探測配置
+ */
+void destroy_probe_config();
+
+/**
+ * 探測連接實現的名稱
+ * @param backend 實現
+ * @return 名稱
+ */
+const gchar* probe_backend_name(probe_backend backend);
+
+/**
+ * 探測結果回調，在事件循環線程中調用
+ * @param t 目標
+ * @param result 探測結果
+ * @param user_data 用戶數據
+ */
+typedef void (*probe_result_fn)(target* t, const probe_result* result, gpointer user_data);
+
+/**
+ * 為所有目標創建定時器並開始探測
+ *
+ * 每個目標持有一條常駐的異步連接，連接斷開後在下一次探測時重連；
+ * 首次探測在啟動窗口內隨機分佈，所有目標完成首次探測後報告就緒；
+ * 使用 io_uring 時 [AUTH]、PING 與 INFO 一次寫入，各階段耗時按響應到達的間隔計算
+ * @param base 事件循環
+ * @param callback 探測結果回調
+ * @param user_data 用戶數據
+ * @return 是否成功
+ */
+gboolean start_probes(struct event_base* base, probe_result_fn callback, gpointer user_data);
+
+/**
+ * 停止所有探測並關閉連接
+ */
+void stop_probes();
+
+/**
+ * 為目標創建定時器並開始探測，需在 start_probes 之後調用
+ * @param t 目標
+ * @return 是否成功
+ */
+gboolean start_probe(target* t);
+
+/**
+ * 停止目標的探測並關閉連接
+ * @param t 目標
+ */
+void stop_probe(target* t);
+
+/**
+ * 關閉目標的連接，在下一次探測時以當前配置重新連接
+ * @param t 目標
+ */
+void reconnect_probe(target* t);
+
+/**
+ * 計算目標的 φ 值 (phi accrual)，由成功探測的間隔分佈估計目標失聯的可疑程度
+ * @param t 目標
+ * @return φ 值，間隔樣本不足時返回 0
+ */
+gdouble probe_phi(const target* t);
+
+/**
+ * 是否所有目標都已完成首次探測
+ * @return 是否就緒
+ */
+gboolean probes_ready();
+
+/**
+ * 匯總所有目標的探測分配器統計，在事件循環線程中調用
+ *
+ * 每個目標持有一個分配器，存放一次探測中的響應與命令，探測結束時重置
+ * @param stats 輸出的統計，high_water 為單個目標的最大值
+ */
+void probe_arena_stats(arena_stats* stats);
+
+/**
+ * 實際使用的探測連接實現，start_probes 之後有效
+ * @return 實現
+ */
+probe_backend probe_active_backend();
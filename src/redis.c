@@ -4,21 +4,32 @@
 redis_config_t r_config = nullptr;
 
 /**
- * 讀取redis配置
+ * 釋放redis配置對象
+ * @param config redis配置
+ */
+void free_redis_config(redis_config* config)
+{
+    if (config == nullptr) return;
+    g_free(config->redis_host);
+    g_free(config->redis_username);
+    g_free(config->redis_password);
+    g_free(config);
+}
+
+/**
+ * 從配置文件讀取redis配置，不修改全局配置，可在其他線程中調用
  * @param keyfile 配置文件
- * @param error 錯誤對象
+ * @return redis配置 (需要使用 free_redis_config 釋放)，出錯時返回空
  */
-gboolean init_redis_config(GKeyFile* keyfile, GError* error)
+redis_config* read_redis_config(GKeyFile* keyfile)
 {
+    GError* error = nullptr;
+
     // 創建 redis 配置對象
-    r_config = g_malloc0(sizeof(redis_config));
-    r_config->redis_host = nullptr;
-    r_config->redis_username = nullptr;
-    r_config->redis_password = nullptr;
+    redis_config* config = g_malloc0(sizeof(redis_config));
 
     // 讀取檢查間隔秒數
-    error = nullptr;
-    r_config->interval_seconds = g_key_file_get_integer(keyfile, "General", "interval", &error);
+    config->interval_seconds = g_key_file_get_integer(keyfile, "General", "interval", &error);
     if (error != nullptr)
     {
         g_printerr("Error reading interval: %s\n", error->message);
@@ -26,8 +37,7 @@ gboolean init_redis_config(GKeyFile* keyfile, GError* error)
     }
 
     // 讀取連接超時秒數
-    error = nullptr;
-    r_config->connect_timeout_seconds = g_key_file_get_integer(keyfile, "General", "connect_timeout", &error);
+    config->connect_timeout_seconds = g_key_file_get_integer(keyfile, "General", "connect_timeout", &error);
     if (error != nullptr)
     {
         g_printerr("Error reading connect_timeout: %s\n", error->message);
@@ -35,8 +45,7 @@ gboolean init_redis_config(GKeyFile* keyfile, GError* error)
     }
 
     // 讀取redis連接地址
-    error = nullptr;
-    r_config->redis_host = g_key_file_get_string(keyfile, "General", "redis_host", &error);
+    config->redis_host = g_key_file_get_string(keyfile, "General", "redis_host", &error);
     if (error != nullptr)
     {
         g_printerr("Error reading redis_host: %s\n", error->message);
@@ -44,8 +53,7 @@ gboolean init_redis_config(GKeyFile* keyfile, GError* error)
     }
 
     // 讀取redis連接端口
-    error = nullptr;
-    r_config->redis_port = g_key_file_get_integer(keyfile, "General", "redis_port", &error);
+    config->redis_port = g_key_file_get_integer(keyfile, "General", "redis_port", &error);
     if (error != nullptr)
     {
         g_printerr("Error reading redis_port: %s\n", error->message);
@@ -53,8 +61,7 @@ gboolean init_redis_config(GKeyFile* keyfile, GError* error)
     }
 
     // 讀取redis是否認證
-    error = nullptr;
-    r_config->auth = g_key_file_get_boolean(keyfile, "General", "redis_auth", &error);
+    config->auth = g_key_file_get_boolean(keyfile, "General", "redis_auth", &error);
     if (error != nullptr)
     {
         g_printerr("Error reading redis_auth: %s\n", error->message);
@@ -62,14 +69,13 @@ gboolean init_redis_config(GKeyFile* keyfile, GError* error)
     }
 
     // 如果不需要認證
-    if (!r_config->auth)
+    if (!config->auth)
     {
-        return TRUE;
+        return config;
     }
 
     // 讀取redis用戶名
-    error = nullptr;
-    r_config->redis_username = g_key_file_get_string(keyfile, "General", "redis_username", &error);
+    config->redis_username = g_key_file_get_string(keyfile, "General", "redis_username", &error);
     if (error != nullptr)
     {
         g_printerr("Error reading redis_username: %s\n", error->message);
@@ -77,19 +83,32 @@ gboolean init_redis_config(GKeyFile* keyfile, GError* error)
     }
 
     // 讀取redis密碼
-    error = nullptr;
-    r_config->redis_password = g_key_file_get_string(keyfile, "General", "redis_password", &error);
+    config->redis_password = g_key_file_get_string(keyfile, "General", "redis_password", &error);
     if (error != nullptr)
     {
         g_printerr("Error reading redis_password: %s\n", error->message);
         goto error;
     }
-    return TRUE;
+    return config;
 
 error:
     // 釋放配置
-    destroy_redis_config();
-    return FALSE;
+    g_error_free(error);
+    free_redis_config(config);
+    return nullptr;
+}
+
+/**
+ * 讀取redis配置
+ * @param keyfile 配置文件
+ * @param error 錯誤對象
+ */
+gboolean init_redis_config(GKeyFile* keyfile, GError* error)
+{
+    (void)error; // 由 read_redis_config 自行處理錯誤
+
+    r_config = read_redis_config(keyfile);
+    return r_config != nullptr;
 }
 
 /**
@@ -97,12 +116,6 @@ error:
  */
 void destroy_redis_config()
 {
-    // 釋放配置結構體
-    if (r_config)
-    {
-        if (r_config->redis_host) g_free(r_config->redis_host);
-        if (r_config->redis_username) g_free(r_config->redis_username);
-        if (r_config->redis_password) g_free(r_config->redis_password);
-        g_free(r_config);
-    }
+    free_redis_config(r_config);
+    r_config = nullptr;
 }
@@ -45,3 +45,16 @@ gboolean init_redis_config(GKeyFile* keyfile, GError* error);
  * 釋放redis配置
  */
 void destroy_redis_config();
+
+/**
+ * 從配置文件讀取redis配置，不修改全局配置，可在其他線程中調用
+ * @param keyfile 配置文件
+ * @return redis配置 (需要使用 free_redis_config 釋放)，出錯時返回空
+ */
+redis_config* read_redis_config(GKeyFile* keyfile);
+
+/**
+ * 釋放redis配置對象
+ * @param config redis配置
+ */
+void free_redis_config(redis_config* config);
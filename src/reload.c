@@ -0,0 +1,367 @@
+#include "reload.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdalign.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+
+#include "aggregator.h"
+#include "alert.h"
+#include "anomaly.h"
+#include "loopmon.h"
+#include "probe.h"
+#include "shard.h"
+#include "target.h"
+
+// 文件變更後等待的毫秒數，合併編輯器的多次寫入
+#define RELOAD_DEBOUNCE_MS 500
+
+/**
+ * 讀取線程的結果
+ */
+typedef struct reload_job
+{
+    // 新的目標配置 (target_config*)，讀取失敗時為空
+    GPtrArray* configs;
+    // 需要重啓才能生效的分組摘要
+    gchar* digest;
+} reload_job;
+
+// 配置文件路徑
+static gchar* reload_path = nullptr;
+// 配置文件名稱
+static gchar* reload_name = nullptr;
+// 啟動時需要重啓才能生效的分組摘要
+static gchar* startup_digest = nullptr;
+// SIGHUP 事件
+static struct event* sighup_event = nullptr;
+// inotify 文件描述符
+static gint inotify_fd = -1;
+// inotify 事件
+static struct event* inotify_event = nullptr;
+// 合併多次寫入的定時器
+static struct event* debounce_timer = nullptr;
+// 讀取完成通知
+static gint done_fd = -1;
+// 讀取完成事件
+static struct event* done_event = nullptr;
+// 讀取線程
+static GThread* loader = nullptr;
+// 讀取期間再次收到重新載入的請求
+static gboolean reload_again = FALSE;
+// 被測量的回調
+static loop_site apply_site = LOOP_SITE("reload.apply");
+
+/**
+ * 計算除 [General]、[Services] 與 [Target:*] 以外的分組摘要，這些分組在運行中不重新載入
+ * @param keyfile 配置文件
+ * @return 摘要 (需要手動釋放)
+ */
+static gchar* restart_sections_digest(GKeyFile* keyfile)
+{
+    GString* text = g_string_new(nullptr);
+    gchar** groups = g_key_file_get_groups(keyfile, nullptr);
+    for (gint i = 0; groups[i] != nullptr; ++i)
+    {
+        if (g_str_equal(groups[i], "General") || g_str_equal(groups[i], "Services") ||
+            g_str_has_prefix(groups[i], "Target:"))
+            continue;
+
+        g_string_append_printf(text, "[%s]\n", groups[i]);
+        gchar** keys = g_key_file_get_keys(keyfile, groups[i], nullptr, nullptr);
+        for (gint j = 0; keys != nullptr && keys[j] != nullptr; ++j)
+        {
+            gchar* value = g_key_file_get_value(keyfile, groups[i], keys[j], nullptr);
+            g_string_append_printf(text, "%s=%s\n", keys[j], value ? value : "");
+            g_free(value);
+        }
+        g_strfreev(keys);
+    }
+    g_strfreev(groups);
+
+    gchar* digest = g_compute_checksum_for_string(G_CHECKSUM_SHA256, text->str, (gssize)text->len);
+    g_string_free(text, TRUE);
+    return digest;
+}
+
+/**
+ * 讀取線程，解析並校驗配置，不修改任何全局狀態
+ * @param data 未使用
+ * @return 讀取結果
+ */
+static gpointer load_config(gpointer data)
+{
+    (void)data; // 未使用
+
+    reload_job* job = g_malloc0(sizeof(reload_job));
+    GError* error = nullptr;
+    GKeyFile* keyfile = g_key_file_new();
+    if (g_key_file_load_from_file(keyfile, reload_path, G_KEY_FILE_NONE, &error))
+    {
+        job->configs = load_target_configs(keyfile);
+        job->digest = restart_sections_digest(keyfile);
+    }
+    else
+    {
+        g_printerr("Error loading config file: %s\n", error->message);
+        g_error_free(error);
+    }
+    g_key_file_free(keyfile);
+
+    // 通知事件循環
+    eventfd_write(done_fd, 1);
+    return job;
+}
+
+/**
+ * 釋放讀取結果
+ * @param job 讀取結果
+ */
+static void free_reload_job(reload_job* job)
+{
+    if (job->configs != nullptr) g_ptr_array_free(job->configs, TRUE);
+    g_free(job->digest);
+    g_free(job);
+}
+
+/**
+ * 開始重新載入，讀取進行中時在其結束後再讀取一次
+ */
+static void begin_reload()
+{
+    if (loader != nullptr)
+    {
+        reload_again = TRUE;
+        return;
+    }
+    loader = g_thread_new("config-reload", load_config, nullptr);
+}
+
+/**
+ * 目標變更的處理
+ * @param t 目標
+ * @param change 變更
+ * @param previous 變更前的配置
+ * @param user_data 未使用
+ */
+void apply_target_change(target* t, const target_change change, const target_config* previous,
+                         gpointer user_data)
+{
+    (void)user_data; // 未使用
+
+    switch (change)
+    {
+    case TARGET_ADDED:
+        g_print("[%s] Target added.\n", t->config->name);
+        start_probe(t);
+        break;
+    case TARGET_REMOVED:
+        g_print("[%s] Target removed.\n", t->config->name);
+        stop_probe(t);
+        forget_alerts(t->config->name);
+        forget_anomalies(t->config->name);
+        // 經匯總線程丟棄，排在已提交的結果之後
+        aggregate_forget(t->config->name);
+        break;
+    case TARGET_UPDATED:
+    case TARGET_RECONNECT:
+        g_print("[%s] Target updated%s.\n", t->config->name, change == TARGET_RECONNECT ? ", reconnecting" : "");
+        // 集群變化後告警指紋不同，舊的告警無法再恢復，重新開始判斷
+        if (g_strcmp0(previous->cluster, t->config->cluster) != 0)
+        {
+            forget_alerts(t->config->name);
+            forget_anomalies(t->config->name);
+            t->error_ongoing = FALSE;
+        }
+        if (change == TARGET_RECONNECT) reconnect_probe(t);
+        break;
+    }
+}
+
+/**
+ * 讀取完成回調，在事件循環中應用新的目標配置
+ * @param fd 文件描述符
+ * @param event 事件類型
+ * @param arg 未使用
+ */
+static void done_callback(const evutil_socket_t fd, const short event, void* arg)
+{
+    (void)event; // 未使用
+    (void)arg; // 未使用
+
+    eventfd_t count = 0;
+    eventfd_read(fd, &count);
+    if (loader == nullptr) return;
+
+    const gint64 started = loop_enter();
+    reload_job* job = g_thread_join(loader);
+    loader = nullptr;
+
+    if (job->configs == nullptr)
+    {
+        g_printerr("Configuration reload failed, keeping the current configuration.\n");
+    }
+    else
+    {
+        if (g_strcmp0(job->digest, startup_digest) != 0)
+        {
+            g_printerr("Sections other than [General], [Services] and [Target:*] changed, "
+                       "they take effect after a restart.\n");
+        }
+        GPtrArray* configs = job->configs;
+        job->configs = nullptr;
+        // 啟用分片時只保留本副本負責的目標
+        const guint changes = update_targets(shard_assign(configs), apply_target_change, nullptr);
+        g_print("Configuration reloaded: %u target(s), %u changed.\n", targets->len, changes);
+    }
+    free_reload_job(job);
+
+    if (reload_again)
+    {
+        reload_again = FALSE;
+        begin_reload();
+    }
+    loop_leave(&apply_site, started);
+}
+
+/**
+ * SIGHUP 回調
+ * @param sig 信號
+ * @param event 事件類型
+ * @param arg 未使用
+ */
+static void sighup_callback(const evutil_socket_t sig, const short event, void* arg)
+{
+    (void)sig; // 未使用
+    (void)event; // 未使用
+    (void)arg; // 未使用
+
+    g_print("Received SIGHUP, reloading configuration.\n");
+    begin_reload();
+}
+
+/**
+ * 合併寫入的定時器回調
+ * @param fd 文件描述符
+ * @param event 事件類型
+ * @param arg 未使用
+ */
+static void debounce_callback(const evutil_socket_t fd, const short event, void* arg)
+{
+    (void)fd; // 未使用
+    (void)event; // 未使用
+    (void)arg; // 未使用
+
+    g_print("Config file changed, reloading configuration.\n");
+    begin_reload();
+}
+
+/**
+ * inotify 回調，配置文件被寫入或替換時延遲重新載入
+ * @param fd inotify 文件描述符
+ * @param event 事件類型
+ * @param arg 未使用
+ */
+static void inotify_callback(const evutil_socket_t fd, const short event, void* arg)
+{
+    (void)event; // 未使用
+    (void)arg; // 未使用
+
+    alignas(struct inotify_event) gchar buffer[4096];
+    gboolean changed = FALSE;
+    gssize len = 0;
+    while ((len = read(fd, buffer, sizeof(buffer))) > 0)
+    {
+        for (gchar* p = buffer; p < buffer + len;)
+        {
+            const struct inotify_event* ev = (const struct inotify_event*)p;
+            // 直接寫入或原子替換配置文件；Kubernetes ConfigMap 通過替換 ..data 鏈接更新
+            if (ev->len > 0 && (g_str_equal(ev->name, reload_name) || g_str_equal(ev->name, "..data")))
+                changed = TRUE;
+            p += sizeof(struct inotify_event) + ev->len;
+        }
+    }
+    if (!changed) return;
+
+    const struct timeval delay = {0, RELOAD_DEBOUNCE_MS * 1000};
+    evtimer_add(debounce_timer, &delay);
+}
+
+/**
+ * 開始監聽配置變更，收到 SIGHUP 或配置文件被改寫時重新載入探測目標
+ * @param base 事件循環
+ * @param path 配置文件路徑
+ * @return 是否成功，文件監聽不可用時仍可使用 SIGHUP
+ */
+gboolean start_reload(struct event_base* base, const gchar* path)
+{
+    reload_path = g_strdup(path);
+    reload_name = g_path_get_basename(path);
+
+    // 記錄啟動時的配置，用於提示需要重啓才能生效的修改
+    GKeyFile* keyfile = g_key_file_new();
+    if (g_key_file_load_from_file(keyfile, path, G_KEY_FILE_NONE, nullptr))
+        startup_digest = restart_sections_digest(keyfile);
+    g_key_file_free(keyfile);
+
+    // 讀取完成通知
+    done_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (done_fd < 0)
+    {
+        g_printerr("Cannot create eventfd for configuration reload: %s\n", g_strerror(errno));
+        return FALSE;
+    }
+    done_event = event_new(base, done_fd, EV_READ | EV_PERSIST, done_callback, nullptr);
+    event_add(done_event, nullptr);
+
+    // SIGHUP
+    sighup_event = evsignal_new(base, SIGHUP, sighup_callback, nullptr);
+    evsignal_add(sighup_event, nullptr);
+
+    // 監聽配置文件所在目錄，編輯器與 ConfigMap 通常以替換文件的方式更新
+    debounce_timer = evtimer_new(base, debounce_callback, nullptr);
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    gchar* dir = g_path_get_dirname(path);
+    if (inotify_fd < 0 || inotify_add_watch(inotify_fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0)
+    {
+        g_printerr("Cannot watch %s for changes (%s), reload with SIGHUP instead\n", dir, g_strerror(errno));
+        if (inotify_fd >= 0) close(inotify_fd);
+        inotify_fd = -1;
+    }
+    else
+    {
+        inotify_event = event_new(base, inotify_fd, EV_READ | EV_PERSIST, inotify_callback, nullptr);
+        event_add(inotify_event, nullptr);
+    }
+    g_free(dir);
+    return TRUE;
+}
+
+/**
+ * 停止監聽配置變更，等待進行中的讀取結束
+ */
+void stop_reload()
+{
+    if (loader != nullptr)
+    {
+        free_reload_job(g_thread_join(loader));
+        loader = nullptr;
+    }
+    reload_again = FALSE;
+
+    if (inotify_event != nullptr) event_free(inotify_event);
+    if (debounce_timer != nullptr) event_free(debounce_timer);
+    if (sighup_event != nullptr) event_free(sighup_event);
+    if (done_event != nullptr) event_free(done_event);
+    inotify_event = debounce_timer = sighup_event = done_event = nullptr;
+    if (inotify_fd >= 0) close(inotify_fd);
+    if (done_fd >= 0) close(done_fd);
+    inotify_fd = done_fd = -1;
+
+    g_free(reload_path);
+    g_free(reload_name);
+    g_free(startup_digest);
+    reload_path = reload_name = startup_digest = nullptr;
+}
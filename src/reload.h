@@ -0,0 +1,30 @@
+#pragma once
+#include <glib.h>
+#include <event2/event.h>
+
+#include "target.h"
+
+/**
+ * 開始監聽配置變更，收到 SIGHUP 或配置文件被改寫時重新載入探測目標
+ *
+ * 配置在獨立線程中讀取與校驗，完成後回到事件循環按目標比較差異，
+ * 只重新連接或重建變化的目標，其餘目標的連接與狀態保持不變
+ * @param base 事件循環
+ * @param path 配置文件路徑
+ * @return 是否成功，文件監聽不可用時仍可使用 SIGHUP
+ */
+gboolean start_reload(struct event_base* base, const gchar* path);
+
+/**
+ * 停止監聽配置變更，等待進行中的讀取結束
+ */
+void stop_reload();
+
+/**
+ * 目標變更的處理：開始或停止探測並丟棄移除目標的告警與匯總，重新載入配置與分片調整共用
+ * @param t 目標
+ * @param change 變更
+ * @param previous 變更前的配置
+ * @param user_data 未使用
+ */
+void apply_target_change(target* t, target_change change, const target_config* previous, gpointer user_data);
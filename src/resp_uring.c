@@ -0,0 +1,825 @@
+#include "resp_uring.h"
+
+#include <errno.h>
+
+#ifdef HAVE_LIBURING
+
+#include <liburing.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <hiredis/hiredis.h>
+
+#include "loopmon.h"
+
+// 登記固定緩衝區的連接數上限，之後的連接使用普通讀取
+#define FIXED_BUFFERS_MAX 16384
+// 單次取出的完成事件數
+#define COMPLETION_BATCH 256
+// 連接槽位編號的上限，user_data 中佔 24 位
+#define SLOT_INDEX_MAX (1u << 24)
+
+/**
+ * 請求類型，與代數、槽位編號一起編碼在 user_data 中
+ */
+typedef enum uring_op
+{
+    // 連接
+    OP_CONNECT = 1,
+    // 連接的超時，鏈接在連接之後
+    OP_CONNECT_TIMEOUT,
+    // 發送命令
+    OP_SEND,
+    // 讀取響應
+    OP_READ,
+    // 等待響應的超時
+    OP_TIMEOUT,
+    // 取消請求
+    OP_CANCEL
+} uring_op;
+
+/**
+ * 連接，佔用一個槽位；關閉後在所有請求歸還前不復用
+ */
+struct resp_conn
+{
+    // 所有者
+    gpointer owner;
+    // 槽位編號
+    guint index;
+    // 代數，槽位每次復用時遞增，避免取消請求誤中之後的連接
+    guint32 generation;
+    // 是否佔用
+    gboolean used;
+    // 是否已關閉，不再回調
+    gboolean closed;
+    // 是否已連接
+    gboolean connected;
+    // 套接字
+    gint fd;
+    // 進行中且可取消的請求 (1 << uring_op)
+    guint active;
+    // 進行中的請求數，包括超時
+    guint in_flight;
+    // 尚未收到的響應數
+    guint pending;
+    // 響應解析器
+    redisReader* reader;
+    // 讀取緩衝區
+    gchar* read_buffer;
+    // 讀取緩衝區是否已登記
+    gboolean fixed;
+    // 發送緩衝區，內核完成發送前保持不變
+    gchar* send_buffer;
+    // 發送緩衝區容量
+    gsize send_capacity;
+    // 待發送的字節數
+    gsize send_length;
+    // 已發送的字節數
+    gsize sent;
+    // 地址
+    struct sockaddr_storage addr;
+    // 連接超時
+    struct __kernel_timespec connect_timeout;
+    // 等待響應的超時
+    struct __kernel_timespec reply_timeout;
+};
+
+// io_uring 實例
+static struct io_uring ring;
+// 是否已創建
+static gboolean ring_ready = FALSE;
+// 完成事件通知
+static gint completion_fd = -1;
+static struct event* completion_event = nullptr;
+// 合併提交
+static struct event* submit_event = nullptr;
+// 是否已安排提交
+static gboolean submit_scheduled = FALSE;
+// 連接事件回調
+static resp_conn_callbacks uring_callbacks;
+// 連接槽位，按需創建
+static resp_conn** slots = nullptr;
+// 槽位數上限
+static guint slot_capacity = 0;
+// 已創建的槽位數
+static guint n_slots = 0;
+// 空閒的槽位編號
+static guint* free_slots = nullptr;
+static guint n_free = 0;
+// 讀取緩衝區字節數
+static gsize buffer_size = 0;
+// 固定緩衝區表的大小
+static guint fixed_buffers = 0;
+// 統計
+static resp_uring_stats uring_stats;
+// 被測量的回調
+static loop_site completion_site = LOOP_SITE("resp_uring.completions");
+
+/**
+ * 編碼 user_data
+ * @param conn 連接
+ * @param op 請求類型
+ * @return user_data
+ */
+static guint64 pack_user_data(const resp_conn* conn, const uring_op op)
+{
+    return (guint64)conn->generation << 32 | (guint64)conn->index << 8 | op;
+}
+
+/**
+ * 設置超時
+ * @param ts 輸出的時間
+ * @param timeout_ms 毫秒數
+ */
+static void set_timeout(struct __kernel_timespec* ts, const gint64 timeout_ms)
+{
+    ts->tv_sec = timeout_ms / 1000;
+    ts->tv_nsec = timeout_ms % 1000 * 1000000;
+}
+
+/**
+ * 提交已準備的請求
+ */
+static void submit_queued()
+{
+    submit_scheduled = FALSE;
+    if (io_uring_sq_ready(&ring) == 0) return;
+
+    const gint submitted = io_uring_submit(&ring);
+    if (submitted < 0)
+    {
+        // 完成隊列積壓等暫時性錯誤，處理完成事件後重試
+        g_printerr("io_uring submit failed: %s\n", g_strerror(-submitted));
+        return;
+    }
+    uring_stats.submits++;
+    uring_stats.sqes += submitted;
+}
+
+/**
+ * 提交回調，本輪事件循環中準備的請求合併為一次提交
+ * @param fd 未使用
+ * @param event 未使用
+ * @param arg 未使用
+ */
+static void submit_callback(const evutil_socket_t fd, const short event, void* arg)
+{
+    (void)fd; // 未使用
+    (void)event; // 未使用
+    (void)arg; // 未使用
+    submit_queued();
+}
+
+/**
+ * 確保提交隊列有足夠的空位，隊列已滿時先提交，並安排本輪事件循環結束前提交
+ * @param needed 需要的空位數
+ * @return 是否有足夠的空位
+ */
+static gboolean reserve_sqes(const guint needed)
+{
+    if (io_uring_sq_space_left(&ring) < needed) submit_queued();
+    if (io_uring_sq_space_left(&ring) < needed) return FALSE;
+    if (!submit_scheduled)
+    {
+        submit_scheduled = TRUE;
+        event_active(submit_event, EV_WRITE, 0);
+    }
+    return TRUE;
+}
+
+/**
+ * 登記槽位的讀取緩衝區，超出固定緩衝區表或登記失敗時使用普通讀取
+ * @param conn 連接
+ * @return 是否已登記
+ */
+static gboolean register_buffer(const resp_conn* conn)
+{
+    if (conn->index >= fixed_buffers) return FALSE;
+
+    const struct iovec iov = {.iov_base = conn->read_buffer, .iov_len = buffer_size};
+    const __u64 tag = 0;
+    const gint ret = io_uring_register_buffers_update_tag(&ring, conn->index, &iov, &tag, 1);
+    if (ret < 0)
+    {
+        g_printerr("Cannot register io_uring read buffer: %s, using unregistered reads\n", g_strerror(-ret));
+        fixed_buffers = 0;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/**
+ * 取得空閒的槽位
+ * @return 連接，槽位已用完時返回空
+ */
+static resp_conn* acquire_slot()
+{
+    resp_conn* conn;
+    if (n_free > 0)
+    {
+        conn = slots[free_slots[--n_free]];
+    }
+    else if (n_slots < slot_capacity)
+    {
+        conn = g_malloc0(sizeof(resp_conn));
+        conn->index = n_slots;
+        conn->read_buffer = g_malloc(buffer_size);
+        conn->fixed = register_buffer(conn);
+        slots[n_slots++] = conn;
+    }
+    else
+    {
+        return nullptr;
+    }
+
+    conn->generation++;
+    conn->used = TRUE;
+    conn->closed = FALSE;
+    conn->connected = FALSE;
+    conn->fd = -1;
+    conn->active = 0;
+    conn->in_flight = 0;
+    conn->pending = 0;
+    uring_stats.open++;
+    return conn;
+}
+
+/**
+ * 歸還槽位，所有請求都已完成
+ * @param conn 連接
+ */
+static void release_slot(resp_conn* conn)
+{
+    if (conn->fd >= 0) close(conn->fd);
+    conn->fd = -1;
+    redisReaderFree(conn->reader);
+    conn->reader = nullptr;
+    conn->owner = nullptr;
+    conn->used = FALSE;
+    free_slots[n_free++] = conn->index;
+    uring_stats.open--;
+}
+
+/**
+ * 提交讀取，登記過緩衝區時使用固定緩衝區
+ * @param conn 連接
+ * @return 是否已排入提交隊列
+ */
+static gboolean post_read(resp_conn* conn)
+{
+    if (!reserve_sqes(1)) return FALSE;
+
+    struct io_uring_sqe* sqe = io_uring_get_sqe(&ring);
+    if (conn->fixed)
+    {
+        io_uring_prep_read_fixed(sqe, conn->fd, conn->read_buffer, buffer_size, 0, (gint)conn->index);
+        uring_stats.fixed_reads++;
+    }
+    else
+    {
+        io_uring_prep_read(sqe, conn->fd, conn->read_buffer, buffer_size, 0);
+    }
+    io_uring_sqe_set_data64(sqe, pack_user_data(conn, OP_READ));
+    conn->active |= 1u << OP_READ;
+    conn->in_flight++;
+    return TRUE;
+}
+
+/**
+ * 提交發送，從已發送的位置繼續
+ * @param conn 連接
+ * @return 是否已排入提交隊列
+ */
+static gboolean post_send(resp_conn* conn)
+{
+    if (!reserve_sqes(1)) return FALSE;
+
+    struct io_uring_sqe* sqe = io_uring_get_sqe(&ring);
+    io_uring_prep_send(sqe, conn->fd, conn->send_buffer + conn->sent, conn->send_length - conn->sent, MSG_NOSIGNAL);
+    io_uring_sqe_set_data64(sqe, pack_user_data(conn, OP_SEND));
+    conn->active |= 1u << OP_SEND;
+    conn->in_flight++;
+    return TRUE;
+}
+
+/**
+ * 取消進行中的請求，取消請求本身的完成事件被忽略
+ * @param conn 連接
+ * @param op 請求類型
+ * @return 是否已排入提交隊列
+ */
+static gboolean post_cancel(resp_conn* conn, const uring_op op)
+{
+    if (!reserve_sqes(1)) return FALSE;
+
+    struct io_uring_sqe* sqe = io_uring_get_sqe(&ring);
+    io_uring_prep_cancel64(sqe, pack_user_data(conn, op), 0);
+    io_uring_sqe_set_data64(sqe, pack_user_data(conn, OP_CANCEL));
+    conn->active &= ~(1u << op);
+    return TRUE;
+}
+
+/**
+ * 發起非阻塞連接，連接請求鏈接一個超時
+ * @param owner 連接的所有者
+ * @param replies 創建響應的分配器
+ * @param addr 地址
+ * @param addr_len 地址長度
+ * @param timeout_ms 連接超時毫秒數
+ * @param error 失敗時輸出負的 errno
+ * @return 連接，失敗時返回空
+ */
+resp_conn* resp_conn_open(const gpointer owner, arena* replies, const struct sockaddr* addr,
+                          const socklen_t addr_len, const gint64 timeout_ms, gint* error)
+{
+    if (addr_len > sizeof(struct sockaddr_storage))
+    {
+        *error = -EINVAL;
+        return nullptr;
+    }
+    resp_conn* conn = acquire_slot();
+    if (conn == nullptr)
+    {
+        *error = -EMFILE;
+        return nullptr;
+    }
+
+    conn->fd = socket(addr->sa_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (conn->fd < 0 || !reserve_sqes(2))
+    {
+        *error = conn->fd < 0 ? -errno : -EBUSY;
+        release_slot(conn);
+        return nullptr;
+    }
+    if (addr->sa_family == AF_INET || addr->sa_family == AF_INET6)
+    {
+        const gint enable = 1;
+        setsockopt(conn->fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    }
+    conn->owner = owner;
+    conn->reader = redisReaderCreateWithFunctions(&arena_reply_functions);
+    conn->reader->privdata = replies;
+    memcpy(&conn->addr, addr, addr_len);
+    set_timeout(&conn->connect_timeout, timeout_ms);
+
+    struct io_uring_sqe* sqe = io_uring_get_sqe(&ring);
+    io_uring_prep_connect(sqe, conn->fd, (struct sockaddr*)&conn->addr, addr_len);
+    io_uring_sqe_set_data64(sqe, pack_user_data(conn, OP_CONNECT));
+    io_uring_sqe_set_flags(sqe, IOSQE_IO_LINK);
+    sqe = io_uring_get_sqe(&ring);
+    io_uring_prep_link_timeout(sqe, &conn->connect_timeout, 0);
+    io_uring_sqe_set_data64(sqe, pack_user_data(conn, OP_CONNECT_TIMEOUT));
+    conn->active |= 1u << OP_CONNECT;
+    conn->in_flight += 2;
+    return conn;
+}
+
+/**
+ * 發送命令並等待指定數量的響應，同時提交發送與超時
+ * @param conn 已連接且沒有待收響應的連接
+ * @param data 編碼後的命令
+ * @param length 字節數
+ * @param replies 預期的響應數
+ * @param timeout_ms 等待所有響應的超時毫秒數
+ * @return 是否已排入提交隊列
+ */
+gboolean resp_conn_send(resp_conn* conn, const gchar* data, const gsize length, const guint replies,
+                        const gint64 timeout_ms)
+{
+    if (conn->closed || !conn->connected || conn->pending > 0 || conn->active & 1u << OP_SEND) return FALSE;
+    if (!reserve_sqes(2)) return FALSE;
+
+    if (length > conn->send_capacity)
+    {
+        conn->send_buffer = g_realloc(conn->send_buffer, length);
+        conn->send_capacity = length;
+    }
+    memcpy(conn->send_buffer, data, length);
+    conn->send_length = length;
+    conn->sent = 0;
+    conn->pending = replies;
+    post_send(conn);
+
+    set_timeout(&conn->reply_timeout, timeout_ms);
+    struct io_uring_sqe* sqe = io_uring_get_sqe(&ring);
+    io_uring_prep_timeout(sqe, &conn->reply_timeout, 0, 0);
+    io_uring_sqe_set_data64(sqe, pack_user_data(conn, OP_TIMEOUT));
+    conn->active |= 1u << OP_TIMEOUT;
+    conn->in_flight++;
+    return TRUE;
+}
+
+/**
+ * 尚未收到的響應數
+ * @param conn 連接
+ * @return 響應數
+ */
+guint resp_conn_pending(const resp_conn* conn)
+{
+    return conn->pending;
+}
+
+/**
+ * 連接的套接字
+ * @param conn 連接
+ * @return 文件描述符
+ */
+gint resp_conn_fd(const resp_conn* conn)
+{
+    return conn->fd;
+}
+
+/**
+ * 關閉連接，取消進行中的請求；無法提交取消時關閉套接字的讀寫，連接請求由其超時結束
+ * @param conn 連接
+ */
+void resp_conn_close(resp_conn* conn)
+{
+    if (conn->closed) return;
+    conn->closed = TRUE;
+    conn->pending = 0;
+
+    static const uring_op cancellable[] = {OP_CONNECT, OP_SEND, OP_READ, OP_TIMEOUT};
+    for (guint i = 0; i < G_N_ELEMENTS(cancellable); ++i)
+    {
+        if (conn->active & 1u << cancellable[i] && !post_cancel(conn, cancellable[i])) shutdown(conn->fd, SHUT_RDWR);
+    }
+    if (conn->in_flight == 0) release_slot(conn);
+}
+
+/**
+ * 關閉連接並報告失敗
+ * @param conn 連接
+ * @param error 負的 errno，對端關閉時為 0
+ */
+static void fail_conn(resp_conn* conn, const gint error)
+{
+    if (conn->closed) return;
+    resp_conn_close(conn);
+    uring_callbacks.failed(conn->owner, error);
+}
+
+/**
+ * 取出解析完成的響應，收齊後取消超時；回調中可能關閉連接
+ * @param conn 連接
+ */
+static void dispatch_replies(resp_conn* conn)
+{
+    while (!conn->closed)
+    {
+        void* reply = nullptr;
+        if (redisReaderGetReply(conn->reader, &reply) != REDIS_OK || (reply != nullptr && conn->pending == 0))
+        {
+            fail_conn(conn, -EPROTO);
+            return;
+        }
+        if (reply == nullptr) return;
+
+        if (--conn->pending == 0 && conn->active & 1u << OP_TIMEOUT) post_cancel(conn, OP_TIMEOUT);
+        uring_callbacks.reply(conn->owner, reply);
+    }
+}
+
+/**
+ * 連接完成，成功時開始讀取
+ * @param conn 連接
+ * @param res 結果
+ */
+static void complete_connect(resp_conn* conn, const gint res)
+{
+    conn->active &= ~(1u << OP_CONNECT);
+    if (conn->closed) return;
+
+    // 鏈接的超時先到時，連接請求被取消
+    gint error = res == -ECANCELED ? -ETIMEDOUT : res;
+    if (error == 0)
+    {
+        conn->connected = TRUE;
+        if (!post_read(conn)) error = -EBUSY;
+    }
+    if (error != 0) resp_conn_close(conn);
+    uring_callbacks.connected(conn->owner, error);
+}
+
+/**
+ * 發送完成，未發送完時繼續發送
+ * @param conn 連接
+ * @param res 發送的字節數或負的 errno
+ */
+static void complete_send(resp_conn* conn, const gint res)
+{
+    conn->active &= ~(1u << OP_SEND);
+    if (conn->closed) return;
+
+    if (res < 0)
+    {
+        fail_conn(conn, res);
+        return;
+    }
+    conn->sent += (gsize)res;
+    if (conn->sent < conn->send_length && !post_send(conn)) fail_conn(conn, -EBUSY);
+}
+
+/**
+ * 讀取完成，解析響應後繼續讀取
+ * @param conn 連接
+ * @param res 讀取的字節數，對端關閉時為 0，失敗時為負的 errno
+ */
+static void complete_read(resp_conn* conn, const gint res)
+{
+    conn->active &= ~(1u << OP_READ);
+    if (conn->closed) return;
+
+    if (res <= 0)
+    {
+        fail_conn(conn, res);
+        return;
+    }
+    redisReaderFeed(conn->reader, conn->read_buffer, (size_t)res);
+    dispatch_replies(conn);
+    if (!conn->closed && !post_read(conn)) fail_conn(conn, -EBUSY);
+}
+
+/**
+ * 等待響應超時；收齊響應後取消的超時以 -ECANCELED 完成
+ * @param conn 連接
+ * @param res 結果
+ */
+static void complete_timeout(resp_conn* conn, const gint res)
+{
+    if (res != -ETIME) return;
+    conn->active &= ~(1u << OP_TIMEOUT);
+    if (!conn->closed && conn->pending > 0) fail_conn(conn, -ETIMEDOUT);
+}
+
+/**
+ * 處理一個完成事件；處理期間持有請求計數，回調中關閉的連接在處理完後歸還槽位
+ * @param cqe 完成事件
+ */
+static void complete(const struct io_uring_cqe* cqe)
+{
+    const guint64 user_data = io_uring_cqe_get_data64(cqe);
+    const uring_op op = (uring_op)(user_data & 0xff);
+    if (op == OP_CANCEL) return;
+
+    // 槽位在所有請求完成前不會復用，完成事件總是屬於當前的連接
+    resp_conn* conn = slots[user_data >> 8 & (SLOT_INDEX_MAX - 1)];
+    switch (op)
+    {
+    case OP_CONNECT:
+        complete_connect(conn, cqe->res);
+        break;
+    case OP_SEND:
+        complete_send(conn, cqe->res);
+        break;
+    case OP_READ:
+        complete_read(conn, cqe->res);
+        break;
+    case OP_TIMEOUT:
+        complete_timeout(conn, cqe->res);
+        break;
+    default:
+        break;
+    }
+    if (--conn->in_flight == 0 && conn->closed) release_slot(conn);
+}
+
+/**
+ * 批量取出並處理完成事件，直到完成隊列為空
+ */
+static void process_completions()
+{
+    struct io_uring_cqe* cqes[COMPLETION_BATCH];
+    guint n;
+    while ((n = io_uring_peek_batch_cqe(&ring, cqes, COMPLETION_BATCH)) > 0)
+    {
+        for (guint i = 0; i < n; ++i) complete(cqes[i]);
+        io_uring_cq_advance(&ring, n);
+        uring_stats.completions += n;
+        uring_stats.batches++;
+    }
+}
+
+/**
+ * 完成事件回調，處理後提交回調中準備的請求
+ * @param fd 完成事件通知
+ * @param event 事件類型
+ * @param arg 未使用
+ */
+static void completion_callback(const evutil_socket_t fd, const short event, void* arg)
+{
+    (void)event; // 未使用
+    (void)arg; // 未使用
+    const gint64 started = loop_enter();
+
+    eventfd_t count = 0;
+    eventfd_read(fd, &count);
+    process_completions();
+    submit_queued();
+    loop_leave(&completion_site, started);
+}
+
+/**
+ * 是否編譯了 io_uring 支持
+ * @return 是否支持
+ */
+gboolean resp_uring_supported()
+{
+    return TRUE;
+}
+
+/**
+ * 創建 io_uring 實例並接入事件循環
+ * @param base 事件循環
+ * @param entries 提交隊列的容量
+ * @param capacity 連接數上限
+ * @param read_size 每個連接的讀取緩衝區字節數
+ * @param callbacks 連接事件回調
+ * @return 是否成功
+ */
+gboolean start_resp_uring(struct event_base* base, const guint entries, const guint capacity, const gsize read_size,
+                          const resp_conn_callbacks* callbacks)
+{
+    // 每個連接最多同時有連接、超時、讀取與發送四個請求，完成隊列按此預留，積壓時由內核暫存
+    struct io_uring_params params = {0};
+    params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_CLAMP;
+    params.cq_entries = (guint)MIN((guint64)MAX(entries, capacity) * 4, G_MAXUINT32);
+    const gint ret = io_uring_queue_init_params(entries, &ring, &params);
+    if (ret < 0)
+    {
+        g_printerr("Cannot create io_uring: %s\n", g_strerror(-ret));
+        return FALSE;
+    }
+    if (!(params.features & IORING_FEAT_NODROP) || !(params.features & IORING_FEAT_FAST_POLL))
+    {
+        g_printerr("Cannot use io_uring: the kernel is too old for socket operations\n");
+        io_uring_queue_exit(&ring);
+        return FALSE;
+    }
+
+    completion_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    const gint eventfd_error = completion_fd < 0 ? errno : -io_uring_register_eventfd(&ring, completion_fd);
+    if (eventfd_error != 0)
+    {
+        g_printerr("Cannot register eventfd for io_uring: %s\n", g_strerror(eventfd_error));
+        if (completion_fd >= 0) close(completion_fd);
+        completion_fd = -1;
+        io_uring_queue_exit(&ring);
+        return FALSE;
+    }
+
+    // 固定緩衝區表先以空位登記，槽位創建時再填入
+    fixed_buffers = MIN(capacity, FIXED_BUFFERS_MAX);
+    const gint registered = io_uring_register_buffers_sparse(&ring, fixed_buffers);
+    if (registered < 0)
+    {
+        g_printerr("Cannot register io_uring buffer table: %s, using unregistered reads\n", g_strerror(-registered));
+        fixed_buffers = 0;
+    }
+
+    uring_callbacks = *callbacks;
+    slot_capacity = MIN(capacity, SLOT_INDEX_MAX);
+    slots = g_new0(resp_conn*, slot_capacity);
+    free_slots = g_new(guint, slot_capacity);
+    n_slots = 0;
+    n_free = 0;
+    buffer_size = read_size;
+    uring_stats = (resp_uring_stats){0};
+
+    completion_event = event_new(base, completion_fd, EV_READ | EV_PERSIST, completion_callback, nullptr);
+    event_add(completion_event, nullptr);
+    submit_event = event_new(base, -1, 0, submit_callback, nullptr);
+    submit_scheduled = FALSE;
+    ring_ready = TRUE;
+    return TRUE;
+}
+
+/**
+ * 關閉所有連接，等待內核歸還請求（最多 1 秒）後釋放 io_uring 實例
+ */
+void stop_resp_uring()
+{
+    if (!ring_ready) return;
+
+    for (guint i = 0; i < n_slots; ++i)
+    {
+        if (slots[i]->used) resp_conn_close(slots[i]);
+    }
+    submit_queued();
+    const gint64 deadline = g_get_monotonic_time() + G_USEC_PER_SEC;
+    while (uring_stats.open > 0 && g_get_monotonic_time() < deadline)
+    {
+        struct io_uring_cqe* cqe;
+        struct __kernel_timespec wait = {.tv_sec = 0, .tv_nsec = 100000000};
+        if (io_uring_wait_cqe_timeout(&ring, &cqe, &wait) == 0) process_completions();
+        submit_queued();
+    }
+
+    event_free(submit_event);
+    submit_event = nullptr;
+    event_free(completion_event);
+    completion_event = nullptr;
+    io_uring_queue_exit(&ring);
+    close(completion_fd);
+    completion_fd = -1;
+    ring_ready = FALSE;
+
+    for (guint i = 0; i < n_slots; ++i)
+    {
+        resp_conn* conn = slots[i];
+        if (conn->fd >= 0) close(conn->fd);
+        redisReaderFree(conn->reader);
+        g_free(conn->read_buffer);
+        g_free(conn->send_buffer);
+        g_free(conn);
+    }
+    g_free(slots);
+    slots = nullptr;
+    g_free(free_slots);
+    free_slots = nullptr;
+    n_slots = n_free = slot_capacity = 0;
+}
+
+/**
+ * 獲取統計
+ * @param stats 輸出的統計
+ */
+void resp_uring_get_stats(resp_uring_stats* stats)
+{
+    *stats = uring_stats;
+}
+
+#else
+
+// 未編譯 io_uring 支持時，啟動失敗並由調用者回退到 libevent
+
+gboolean resp_uring_supported()
+{
+    return FALSE;
+}
+
+gboolean start_resp_uring(struct event_base* base, const guint entries, const guint capacity, const gsize read_size,
+                          const resp_conn_callbacks* callbacks)
+{
+    (void)base; // 未使用
+    (void)entries; // 未使用
+    (void)capacity; // 未使用
+    (void)read_size; // 未使用
+    (void)callbacks; // 未使用
+    g_printerr("Cannot use io_uring: built without liburing\n");
+    return FALSE;
+}
+
+void stop_resp_uring()
+{
+}
+
+resp_conn* resp_conn_open(const gpointer owner, arena* replies, const struct sockaddr* addr,
+                          const socklen_t addr_len, const gint64 timeout_ms, gint* error)
+{
+    (void)owner; // 未使用
+    (void)replies; // 未使用
+    (void)addr; // 未使用
+    (void)addr_len; // 未使用
+    (void)timeout_ms; // 未使用
+    *error = -ENOTSUP;
+    return nullptr;
+}
+
+gboolean resp_conn_send(resp_conn* conn, const gchar* data, const gsize length, const guint replies,
+                        const gint64 timeout_ms)
+{
+    (void)conn; // 未使用
+    (void)data; // 未使用
+    (void)length; // 未使用
+    (void)replies; // 未使用
+    (void)timeout_ms; // 未使用
+    return FALSE;
+}
+
+guint resp_conn_pending(const resp_conn* conn)
+{
+    (void)conn; // 未使用
+    return 0;
+}
+
+gint resp_conn_fd(const resp_conn* conn)
+{
+    (void)conn; // 未使用
+    return -1;
+}
+
+void resp_conn_close(resp_conn* conn)
+{
+    (void)conn; // 未使用
+}
+
+void resp_uring_get_stats(resp_uring_stats* stats)
+{
+    *stats = (resp_uring_stats){0};
+}
+
+#endif
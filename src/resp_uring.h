@@ -0,0 +1,136 @@
+#pragma once
+#include <glib.h>
+#include <sys/socket.h>
+#include <event2/event.h>
+#include <hiredis/read.h>
+
+#include "arena.h"
+
+/**
+ * 基於 io_uring 的 RESP 連接
+ *
+ * 所有連接共用一個 io_uring 實例，通過 eventfd 接入事件循環：同一輪事件循環中準備的請求合併為一次提交，
+ * 完成事件批量處理；讀取使用登記的固定緩衝區，響應由 redisReader 在調用者提供的分配器中創建。
+ * 連接建立後始終保留一個讀取請求，空閒時也能及時發現對端關閉；命令一次寫入（可流水線），
+ * 並以一個定時請求限制等待響應的時間
+ */
+typedef struct resp_conn resp_conn;
+
+/**
+ * 連接事件回調，在事件循環線程中調用；關閉連接後不再回調
+ */
+typedef struct resp_conn_callbacks
+{
+    /**
+     * 連接完成
+     * @param owner 連接的所有者
+     * @param error 0 表示成功，否則為負的 errno，超時為 -ETIMEDOUT；失敗時連接已關閉
+     */
+    void (*connected)(gpointer owner, gint error);
+
+    /**
+     * 收到一條響應，響應在分配器重置前有效
+     * @param owner 連接的所有者
+     * @param reply 響應
+     */
+    void (*reply)(gpointer owner, const redisReply* reply);
+
+    /**
+     * 發送或讀取失敗，連接已關閉
+     * @param owner 連接的所有者
+     * @param error 負的 errno，對端關閉時為 0，超時為 -ETIMEDOUT，協議錯誤或多餘的響應為 -EPROTO
+     */
+    void (*failed)(gpointer owner, gint error);
+} resp_conn_callbacks;
+
+/**
+ * io_uring 統計
+ */
+typedef struct resp_uring_stats
+{
+    // 提交次數 (io_uring_enter)
+    guint64 submits;
+    // 提交的請求數
+    guint64 sqes;
+    // 完成事件數
+    guint64 completions;
+    // 處理完成事件的批次數
+    guint64 batches;
+    // 使用固定緩衝區的讀取數
+    guint64 fixed_reads;
+    // 當前連接數
+    guint64 open;
+} resp_uring_stats;
+
+/**
+ * 是否編譯了 io_uring 支持
+ * @return 是否支持
+ */
+gboolean resp_uring_supported();
+
+/**
+ * 創建 io_uring 實例並接入事件循環
+ * @param base 事件循環
+ * @param entries 提交隊列的容量
+ * @param capacity 連接數上限
+ * @param read_size 每個連接的讀取緩衝區字節數
+ * @param callbacks 連接事件回調
+ * @return 是否成功，內核不支持或被禁用時返回 FALSE 並輸出原因
+ */
+gboolean start_resp_uring(struct event_base* base, guint entries, guint capacity, gsize read_size,
+                          const resp_conn_callbacks* callbacks);
+
+/**
+ * 關閉所有連接並釋放 io_uring 實例
+ */
+void stop_resp_uring();
+
+/**
+ * 發起非阻塞連接，完成時調用 connected
+ * @param owner 連接的所有者，回調時傳回
+ * @param replies 創建響應的分配器
+ * @param addr 地址
+ * @param addr_len 地址長度
+ * @param timeout_ms 連接超時毫秒數
+ * @param error 失敗時輸出負的 errno
+ * @return 連接，失敗時返回空
+ */
+resp_conn* resp_conn_open(gpointer owner, arena* replies, const struct sockaddr* addr, socklen_t addr_len,
+                          gint64 timeout_ms, gint* error);
+
+/**
+ * 發送命令並等待指定數量的響應，每條響應調用一次 reply
+ * @param conn 已連接且沒有待收響應的連接
+ * @param data 編碼後的命令，會被複製
+ * @param length 字節數
+ * @param replies 預期的響應數
+ * @param timeout_ms 等待所有響應的超時毫秒數
+ * @return 是否已排入提交隊列，失敗時連接保持打開
+ */
+gboolean resp_conn_send(resp_conn* conn, const gchar* data, gsize length, guint replies, gint64 timeout_ms);
+
+/**
+ * 尚未收到的響應數
+ * @param conn 連接
+ * @return 響應數
+ */
+guint resp_conn_pending(const resp_conn* conn);
+
+/**
+ * 連接的套接字，可用於讀取套接字選項
+ * @param conn 連接
+ * @return 文件描述符
+ */
+gint resp_conn_fd(const resp_conn* conn);
+
+/**
+ * 關閉連接，取消進行中的請求，之後不再回調；緩衝區在內核歸還後才會復用
+ * @param conn 連接
+ */
+void resp_conn_close(resp_conn* conn);
+
+/**
+ * 獲取統計
+ * @param stats 輸出的統計
+ */
+void resp_uring_get_stats(resp_uring_stats* stats);
@@ -0,0 +1,462 @@
+#include "rollup.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "config.h"
+
+// 匯總配置
+rollup_config_t ru_config = nullptr;
+
+// 每個草圖的桶數上限，相對誤差 5% 時可覆蓋約 6 個數量級
+#define ROLLUP_MAX_BINS 128
+
+// 各層級的時間粒度（秒）
+static const guint32 tier_seconds[ROLLUP_TIER_COUNT] = {1, 60, 3600};
+
+// 各層級的名稱
+static const gchar* tier_names[ROLLUP_TIER_COUNT] = {"1s", "1m", "1h"};
+
+/**
+ * 目標的匯總
+ */
+typedef struct rollup_series
+{
+    // 各層級的時間桶，按開始時間取模定位
+    rollup_bucket* tiers[ROLLUP_TIER_COUNT];
+    // 最近一次寫入的時間（UNIX 秒）
+    guint32 latest;
+} rollup_series;
+
+// 目標名稱到匯總的映射 (gchar* -> rollup_series*)
+static GHashTable* series_table = nullptr;
+// 保護 series_table 與時間桶；只有匯總線程寫入，查詢線程在讀鎖內複製所需的桶
+static GRWLock series_lock;
+// 草圖桶寬度的對數 (ln γ)
+static gdouble log_gamma = 0;
+
+/**
+ * 讀取匯總配置
+ * @param keyfile 配置文件
+ * @param error 錯誤對象
+ */
+gboolean init_rollup_config(GKeyFile* keyfile, GError* error)
+{
+    (void)error; // 可選配置由 read_optional_* 自行處理錯誤
+
+    // 創建匯總配置對象
+    ru_config = g_malloc0(sizeof(rollup_config));
+
+    // 讀取各層級保留的桶數，默認保留 5 分鐘、12 小時與 3 週
+    static const gchar* keys[ROLLUP_TIER_COUNT] = {"seconds", "minutes", "hours"};
+    static const gint64 defaults[ROLLUP_TIER_COUNT] = {300, 720, 504};
+    for (gint i = 0; i < ROLLUP_TIER_COUNT; ++i)
+    {
+        if (!read_optional_integer(keyfile, "Rollup", keys[i], defaults[i], &ru_config->buckets[i])) goto error;
+        if (ru_config->buckets[i] < 1 || ru_config->buckets[i] > 1 << 20)
+        {
+            g_printerr("Error reading %s: must be between 1 and 1048576\n", keys[i]);
+            goto error;
+        }
+    }
+
+    // 讀取分位數的相對誤差
+    if (!read_optional_double(keyfile, "Rollup", "relative_accuracy", 0.05, &ru_config->relative_accuracy))
+        goto error;
+    if (ru_config->relative_accuracy < 0.005 || ru_config->relative_accuracy > 0.2)
+    {
+        g_printerr("Error reading relative_accuracy: must be between 0.005 and 0.2\n");
+        goto error;
+    }
+    return TRUE;
+
+error:
+    // 釋放配置
+    destroy_rollup_config();
+    return FALSE;
+}
+
+/**
+ * 釋放匯總配置
+ */
+void destroy_rollup_config()
+{
+    g_free(ru_config);
+    ru_config = nullptr;
+}
+
+/**
+ * 清空時間桶並釋放草圖
+ * @param bucket 時間桶
+ */
+void rollup_clear(rollup_bucket* bucket)
+{
+    g_free(bucket->sketch.bins);
+    memset(bucket, 0, sizeof(rollup_bucket));
+}
+
+/**
+ * 釋放目標的匯總
+ * @param data 匯總
+ */
+static void free_series(gpointer data)
+{
+    rollup_series* series = data;
+    for (gint i = 0; i < ROLLUP_TIER_COUNT; ++i)
+    {
+        for (gint64 j = 0; j < ru_config->buckets[i]; ++j) g_free(series->tiers[i][j].sketch.bins);
+        g_free(series->tiers[i]);
+    }
+    g_free(series);
+}
+
+/**
+ * 開始匯總
+ */
+void start_rollups()
+{
+    const gdouble a = ru_config->relative_accuracy;
+    log_gamma = log((1 + a) / (1 - a));
+    series_table = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, free_series);
+}
+
+/**
+ * 停止匯總並釋放所有時間桶
+ */
+void stop_rollups()
+{
+    if (series_table == nullptr) return;
+    g_rw_lock_writer_lock(&series_lock);
+    g_hash_table_destroy(series_table);
+    series_table = nullptr;
+    g_rw_lock_writer_unlock(&series_lock);
+}
+
+/**
+ * 草圖的計數
+ * @param sketch 草圖
+ * @return 計數數組
+ */
+static guint32* sketch_counts(const rollup_sketch* sketch)
+{
+    return sketch->bins;
+}
+
+/**
+ * 草圖的桶索引
+ * @param sketch 草圖
+ * @return 索引數組
+ */
+static gint16* sketch_keys(const rollup_sketch* sketch)
+{
+    return (gint16*)((guint32*)sketch->bins + sketch->capacity);
+}
+
+/**
+ * 擴大草圖的容量
+ * @param sketch 草圖
+ */
+static void grow_sketch(rollup_sketch* sketch)
+{
+    const guint16 capacity = sketch->capacity == 0 ? 4 : MIN(sketch->capacity * 2, ROLLUP_MAX_BINS);
+    gpointer bins = g_malloc(capacity * (sizeof(guint32) + sizeof(gint16)));
+    if (sketch->n_bins > 0)
+    {
+        memcpy(bins, sketch_counts(sketch), sketch->n_bins * sizeof(guint32));
+        memcpy((guint32*)bins + capacity, sketch_keys(sketch), sketch->n_bins * sizeof(gint16));
+    }
+    g_free(sketch->bins);
+    sketch->bins = bins;
+    sketch->capacity = capacity;
+}
+
+/**
+ * 在草圖中計入樣本
+ * @param sketch 草圖
+ * @param key 桶索引
+ * @param count 樣本數
+ */
+static void add_to_sketch(rollup_sketch* sketch, const gint key, const guint32 count)
+{
+    guint32* counts = sketch_counts(sketch);
+    gint16* keys = sketch_keys(sketch);
+
+    // 二分查找第一個不小於 key 的桶
+    guint low = 0;
+    guint high = sketch->n_bins;
+    while (low < high)
+    {
+        const guint mid = (low + high) / 2;
+        if (keys[mid] < key) low = mid + 1;
+        else high = mid;
+    }
+
+    if (low == sketch->n_bins || keys[low] != key)
+    {
+        // 桶數已滿，低於所有桶的樣本直接併入最低的桶，否則合併最低的兩個桶騰出位置後照常插入
+        if (sketch->n_bins == ROLLUP_MAX_BINS && low == 0)
+        {
+            counts[0] = counts[0] > G_MAXUINT32 - count ? G_MAXUINT32 : counts[0] + count;
+            return;
+        }
+        if (sketch->n_bins == ROLLUP_MAX_BINS)
+        {
+            counts[1] = counts[1] > G_MAXUINT32 - counts[0] ? G_MAXUINT32 : counts[1] + counts[0];
+            memmove(counts, counts + 1, (sketch->n_bins - 1) * sizeof(guint32));
+            memmove(keys, keys + 1, (sketch->n_bins - 1) * sizeof(gint16));
+            sketch->n_bins--;
+            low--;
+        }
+        else if (sketch->n_bins == sketch->capacity)
+        {
+            grow_sketch(sketch);
+            counts = sketch_counts(sketch);
+            keys = sketch_keys(sketch);
+        }
+        memmove(counts + low + 1, counts + low, (sketch->n_bins - low) * sizeof(guint32));
+        memmove(keys + low + 1, keys + low, (sketch->n_bins - low) * sizeof(gint16));
+        counts[low] = 0;
+        keys[low] = (gint16)key;
+        sketch->n_bins++;
+    }
+
+    counts[low] = counts[low] > G_MAXUINT32 - count ? G_MAXUINT32 : counts[low] + count;
+}
+
+/**
+ * 耗時對應的草圖桶索引
+ * @param us 耗時（微秒）
+ * @return 索引
+ */
+static gint sketch_key(const gint64 us)
+{
+    return us <= 1 ? 0 : (gint)ceil(log((gdouble)us) / log_gamma);
+}
+
+/**
+ * 計入一個樣本
+ * @param bucket 時間桶
+ * @param result 探測結果
+ */
+static void add_sample(rollup_bucket* bucket, const probe_result* result)
+{
+    if (result->outcome != PROBE_OK)
+    {
+        bucket->failures++;
+        return;
+    }
+
+    const gint32 us = (gint32)CLAMP(result->total_us, 0, G_MAXINT32);
+    if (bucket->count == 0 || us < bucket->min_us) bucket->min_us = us;
+    if (bucket->count == 0 || us > bucket->max_us) bucket->max_us = us;
+    bucket->count++;
+    bucket->sum_us += us;
+    add_to_sketch(&bucket->sketch, sketch_key(us), 1);
+}
+
+/**
+ * 將探測結果計入目標各層級的當前時間桶，每個樣本 O(1)
+ * @param name 目標名稱
+ * @param result 探測結果
+ */
+void rollup_append(const gchar* name, const probe_result* result)
+{
+    if (series_table == nullptr) return;
+
+    g_rw_lock_writer_lock(&series_lock);
+    rollup_series* series = g_hash_table_lookup(series_table, name);
+    if (series == nullptr)
+    {
+        series = g_malloc0(sizeof(rollup_series));
+        for (gint i = 0; i < ROLLUP_TIER_COUNT; ++i) series->tiers[i] = g_new0(rollup_bucket, ru_config->buckets[i]);
+        g_hash_table_insert(series_table, g_strdup(name), series);
+    }
+
+    const guint32 now = (guint32)(result->timestamp / G_USEC_PER_SEC);
+    series->latest = MAX(series->latest, now);
+    for (gint i = 0; i < ROLLUP_TIER_COUNT; ++i)
+    {
+        const guint32 period = now / tier_seconds[i];
+        rollup_bucket* bucket = &series->tiers[i][period % ru_config->buckets[i]];
+        const guint32 start = period * tier_seconds[i];
+        // 晚到的樣本所屬的桶已被覆蓋
+        if (bucket->start > start) continue;
+        // 桶中是上一輪的數據，覆蓋
+        if (bucket->start < start)
+        {
+            rollup_clear(bucket);
+            bucket->start = start;
+        }
+        add_sample(bucket, result);
+    }
+    g_rw_lock_writer_unlock(&series_lock);
+}
+
+/**
+ * 丟棄目標的匯總，用於目標被移除
+ * @param name 目標名稱
+ */
+void forget_rollups(const gchar* name)
+{
+    if (series_table == nullptr) return;
+    g_rw_lock_writer_lock(&series_lock);
+    g_hash_table_remove(series_table, name);
+    g_rw_lock_writer_unlock(&series_lock);
+}
+
+/**
+ * 遍歷目標在某層級中結束時間晚於 since 的時間桶
+ * @param name 目標名稱
+ * @param tier 層級
+ * @param since 起始時間（UNIX 微秒）
+ * @param visit 回調
+ * @param user_data 用戶數據
+ * @return 遍歷的桶數
+ */
+guint rollup_foreach(const gchar* name, const rollup_tier tier, const gint64 since, const rollup_visit_fn visit,
+                     const gpointer user_data)
+{
+    // 在讀鎖內複製窗口內的桶，回調在鎖外執行，不阻塞匯總線程的寫入
+    GArray* copies = g_array_new(FALSE, FALSE, sizeof(rollup_bucket));
+    g_rw_lock_reader_lock(&series_lock);
+    const rollup_series* series = series_table != nullptr ? g_hash_table_lookup(series_table, name) : nullptr;
+    if (series != nullptr)
+    {
+        // 從最舊的保留週期開始，跳過空桶與未被覆蓋的過期桶
+        const guint64 capacity = ru_config->buckets[tier];
+        const guint64 latest = series->latest / tier_seconds[tier];
+        const guint64 first = latest + 1 > capacity ? latest + 1 - capacity : 0;
+        for (guint64 period = first; period <= latest; ++period)
+        {
+            const rollup_bucket* bucket = &series->tiers[tier][period % capacity];
+            if (bucket->start != period * tier_seconds[tier] || bucket->start == 0) continue;
+            if ((gint64)(bucket->start + tier_seconds[tier]) * G_USEC_PER_SEC <= since) continue;
+            rollup_bucket copy = *bucket;
+            if (bucket->sketch.capacity > 0)
+                copy.sketch.bins = g_memdup2(bucket->sketch.bins,
+                                             bucket->sketch.capacity * (sizeof(guint32) + sizeof(gint16)));
+            g_array_append_val(copies, copy);
+        }
+    }
+    g_rw_lock_reader_unlock(&series_lock);
+
+    guint visited = 0;
+    while (visited < copies->len)
+    {
+        if (!visit(&g_array_index(copies, rollup_bucket, visited++), user_data)) break;
+    }
+    for (guint i = 0; i < copies->len; ++i) rollup_clear(&g_array_index(copies, rollup_bucket, i));
+    g_array_free(copies, TRUE);
+    return visited;
+}
+
+/**
+ * 合併回調
+ * @param bucket 時間桶
+ * @param user_data 合併結果
+ * @return 繼續遍歷
+ */
+static gboolean merge_visit(const rollup_bucket* bucket, const gpointer user_data)
+{
+    rollup_merge(user_data, bucket);
+    return TRUE;
+}
+
+/**
+ * 合併目標在某層級中結束時間晚於 since 的時間桶
+ * @param name 目標名稱
+ * @param tier 層級
+ * @param since 起始時間（UNIX 微秒）
+ * @param summary 輸出的合併結果，使用後需調用 rollup_clear
+ * @return 合併的桶數
+ */
+guint rollup_summarize(const gchar* name, const rollup_tier tier, const gint64 since, rollup_bucket* summary)
+{
+    memset(summary, 0, sizeof(rollup_bucket));
+    return rollup_foreach(name, tier, since, merge_visit, summary);
+}
+
+/**
+ * 將時間桶合併到另一個桶
+ * @param dst 目標桶
+ * @param src 來源桶
+ */
+void rollup_merge(rollup_bucket* dst, const rollup_bucket* src)
+{
+    if (dst->start == 0 || (src->start != 0 && src->start < dst->start)) dst->start = src->start;
+    dst->failures += src->failures;
+    if (src->count == 0) return;
+
+    if (dst->count == 0 || src->min_us < dst->min_us) dst->min_us = src->min_us;
+    if (dst->count == 0 || src->max_us > dst->max_us) dst->max_us = src->max_us;
+    dst->count += src->count;
+    dst->sum_us += src->sum_us;
+    const guint32* counts = sketch_counts(&src->sketch);
+    const gint16* keys = sketch_keys(&src->sketch);
+    for (guint i = 0; i < src->sketch.n_bins; ++i) add_to_sketch(&dst->sketch, keys[i], counts[i]);
+}
+
+/**
+ * 估算分位數
+ * @param bucket 時間桶
+ * @param q 分位 (0 ~ 1)
+ * @return 耗時（微秒），沒有樣本時返回 -1
+ */
+gint64 rollup_quantile(const rollup_bucket* bucket, const gdouble q)
+{
+    if (bucket->count == 0) return -1;
+    if (q <= 0) return bucket->min_us;
+    if (q >= 1) return bucket->max_us;
+
+    const guint32* counts = sketch_counts(&bucket->sketch);
+    const gint16* keys = sketch_keys(&bucket->sketch);
+    const gdouble rank = q * (bucket->count - 1);
+    guint64 seen = 0;
+    for (guint i = 0; i < bucket->sketch.n_bins; ++i)
+    {
+        seen += counts[i];
+        if (seen > rank)
+        {
+            // 取桶的中點，相對誤差不超過配置值，並限制在實際的最小與最大值之間
+            const gint key = keys[i];
+            const gdouble gamma = exp(log_gamma);
+            const gint64 value = key == 0 ? 1 : (gint64)(2 * exp(key * log_gamma) / (gamma + 1));
+            return CLAMP(value, bucket->min_us, bucket->max_us);
+        }
+    }
+    return bucket->max_us;
+}
+
+/**
+ * 選擇能覆蓋窗口的最細層級，超出所有層級時使用最粗的層級
+ * @param seconds 窗口秒數
+ * @return 層級
+ */
+rollup_tier rollup_pick_tier(const gint64 seconds)
+{
+    for (gint i = 0; i < ROLLUP_TIER_COUNT; ++i)
+    {
+        if (ru_config->buckets[i] * tier_seconds[i] >= seconds) return i;
+    }
+    return ROLLUP_HOUR;
+}
+
+/**
+ * 獲取層級名稱
+ * @param tier 層級
+ * @return 名稱
+ */
+const gchar* rollup_tier_name(const rollup_tier tier)
+{
+    return tier_names[tier];
+}
+
+/**
+ * 層級的時間粒度
+ * @param tier 層級
+ * @return 秒數
+ */
+guint32 rollup_tier_seconds(const rollup_tier tier)
+{
+    return tier_seconds[tier];
+}
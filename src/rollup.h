@@ -0,0 +1,188 @@
+#pragma once
+#include <glib.h>
+
+#include "target.h"
+
+/**
+ * 匯總層級
+ */
+typedef enum rollup_tier
+{
+    // 每秒
+    ROLLUP_SECOND = 0,
+    // 每分鐘
+    ROLLUP_MINUTE,
+    // 每小時
+    ROLLUP_HOUR,
+    // 層級數量
+    ROLLUP_TIER_COUNT
+} rollup_tier;
+
+/**
+ * 探測指標匯總配置
+ *
+ * 每個目標在每個層級保留固定數量的時間桶，過期的桶在寫入新數據時被覆蓋；
+ * 原始探測記錄由探測歷史保存，匯總只保留統計值，因此可以保留數週
+ *
+ * 配置:
+ *  - seconds 保留的秒級桶數
+ *  - minutes 保留的分鐘級桶數
+ *  - hours 保留的小時級桶數
+ *  - relative_accuracy 分位數的相對誤差
+ */
+typedef struct rollup_config
+{
+    // 各層級保留的桶數
+    gint64 buckets[ROLLUP_TIER_COUNT];
+    // 分位數的相對誤差
+    gdouble relative_accuracy;
+} rollup_config;
+
+typedef rollup_config* rollup_config_t;
+
+extern rollup_config_t ru_config;
+
+/**
+ * 分位數草圖 (DDSketch)，按耗時的對數分桶，可合併
+ *
+ * 只保存非空的桶，前 capacity 個 guint32 為計數，之後 capacity 個 gint16 為升序的桶索引；
+ * 桶數超過上限時合併最低的兩個桶，高分位數的精度不受影響
+ */
+typedef struct rollup_sketch
+{
+    // 計數與索引
+    gpointer bins;
+    // 非空的桶數
+    guint16 n_bins;
+    // 已分配的桶數
+    guint16 capacity;
+} rollup_sketch;
+
+/**
+ * 時間桶，耗時只統計成功的探測，單位為微秒
+ */
+typedef struct rollup_bucket
+{
+    // 耗時總和
+    gint64 sum_us;
+    // 分位數草圖
+    rollup_sketch sketch;
+    // 桶的開始時間（UNIX 秒），為 0 時為空桶
+    guint32 start;
+    // 成功的探測數
+    guint32 count;
+    // 失敗的探測數
+    guint32 failures;
+    // 最小耗時
+    gint32 min_us;
+    // 最大耗時
+    gint32 max_us;
+} rollup_bucket;
+
+/**
+ * 遍歷時間桶的回調，按時間從舊到新
+ * @param bucket 時間桶
+ * @param user_data 用戶數據
+ * @return 返回 FALSE 停止遍歷
+ */
+typedef gboolean (*rollup_visit_fn)(const rollup_bucket* bucket, gpointer user_data);
+
+/**
+ * 讀取匯總配置
+ * @param keyfile 配置文件
+ * @param error 錯誤對象
+ */
+gboolean init_rollup_config(GKeyFile* keyfile, GError* error);
+
+/**
+ * 釋放匯總配置
+ */
+void destroy_rollup_config();
+
+/**
+ * 開始匯總
+ */
+void start_rollups();
+
+/**
+ * 停止匯總並釋放所有時間桶
+ */
+void stop_rollups();
+
+/**
+ * 將探測結果計入目標各層級的當前時間桶，每個樣本 O(1)，只在匯總線程中調用
+ * @param name 目標名稱
+ * @param result 探測結果
+ */
+void rollup_append(const gchar* name, const probe_result* result);
+
+/**
+ * 丟棄目標的匯總，用於目標被移除，只在匯總線程中調用
+ * @param name 目標名稱
+ */
+void forget_rollups(const gchar* name);
+
+/**
+ * 遍歷目標在某層級中結束時間晚於 since 的時間桶，可在任意線程中調用
+ *
+ * 先在讀鎖內複製所需的桶，回調收到的是副本，不阻塞事件循環
+ * @param name 目標名稱
+ * @param tier 層級
+ * @param since 起始時間（UNIX 微秒）
+ * @param visit 回調
+ * @param user_data 用戶數據
+ * @return 遍歷的桶數
+ */
+guint rollup_foreach(const gchar* name, rollup_tier tier, gint64 since, rollup_visit_fn visit, gpointer user_data);
+
+/**
+ * 合併目標在某層級中結束時間晚於 since 的時間桶
+ * @param name 目標名稱
+ * @param tier 層級
+ * @param since 起始時間（UNIX 微秒）
+ * @param summary 輸出的合併結果，使用後需調用 rollup_clear
+ * @return 合併的桶數
+ */
+guint rollup_summarize(const gchar* name, rollup_tier tier, gint64 since, rollup_bucket* summary);
+
+/**
+ * 將時間桶合併到另一個桶
+ * @param dst 目標桶
+ * @param src 來源桶
+ */
+void rollup_merge(rollup_bucket* dst, const rollup_bucket* src);
+
+/**
+ * 估算分位數
+ * @param bucket 時間桶
+ * @param q 分位 (0 ~ 1)
+ * @return 耗時（微秒），沒有樣本時返回 -1
+ */
+gint64 rollup_quantile(const rollup_bucket* bucket, gdouble q);
+
+/**
+ * 清空時間桶並釋放草圖
+ * @param bucket 時間桶
+ */
+void rollup_clear(rollup_bucket* bucket);
+
+/**
+ * 選擇能覆蓋窗口的最細層級，超出所有層級時使用最粗的層級
+ * @param seconds 窗口秒數
+ * @return 層級
+ */
+rollup_tier rollup_pick_tier(gint64 seconds);
+
+/**
+ * 獲取層級名稱
+ * @param tier 層級
+ * @return 名稱
+ */
+const gchar* rollup_tier_name(rollup_tier tier);
+
+/**
+ * 層級的時間粒度
+ * @param tier 層級
+ * @return 秒數
+ */
+guint32 rollup_tier_seconds(rollup_tier tier);
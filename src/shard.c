@@ -0,0 +1,570 @@
+#include "shard.h"
+
+#include <stdatomic.h>
+#include <string.h>
+#include <unistd.h>
+#include <hiredis/hiredis.h>
+#include <hiredis/async.h>
+#include <hiredis/adapters/libevent.h>
+
+#include "config.h"
+#include "reload.h"
+#include "target.h"
+
+// 分片配置
+shard_config_t sh_config = nullptr;
+
+/**
+ * 續期腳本：以服務端時間寫入本成員，刪除過期成員並返回成員列表，副本之間的時鐘偏差不影響判斷。
+ * 腳本在 TIME 之後寫入，舊版本 Redis 需要按命令複製
+ */
+static const gchar heartbeat_script[] =
+    "redis.replicate_commands()\n"
+    "local t = redis.call('TIME')\n"
+    "local now = tonumber(t[1]) * 1000 + math.floor(tonumber(t[2]) / 1000)\n"
+    "redis.call('ZADD', KEYS[1], now, ARGV[1])\n"
+    "redis.call('ZREMRANGEBYSCORE', KEYS[1], '-inf', now - tonumber(ARGV[2]))\n"
+    "redis.call('PEXPIRE', KEYS[1], tonumber(ARGV[2]) * 2)\n"
+    "return redis.call('ZRANGE', KEYS[1], 0, -1)\n";
+
+// 事件循環
+static struct event_base* shard_base = nullptr;
+// 續期定時器
+static struct event* heartbeat_timer = nullptr;
+// 協調用 Redis 的連接
+static redisAsyncContext* store = nullptr;
+// 是否有續期請求在等待響應
+static gboolean in_flight = FALSE;
+// 上一次續期成功的時間（單調時鐘），從未成功時為 0
+static gint64 last_success = 0;
+// 協調服務是否可用，用於只在狀態變化時輸出
+static gboolean store_available = TRUE;
+// 當前成員，按名稱排序
+static gchar** members = nullptr;
+// 完整的目標配置列表 (target_config*)，分片的依據
+static GPtrArray* all_configs = nullptr;
+// 是否在運行
+static gboolean started = FALSE;
+// 是否正在停止
+static gboolean stopping = FALSE;
+
+// 狀態
+static atomic_uint stat_members = 0;
+static atomic_uint stat_owned = 0;
+static atomic_uint stat_total = 0;
+static atomic_bool stat_degraded = false;
+static atomic_uint_least64_t stat_rebalances = 0;
+
+/**
+ * 讀取分片配置
+ * @param keyfile 配置文件
+ * @param error 錯誤對象
+ */
+gboolean init_shard_config(GKeyFile* keyfile, GError* error)
+{
+    (void)error; // 可選配置由 read_optional_* 自行處理錯誤
+
+    gint64 port = 0;
+    gint64 heartbeat = 0;
+    gint64 ttl = 0;
+
+    // 創建分片配置對象
+    sh_config = g_malloc0(sizeof(shard_config));
+
+    // 讀取是否啟用
+    if (!read_optional_boolean(keyfile, "Shard", "enabled", FALSE, &sh_config->enabled)) goto error;
+    if (!sh_config->enabled) return TRUE;
+
+    // 讀取協調用 Redis 的連接參數
+    if (!read_optional_string(keyfile, "Shard", "redis_host", "127.0.0.1", &sh_config->redis_host)) goto error;
+    if (!read_optional_integer(keyfile, "Shard", "redis_port", 6379, &port)) goto error;
+    if (port <= 0 || port > 65535)
+    {
+        g_printerr("Error reading redis_port: must be between 1 and 65535\n");
+        goto error;
+    }
+    sh_config->redis_port = (gint)port;
+    if (!read_optional_string(keyfile, "Shard", "redis_username", nullptr, &sh_config->redis_username)) goto error;
+    if (!read_optional_string(keyfile, "Shard", "redis_password", nullptr, &sh_config->redis_password)) goto error;
+    if (sh_config->redis_username != nullptr && *sh_config->redis_username == '\0')
+        g_clear_pointer(&sh_config->redis_username, g_free);
+    if (sh_config->redis_password != nullptr && *sh_config->redis_password == '\0')
+        g_clear_pointer(&sh_config->redis_password, g_free);
+
+    // 讀取鍵名與成員名稱
+    if (!read_optional_string(keyfile, "Shard", "key", "redis-watcher:members", &sh_config->key)) goto error;
+    if (!read_optional_string(keyfile, "Shard", "id", nullptr, &sh_config->id)) goto error;
+    if (sh_config->id == nullptr || *sh_config->id == '\0')
+    {
+        g_free(sh_config->id);
+        sh_config->id = g_strdup_printf("%s:%d", g_get_host_name(), (gint)getpid());
+    }
+
+    // 讀取續期間隔與存活時間，存活時間至少容忍一次續期失敗
+    if (!read_optional_integer(keyfile, "Shard", "heartbeat", 2, &heartbeat)) goto error;
+    if (!read_optional_integer(keyfile, "Shard", "ttl", 10, &ttl)) goto error;
+    if (heartbeat < 1 || ttl < heartbeat * 2)
+    {
+        g_printerr("Error reading heartbeat: heartbeat must be positive and ttl at least twice the heartbeat\n");
+        goto error;
+    }
+    sh_config->heartbeat_ms = heartbeat * 1000;
+    sh_config->ttl_ms = ttl * 1000;
+    return TRUE;
+
+error:
+    // 釋放配置
+    destroy_shard_config();
+    return FALSE;
+}
+
+/**
+ * 釋放分片配置
+ */
+void destroy_shard_config()
+{
+    if (sh_config == nullptr) return;
+    g_free(sh_config->redis_host);
+    g_free(sh_config->redis_username);
+    g_free(sh_config->redis_password);
+    g_free(sh_config->key);
+    g_free(sh_config->id);
+    g_free(sh_config);
+    sh_config = nullptr;
+}
+
+/**
+ * 成員與目標名稱的權重，FNV-1a 後再做一次混合使各成員的權重相互獨立
+ * @param member 成員名稱
+ * @param name 目標名稱
+ * @return 權重
+ */
+static guint64 rendezvous_weight(const gchar* member, const gchar* name)
+{
+    guint64 h = 14695981039346656037ULL;
+    for (const gchar* p = member; *p != '\0'; ++p) h = (h ^ (guchar)*p) * 1099511628211ULL;
+    // 分隔符避免 "ab"+"c" 與 "a"+"bc" 相同
+    h = (h ^ 0xFF) * 1099511628211ULL;
+    for (const gchar* p = name; *p != '\0'; ++p) h = (h ^ (guchar)*p) * 1099511628211ULL;
+
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+/**
+ * 目標是否由本副本負責：權重最高的成員負責，權重相同時取名稱較小者
+ * @param name 目標名稱
+ * @return 是否負責
+ */
+static gboolean owns_target(const gchar* name)
+{
+    if (members == nullptr || atomic_load_explicit(&stat_degraded, memory_order_relaxed)) return TRUE;
+
+    const gchar* owner = nullptr;
+    guint64 best = 0;
+    for (guint i = 0; members[i] != nullptr; ++i)
+    {
+        const guint64 weight = rendezvous_weight(members[i], name);
+        if (owner == nullptr || weight > best || (weight == best && strcmp(members[i], owner) < 0))
+        {
+            owner = members[i];
+            best = weight;
+        }
+    }
+    return owner == nullptr || g_strcmp0(owner, sh_config->id) == 0;
+}
+
+/**
+ * 從完整列表中選出本副本負責的目標
+ * @return 目標配置的副本列表 (target_config*)
+ */
+static GPtrArray* select_owned()
+{
+    GPtrArray* owned = g_ptr_array_new();
+    for (guint i = 0; i < all_configs->len; ++i)
+    {
+        const target_config* config = g_ptr_array_index(all_configs, i);
+        if (owns_target(config->name)) g_ptr_array_add(owned, copy_target_config(config));
+    }
+    atomic_store_explicit(&stat_owned, owned->len, memory_order_relaxed);
+    atomic_store_explicit(&stat_total, all_configs->len, memory_order_relaxed);
+    return owned;
+}
+
+/**
+ * 按當前成員重新分配目標，只有歸屬變化的目標會開始或停止探測
+ */
+static void rebalance()
+{
+    const guint changes = update_targets(select_owned(), apply_target_change, nullptr);
+    atomic_fetch_add_explicit(&stat_rebalances, 1, memory_order_relaxed);
+    g_print("Shard rebalanced: %u replica(s)%s, owning %u of %u target(s), %u changed.\n",
+            members != nullptr ? g_strv_length(members) : 0,
+            atomic_load_explicit(&stat_degraded, memory_order_relaxed) ? " (coordination unavailable)" : "",
+            targets->len, all_configs->len, changes);
+}
+
+/**
+ * 按名稱比較成員
+ * @param a 成員指針
+ * @param b 成員指針
+ * @return 比較結果
+ */
+static gint compare_members(gconstpointer a, gconstpointer b)
+{
+    return g_strcmp0(*(const gchar* const*)a, *(const gchar* const*)b);
+}
+
+/**
+ * 解析續期腳本的響應
+ * @param reply 響應
+ * @return 排序後的成員列表 (需要使用 g_strfreev 釋放)，響應無效時返回空
+ */
+static gchar** parse_members(const redisReply* reply)
+{
+    if (reply == nullptr || reply->type != REDIS_REPLY_ARRAY) return nullptr;
+
+    GPtrArray* list = g_ptr_array_new();
+    for (gsize i = 0; i < reply->elements; ++i)
+    {
+        const redisReply* element = reply->element[i];
+        if (element->type == REDIS_REPLY_STRING) g_ptr_array_add(list, g_strndup(element->str, element->len));
+    }
+    g_ptr_array_sort(list, compare_members);
+    g_ptr_array_add(list, nullptr);
+    return (gchar**)g_ptr_array_free(list, FALSE);
+}
+
+/**
+ * 協調服務不可用時輸出原因，超過存活時間後改為探測全部目標
+ * @param reason 原因
+ */
+static void heartbeat_failed(const gchar* reason)
+{
+    if (store_available)
+    {
+        g_printerr("Shard coordination store unavailable: %s\n", reason);
+        store_available = FALSE;
+    }
+    if (atomic_load_explicit(&stat_degraded, memory_order_relaxed)) return;
+    if (g_get_monotonic_time() - last_success <= sh_config->ttl_ms * 1000) return;
+
+    // 其他副本此時已把本副本視為離開，它們可能也失去了協調服務，探測全部目標以免遺漏
+    atomic_store_explicit(&stat_degraded, true, memory_order_relaxed);
+    rebalance();
+}
+
+/**
+ * 成員列表更新，成員變化或從降級中恢復時重新分配
+ * @param list 排序後的成員列表（所有權轉移）
+ */
+static void heartbeat_succeeded(gchar** list)
+{
+    last_success = g_get_monotonic_time();
+    if (!store_available)
+    {
+        g_print("Shard coordination store available again.\n");
+        store_available = TRUE;
+    }
+
+    const gboolean recovered = atomic_load_explicit(&stat_degraded, memory_order_relaxed);
+    const gboolean changed = members == nullptr || !g_strv_equal((const gchar* const*)members,
+                                                                 (const gchar* const*)list);
+    g_strfreev(members);
+    members = list;
+    atomic_store_explicit(&stat_members, g_strv_length(members), memory_order_relaxed);
+    atomic_store_explicit(&stat_degraded, false, memory_order_relaxed);
+    if (changed || recovered) rebalance();
+}
+
+/**
+ * 續期響應回調
+ * @param c 連接
+ * @param r 響應，連接斷開或超時時為空
+ * @param privdata 未使用
+ */
+static void on_heartbeat(redisAsyncContext* c, void* r, void* privdata)
+{
+    (void)privdata; // 未使用
+    in_flight = FALSE;
+    if (stopping) return;
+
+    const redisReply* reply = r;
+    gchar** list = parse_members(reply);
+    if (list != nullptr)
+    {
+        heartbeat_succeeded(list);
+        return;
+    }
+    if (reply != nullptr && reply->type == REDIS_REPLY_ERROR) heartbeat_failed(reply->str);
+    else heartbeat_failed(c->err ? c->errstr : "no reply");
+}
+
+/**
+ * 認證響應回調，失敗時由續期請求報告
+ * @param c 連接
+ * @param r 響應
+ * @param privdata 未使用
+ */
+static void on_auth(redisAsyncContext* c, void* r, void* privdata)
+{
+    (void)c; // 未使用
+    (void)privdata; // 未使用
+    const redisReply* reply = r;
+    if (!stopping && reply != nullptr && reply->type == REDIS_REPLY_ERROR) heartbeat_failed(reply->str);
+}
+
+/**
+ * 連接完成回調
+ * @param c 連接
+ * @param status 連接狀態
+ */
+static void on_store_connect(const redisAsyncContext* c, const int status)
+{
+    // 連接失敗時 hiredis 會自動釋放連接
+    if (status == REDIS_OK) return;
+    store = nullptr;
+    in_flight = FALSE;
+    if (!stopping) heartbeat_failed(c->errstr);
+}
+
+/**
+ * 連接斷開回調，下一次續期時重新連接
+ * @param c 連接
+ * @param status 斷開狀態
+ */
+static void on_store_disconnect(const redisAsyncContext* c, const int status)
+{
+    store = nullptr;
+    in_flight = FALSE;
+    if (status != REDIS_OK && !stopping) heartbeat_failed(c->errstr);
+}
+
+/**
+ * 發起到協調服務的非阻塞連接，認證命令在連接完成前排隊
+ */
+static void connect_store()
+{
+    const struct timeval timeout = {sh_config->heartbeat_ms / 1000, sh_config->heartbeat_ms % 1000 * 1000};
+    redisOptions options = {0};
+    REDIS_OPTIONS_SET_TCP(&options, sh_config->redis_host, sh_config->redis_port);
+    options.connect_timeout = &timeout;
+    options.command_timeout = &timeout;
+
+    redisAsyncContext* ctx = redisAsyncConnectWithOptions(&options);
+    if (ctx == nullptr)
+    {
+        heartbeat_failed("can't allocate redis context");
+        return;
+    }
+    if (ctx->err)
+    {
+        heartbeat_failed(ctx->errstr);
+        redisAsyncFree(ctx);
+        return;
+    }
+
+    redisLibeventAttach(ctx, shard_base);
+    redisAsyncSetConnectCallback(ctx, on_store_connect);
+    redisAsyncSetDisconnectCallback(ctx, on_store_disconnect);
+    if (sh_config->redis_username != nullptr && sh_config->redis_password != nullptr)
+        redisAsyncCommand(ctx, on_auth, nullptr, "AUTH %s %s", sh_config->redis_username, sh_config->redis_password);
+    else if (sh_config->redis_password != nullptr)
+        redisAsyncCommand(ctx, on_auth, nullptr, "AUTH %s", sh_config->redis_password);
+    store = ctx;
+}
+
+/**
+ * 續期定時器回調，上一次請求未完成時跳過，由命令超時結束
+ * @param fd 文件描述符
+ * @param event 事件類型
+ * @param arg 未使用
+ */
+static void heartbeat_callback(const evutil_socket_t fd, const short event, void* arg)
+{
+    (void)fd; // 未使用
+    (void)event; // 未使用
+    (void)arg; // 未使用
+
+    if (in_flight) return;
+    if (store == nullptr) connect_store();
+    if (store == nullptr) return;
+
+    if (redisAsyncCommand(store, on_heartbeat, nullptr, "EVAL %s 1 %s %s %lld", heartbeat_script, sh_config->key,
+                          sh_config->id, (long long)sh_config->ttl_ms) == REDIS_OK)
+        in_flight = TRUE;
+}
+
+/**
+ * 建立阻塞連接並認證，用於啟動時登記與停止時註銷
+ * @return 連接，失敗時返回空並輸出原因
+ */
+static redisContext* connect_blocking()
+{
+    const struct timeval timeout = {sh_config->heartbeat_ms / 1000, sh_config->heartbeat_ms % 1000 * 1000};
+    redisContext* ctx = redisConnectWithTimeout(sh_config->redis_host, sh_config->redis_port, timeout);
+    if (ctx == nullptr || ctx->err)
+    {
+        g_printerr("Cannot connect to the shard coordination store %s:%d: %s\n", sh_config->redis_host,
+                   sh_config->redis_port, ctx != nullptr ? ctx->errstr : "can't allocate redis context");
+        if (ctx != nullptr) redisFree(ctx);
+        return nullptr;
+    }
+    redisSetTimeout(ctx, timeout);
+
+    redisReply* reply = nullptr;
+    if (sh_config->redis_username != nullptr && sh_config->redis_password != nullptr)
+        reply = redisCommand(ctx, "AUTH %s %s", sh_config->redis_username, sh_config->redis_password);
+    else if (sh_config->redis_password != nullptr)
+        reply = redisCommand(ctx, "AUTH %s", sh_config->redis_password);
+    else return ctx;
+
+    if (reply == nullptr || reply->type == REDIS_REPLY_ERROR)
+    {
+        g_printerr("Cannot authenticate to the shard coordination store: %s\n",
+                   reply != nullptr ? reply->str : ctx->errstr);
+        if (reply != nullptr) freeReplyObject(reply);
+        redisFree(ctx);
+        return nullptr;
+    }
+    freeReplyObject(reply);
+    return ctx;
+}
+
+/**
+ * 啟動時篩選目標的回調，探測尚未開始，無需處理
+ * @param t 目標
+ * @param change 變更
+ * @param previous 變更前的配置
+ * @param user_data 未使用
+ */
+static void ignore_change(target* t, const target_change change, const target_config* previous,
+                          gpointer user_data)
+{
+    (void)t; // 未使用
+    (void)change; // 未使用
+    (void)previous; // 未使用
+    (void)user_data; // 未使用
+}
+
+/**
+ * 登記成員並篩選目標
+ * @param base 事件循環
+ * @return 是否成功
+ */
+gboolean start_shard(struct event_base* base)
+{
+    if (!sh_config->enabled) return TRUE;
+
+    shard_base = base;
+    stopping = FALSE;
+    all_configs = g_ptr_array_new_with_free_func((GDestroyNotify)free_target_config);
+    for (guint i = 0; i < targets->len; ++i)
+    {
+        const target* t = g_ptr_array_index(targets, i);
+        g_ptr_array_add(all_configs, copy_target_config(t->config));
+    }
+
+    // 同步登記一次，取得成員列表後再開始探測，避免與其他副本重複探測
+    redisContext* ctx = connect_blocking();
+    redisReply* reply = ctx != nullptr
+                            ? redisCommand(ctx, "EVAL %s 1 %s %s %lld", heartbeat_script, sh_config->key,
+                                           sh_config->id, (long long)sh_config->ttl_ms)
+                            : nullptr;
+    gchar** list = parse_members(reply);
+    if (list != nullptr)
+    {
+        last_success = g_get_monotonic_time();
+        members = list;
+        atomic_store_explicit(&stat_members, g_strv_length(members), memory_order_relaxed);
+    }
+    else
+    {
+        if (ctx != nullptr)
+        {
+            g_printerr("Cannot join the shard: %s\n",
+                       reply != nullptr && reply->type == REDIS_REPLY_ERROR ? reply->str : ctx->errstr);
+        }
+        g_printerr("Probing all targets until the shard coordination store is reachable.\n");
+        store_available = FALSE;
+        atomic_store_explicit(&stat_degraded, true, memory_order_relaxed);
+    }
+    if (reply != nullptr) freeReplyObject(reply);
+    if (ctx != nullptr) redisFree(ctx);
+
+    update_targets(select_owned(), ignore_change, nullptr);
+    g_print("Shard member %s joined: %u replica(s), owning %u of %u target(s).\n", sh_config->id,
+            members != nullptr ? g_strv_length(members) : 0, targets->len, all_configs->len);
+
+    heartbeat_timer = event_new(base, -1, EV_PERSIST, heartbeat_callback, nullptr);
+    const struct timeval interval = {sh_config->heartbeat_ms / 1000, sh_config->heartbeat_ms % 1000 * 1000};
+    event_add(heartbeat_timer, &interval);
+    started = TRUE;
+    return TRUE;
+}
+
+/**
+ * 停止續期並註銷成員
+ */
+void stop_shard()
+{
+    if (!started) return;
+    started = FALSE;
+    stopping = TRUE;
+
+    event_free(heartbeat_timer);
+    heartbeat_timer = nullptr;
+    // 釋放時以空響應調用等待中的回調
+    if (store != nullptr) redisAsyncFree(store);
+    store = nullptr;
+    in_flight = FALSE;
+
+    // 立即註銷，其他副本不必等到存活時間過後才接管
+    redisContext* ctx = connect_blocking();
+    if (ctx != nullptr)
+    {
+        redisReply* reply = redisCommand(ctx, "ZREM %s %s", sh_config->key, sh_config->id);
+        if (reply != nullptr) freeReplyObject(reply);
+        redisFree(ctx);
+    }
+
+    g_strfreev(members);
+    members = nullptr;
+    g_ptr_array_free(all_configs, TRUE);
+    all_configs = nullptr;
+    shard_base = nullptr;
+}
+
+/**
+ * 以新的完整目標配置替換分片依據的列表
+ * @param configs 完整的目標配置列表，所有權轉移
+ * @return 本副本負責的目標配置列表
+ */
+GPtrArray* shard_assign(GPtrArray* configs)
+{
+    if (!started) return configs;
+
+    g_ptr_array_set_free_func(configs, (GDestroyNotify)free_target_config);
+    g_ptr_array_free(all_configs, TRUE);
+    all_configs = configs;
+    return select_owned();
+}
+
+/**
+ * 獲取分片狀態
+ * @param stats 輸出的狀態
+ */
+void shard_get_stats(shard_stats* stats)
+{
+    *stats = (shard_stats){
+        .members = atomic_load_explicit(&stat_members, memory_order_relaxed),
+        .owned = atomic_load_explicit(&stat_owned, memory_order_relaxed),
+        .total = atomic_load_explicit(&stat_total, memory_order_relaxed),
+        .degraded = atomic_load_explicit(&stat_degraded, memory_order_relaxed),
+        .rebalances = atomic_load_explicit(&stat_rebalances, memory_order_relaxed),
+    };
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include <glib.h>
+#include <event2/event.h>
+
+/**
+ * 目標分片配置
+ *
+ * 多個副本通過協調用的 Redis 登記成員：每個副本定期以腳本寫入有序集合（分數為 Redis 服務端時間），
+ * 同時刪除超過存活時間未續期的成員並讀回成員列表。每個目標按最高隨機權重 (rendezvous) 哈希
+ * 分配給唯一的成員，成員增減時只有歸屬變化的目標在副本間移動，其餘目標的連接與狀態不受影響。
+ * 協調服務不可用超過存活時間後改為探測全部目標，寧可重複告警也不遺漏
+ *
+ * 配置:
+ *  - enabled 是否啟用分片，未啟用時探測全部目標
+ *  - redis_host 協調用 Redis 的地址
+ *  - redis_port 協調用 Redis 的端口
+ *  - redis_username 協調用 Redis 的用戶名，可為空
+ *  - redis_password 協調用 Redis 的密碼，為空時不認證
+ *  - key 成員有序集合的鍵名
+ *  - id 本副本的成員名稱，默認為主機名加進程號
+ *  - heartbeat 續期間隔秒數
+ *  - ttl 成員存活時間秒數，須大於續期間隔
+ */
+typedef struct shard_config
+{
+    // 是否啟用
+    gboolean enabled;
+    // 協調用 Redis 的地址
+    gchar* redis_host;
+    // 協調用 Redis 的端口
+    gint redis_port;
+    // 協調用 Redis 的用戶名
+    gchar* redis_username;
+    // 協調用 Redis 的密碼
+    gchar* redis_password;
+    // 成員有序集合的鍵名
+    gchar* key;
+    // 本副本的成員名稱
+    gchar* id;
+    // 續期間隔（毫秒）
+    gint64 heartbeat_ms;
+    // 成員存活時間（毫秒）
+    gint64 ttl_ms;
+} shard_config;
+
+typedef shard_config* shard_config_t;
+
+extern shard_config_t sh_config;
+
+/**
+ * 分片狀態，可在任意線程中讀取
+ */
+typedef struct shard_stats
+{
+    // 當前成員數，未啟用時為 0
+    guint members;
+    // 本副本負責的目標數
+    guint owned;
+    // 配置中的目標總數
+    guint total;
+    // 是否因協調服務不可用而探測全部目標
+    gboolean degraded;
+    // 成員變化次數
+    guint64 rebalances;
+} shard_stats;
+
+/**
+ * 讀取分片配置
+ * @param keyfile 配置文件
+ * @param error 錯誤對象
+ */
+gboolean init_shard_config(GKeyFile* keyfile, GError* error);
+
+/**
+ * 釋放分片配置
+ */
+void destroy_shard_config();
+
+/**
+ * 登記成員並按首次取得的成員列表篩選目標，需在開始探測之前調用；
+ * 協調服務暫時不可用時探測全部目標並在後台重試
+ * @param base 事件循環
+ * @return 是否成功，未啟用時返回 TRUE
+ */
+gboolean start_shard(struct event_base* base);
+
+/**
+ * 停止續期並註銷成員，其他副本在下一次續期時接管本副本的目標
+ */
+void stop_shard();
+
+/**
+ * 以新的完整目標配置替換分片依據的列表，返回本副本負責的部分，用於重新載入配置
+ * @param configs 完整的目標配置列表 (target_config*)，所有權轉移
+ * @return 本副本負責的目標配置列表，未啟用時即為 configs
+ */
+GPtrArray* shard_assign(GPtrArray* configs);
+
+/**
+ * 獲取分片狀態，可在任意線程中調用
+ * @param stats 輸出的狀態
+ */
+void shard_get_stats(shard_stats* stats);
@@ -1,16 +1,141 @@
 #include "sms.h"
 
+#include <time.h>
 #include <jansson.h>
 #include <glib.h>
 #include <curl/curl.h>
 #include <openssl/rand.h>
-#include <openssl/hmac.h>
 #include <openssl/evp.h>
+#include <openssl/core_names.h>
+#include <openssl/params.h>
 #include <openssl/sha.h>
 
+#include "config.h"
+
+// API 版本
+#define API_VERSION "2018-05-01"
+// 單個號碼的發送接口
+#define ACTION_SEND "SendMessageToGlobe"
+// 多個號碼的批量發送接口
+#define ACTION_BATCH_SEND "BatchSendMessageToGlobe"
+// 簽名欄位
+#define SIGNED_HEADERS "host;x-acs-action;x-acs-content-sha256;x-acs-date;x-acs-signature-nonce;x-acs-version"
+// 請求類型
+#define CONTENT_TYPE "application/x-www-form-urlencoded"
+// SHA-256 的十六進制長度
+#define SHA256_HEX_LENGTH (SHA256_DIGEST_LENGTH * 2)
+// UUID 的長度
+#define UUID_LENGTH 36
+// x-acs-date 的長度，如 2025-01-01T00:00:00Z
+#define ACS_DATE_LENGTH 20
+
 // 阿里雲短信配置
 aliyun_sms_config_t ali_config = nullptr;
 
+/**
+ * 簽名器，讀取配置時建構一次
+ *
+ * HMAC 密鑰只在建構時設定一次，之後每次簽名以空密鑰重新初始化同一上下文；
+ * 摘要上下文與拼接緩衝區同樣復用，簽名過程除 curl 複製請求標頭外不再分配內存。
+ * 規範化請求與請求標頭中不隨請求變化的部分也預先拼好
+ */
+typedef struct sms_signer
+{
+    // HMAC 算法
+    EVP_MAC* mac;
+    // 已設定密鑰的 HMAC 上下文
+    EVP_MAC_CTX* hmac;
+    // SHA-256 算法，預先獲取以免每次摘要都查找實現
+    EVP_MD* sha256;
+    // 摘要上下文
+    EVP_MD_CTX* digest;
+    // 拼接規範化請求、待簽名字串與請求標頭的緩衝區
+    GString* scratch;
+    // 請求URL
+    gchar* url;
+    // 規範化請求開頭："POST\n/\n\nhost:<endpoint>\nx-acs-action:"
+    gchar* canonical_prefix;
+    // 規範化請求結尾："\nx-acs-version:<version>\n\n<signed headers>\n"
+    gchar* canonical_suffix;
+    // 授權頭開頭，其後接簽名
+    gchar* authorization_prefix;
+    // 固定的請求標頭
+    gchar* host_header;
+} sms_signer;
+
+// 簽名器，只在通知線程中使用
+static sms_signer signer;
+
+/**
+ * 釋放簽名器
+ */
+static void destroy_sms_signer()
+{
+    if (signer.hmac) EVP_MAC_CTX_free(signer.hmac);
+    if (signer.mac) EVP_MAC_free(signer.mac);
+    if (signer.digest) EVP_MD_CTX_free(signer.digest);
+    if (signer.sha256) EVP_MD_free(signer.sha256);
+    if (signer.scratch) g_string_free(signer.scratch, TRUE);
+    g_free(signer.url);
+    g_free(signer.canonical_prefix);
+    g_free(signer.canonical_suffix);
+    g_free(signer.authorization_prefix);
+    g_free(signer.host_header);
+    memset(&signer, 0, sizeof(signer));
+}
+
+/**
+ * 建構簽名器，預先處理 HMAC 密鑰與固定的請求片段
+ * @return 是否成功
+ */
+static gboolean init_sms_signer()
+{
+    signer.mac = EVP_MAC_fetch(nullptr, "HMAC", nullptr);
+    if (signer.mac == nullptr)
+    {
+        g_printerr("EVP_MAC_fetch() failed\n");
+        goto error;
+    }
+    signer.hmac = EVP_MAC_CTX_new(signer.mac);
+    if (signer.hmac == nullptr)
+    {
+        g_printerr("EVP_MAC_CTX_new() failed\n");
+        goto error;
+    }
+
+    gchar digest[] = "SHA256";
+    const OSSL_PARAM params[] = {
+        OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, digest, 0),
+        OSSL_PARAM_construct_end()
+    };
+    if (!EVP_MAC_init(signer.hmac, (const guchar*)ali_config->secret, strlen(ali_config->secret), params))
+    {
+        g_printerr("EVP_MAC_init() failed\n");
+        goto error;
+    }
+
+    signer.sha256 = EVP_MD_fetch(nullptr, "SHA256", nullptr);
+    signer.digest = EVP_MD_CTX_new();
+    if (signer.sha256 == nullptr || signer.digest == nullptr)
+    {
+        g_printerr("EVP_MD_fetch() failed\n");
+        goto error;
+    }
+
+    signer.url = g_strdup_printf("https://%s/", ali_config->endpoint);
+    signer.canonical_prefix = g_strdup_printf("POST\n/\n\nhost:%s\nx-acs-action:", ali_config->endpoint);
+    signer.canonical_suffix = g_strdup("\nx-acs-version:" API_VERSION "\n\n" SIGNED_HEADERS "\n");
+    signer.authorization_prefix = g_strdup_printf("Authorization: %s Credential=%s,SignedHeaders=" SIGNED_HEADERS
+                                                  ",Signature=", ali_config->algorithm, ali_config->key);
+    signer.host_header = g_strdup_printf("host: %s", ali_config->endpoint);
+    signer.scratch = g_string_sized_new(512);
+    return TRUE;
+
+error:
+    destroy_sms_signer();
+    return FALSE;
+}
+
 /**
  * 讀取sms配置
  * @param keyfile 配置文件
@@ -21,9 +146,9 @@ gboolean init_sms_config(GKeyFile* keyfile, GError* error)
     // 申請内存
     ali_config = g_malloc0(sizeof(aliyun_sms_config));
 
-    // 讀取電話號碼
+    // 讀取電話號碼列表
     error = nullptr;
-    ali_config->mobile = g_key_file_get_string(keyfile, "Sms", "mobile", &error);
+    ali_config->mobile = g_key_file_get_string_list(keyfile, "Sms", "mobile", nullptr, &error);
     if (error != nullptr)
     {
         g_printerr("Error reading mobile: %s\n", error->message);
@@ -66,6 +191,12 @@ gboolean init_sms_config(GKeyFile* keyfile, GError* error)
         goto error;
     }
 
+    // 讀取可選的 CA 證書文件，未配置時使用系統默認
+    if (!read_optional_string(keyfile, "Sms", "ca_file", nullptr, &ali_config->ca_file)) goto error;
+
+    // 建構簽名器
+    if (!init_sms_signer()) goto error;
+
     return TRUE;
 error:
     // 釋放配置
@@ -80,8 +211,10 @@ void destroy_sms_config()
 {
     // 如果配置為空，則直接返回
     if (ali_config == nullptr)return;
+    // 釋放簽名器
+    destroy_sms_signer();
     // 釋放短信號碼
-    if (ali_config->mobile != nullptr)g_free(ali_config->mobile);
+    if (ali_config->mobile != nullptr)g_strfreev(ali_config->mobile);
     // 釋放api端點
     if (ali_config->endpoint != nullptr)g_free(ali_config->endpoint);
     // 釋放api key
@@ -90,535 +223,340 @@ void destroy_sms_config()
     if (ali_config->secret != nullptr)g_free(ali_config->secret);
     // 釋放api算法
     if (ali_config->algorithm != nullptr)g_free(ali_config->algorithm);
+    // 釋放CA證書路徑
+    g_free(ali_config->ca_file);
     // 釋放配置
     g_free(ali_config);
+    ali_config = nullptr;
 }
 
 
+// 小寫十六進制字符
+static const gchar hex_digits[] = "0123456789abcdef";
+
 /**
- * 生成nonce隨機數
- * @return 隨機數 (需要手動釋放)
+ * 以查表方式編碼為小寫十六進制
+ * @param bytes 輸入
+ * @param length 輸入長度
+ * @param output 輸出，至少 length * 2 + 1 字節
  */
-gchar* generate_uuid()
+static void hex_encode(const guchar* bytes, const gsize length, gchar* output)
 {
-    // 分配固定大小的記憶體（36字節 + null 結尾）
-    gchar* uuid = g_malloc0(37); // 自動補 '\0'
+    for (gsize i = 0; i < length; ++i)
+    {
+        output[i * 2] = hex_digits[bytes[i] >> 4];
+        output[i * 2 + 1] = hex_digits[bytes[i] & 0x0F];
+    }
+    output[length * 2] = '\0';
+}
 
+/**
+ * 生成nonce隨機數 (UUID v4)
+ * @param output 輸出
+ * @return 是否成功
+ */
+static gboolean generate_uuid(gchar output[UUID_LENGTH + 1])
+{
     // 產生16個隨機位元組
     guchar random_bytes[16];
     if (RAND_bytes(random_bytes, sizeof(random_bytes)) != 1)
     {
         g_printerr("RAND_bytes() failed\n");
-        g_free(uuid);
-        return nullptr;
+        return FALSE;
     }
 
     // 設定版本與變體
     random_bytes[6] = (random_bytes[6] & 0x0F) | 0x40; // Version 4
     random_bytes[8] = (random_bytes[8] & 0x3F) | 0x80; // Variant
 
-    // 格式化為 UUID 字串
-    g_snprintf(
-        uuid,
-        37,
-        "%02x%02x%02x%02x-%02x%02x-%02x%02x-%02x%02x-%02x%02x%02x%02x%02x%02x",
-        random_bytes[0], random_bytes[1], random_bytes[2], random_bytes[3],
-        random_bytes[4], random_bytes[5], random_bytes[6], random_bytes[7],
-        random_bytes[8], random_bytes[9], random_bytes[10], random_bytes[11],
-        random_bytes[12], random_bytes[13], random_bytes[14], random_bytes[15]);
-
-    return uuid; // 使用者記得 g_free
-}
-
-/**
- * 計算 SHA-256 哈希
- * @param input 輸入
- * @return 輸出 (需要手動釋放)
- */
-gchar* sha256_hex(const gchar* input)
-{
-    // 定義 SHA-256 容器
-    guchar hash[SHA256_DIGEST_LENGTH];
-
-    // 計算 SHA-256
-    SHA256((const guchar*)input, strlen(input), hash);
-
-    // 分配輸出字串記憶體：64位（2字元/byte）+ 結尾符
-    gchar* output = g_malloc0(SHA256_DIGEST_LENGTH * 2 + 1);
-
-    for (gint i = 0; i < SHA256_DIGEST_LENGTH; ++i)
+    // 格式化為 8-4-4-4-12 的 UUID 字串
+    gchar* p = output;
+    for (gsize i = 0; i < sizeof(random_bytes); ++i)
     {
-        g_snprintf(output + (i * 2), 3, "%02x", hash[i]);
+        if (i == 4 || i == 6 || i == 8 || i == 10) *p++ = '-';
+        *p++ = hex_digits[random_bytes[i] >> 4];
+        *p++ = hex_digits[random_bytes[i] & 0x0F];
     }
-
-    return output;
-}
-
-/**
- * 構建規範化標頭
- * @param host 主機地址
- * @param x_acs_action API名稱
- * @param hashed_payload 哈希請求體
- * @param x_acs_date 請求時間
- * @param uuid 隨機數
- * @param x_acs_version API版本
- * @return 規範化標頭 (需要手動釋放)
- */
-gchar* build_canonical_headers(
-    const gchar* host,
-    const gchar* x_acs_action,
-    const gchar* hashed_payload,
-    const gchar* x_acs_date,
-    const gchar* uuid,
-    const gchar* x_acs_version
-)
-{
-    GString* canonical = g_string_new(nullptr);
-
-    g_string_append_printf(canonical, "host:%s\n", host);
-    g_string_append_printf(canonical, "x-acs-action:%s\n", x_acs_action);
-    g_string_append_printf(canonical, "x-acs-content-sha256:%s\n", hashed_payload);
-    g_string_append_printf(canonical, "x-acs-date:%s\n", x_acs_date);
-    g_string_append_printf(canonical, "x-acs-signature-nonce:%s\n", uuid);
-    g_string_append_printf(canonical, "x-acs-version:%s", x_acs_version); // 最後一行不用換行
-
-    gchar* result = g_string_free(canonical, FALSE); // 轉為 gchar*，記得 g_free
-    return result;
+    *p = '\0';
+    return TRUE;
 }
 
 /**
- * 構建規範化請求
- * @param http_method 請求方法
- * @param canonical_uri 請求URI
- * @param query_params 查詢參數
- * @param canonical_headers 規範化標頭
- * @param signed_headers 簽名欄位
- * @param hashed_payload 哈希請求體
- * @return 規範化請求 (需要手動釋放)
+ * 生成 x-acs-date，精確到秒的 UTC 時間
+ * @param output 輸出
  */
-gchar* build_canonical_request(
-    const gchar* http_method,
-    const gchar* canonical_uri,
-    const gchar* query_params,
-    const gchar* canonical_headers,
-    const gchar* signed_headers,
-    const gchar* hashed_payload
-)
+static void format_acs_date(gchar output[ACS_DATE_LENGTH + 1])
 {
-    GString* request = g_string_new(nullptr);
-
-    g_string_append_printf(request, "%s\n", http_method);
-    g_string_append_printf(request, "%s\n", canonical_uri);
-    g_string_append_printf(request, "%s\n", query_params ? query_params : "");
-    g_string_append_printf(request, "%s\n\n", canonical_headers);
-    g_string_append_printf(request, "%s\n", signed_headers);
-    g_string_append(request, hashed_payload); // 最後一行不用換行
-
-    return g_string_free(request, FALSE);
+    const time_t now = time(nullptr);
+    struct tm utc;
+    gmtime_r(&now, &utc);
+    strftime(output, ACS_DATE_LENGTH + 1, "%Y-%m-%dT%H:%M:%SZ", &utc);
 }
 
 /**
- * 構建待簽名字串
- * @param algorithm 簽名算法
- * @param hashed_canonical_request 正常化請求的SHA-256
- * @return 待簽名字串 (需要手動釋放)
+ * 計算 SHA-256 哈希
+ * @param input 輸入
+ * @param length 輸入長度
+ * @param output 十六進制輸出
+ * @return 是否成功
  */
-gchar* build_string_to_sign(
-    const gchar* algorithm,
-    const gchar* hashed_canonical_request
-)
+static gboolean sha256_hex(const gchar* input, const gsize length, gchar output[SHA256_HEX_LENGTH + 1])
 {
-    GString* str = g_string_new(nullptr);
-    g_string_append_printf(str, "%s\n%s", algorithm, hashed_canonical_request);
-    return g_string_free(str, FALSE);
+    guchar hash[SHA256_DIGEST_LENGTH];
+    guint hash_length = 0;
+    if (!EVP_DigestInit_ex2(signer.digest, signer.sha256, nullptr) ||
+        !EVP_DigestUpdate(signer.digest, input, length) ||
+        !EVP_DigestFinal_ex(signer.digest, hash, &hash_length))
+    {
+        g_printerr("SHA-256 failed\n");
+        return FALSE;
+    }
+    hex_encode(hash, sizeof(hash), output);
+    return TRUE;
 }
 
 /**
- * HMAC-SHA256 簽名
- * @param key 密鑰
+ * HMAC-SHA256 簽名，以空密鑰重新初始化即沿用建構時設定的密鑰
  * @param message 訊息
- * @return 簽名 (需要手動釋放)
+ * @param length 訊息長度
+ * @param output 十六進制輸出
+ * @return 是否成功
  */
-gchar* hmac256(const gchar* key, const gchar* message)
+static gboolean hmac256_hex(const gchar* message, const gsize length, gchar output[SHA256_HEX_LENGTH + 1])
 {
     guchar hmac[SHA256_DIGEST_LENGTH];
-    unsigned int len = 0;
-
-    // 計算 HMAC
-    HMAC(EVP_sha256(),
-         key, (int)strlen(key),
-         (const guchar*)message, strlen(message),
-         hmac, &len);
-
-    // 分配 hex 字串空間（64字元 + null 結尾）
-    gchar* output = g_malloc0(SHA256_DIGEST_LENGTH * 2 + 1);
-
-    for (gint i = 0; i < SHA256_DIGEST_LENGTH; ++i)
+    gsize hmac_length = 0;
+    if (!EVP_MAC_init(signer.hmac, nullptr, 0, nullptr) ||
+        !EVP_MAC_update(signer.hmac, (const guchar*)message, length) ||
+        !EVP_MAC_final(signer.hmac, hmac, &hmac_length, sizeof(hmac)))
     {
-        g_snprintf(output + (i * 2), 3, "%02x", hmac[i]);
+        g_printerr("HMAC-SHA256 failed\n");
+        return FALSE;
     }
-
-    return output;
+    hex_encode(hmac, sizeof(hmac), output);
+    return TRUE;
 }
 
 /**
- * 構建授權頭
- * @param algorithm 簽名算法
- * @param access_key_id Access Key ID
- * @param signed_headers 簽名欄位
- * @param signature 簽名
- * @return 授權頭 (需要手動釋放)
+ * 在緩衝區中拼接請求標頭並追加到列表，curl 會複製內容
+ * @param headers 請求標頭
+ * @param name 標頭名稱與分隔符
+ * @param value 標頭值
+ * @return 請求標頭
  */
-gchar* build_authorization_header(
-    const gchar* algorithm,
-    const gchar* access_key_id,
-    const gchar* signed_headers,
-    const gchar* signature
-)
+static struct curl_slist* append_header(struct curl_slist* headers, const gchar* name, const gchar* value)
 {
-    GString* auth = g_string_new(nullptr);
-
-    g_string_append_printf(
-        auth,
-        "%s Credential=%s,SignedHeaders=%s,Signature=%s",
-        algorithm,
-        access_key_id,
-        signed_headers,
-        signature
-    );
-
-    return g_string_free(auth, FALSE);
+    g_string_assign(signer.scratch, name);
+    g_string_append(signer.scratch, value);
+    return curl_slist_append(headers, signer.scratch->str);
 }
 
 /**
- * 獲取authorization請求頭
- * @param http_method 請求方法
- * @param canonical_uri 請求URI
- * @param host 主機地址
- * @param x_acs_action API名稱
- * @param x_acs_version API版本
- * @param query_params 查詢參數
+ * 簽名並構建請求標頭，使用簽名器中復用的上下文與緩衝區，只能在通知線程中調用
+ * @param action API名稱
  * @param body 請求體
- * @param authorization_header 授權頭
- * @param hashed_payload 哈希請求體
- * @param x_acs_date 請求時間
- * @param uuid 隨機數
- */
-void get_authorization(
-    const gchar* http_method,
-    const gchar* canonical_uri,
-    const gchar* host,
-    const gchar* x_acs_action,
-    const gchar* x_acs_version,
-    const gchar* x_acs_date,
-    const gchar* query_params,
-    const gchar* body,
-    gchar** authorization_header,
-    gchar** hashed_payload,
-    gchar** uuid
-)
-{
-    // 產生UUID
-    *uuid = generate_uuid();
-
-    // 計算請求體的 SHA-256 哈希 (即 x-acs-content-sha256)
-    *hashed_payload = sha256_hex(body ? body : "");
-
-    // 構建規範化標頭
-    const auto canonical_headers = build_canonical_headers(
-        host,
-        x_acs_action,
-        *hashed_payload,
-        x_acs_date,
-        *uuid,
-        x_acs_version
-    );
-
-    // 簽名欄位
-    const auto signed_headers = "host;x-acs-action;x-acs-content-sha256;x-acs-date;x-acs-signature-nonce;x-acs-version";
-
-    // 構建規範化請求
-    const auto canonical_request = build_canonical_request(
-        http_method,
-        canonical_uri,
-        query_params,
-        canonical_headers,
-        signed_headers,
-        *hashed_payload
-    );
-
-    // 計算正常化請求的SHA-256雜湊
-    const auto hashed_canonical_request = sha256_hex(canonical_request);
-
-    // 構建待簽名字串
-    const auto string_to_sign = build_string_to_sign(ali_config->algorithm, hashed_canonical_request);
-
-    // 計算簽名
-    const auto signature = hmac256(ali_config->secret, string_to_sign);
-
-
-    // 構建最終的 Authorization 頭，包含 SignedHeaders
-    *authorization_header = build_authorization_header(ali_config->algorithm, ali_config->key, signed_headers,
-                                                       signature);
-
-    // 釋放資源
-    g_free(canonical_headers);
-    g_free(canonical_request);
-    g_free(hashed_canonical_request);
-    g_free(string_to_sign);
-    g_free(signature);
-}
-
-/**
- * 構建請求URL
- * @param host 主機地址
- * @param canonical_uri 請求URI
- * @param query_params 查詢參數
- * @return 請求URL (需要手動釋放)
+ * @param body_length 請求體長度
+ * @param date x-acs-date，為空時使用當前時間
+ * @param nonce x-acs-signature-nonce，為空時隨機生成
+ * @return cURL標頭 (需要手動釋放)，失敗時返回空
  */
-gchar* build_request_url(
-    const gchar* host,
-    const gchar* canonical_uri,
-    const gchar* query_params
-)
+struct curl_slist* sms_sign_request(const gchar* action, const gchar* body, const gsize body_length,
+                                    const gchar* date, const gchar* nonce)
 {
-    GString* url = g_string_new(nullptr);
-
-    if (query_params && *query_params != '\0')
+    gchar date_buffer[ACS_DATE_LENGTH + 1];
+    gchar nonce_buffer[UUID_LENGTH + 1];
+    gchar hashed_payload[SHA256_HEX_LENGTH + 1];
+    gchar hashed_canonical_request[SHA256_HEX_LENGTH + 1];
+    gchar signature[SHA256_HEX_LENGTH + 1];
+
+    // 產生x-acs-date、UUID與請求體哈希
+    if (date == nullptr)
     {
-        g_string_append_printf(url, "https://%s%s?%s", host, canonical_uri, query_params);
+        format_acs_date(date_buffer);
+        date = date_buffer;
     }
-    else
+    if (nonce == nullptr)
     {
-        g_string_append_printf(url, "https://%s%s", host, canonical_uri);
+        if (!generate_uuid(nonce_buffer)) return nullptr;
+        nonce = nonce_buffer;
     }
-
-    return g_string_free(url, FALSE);
+    if (!sha256_hex(body, body_length, hashed_payload)) return nullptr;
+
+    // 構建規範化請求，固定部分已預先拼好
+    GString* canonical = signer.scratch;
+    g_string_assign(canonical, signer.canonical_prefix);
+    g_string_append(canonical, action);
+    g_string_append(canonical, "\nx-acs-content-sha256:");
+    g_string_append_len(canonical, hashed_payload, SHA256_HEX_LENGTH);
+    g_string_append(canonical, "\nx-acs-date:");
+    g_string_append(canonical, date);
+    g_string_append(canonical, "\nx-acs-signature-nonce:");
+    g_string_append(canonical, nonce);
+    g_string_append(canonical, signer.canonical_suffix);
+    g_string_append_len(canonical, hashed_payload, SHA256_HEX_LENGTH);
+    if (!sha256_hex(canonical->str, canonical->len, hashed_canonical_request)) return nullptr;
+
+    // 構建待簽名字串並計算簽名
+    g_string_assign(canonical, ali_config->algorithm);
+    g_string_append_c(canonical, '\n');
+    g_string_append_len(canonical, hashed_canonical_request, SHA256_HEX_LENGTH);
+    if (!hmac256_hex(canonical->str, canonical->len, signature)) return nullptr;
+
+    // 構建請求標頭
+    struct curl_slist* headers = curl_slist_append(nullptr, "Content-Type: " CONTENT_TYPE);
+    headers = append_header(headers, signer.authorization_prefix, signature);
+    headers = curl_slist_append(headers, signer.host_header);
+    headers = append_header(headers, "x-acs-action: ", action);
+    headers = append_header(headers, "x-acs-content-sha256: ", hashed_payload);
+    headers = append_header(headers, "x-acs-date: ", date);
+    headers = append_header(headers, "x-acs-signature-nonce: ", nonce);
+    headers = curl_slist_append(headers, "x-acs-version: " API_VERSION);
+    return headers;
 }
 
 /**
- * 構建cURL標頭
- * @param content_type 請求類型
- * @param authorization_header 授權頭
- * @param host 主機地址
- * @param x_acs_action API名稱
- * @param hashed_payload 哈希請求體
- * @param x_acs_date 請求時間
- * @param uuid 隨機數
- * @param x_acs_version API版本
- * @return cURL標頭 (需要手動釋放)
+ * API 請求狀態，curl 不複製這些資料，需保留到請求完成
  */
-struct curl_slist* build_curl_headers(
-    const gchar* content_type,
-    const gchar* authorization_header,
-    const gchar* host,
-    const gchar* x_acs_action,
-    const gchar* hashed_payload,
-    const gchar* x_acs_date,
-    const gchar* uuid,
-    const gchar* x_acs_version
-)
+typedef struct api_request
 {
-    struct curl_slist* headers = nullptr;
-    GString* header = g_string_new(nullptr);
-
-    // Content-Type
-    g_string_printf(header, "Content-Type: %s", content_type);
-    headers = curl_slist_append(headers, header->str);
+    // 請求URL
+    gchar* url;
+    // 請求體
+    gchar* body;
+    // 請求標頭
+    struct curl_slist* headers;
+} api_request;
 
-    // Authorization
-    g_string_printf(header, "Authorization: %s", authorization_header);
-    headers = curl_slist_append(headers, header->str);
-
-    // Host
-    g_string_printf(header, "host: %s", host);
-    headers = curl_slist_append(headers, header->str);
-
-    // x-acs-action
-    g_string_printf(header, "x-acs-action: %s", x_acs_action);
-    headers = curl_slist_append(headers, header->str);
-
-    // x-acs-content-sha256
-    g_string_printf(header, "x-acs-content-sha256: %s", hashed_payload);
-    headers = curl_slist_append(headers, header->str);
-
-    // x-acs-date
-    g_string_printf(header, "x-acs-date: %s", x_acs_date);
-    headers = curl_slist_append(headers, header->str);
-
-    // x-acs-signature-nonce
-    g_string_printf(header, "x-acs-signature-nonce: %s", uuid);
-    headers = curl_slist_append(headers, header->str);
-
-    // x-acs-version
-    g_string_printf(header, "x-acs-version: %s", x_acs_version);
-    headers = curl_slist_append(headers, header->str);
-
-    g_string_free(header, TRUE); // 清理 GString
-    return headers; // 呼叫者 curl_slist_free_all()
+/**
+ * 釋放 API 請求狀態
+ * @param data API 請求狀態
+ */
+static void free_api_request(gpointer data)
+{
+    api_request* state = data;
+    g_free(state->url);
+    g_free(state->body);
+    curl_slist_free_all(state->headers);
+    g_free(state);
 }
 
 /**
- * 調用API
- * @param http_method 請求方法
- * @param canonical_uri 請求URI
- * @param host 主機地址
+ * 建構API請求
+ *
+ * 句柄來自通知器的句柄池，與其他請求共享 TLS 會話；開啟證書驗證，並優先使用 HTTP/2 以便併發請求復用同一連接
+ * @param request 請求對象
  * @param x_acs_action API名稱
- * @param x_acs_version API版本
- * @param query_params 查詢參數
  * @param body 請求體
- * @param content_type 請求類型
  * @param body_length 請求體長度
+ * @return 是否成功
  */
-void call_api(
-    const gchar* http_method,
-    const gchar* canonical_uri,
-    const gchar* host,
-    const gchar* x_acs_action,
-    const gchar* x_acs_version,
-    const gchar* query_params,
-    const gchar* body,
-    const gchar* content_type,
-    size_t body_length
-)
+static gboolean prepare_api_request(notify_request* request, const gchar* x_acs_action, const gchar* body,
+                                    const gsize body_length)
 {
-    // 擷取簽名所需的參數值
-    gchar* authorization_header = nullptr;
-    gchar* hashed_payload = nullptr;
-    gchar* uuid = nullptr;
-
-    // 產生x-acs-date
-    const auto now = g_date_time_new_now_utc();
-    const auto x_acs_date = g_date_time_format(now, "%Y-%m-%dT%H:%M:%SZ");
-    g_date_time_unref(now);
-
-    // 擷取授權頭
-    get_authorization(
-        http_method,
-        canonical_uri,
-        host,
-        x_acs_action,
-        x_acs_version,
-        x_acs_date,
-        query_params,
-        body,
-        &authorization_header,
-        &hashed_payload,
-        &uuid
-    );
-
-    // 構建請求路徑 URL
-    const auto url = build_request_url(host, canonical_uri, query_params);
-
-    // 初始化cURL
-    CURL* curl = curl_easy_init();
+    // 簽名
+    struct curl_slist* headers = sms_sign_request(x_acs_action, body, body_length, nullptr, nullptr);
+    if (headers == nullptr) return FALSE;
+
+    // 從句柄池取得cURL
+    CURL* curl = acquire_curl_handle();
     if (!curl)
     {
         g_printerr("curl_easy_init() failed\n");
-        return;
+        curl_slist_free_all(headers);
+        return FALSE;
     }
 
-    // 定義數組用於添加要求標頭
-    struct curl_slist* headers = build_curl_headers(
-        content_type,
-        authorization_header,
-        host,
-        x_acs_action,
-        hashed_payload,
-        x_acs_date,
-        uuid,
-        x_acs_version
-    );
+    api_request* state = g_malloc0(sizeof(api_request));
+    state->headers = headers;
+    // 請求在工作線程異步執行，需保留請求體副本
+    state->body = g_strndup(body, body_length);
 
     // 設定cURL選項
-    // 設定cURL要求方法
-    curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, http_method);
-    // 設定 url
-    curl_easy_setopt(curl, CURLOPT_URL, url);
-    // 禁用 SSL 驗證，（調試）
-    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
-    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
-    // 添加調試資訊
-    curl_easy_setopt(curl, CURLOPT_VERBOSE, 0L);
-    // 添加要求標頭
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-
-    // 添加 body 請求體
-    if (body)
-    {
-        // 佈建要求體的大小
-        curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, body_length);
-
-        if (strcmp(content_type, "application/octet-stream") == 0)
-        {
-            // 添加請求體
-            curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body);
-        }
-        else if (strcmp(content_type, "application/x-www-form-urlencoded") == 0)
-        {
-            // 添加請求體
-            curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body);
-        }
-        else if (strcmp(content_type, "application/json; charset=utf-8") == 0)
-        {
-            // 添加請求體
-            curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body);
-        }
-    }
+    curl_easy_setopt(curl, CURLOPT_URL, signer.url);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, state->headers);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long)body_length);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, state->body);
+    // 驗證服務端證書
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 1L);
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 2L);
+    if (ali_config->ca_file) curl_easy_setopt(curl, CURLOPT_CAINFO, ali_config->ca_file);
+    // 保持連接，併發請求等待復用已有連接
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_2TLS);
+    curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+
+    request->curl = curl;
+    request->data = state;
+    request->free_data = free_api_request;
+    return TRUE;
+}
 
-    // 執行請求並檢查響應
-    const CURLcode res = curl_easy_perform(curl);
-    if (res != CURLE_OK)
+/**
+ * 構建收件號碼參數，多個號碼時為 JSON 數組
+ * @return 號碼參數 (需要手動釋放)
+ */
+static gchar* build_recipients()
+{
+    if (g_strv_length(ali_config->mobile) == 1) return g_strdup(ali_config->mobile[0]);
+
+    json_t* numbers = json_array();
+    for (gint i = 0; ali_config->mobile[i] != nullptr; ++i)
     {
-        g_printerr("curl_easy_perform() failed: %s\n", curl_easy_strerror(res));
-        return;
+        json_array_append_new(numbers, json_string(ali_config->mobile[i]));
     }
+    gchar* dumped = json_dumps(numbers, JSON_COMPACT);
+    json_decref(numbers);
 
-    // 清理
-    curl_slist_free_all(headers);
-    curl_easy_cleanup(curl);
-
-
-    // 釋放資源
-    g_free(authorization_header);
-    g_free(hashed_payload);
-    g_free(uuid);
-    g_free(x_acs_date);
-
-    g_free(url);
+    // 轉為 GLib 分配的字符串
+    gchar* result = g_strdup(dumped);
+    free(dumped);
+    return result;
 }
 
 /**
- * 發送短信
+ * 建構短信發送請求，由通知工作線程執行
+ *
+ * 多個號碼時使用批量接口，一次請求發送給所有號碼
+ * @param request 請求對象
+ * @param notification 通知內容
+ * @param config 未使用
+ * @return 是否成功
  */
-void send_sms()
+static gboolean prepare_sms_request(notify_request* request, const notify_message* notification, gpointer config)
 {
-    const gchar* http_method = "POST";
-    const gchar* canonical_uri = "/";
-    const gchar* x_acs_action = "SendMessageToGlobe";
-    const gchar* x_acs_version = "2018-05-01";
-    const gchar* content_type = "application/x-www-form-urlencoded";
+    (void)config; // 使用全局短信配置
+
+    const gchar* message = notification->summary ? notification->summary : notification->body;
 
-    // 定義查詢參數
-    const auto query_params = "";
+    if (ali_config->mobile == nullptr || ali_config->mobile[0] == nullptr)
+    {
+        g_printerr("No sms recipients configured\n");
+        return FALSE;
+    }
+    const gchar* x_acs_action = ali_config->mobile[1] == nullptr ? ACTION_SEND : ACTION_BATCH_SEND;
 
-    // 構建JSON格式的請求體
+    // 表單編碼，內容可能包含 & = 等字符
+    gchar* recipients = build_recipients();
+    const auto mobile = g_uri_escape_string(recipients, nullptr, FALSE);
+    const auto text = g_uri_escape_string(message, nullptr, FALSE);
+
+    // 構建表單格式的請求體
     const auto body = g_string_new(nullptr);
-    g_string_append_printf(body, "To=%s&", ali_config->mobile);
-    g_string_append_printf(body, "Message=%s", "Redis 的連接發生了問題，請檢查！");
-
-    // 發送請求
-    call_api(
-        http_method,
-        canonical_uri,
-        ali_config->endpoint,
-        x_acs_action,
-        x_acs_version,
-        query_params,
-        body->str,
-        content_type,
-        body->len
-    );
+    g_string_append_printf(body, "To=%s&", mobile);
+    g_string_append_printf(body, "Message=%s", text);
+
+    // 建構請求
+    const gboolean res = prepare_api_request(request, x_acs_action, body->str, body->len);
 
     g_string_free(body, TRUE);
+    g_free(recipients);
+    g_free(mobile);
+    g_free(text);
+    return res;
 }
+
+// 短信通知後端
+const notify_backend sms_backend = {
+    .kind = "sms",
+    .prepare = prepare_sms_request,
+};
@@ -1,27 +1,33 @@
 #pragma once
 #include <glib.h>
 
+#include "notifier.h"
+
 /**
  * 阿里雲短信配置
  *
  * 參數
- *  - mobile: 手機號碼
+ *  - mobile: 手機號碼列表，多個號碼時使用批量接口
  *  - endpoint: API 端點
  *  - key: API 密鑰
  *  - secret: API 密鑰
  *  - algorithm: 簽名算法
+ *  - ca_file: CA 證書文件（可選）
  */
 typedef struct aliyun_sms_config
 {
-    char* mobile;
+    char** mobile;
     char* endpoint;
     char* key;
     char* secret;
     char* algorithm;
+    char* ca_file;
 } aliyun_sms_config;
 
 typedef aliyun_sms_config* aliyun_sms_config_t;
 
+extern aliyun_sms_config_t ali_config;
+
 /**
  * 讀取sms配置
  * @param keyfile 配置文件
@@ -35,6 +41,18 @@ gboolean init_sms_config(GKeyFile* keyfile, GError* error);
 void destroy_sms_config();
 
 /**
- * 發送短信
+ * 簽名並構建請求標頭，復用簽名器的上下文與緩衝區，只能在通知線程中調用
+ * @param action API名稱
+ * @param body 請求體
+ * @param body_length 請求體長度
+ * @param date x-acs-date，為空時使用當前時間
+ * @param nonce x-acs-signature-nonce，為空時隨機生成
+ * @return cURL標頭 (需要手動釋放)，失敗時返回空
+ */
+struct curl_slist* sms_sign_request(const gchar* action, const gchar* body, gsize body_length, const gchar* date,
+                                    const gchar* nonce);
+
+/**
+ * 短信通知後端，優先發送簡短內容，多個號碼時使用批量接口
  */
-void send_sms();
+extern const notify_backend sms_backend;
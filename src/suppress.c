@@ -0,0 +1,177 @@
+#include "suppress.h"
+
+// 最小槽位數量
+#define SUPPRESS_MIN_SLOTS 64
+
+/**
+ * 指紋對應的起始槽位
+ *
+ * 指紋已是 FNV 哈希，低位分佈不夠均勻，再做一次乘法混合取高位
+ * @param table 抑制表
+ * @param fingerprint 告警指紋
+ * @return 槽位
+ */
+static inline gsize slot_of(const suppress_table* table, const guint64 fingerprint)
+{
+    return (gsize)((fingerprint * 0x9E3779B97F4A7C15ULL) >> 32) & table->mask;
+}
+
+/**
+ * 空槽以 0 表示，指紋為 0 時映射為 1
+ * @param fingerprint 告警指紋
+ * @return 存儲用的指紋
+ */
+static inline guint64 stored_key(const guint64 fingerprint)
+{
+    return fingerprint != 0 ? fingerprint : 1;
+}
+
+/**
+ * 擴容並重新放置所有記錄
+ * @param table 抑制表
+ * @param slots 新的槽位數量
+ */
+static void resize(suppress_table* table, const gsize slots)
+{
+    suppress_record* old = table->slots;
+    const gsize old_slots = old != nullptr ? table->mask + 1 : 0;
+
+    table->slots = g_malloc0_n(slots, sizeof(suppress_record));
+    table->mask = slots - 1;
+    for (gsize i = 0; i < old_slots; ++i)
+    {
+        if (old[i].fingerprint == 0) continue;
+        gsize slot = slot_of(table, old[i].fingerprint);
+        while (table->slots[slot].fingerprint != 0) slot = (slot + 1) & table->mask;
+        table->slots[slot] = old[i];
+    }
+    g_free(old);
+}
+
+/**
+ * 創建抑制表
+ * @param capacity 預期的記錄數量
+ * @return 抑制表
+ */
+suppress_table* suppress_table_new(const gsize capacity)
+{
+    suppress_table* table = g_malloc0(sizeof(suppress_table));
+    gsize slots = SUPPRESS_MIN_SLOTS;
+    while (slots < capacity * 2) slots <<= 1;
+    resize(table, slots);
+    return table;
+}
+
+/**
+ * 釋放抑制表
+ * @param table 抑制表
+ */
+void suppress_table_free(suppress_table* table)
+{
+    if (table == nullptr) return;
+    g_free(table->slots);
+    g_free(table);
+}
+
+/**
+ * 查找記錄
+ * @param table 抑制表
+ * @param fingerprint 告警指紋
+ * @return 記錄，不存在時返回空；表結構變更後失效
+ */
+suppress_record* suppress_lookup(const suppress_table* table, const guint64 fingerprint)
+{
+    const guint64 key = stored_key(fingerprint);
+    for (gsize slot = slot_of(table, key);; slot = (slot + 1) & table->mask)
+    {
+        suppress_record* record = &table->slots[slot];
+        if (record->fingerprint == key) return record;
+        if (record->fingerprint == 0) return nullptr;
+    }
+}
+
+/**
+ * 查找記錄，不存在時插入一條空記錄
+ * @param table 抑制表
+ * @param fingerprint 告警指紋
+ * @return 記錄；表結構變更後失效
+ */
+suppress_record* suppress_insert(suppress_table* table, const guint64 fingerprint)
+{
+    const guint64 key = stored_key(fingerprint);
+    suppress_record* record = suppress_lookup(table, key);
+    if (record != nullptr) return record;
+
+    // 保持負載因子不超過 1/2
+    if ((table->count + 1) * 2 > table->mask + 1) resize(table, (table->mask + 1) * 2);
+
+    gsize slot = slot_of(table, key);
+    while (table->slots[slot].fingerprint != 0) slot = (slot + 1) & table->mask;
+    record = &table->slots[slot];
+    memset(record, 0, sizeof(suppress_record));
+    record->fingerprint = key;
+    table->count++;
+    return record;
+}
+
+/**
+ * 刪除指定槽位的記錄，將同一探測鏈上的後續記錄前移
+ * @param table 抑制表
+ * @param slot 槽位
+ */
+static void remove_slot(suppress_table* table, gsize slot)
+{
+    gsize next = (slot + 1) & table->mask;
+    while (table->slots[next].fingerprint != 0)
+    {
+        // 後續記錄的起始槽位不在 (slot, next] 之間時，可以前移到 slot
+        const gsize home = slot_of(table, table->slots[next].fingerprint);
+        if (((next - home) & table->mask) >= ((next - slot) & table->mask))
+        {
+            table->slots[slot] = table->slots[next];
+            slot = next;
+        }
+        next = (next + 1) & table->mask;
+    }
+    memset(&table->slots[slot], 0, sizeof(suppress_record));
+    table->count--;
+}
+
+/**
+ * 刪除記錄
+ * @param table 抑制表
+ * @param fingerprint 告警指紋
+ * @return 記錄是否存在
+ */
+gboolean suppress_remove(suppress_table* table, const guint64 fingerprint)
+{
+    const suppress_record* record = suppress_lookup(table, fingerprint);
+    if (record == nullptr) return FALSE;
+    remove_slot(table, record - table->slots);
+    return TRUE;
+}
+
+/**
+ * 清除已過期且不在靜默中的記錄
+ * @param table 抑制表
+ * @param now 當前時間（UNIX 微秒）
+ * @return 清除的記錄數量
+ */
+guint suppress_expire(suppress_table* table, const gint64 now)
+{
+    guint removed = 0;
+    gsize slot = 0;
+    while (slot <= table->mask)
+    {
+        const suppress_record* record = &table->slots[slot];
+        if (record->fingerprint != 0 && record->expires_at <= now && record->silenced_until <= now)
+        {
+            // 前移後當前槽位可能放入了尚未檢查的記錄，需要重新檢查
+            remove_slot(table, slot);
+            removed++;
+            continue;
+        }
+        slot++;
+    }
+    return removed;
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <glib.h>
+
+/**
+ * 抑制記錄，以告警指紋為鍵，時間均為 UNIX 微秒
+ */
+typedef struct suppress_record
+{
+    // 告警指紋，0 表示空槽
+    guint64 fingerprint;
+    // 最近一次通知的時間，未通知過時為 0
+    gint64 notified_at;
+    // 靜默截止時間
+    gint64 silenced_until;
+    // 記錄過期時間，過期且不在靜默中的記錄會被清除
+    gint64 expires_at;
+    // 被抑制的次數
+    guint32 suppressed;
+} suppress_record;
+
+/**
+ * 抑制表
+ *
+ * 開放定址（線性探測）哈希表，槽位連續存放，負載因子不超過 1/2，
+ * 刪除時向前移動後續記錄，不使用墓碑，查找只需比較相鄰的少數槽位
+ */
+typedef struct suppress_table
+{
+    // 槽位
+    suppress_record* slots;
+    // 槽位數量減一，槽位數量為 2 的冪
+    gsize mask;
+    // 記錄數量
+    gsize count;
+} suppress_table;
+
+/**
+ * 創建抑制表
+ * @param capacity 預期的記錄數量
+ * @return 抑制表
+ */
+suppress_table* suppress_table_new(gsize capacity);
+
+/**
+ * 釋放抑制表
+ * @param table 抑制表
+ */
+void suppress_table_free(suppress_table* table);
+
+/**
+ * 查找記錄
+ * @param table 抑制表
+ * @param fingerprint 告警指紋
+ * @return 記錄，不存在時返回空；表結構變更後失效
+ */
+suppress_record* suppress_lookup(const suppress_table* table, guint64 fingerprint);
+
+/**
+ * 查找記錄，不存在時插入一條空記錄
+ * @param table 抑制表
+ * @param fingerprint 告警指紋
+ * @return 記錄；表結構變更後失效
+ */
+suppress_record* suppress_insert(suppress_table* table, guint64 fingerprint);
+
+/**
+ * 刪除記錄
+ * @param table 抑制表
+ * @param fingerprint 告警指紋
+ * @return 記錄是否存在
+ */
+gboolean suppress_remove(suppress_table* table, guint64 fingerprint);
+
+/**
+ * 清除已過期且不在靜默中的記錄
+ * @param table 抑制表
+ * @param now 當前時間（UNIX 微秒）
+ * @return 清除的記錄數量
+ */
+guint suppress_expire(suppress_table* table, gint64 now);
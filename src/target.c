@@ -0,0 +1,421 @@
+#include "target.h"
+
+#include "config.h"
+#include "notifier.h"
+#include "redis.h"
+#include "watcher.h"
+
+// 探測目標列表
+GPtrArray* targets = nullptr;
+
+// 目標分組前綴
+#define TARGET_GROUP_PREFIX "Target:"
+
+/**
+ * 目標配置的默認值，來自 [General] 與 [Services]
+ */
+typedef struct target_defaults
+{
+    // Redis 配置
+    const redis_config* redis;
+    // 服務列表
+    gchar** services;
+    // 服務數量
+    gsize n_services;
+} target_defaults;
+
+/**
+ * 釋放目標配置
+ * @param config 目標配置
+ */
+void free_target_config(target_config* config)
+{
+    if (config == nullptr) return;
+    g_free(config->name);
+    g_free(config->cluster);
+    g_free(config->host);
+    g_free(config->username);
+    g_free(config->password);
+    g_strfreev(config->services);
+    g_free(config);
+}
+
+/**
+ * 複製目標配置
+ * @param config 目標配置
+ * @return 副本
+ */
+target_config* copy_target_config(const target_config* config)
+{
+    target_config* copy = g_memdup2(config, sizeof(target_config));
+    copy->name = g_strdup(config->name);
+    copy->cluster = g_strdup(config->cluster);
+    copy->host = g_strdup(config->host);
+    copy->username = g_strdup(config->username);
+    copy->password = g_strdup(config->password);
+    copy->services = g_strdupv(config->services);
+    return copy;
+}
+
+/**
+ * 釋放目標
+ * @param data 目標
+ */
+static void free_target(gpointer data)
+{
+    target* t = data;
+    free_target_config(t->config);
+    g_free(t);
+}
+
+/**
+ * 創建目標
+ * @param config 目標配置（所有權轉移）
+ * @return 目標
+ */
+static target* new_target(target_config* config)
+{
+    target* t = g_malloc0(sizeof(target));
+    t->config = config;
+    t->last_result.outcome = PROBE_OK;
+    t->last_result.tcp = (probe_tcp){-1, -1, -1, -1, -1};
+    t->last_success.timestamp = 0;
+    return t;
+}
+
+/**
+ * 由 [General] 與 [Services] 生成默認目標，兼容單目標配置
+ * @param defaults 默認值
+ * @return 目標配置
+ */
+static target_config* default_target_config(const target_defaults* defaults)
+{
+    const redis_config* redis = defaults->redis;
+    target_config* config = g_malloc0(sizeof(target_config));
+    config->name = g_strdup_printf("%s:%d", redis->redis_host, redis->redis_port);
+    config->cluster = g_strdup("default");
+    config->host = g_strdup(redis->redis_host);
+    config->port = redis->redis_port;
+    config->auth = redis->auth;
+    config->username = g_strdup(redis->redis_username);
+    config->password = g_strdup(redis->redis_password);
+    config->services = g_strdupv(defaults->services);
+    config->n_services = defaults->n_services;
+    config->interval_seconds = redis->interval_seconds;
+    config->connect_timeout_seconds = redis->connect_timeout_seconds;
+    config->channels = notify_all_channels();
+    return config;
+}
+
+/**
+ * 讀取單個目標分組，未配置的項目繼承 [General] 與 [Services]
+ * @param keyfile 配置文件
+ * @param group 分組名稱
+ * @param defaults 默認值
+ * @return 目標配置，出錯時返回空
+ */
+static target_config* read_target_group(GKeyFile* keyfile, const gchar* group, const target_defaults* defaults)
+{
+    const redis_config* redis = defaults->redis;
+    GError* error = nullptr;
+    gint64 port = 0;
+    target_config* config = g_malloc0(sizeof(target_config));
+
+    config->name = g_strdup(group + strlen(TARGET_GROUP_PREFIX));
+    if (*config->name == '\0')
+    {
+        g_printerr("Error reading %s: target name is empty\n", group);
+        goto error;
+    }
+    if (strlen(config->name) >= TARGET_NAME_MAX)
+    {
+        g_printerr("Error reading %s: target name is longer than %d bytes\n", group, TARGET_NAME_MAX - 1);
+        goto error;
+    }
+
+    // 讀取redis連接地址
+    config->host = g_key_file_get_string(keyfile, group, "host", &error);
+    if (error != nullptr)
+    {
+        g_printerr("Error reading %s host: %s\n", group, error->message);
+        g_error_free(error);
+        goto error;
+    }
+
+    // 讀取可選項目
+    if (!read_optional_integer(keyfile, group, "port", 6379, &port)) goto error;
+    config->port = (gint)port;
+    if (!read_optional_string(keyfile, group, "cluster", "default", &config->cluster)) goto error;
+    if (!read_optional_boolean(keyfile, group, "auth", redis->auth, &config->auth)) goto error;
+    if (!read_optional_string(keyfile, group, "username", redis->redis_username, &config->username)) goto error;
+    if (!read_optional_string(keyfile, group, "password", redis->redis_password, &config->password)) goto error;
+    if (!read_optional_integer(keyfile, group, "interval", redis->interval_seconds, &config->interval_seconds))
+        goto error;
+    if (!read_optional_integer(keyfile, group, "connect_timeout", redis->connect_timeout_seconds,
+                               &config->connect_timeout_seconds))
+        goto error;
+    if (!read_notify_channels(keyfile, group, "channels", &config->channels)) goto error;
+
+    // 讀取服務列表
+    if (g_key_file_has_key(keyfile, group, "services", nullptr))
+    {
+        config->services = g_key_file_get_string_list(keyfile, group, "services", &config->n_services, &error);
+        if (error != nullptr)
+        {
+            g_printerr("Error reading %s services: %s\n", group, error->message);
+            g_error_free(error);
+            goto error;
+        }
+    }
+    else
+    {
+        config->services = g_strdupv(defaults->services);
+        config->n_services = defaults->n_services;
+    }
+
+    if (config->interval_seconds <= 0 || config->connect_timeout_seconds <= 0)
+    {
+        g_printerr("Error reading %s: interval and connect_timeout must be positive\n", group);
+        goto error;
+    }
+    return config;
+
+error:
+    free_target_config(config);
+    return nullptr;
+}
+
+/**
+ * 讀取所有目標分組
+ * @param keyfile 配置文件
+ * @param defaults 默認值
+ * @return 目標配置列表 (target_config*)，出錯時返回空
+ */
+static GPtrArray* read_target_configs(GKeyFile* keyfile, const target_defaults* defaults)
+{
+    GPtrArray* configs = g_ptr_array_new_with_free_func((GDestroyNotify)free_target_config);
+
+    // 讀取所有 [Target:<name>] 分組
+    gchar** groups = g_key_file_get_groups(keyfile, nullptr);
+    for (gint i = 0; groups[i] != nullptr; ++i)
+    {
+        if (!g_str_has_prefix(groups[i], TARGET_GROUP_PREFIX)) continue;
+
+        target_config* config = read_target_group(keyfile, groups[i], defaults);
+        if (config == nullptr)
+        {
+            g_strfreev(groups);
+            g_ptr_array_free(configs, TRUE);
+            return nullptr;
+        }
+        g_ptr_array_add(configs, config);
+    }
+    g_strfreev(groups);
+
+    // 未配置目標分組時使用 [General] 的 Redis
+    if (configs->len == 0)
+    {
+        g_ptr_array_add(configs, default_target_config(defaults));
+    }
+    return configs;
+}
+
+/**
+ * 讀取探測目標配置，需在 redis、watcher 與所有通知通道之後讀取
+ * @param keyfile 配置文件
+ * @param error 錯誤對象
+ */
+gboolean init_target_config(GKeyFile* keyfile, GError* error)
+{
+    (void)error; // 各分組自行處理錯誤
+
+    const target_defaults defaults = {r_config, services, n_services};
+    GPtrArray* configs = read_target_configs(keyfile, &defaults);
+    if (configs == nullptr) return FALSE;
+
+    targets = g_ptr_array_new_with_free_func(free_target);
+    for (guint i = 0; i < configs->len; ++i)
+    {
+        g_ptr_array_add(targets, new_target(g_ptr_array_index(configs, i)));
+    }
+    // 配置的所有權已轉移給目標
+    g_ptr_array_set_free_func(configs, nullptr);
+    g_ptr_array_free(configs, TRUE);
+
+    g_print("Loaded %u target(s).\n", targets->len);
+    return TRUE;
+}
+
+/**
+ * 釋放探測目標配置
+ */
+void destroy_target_config()
+{
+    if (targets != nullptr)
+    {
+        g_ptr_array_free(targets, TRUE);
+        targets = nullptr;
+    }
+}
+
+/**
+ * 重新讀取探測目標配置，連同 [General] 與 [Services] 的默認值，不修改全局狀態，可在其他線程中調用
+ * @param keyfile 配置文件
+ * @return 目標配置列表 (target_config*)，出錯時返回空
+ */
+GPtrArray* load_target_configs(GKeyFile* keyfile)
+{
+    GError* error = nullptr;
+
+    redis_config* redis = read_redis_config(keyfile);
+    if (redis == nullptr) return nullptr;
+
+    gsize count = 0;
+    gchar** list = g_key_file_get_string_list(keyfile, "Services", "targets", &count, &error);
+    if (error != nullptr)
+    {
+        g_printerr("Error reading targets: %s\n", error->message);
+        g_error_free(error);
+        free_redis_config(redis);
+        return nullptr;
+    }
+
+    const target_defaults defaults = {redis, list, count};
+    GPtrArray* configs = read_target_configs(keyfile, &defaults);
+    g_strfreev(list);
+    free_redis_config(redis);
+    return configs;
+}
+
+/**
+ * 判斷兩個配置的連接參數是否不同，不同時需要重新連接
+ * @param a 配置
+ * @param b 配置
+ * @return 是否不同
+ */
+static gboolean connection_changed(const target_config* a, const target_config* b)
+{
+    return g_strcmp0(a->host, b->host) != 0 || a->port != b->port || a->auth != b->auth ||
+        g_strcmp0(a->username, b->username) != 0 || g_strcmp0(a->password, b->password) != 0 ||
+        a->connect_timeout_seconds != b->connect_timeout_seconds;
+}
+
+/**
+ * 判斷兩個配置的其他參數是否不同
+ * @param a 配置
+ * @param b 配置
+ * @return 是否不同
+ */
+static gboolean settings_changed(const target_config* a, const target_config* b)
+{
+    if (g_strcmp0(a->cluster, b->cluster) != 0 || a->interval_seconds != b->interval_seconds ||
+        a->channels != b->channels || a->n_services != b->n_services)
+        return TRUE;
+    for (gsize i = 0; i < a->n_services; ++i)
+    {
+        if (g_strcmp0(a->services[i], b->services[i]) != 0) return TRUE;
+    }
+    return FALSE;
+}
+
+/**
+ * 以新的配置更新目標列表，按名稱對應，未變化的目標保持原樣，變化的目標保留探測與告警狀態
+ * @param configs 新的目標配置列表 (target_config*)，所有權轉移
+ * @param callback 變更回調，新增的目標在加入列表後調用，移除的目標在釋放前調用
+ * @param user_data 用戶數據
+ * @return 變更的目標數量
+ */
+guint update_targets(GPtrArray* configs, const target_change_fn callback, const gpointer user_data)
+{
+    guint changes = 0;
+    GHashTable* existing = g_hash_table_new(g_str_hash, g_str_equal);
+    for (guint i = 0; i < targets->len; ++i)
+    {
+        target* t = g_ptr_array_index(targets, i);
+        g_hash_table_insert(existing, t->config->name, t);
+    }
+
+    GPtrArray* updated = g_ptr_array_new_full(configs->len, free_target);
+    GPtrArray* added = g_ptr_array_new();
+    for (guint i = 0; i < configs->len; ++i)
+    {
+        target_config* config = g_ptr_array_index(configs, i);
+        target* t = g_hash_table_lookup(existing, config->name);
+        if (t == nullptr)
+        {
+            t = new_target(config);
+            g_ptr_array_add(added, t);
+            g_ptr_array_add(updated, t);
+            continue;
+        }
+        g_hash_table_remove(existing, config->name);
+        g_ptr_array_add(updated, t);
+
+        // 未變化：保留原配置
+        const gboolean reconnect = connection_changed(t->config, config);
+        if (!reconnect && !settings_changed(t->config, config))
+        {
+            free_target_config(config);
+            continue;
+        }
+
+        // 變化：替換配置，回調後釋放舊配置
+        target_config* previous = t->config;
+        t->config = config;
+        callback(t, reconnect ? TARGET_RECONNECT : TARGET_UPDATED, previous, user_data);
+        free_target_config(previous);
+        changes++;
+    }
+    g_ptr_array_set_free_func(configs, nullptr);
+    g_ptr_array_free(configs, TRUE);
+
+    // 不在新配置中的目標
+    GHashTableIter iter;
+    gpointer value = nullptr;
+    g_hash_table_iter_init(&iter, existing);
+    while (g_hash_table_iter_next(&iter, nullptr, &value))
+    {
+        callback(value, TARGET_REMOVED, nullptr, user_data);
+        free_target(value);
+        changes++;
+    }
+    g_hash_table_destroy(existing);
+
+    // 替換列表，目標已全部轉移或釋放
+    g_ptr_array_set_free_func(targets, nullptr);
+    g_ptr_array_free(targets, TRUE);
+    targets = updated;
+
+    // 新增的目標
+    for (guint i = 0; i < added->len; ++i)
+    {
+        callback(g_ptr_array_index(added, i), TARGET_ADDED, nullptr, user_data);
+        changes++;
+    }
+    g_ptr_array_free(added, TRUE);
+    return changes;
+}
+
+/**
+ * 獲取探測結果名稱
+ * @param outcome 探測結果
+ * @return 名稱
+ */
+const gchar* probe_outcome_name(const probe_outcome outcome)
+{
+    switch (outcome)
+    {
+    case PROBE_OK:
+        return "ok";
+    case PROBE_CONNECT_ERROR:
+        return "connect_error";
+    case PROBE_AUTH_ERROR:
+        return "auth_error";
+    case PROBE_TIMEOUT:
+        return "timeout";
+    case PROBE_BAD_REPLY:
+        return "bad_reply";
+    default:
+        return "unknown";
+    }
+}
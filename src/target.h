@@ -0,0 +1,228 @@
+#pragma once
+#include <glib.h>
+
+// 目標名稱的最大長度（含結尾的 0），與探測歷史的槽位名稱一致
+#define TARGET_NAME_MAX 96
+
+/**
+ * 探測目標配置
+ *
+ * 配置（[Target:<name>] 分組，未配置任何分組時使用 [General] 與 [Services] 生成單一目標）:
+ *  - host Redis 連接地址
+ *  - port Redis 連接端口
+ *  - cluster 所屬集群，用於告警分組
+ *  - auth 是否認證
+ *  - username Redis 用戶名
+ *  - password Redis 密碼
+ *  - services 恢復後需要重啓的服務列表
+ *  - interval 定時間隔秒數
+ *  - connect_timeout 連接超時秒數
+ *  - channels 告警投遞的通知通道列表，缺省時投遞到所有通道
+ */
+typedef struct target_config
+{
+    // 目標名稱
+    gchar* name;
+    // 所屬集群
+    gchar* cluster;
+    // Redis 連接地址
+    gchar* host;
+    // Redis 連接端口
+    gint port;
+    // 是否認證
+    gboolean auth;
+    // Redis 用戶名
+    gchar* username;
+    // Redis 密碼
+    gchar* password;
+    // 恢復後需要重啓的服務列表
+    gchar** services;
+    // 服務數量
+    gsize n_services;
+    // 定時間隔秒數
+    gint64 interval_seconds;
+    // 連接超時秒數
+    gint64 connect_timeout_seconds;
+    // 告警投遞的通道掩碼
+    guint channels;
+} target_config;
+
+/**
+ * 探測結果
+ */
+typedef enum probe_outcome
+{
+    // 成功
+    PROBE_OK = 0,
+    // 連接失敗
+    PROBE_CONNECT_ERROR,
+    // 認證失敗
+    PROBE_AUTH_ERROR,
+    // 命令超時
+    PROBE_TIMEOUT,
+    // 響應異常
+    PROBE_BAD_REPLY,
+    // 結果數量
+    PROBE_OUTCOME_COUNT
+} probe_outcome;
+
+/**
+ * INFO 中的關鍵指標，未取得時為 -1
+ */
+typedef struct probe_info
+{
+    // 已連接客戶端數
+    gint64 connected_clients;
+    // 阻塞中的客戶端數
+    gint64 blocked_clients;
+    // 已使用內存（字節）
+    gint64 used_memory;
+    // 每秒處理的命令數
+    gint64 ops_per_sec;
+    // 運行時間（秒）
+    gint64 uptime_seconds;
+} probe_info;
+
+/**
+ * 內核 TCP_INFO 中的連接健康指標，未取得時為 -1
+ */
+typedef struct probe_tcp
+{
+    // 平滑往返時間（微秒），由內核按 ACK 計時
+    gint64 rtt_us;
+    // 往返時間的平均偏差（微秒）
+    gint64 rttvar_us;
+    // 連接累計重傳的報文數
+    gint64 retransmits;
+    // 擁塞窗口（報文數）
+    gint64 cwnd;
+    // 服務端耗時估計：PING 從發送到響應的耗時減去網絡往返時間（微秒），io_uring 流水線中含 AUTH
+    gint64 server_us;
+} probe_tcp;
+
+/**
+ * 單次探測的結果，各階段耗時單位為微秒，未執行的階段為 -1
+ */
+typedef struct probe_result
+{
+    // 探測開始時間（UNIX 微秒）
+    gint64 timestamp;
+    // 建立連接耗時，復用連接時為 -1
+    gint64 connect_us;
+    // AUTH 耗時
+    gint64 auth_us;
+    // PING 耗時
+    gint64 ping_us;
+    // INFO 耗時
+    gint64 info_us;
+    // 總耗時
+    gint64 total_us;
+    // 結果
+    probe_outcome outcome;
+    // 錯誤信息
+    gchar error[128];
+    // INFO 指標
+    probe_info info;
+    // TCP 連接指標
+    probe_tcp tcp;
+} probe_result;
+
+// 探測器私有狀態
+typedef struct probe_state probe_state;
+
+/**
+ * 探測目標
+ */
+typedef struct target
+{
+    // 目標配置
+    target_config* config;
+    // 探測器狀態
+    probe_state* probe;
+    // 錯誤是否在持續中
+    gboolean error_ongoing;
+    // 觸發本次錯誤的探測結果
+    probe_outcome error_outcome;
+    // 最近一次探測結果
+    probe_result last_result;
+    // 最近一次成功的探測結果
+    probe_result last_success;
+    // 成功探測日誌的採樣計數
+    guint success_logs;
+} target;
+
+// 探測目標列表 (target*)
+extern GPtrArray* targets;
+
+/**
+ * 重新載入配置時目標的變更
+ */
+typedef enum target_change
+{
+    // 新增
+    TARGET_ADDED = 0,
+    // 移除
+    TARGET_REMOVED,
+    // 連接以外的配置變化
+    TARGET_UPDATED,
+    // 連接參數變化，需要重新連接
+    TARGET_RECONNECT
+} target_change;
+
+/**
+ * 目標變更回調，在事件循環線程中調用
+ * @param t 目標
+ * @param change 變更
+ * @param previous 變更前的配置，僅在 TARGET_UPDATED 與 TARGET_RECONNECT 時有效
+ * @param user_data 用戶數據
+ */
+typedef void (*target_change_fn)(target* t, target_change change, const target_config* previous,
+                                 gpointer user_data);
+
+/**
+ * 讀取探測目標配置，需在 redis、watcher 與所有通知通道之後讀取
+ * @param keyfile 配置文件
+ * @param error 錯誤對象
+ */
+gboolean init_target_config(GKeyFile* keyfile, GError* error);
+
+/**
+ * 釋放探測目標配置
+ */
+void destroy_target_config();
+
+/**
+ * 重新讀取探測目標配置，連同 [General] 與 [Services] 的默認值，不修改全局狀態，可在其他線程中調用
+ * @param keyfile 配置文件
+ * @return 目標配置列表 (target_config*)，出錯時返回空
+ */
+GPtrArray* load_target_configs(GKeyFile* keyfile);
+
+/**
+ * 複製目標配置
+ * @param config 目標配置
+ * @return 副本 (需要使用 free_target_config 釋放)
+ */
+target_config* copy_target_config(const target_config* config);
+
+/**
+ * 釋放目標配置
+ * @param config 目標配置，可為空
+ */
+void free_target_config(target_config* config);
+
+/**
+ * 以新的配置更新目標列表，按名稱對應，未變化的目標保持原樣，變化的目標保留探測與告警狀態
+ * @param configs 新的目標配置列表 (target_config*)，所有權轉移
+ * @param callback 變更回調，新增的目標在加入列表後調用，移除的目標在釋放前調用
+ * @param user_data 用戶數據
+ * @return 變更的目標數量
+ */
+guint update_targets(GPtrArray* configs, target_change_fn callback, gpointer user_data);
+
+/**
+ * 獲取探測結果名稱
+ * @param outcome 探測結果
+ * @return 名稱
+ */
+const gchar* probe_outcome_name(probe_outcome outcome);
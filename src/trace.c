@@ -0,0 +1,682 @@
+#include "trace.h"
+
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+
+#include "config.h"
+
+// 追蹤配置
+trace_config_t tr_config = nullptr;
+
+/**
+ * 已結束的 span
+ */
+typedef struct trace_span
+{
+    // 追蹤ID
+    guint64 trace_id;
+    // span ID
+    guint64 span_id;
+    // 父 span ID，根 span 為 0
+    guint64 parent_id;
+    // 開始時間（UNIX 微秒）
+    gint64 start_us;
+    // 耗時（微秒）
+    gint64 duration_us;
+    // 名稱（靜態字符串）
+    const gchar* name;
+    // 是否失敗
+    gboolean failed;
+    // 說明
+    gchar detail[TRACE_DETAIL_MAX];
+} trace_span;
+
+/**
+ * 緩衝區單元，序號為奇數時正在寫入
+ */
+typedef struct trace_slot
+{
+    _Atomic guint32 seq;
+    trace_span span;
+} trace_slot;
+
+/**
+ * 線程的環形緩衝區，只有持有它的線程寫入；線程結束後由下一個新線程復用
+ */
+typedef struct trace_ring
+{
+    // 已寫入的 span 數
+    _Atomic guint64 written;
+    // 已推送到 OTLP 的 span 數，只由導出線程使用
+    guint64 pushed;
+    // 下一個ID的序號，只由寫入線程使用
+    guint64 next_id;
+    // 緩衝區序號，作為 Chrome trace 的 tid
+    guint32 index;
+    // 線程名稱，由 rings_lock 保護
+    gchar thread_name[16];
+    // 單元
+    trace_slot* slots;
+} trace_ring;
+
+/**
+ * 釋放線程的緩衝區，交給下一個新線程復用
+ * @param data 緩衝區
+ */
+static void release_ring(gpointer data);
+
+// 所有緩衝區 (trace_ring*)，只增不減
+static GPtrArray* rings = nullptr;
+// 線程已結束、等待復用的緩衝區 (trace_ring*)
+static GPtrArray* idle_rings = nullptr;
+// 保護 rings、idle_rings 與線程名稱
+static GMutex rings_lock;
+// 線程的緩衝區
+static GPrivate ring_key = G_PRIVATE_INIT(release_ring);
+// 線程的當前 span (trace_scope*)
+static GPrivate current_key;
+// 打亂ID的鹽，使不同進程的ID不重複
+static guint64 id_salt = 0;
+// OTLP 128 位追蹤ID的高 64 位
+static guint64 trace_salt = 0;
+// 是否正在導出
+static atomic_bool dumping = false;
+
+/**
+ * 讀取追蹤配置
+ * @param keyfile 配置文件
+ * @param error 錯誤對象
+ */
+gboolean init_trace_config(GKeyFile* keyfile, GError* error)
+{
+    (void)error; // 可選配置由 read_optional_* 自行處理錯誤
+
+    // 創建追蹤配置對象
+    tr_config = g_malloc0(sizeof(trace_config));
+
+    // 讀取是否啟用
+    if (!read_optional_boolean(keyfile, "Trace", "enabled", FALSE, &tr_config->enabled)) goto error;
+
+    // 讀取每個線程的緩衝區大小，向上取整為 2 的冪
+    gint64 ring_size = 0;
+    if (!read_optional_integer(keyfile, "Trace", "ring_size", 2048, &ring_size)) goto error;
+    if (ring_size < 16 || ring_size > 1 << 20)
+    {
+        g_printerr("Error reading ring_size: must be between 16 and 1048576\n");
+        goto error;
+    }
+    tr_config->ring_size = 1;
+    while (tr_config->ring_size < ring_size) tr_config->ring_size <<= 1;
+
+    // 讀取導出設置
+    if (!read_optional_string(keyfile, "Trace", "service_name", "redis-watcher", &tr_config->service_name))
+        goto error;
+    if (!read_optional_string(keyfile, "Trace", "otlp_endpoint", "", &tr_config->otlp_endpoint)) goto error;
+    if (!read_optional_string(keyfile, "Trace", "chrome_path", "", &tr_config->chrome_path)) goto error;
+
+    g_mutex_lock(&rings_lock);
+    rings = g_ptr_array_new();
+    idle_rings = g_ptr_array_new();
+    g_mutex_unlock(&rings_lock);
+    id_salt = (guint64)g_random_int() << 32 | g_random_int();
+    trace_salt = (guint64)g_random_int() << 32 | g_random_int();
+    return TRUE;
+
+error:
+    // 釋放配置
+    destroy_trace_config();
+    return FALSE;
+}
+
+/**
+ * 釋放追蹤配置與所有線程的緩衝區，需在其他線程結束後調用
+ */
+void destroy_trace_config()
+{
+    // 等待導出完成
+    while (atomic_load(&dumping)) g_usleep(10000);
+
+    g_mutex_lock(&rings_lock);
+    if (rings != nullptr)
+    {
+        for (guint i = 0; i < rings->len; ++i)
+        {
+            trace_ring* ring = g_ptr_array_index(rings, i);
+            g_free(ring->slots);
+            g_free(ring);
+        }
+        g_ptr_array_free(rings, TRUE);
+        g_ptr_array_free(idle_rings, TRUE);
+        rings = nullptr;
+        idle_rings = nullptr;
+    }
+    g_mutex_unlock(&rings_lock);
+    g_private_set(&ring_key, nullptr);
+    g_private_set(&current_key, nullptr);
+
+    if (tr_config != nullptr)
+    {
+        g_free(tr_config->service_name);
+        g_free(tr_config->otlp_endpoint);
+        g_free(tr_config->chrome_path);
+        g_free(tr_config);
+        tr_config = nullptr;
+    }
+}
+
+/**
+ * 釋放線程的緩衝區，交給下一個新線程復用
+ * @param data 緩衝區
+ */
+static void release_ring(gpointer data)
+{
+    g_mutex_lock(&rings_lock);
+    if (idle_rings != nullptr) g_ptr_array_add(idle_rings, data);
+    g_mutex_unlock(&rings_lock);
+}
+
+/**
+ * 取得當前線程的緩衝區，首次調用時分配或復用
+ * @return 緩衝區
+ */
+static trace_ring* acquire_ring()
+{
+    trace_ring* ring = g_private_get(&ring_key);
+    if (ring != nullptr) return ring;
+
+    gchar name[16] = {0};
+    prctl(PR_GET_NAME, name);
+
+    g_mutex_lock(&rings_lock);
+    if (idle_rings->len > 0)
+    {
+        ring = g_ptr_array_steal_index_fast(idle_rings, idle_rings->len - 1);
+    }
+    else
+    {
+        ring = g_malloc0(sizeof(trace_ring));
+        ring->slots = g_new0(trace_slot, tr_config->ring_size);
+        ring->index = rings->len;
+        g_ptr_array_add(rings, ring);
+    }
+    memcpy(ring->thread_name, name, sizeof(name));
+    g_mutex_unlock(&rings_lock);
+
+    g_private_set(&ring_key, ring);
+    return ring;
+}
+
+/**
+ * 生成進程內唯一的ID
+ * @param ring 當前線程的緩衝區
+ * @return 非 0 的ID
+ */
+static guint64 next_id(trace_ring* ring)
+{
+    const guint64 id = (++ring->next_id << 16 | ring->index) ^ id_salt;
+    return id != 0 ? id : id_salt;
+}
+
+/**
+ * 寫入一個 span
+ * @param ring 當前線程的緩衝區
+ * @param span span
+ */
+static void write_span(trace_ring* ring, const trace_span* span)
+{
+    const guint64 n = atomic_load_explicit(&ring->written, memory_order_relaxed);
+    trace_slot* slot = &ring->slots[n & (tr_config->ring_size - 1)];
+
+    // 序號變為奇數，讀者會跳過正在寫入的單元
+    const guint32 seq = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+    atomic_store_explicit(&slot->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    slot->span = *span;
+
+    // 序號變回偶數後再發佈寫入數
+    atomic_store_explicit(&slot->seq, seq + 2, memory_order_release);
+    atomic_store_explicit(&ring->written, n + 1, memory_order_release);
+}
+
+/**
+ * 以序號鎖讀取一個 span
+ * @param slot 單元
+ * @param copy 輸出的副本
+ * @return 是否一致
+ */
+static gboolean read_span(const trace_slot* slot, trace_span* copy)
+{
+    for (gint attempt = 0; attempt < 4; ++attempt)
+    {
+        const guint32 before = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        if (before & 1) continue;
+        memcpy(copy, (const void*)&slot->span, sizeof(trace_span));
+        atomic_thread_fence(memory_order_acquire);
+        const guint32 after = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+        if (before == after) return before != 0;
+    }
+    return FALSE;
+}
+
+/**
+ * 確定父 span，為空時使用線程的當前 span
+ * @param parent 指定的父 span
+ * @return 父 span，沒有時返回空
+ */
+static const trace_context* resolve_parent(const trace_context* parent)
+{
+    if (parent == nullptr)
+    {
+        const trace_scope* current = g_private_get(&current_key);
+        parent = current != nullptr ? &current->context : nullptr;
+    }
+    return parent != nullptr && parent->span_id != 0 ? parent : nullptr;
+}
+
+/**
+ * 開始一個 span，不改變線程的當前 span，適用於跨回調的異步操作
+ * @param scope span
+ * @param name 名稱，必須是靜態字符串
+ * @param parent 父 span，為空時使用線程的當前 span，沒有時開始新的追蹤
+ */
+void trace_begin(trace_scope* scope, const gchar* name, const trace_context* parent)
+{
+    scope->context.span_id = 0;
+    scope->entered = FALSE;
+    if (!tracing()) return;
+
+    trace_ring* ring = acquire_ring();
+    parent = resolve_parent(parent);
+    scope->context.trace_id = parent != nullptr ? parent->trace_id : next_id(ring);
+    scope->context.span_id = next_id(ring);
+    scope->parent_id = parent != nullptr ? parent->span_id : 0;
+    scope->name = name;
+    scope->start_us = g_get_real_time();
+    scope->started = g_get_monotonic_time();
+    scope->previous = nullptr;
+}
+
+/**
+ * 開始一個 span 並設為線程的當前 span，之後在同一線程開始的 span 默認以其為父 span
+ * @param scope span
+ * @param name 名稱，必須是靜態字符串
+ * @param parent 父 span，為空時使用線程的當前 span，沒有時開始新的追蹤
+ */
+void trace_enter(trace_scope* scope, const gchar* name, const trace_context* parent)
+{
+    trace_begin(scope, name, parent);
+    if (scope->context.span_id == 0) return;
+    scope->previous = g_private_get(&current_key);
+    scope->entered = TRUE;
+    g_private_set(&current_key, scope);
+}
+
+/**
+ * 結束 span 並寫入當前線程的緩衝區，進入過的 span 恢復先前的當前 span
+ * @param scope span
+ * @param failed 是否失敗
+ * @param format 說明格式，可為空
+ */
+void trace_end(trace_scope* scope, const gboolean failed, const gchar* format, ...)
+{
+    if (scope->context.span_id == 0) return;
+    if (scope->entered)
+    {
+        g_private_set(&current_key, scope->previous);
+        scope->entered = FALSE;
+    }
+
+    trace_span span = {
+        .trace_id = scope->context.trace_id,
+        .span_id = scope->context.span_id,
+        .parent_id = scope->parent_id,
+        .start_us = scope->start_us,
+        .duration_us = g_get_monotonic_time() - scope->started,
+        .name = scope->name,
+        .failed = failed,
+    };
+    if (format != nullptr)
+    {
+        va_list args;
+        va_start(args, format);
+        g_vsnprintf(span.detail, sizeof(span.detail), format, args);
+        va_end(args);
+    }
+    write_span(acquire_ring(), &span);
+    scope->context.span_id = 0;
+}
+
+/**
+ * 記錄一個已經結束的 span
+ * @param parent 父 span，為空時使用線程的當前 span
+ * @param name 名稱，必須是靜態字符串
+ * @param start_us 開始時間（UNIX 微秒）
+ * @param duration_us 耗時（微秒）
+ * @param failed 是否失敗
+ * @param detail 說明，可為空
+ * @return 記錄的 span，未啟用時為全 0
+ */
+trace_context trace_record(const trace_context* parent, const gchar* name, const gint64 start_us,
+                           const gint64 duration_us, const gboolean failed, const gchar* detail)
+{
+    trace_context context = {0};
+    if (!tracing()) return context;
+
+    trace_ring* ring = acquire_ring();
+    parent = resolve_parent(parent);
+    context.trace_id = parent != nullptr ? parent->trace_id : next_id(ring);
+    context.span_id = next_id(ring);
+
+    trace_span span = {
+        .trace_id = context.trace_id,
+        .span_id = context.span_id,
+        .parent_id = parent != nullptr ? parent->span_id : 0,
+        .start_us = start_us,
+        .duration_us = duration_us,
+        .name = name,
+        .failed = failed,
+    };
+    if (detail != nullptr) g_strlcpy(span.detail, detail, sizeof(span.detail));
+    write_span(ring, &span);
+    return context;
+}
+
+/**
+ * 獲取線程的當前 span
+ * @param context 輸出的上下文，沒有當前 span 時為全 0
+ */
+void trace_current(trace_context* context)
+{
+    const trace_scope* current = tracing() ? g_private_get(&current_key) : nullptr;
+    *context = current != nullptr ? current->context : (trace_context){0};
+}
+
+/**
+ * 按 curl 的計時把一次請求拆分為 DNS、連接、TLS、等待響應與傳輸子 span
+ * @param scope 請求的 span，開始時間應為請求開始的時間
+ * @param curl 已完成的請求
+ */
+void trace_curl(const trace_scope* scope, CURL* curl)
+{
+    if (scope->context.span_id == 0) return;
+
+    // 各時間點均為從請求開始起算的微秒數
+    static const CURLINFO infos[] = {
+        CURLINFO_NAMELOOKUP_TIME_T, CURLINFO_CONNECT_TIME_T, CURLINFO_APPCONNECT_TIME_T,
+        CURLINFO_PRETRANSFER_TIME_T, CURLINFO_STARTTRANSFER_TIME_T, CURLINFO_TOTAL_TIME_T
+    };
+    curl_off_t at[G_N_ELEMENTS(infos)] = {0};
+    for (gsize i = 0; i < G_N_ELEMENTS(infos); ++i) curl_easy_getinfo(curl, infos[i], &at[i]);
+
+    // 復用連接時 DNS、連接與 TLS 為 0，不記錄
+    const struct
+    {
+        const gchar* name;
+        curl_off_t from;
+        curl_off_t to;
+    } phases[] = {
+        {"curl.dns", 0, at[0]},
+        {"curl.connect", at[0], at[1]},
+        {"curl.tls", at[1], at[2]},
+        {"curl.wait", at[3], at[4]},
+        {"curl.transfer", at[4], at[5]},
+    };
+    for (gsize i = 0; i < G_N_ELEMENTS(phases); ++i)
+    {
+        if (phases[i].to <= phases[i].from) continue;
+        trace_record(&scope->context, phases[i].name, scope->start_us + phases[i].from,
+                     phases[i].to - phases[i].from, FALSE, nullptr);
+    }
+}
+
+/**
+ * 讀取的 span 與所在線程
+ */
+typedef struct trace_entry
+{
+    // span
+    trace_span span;
+    // 緩衝區序號
+    guint32 thread;
+} trace_entry;
+
+/**
+ * 讀取所有線程緩衝區中的 span
+ * @param only_new 是否只讀取上次推送之後的 span，只在導出線程中使用
+ * @param threads 輸出的線程名稱 (gchar*)，按緩衝區序號排列
+ * @return span (trace_entry)
+ */
+static GArray* collect_spans(const gboolean only_new, GPtrArray* threads)
+{
+    GArray* entries = g_array_new(FALSE, FALSE, sizeof(trace_entry));
+    if (!tracing()) return entries;
+
+    // 緩衝區只增不減，複製列表後無需持有鎖
+    g_mutex_lock(&rings_lock);
+    GPtrArray* snapshot = g_ptr_array_sized_new(rings->len);
+    for (guint i = 0; i < rings->len; ++i)
+    {
+        trace_ring* ring = g_ptr_array_index(rings, i);
+        g_ptr_array_add(snapshot, ring);
+        g_ptr_array_add(threads, g_strdup(ring->thread_name));
+    }
+    g_mutex_unlock(&rings_lock);
+
+    const guint64 size = (guint64)tr_config->ring_size;
+    for (guint i = 0; i < snapshot->len; ++i)
+    {
+        trace_ring* ring = g_ptr_array_index(snapshot, i);
+        const guint64 written = atomic_load_explicit(&ring->written, memory_order_acquire);
+        guint64 from = written > size ? written - size : 0;
+        if (only_new)
+        {
+            from = MAX(from, ring->pushed);
+            ring->pushed = written;
+        }
+        for (guint64 n = from; n < written; ++n)
+        {
+            trace_entry entry = {.thread = ring->index};
+            if (read_span(&ring->slots[n & (size - 1)], &entry.span)) g_array_append_val(entries, entry);
+        }
+    }
+    g_ptr_array_free(snapshot, TRUE);
+    return entries;
+}
+
+/**
+ * ID 轉為十六進制字符串
+ * @param buffer 輸出，至少 17 字節
+ * @param id ID
+ * @return buffer
+ */
+static const gchar* format_id(gchar* buffer, const guint64 id)
+{
+    g_snprintf(buffer, 17, "%016llx", (unsigned long long)id);
+    return buffer;
+}
+
+/**
+ * 導出所有線程緩衝區中的 span 為 Chrome trace-event JSON，可在任意線程中調用
+ * @return JSON 對象
+ */
+json_t* trace_export_chrome()
+{
+    GPtrArray* threads = g_ptr_array_new_with_free_func(g_free);
+    GArray* entries = collect_spans(FALSE, threads);
+    const json_int_t pid = getpid();
+
+    json_t* events = json_array();
+    for (guint i = 0; i < threads->len; ++i)
+    {
+        json_array_append_new(events, json_pack("{s:s,s:s,s:I,s:i,s:{s:s}}", "name", "thread_name", "ph", "M",
+                                                "pid", pid, "tid", (gint)i, "args", "name",
+                                                (const gchar*)g_ptr_array_index(threads, i)));
+    }
+    for (guint i = 0; i < entries->len; ++i)
+    {
+        const trace_entry* entry = &g_array_index(entries, trace_entry, i);
+        const trace_span* span = &entry->span;
+        gchar trace_id[17], span_id[17], parent_id[17];
+        json_t* args = json_pack("{s:s,s:s,s:s}", "trace_id", format_id(trace_id, span->trace_id), "span_id",
+                                 format_id(span_id, span->span_id), "parent_id",
+                                 format_id(parent_id, span->parent_id));
+        if (span->detail[0] != '\0') json_object_set_new(args, "detail", json_string(span->detail));
+        if (span->failed) json_object_set_new(args, "error", json_true());
+        json_array_append_new(events, json_pack("{s:s,s:s,s:s,s:I,s:I,s:I,s:i,s:o}", "name", span->name, "cat",
+                                                "redis-watcher", "ph", "X", "ts", (json_int_t)span->start_us, "dur",
+                                                (json_int_t)span->duration_us, "pid", pid, "tid",
+                                                (gint)entry->thread, "args", args));
+    }
+    g_array_free(entries, TRUE);
+    g_ptr_array_free(threads, TRUE);
+    return json_pack("{s:o,s:s}", "traceEvents", events, "displayTimeUnit", "ms");
+}
+
+/**
+ * OTLP 字符串屬性
+ * @param key 鍵
+ * @param value 值
+ * @return JSON 對象
+ */
+static json_t* otlp_attribute(const gchar* key, const gchar* value)
+{
+    return json_pack("{s:s,s:{s:s}}", "key", key, "value", "stringValue", value);
+}
+
+/**
+ * 導出 span 為 OTLP/HTTP JSON
+ * @param only_new 是否只導出上次推送之後的 span
+ * @param count 輸出的 span 數，可為空
+ * @return JSON 對象
+ */
+static json_t* build_otlp(const gboolean only_new, guint* count)
+{
+    GPtrArray* threads = g_ptr_array_new_with_free_func(g_free);
+    GArray* entries = collect_spans(only_new, threads);
+
+    json_t* spans = json_array();
+    for (guint i = 0; i < entries->len; ++i)
+    {
+        const trace_entry* entry = &g_array_index(entries, trace_entry, i);
+        const trace_span* span = &entry->span;
+        gchar trace_high[17], trace_low[17], span_id[17];
+        gchar* trace_id = g_strconcat(format_id(trace_high, trace_salt), format_id(trace_low, span->trace_id),
+                                      nullptr);
+        gchar* start = g_strdup_printf("%lld", (long long)span->start_us * 1000);
+        gchar* end = g_strdup_printf("%lld", (long long)(span->start_us + span->duration_us) * 1000);
+
+        json_t* attributes = json_array();
+        json_array_append_new(attributes, otlp_attribute("thread.name", g_ptr_array_index(threads, entry->thread)));
+        if (span->detail[0] != '\0') json_array_append_new(attributes, otlp_attribute("detail", span->detail));
+
+        // kind 1 為 INTERNAL，status code 2 為 ERROR
+        json_t* object = json_pack("{s:s,s:s,s:s,s:i,s:s,s:s,s:o,s:{s:i}}", "traceId", trace_id, "spanId",
+                                   format_id(span_id, span->span_id), "name", span->name, "kind", 1,
+                                   "startTimeUnixNano", start, "endTimeUnixNano", end, "attributes", attributes,
+                                   "status", "code", span->failed ? 2 : 0);
+        if (span->parent_id != 0)
+            json_object_set_new(object, "parentSpanId", json_string(format_id(span_id, span->parent_id)));
+        json_array_append_new(spans, object);
+        g_free(trace_id);
+        g_free(start);
+        g_free(end);
+    }
+    if (count != nullptr) *count = entries->len;
+    g_array_free(entries, TRUE);
+    g_ptr_array_free(threads, TRUE);
+
+    json_t* resource_attributes = json_array();
+    json_array_append_new(resource_attributes, otlp_attribute("service.name", tr_config->service_name));
+    return json_pack("{s:[{s:{s:o},s:[{s:{s:s},s:o}]}]}", "resourceSpans", "resource", "attributes",
+                     resource_attributes, "scopeSpans", "scope", "name", "redis-watcher", "spans", spans);
+}
+
+/**
+ * 導出所有線程緩衝區中的 span 為 OTLP/HTTP JSON，可在任意線程中調用
+ * @return JSON 對象
+ */
+json_t* trace_export_otlp()
+{
+    return build_otlp(FALSE, nullptr);
+}
+
+/**
+ * 推送上次推送之後的 span 到 OTLP 收集器
+ */
+static void push_otlp()
+{
+    guint count = 0;
+    json_t* body = build_otlp(TRUE, &count);
+    gchar* payload = json_dumps(body, JSON_COMPACT);
+    json_decref(body);
+
+    CURL* curl = curl_easy_init();
+    if (curl == nullptr)
+    {
+        g_printerr("Failed to initialize CURL\n");
+        free(payload);
+        return;
+    }
+    struct curl_slist* headers = curl_slist_append(nullptr, "Content-Type: application/json");
+    curl_easy_setopt(curl, CURLOPT_URL, tr_config->otlp_endpoint);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, payload);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10L);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+
+    const CURLcode res = curl_easy_perform(curl);
+    glong code = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &code);
+    if (res != CURLE_OK)
+        g_printerr("OTLP export failed: %s\n", curl_easy_strerror(res));
+    else if (code >= 400)
+        g_printerr("OTLP export rejected: status=%ld\n", code);
+    else
+        g_print("Exported %u span(s) to %s\n", count, tr_config->otlp_endpoint);
+
+    curl_slist_free_all(headers);
+    curl_easy_cleanup(curl);
+    free(payload);
+}
+
+/**
+ * 導出線程
+ * @param data 未使用
+ * @return 未使用
+ */
+static gpointer dump_thread(gpointer data)
+{
+    (void)data; // 未使用
+
+    if (*tr_config->chrome_path != '\0')
+    {
+        json_t* chrome = trace_export_chrome();
+        if (json_dump_file(chrome, tr_config->chrome_path, JSON_COMPACT) != 0)
+            g_printerr("Cannot write trace to %s\n", tr_config->chrome_path);
+        else
+            g_print("Trace written to %s\n", tr_config->chrome_path);
+        json_decref(chrome);
+    }
+    if (*tr_config->otlp_endpoint != '\0') push_otlp();
+
+    atomic_store(&dumping, false);
+    return nullptr;
+}
+
+/**
+ * 在後台線程中寫入 chrome_path 並推送上次推送之後的 span 到 otlp_endpoint，上一次尚未完成時忽略
+ */
+void trace_dump()
+{
+    if (!tracing())
+    {
+        g_printerr("Tracing is disabled, nothing to export\n");
+        return;
+    }
+    if (atomic_exchange(&dumping, true)) return;
+    g_thread_unref(g_thread_new("trace-dump", dump_thread, nullptr));
+}
@@ -0,0 +1,158 @@
+#pragma once
+#include <glib.h>
+#include <curl/curl.h>
+#include <jansson.h>
+
+/**
+ * 追蹤配置
+ *
+ * 每個線程把結束的 span 寫入自己的無鎖環形緩衝區，寫滿後覆蓋最舊的 span；
+ * 導出時讀取所有線程的緩衝區，不阻塞寫入。未啟用時每個埋點只多一次判斷
+ *
+ * 配置:
+ *  - enabled 是否記錄 span
+ *  - ring_size 每個線程保留的 span 數，向上取整為 2 的冪
+ *  - service_name OTLP 的 service.name
+ *  - otlp_endpoint 收到 SIGUSR2 時推送 OTLP/HTTP JSON 的地址，如 http://127.0.0.1:4318/v1/traces，為空時不推送
+ *  - chrome_path 收到 SIGUSR2 時寫入 Chrome trace-event JSON 的文件，為空時不寫入
+ */
+typedef struct trace_config
+{
+    // 是否記錄 span
+    gboolean enabled;
+    // 每個線程保留的 span 數
+    gint64 ring_size;
+    // 服務名稱
+    gchar* service_name;
+    // OTLP 收集器地址
+    gchar* otlp_endpoint;
+    // Chrome trace 文件
+    gchar* chrome_path;
+} trace_config;
+
+typedef trace_config* trace_config_t;
+
+extern trace_config_t tr_config;
+
+// span 附帶說明的最大長度（含結尾的 0）
+#define TRACE_DETAIL_MAX 64
+
+/**
+ * span 的上下文，用於跨線程傳遞父 span；span_id 為 0 表示未追蹤
+ */
+typedef struct trace_context
+{
+    // 追蹤ID
+    guint64 trace_id;
+    // span ID
+    guint64 span_id;
+} trace_context;
+
+/**
+ * 進行中的 span，由調用方持有，結束時寫入當前線程的緩衝區
+ */
+typedef struct trace_scope
+{
+    // 上下文
+    trace_context context;
+    // 父 span ID，根 span 為 0
+    guint64 parent_id;
+    // 名稱，必須是靜態字符串
+    const gchar* name;
+    // 開始時間（UNIX 微秒）
+    gint64 start_us;
+    // 開始時間（單調時鐘）
+    gint64 started;
+    // 進入前線程的當前 span
+    struct trace_scope* previous;
+    // 是否為線程的當前 span
+    gboolean entered;
+} trace_scope;
+
+/**
+ * 讀取追蹤配置
+ * @param keyfile 配置文件
+ * @param error 錯誤對象
+ */
+gboolean init_trace_config(GKeyFile* keyfile, GError* error);
+
+/**
+ * 釋放追蹤配置與所有線程的緩衝區，需在其他線程結束後調用
+ */
+void destroy_trace_config();
+
+/**
+ * 是否記錄 span
+ * @return 是否啟用
+ */
+static inline gboolean tracing()
+{
+    return tr_config != nullptr && tr_config->enabled;
+}
+
+/**
+ * 開始一個 span，不改變線程的當前 span，適用於跨回調的異步操作
+ * @param scope span
+ * @param name 名稱，必須是靜態字符串
+ * @param parent 父 span，為空時使用線程的當前 span，沒有時開始新的追蹤
+ */
+void trace_begin(trace_scope* scope, const gchar* name, const trace_context* parent);
+
+/**
+ * 開始一個 span 並設為線程的當前 span，之後在同一線程開始的 span 默認以其為父 span
+ * @param scope span
+ * @param name 名稱，必須是靜態字符串
+ * @param parent 父 span，為空時使用線程的當前 span，沒有時開始新的追蹤
+ */
+void trace_enter(trace_scope* scope, const gchar* name, const trace_context* parent);
+
+/**
+ * 結束 span 並寫入當前線程的緩衝區，進入過的 span 恢復先前的當前 span
+ * @param scope span
+ * @param failed 是否失敗
+ * @param format 說明格式，可為空
+ */
+void trace_end(trace_scope* scope, gboolean failed, const gchar* format, ...) G_GNUC_PRINTF(3, 4);
+
+/**
+ * 記錄一個已經結束的 span
+ * @param parent 父 span，為空時使用線程的當前 span
+ * @param name 名稱，必須是靜態字符串
+ * @param start_us 開始時間（UNIX 微秒）
+ * @param duration_us 耗時（微秒）
+ * @param failed 是否失敗
+ * @param detail 說明，可為空
+ * @return 記錄的 span，未啟用時為全 0
+ */
+trace_context trace_record(const trace_context* parent, const gchar* name, gint64 start_us, gint64 duration_us,
+                           gboolean failed, const gchar* detail);
+
+/**
+ * 獲取線程的當前 span
+ * @param context 輸出的上下文，沒有當前 span 時為全 0
+ */
+void trace_current(trace_context* context);
+
+/**
+ * 按 curl 的計時把一次請求拆分為 DNS、連接、TLS、等待響應與傳輸子 span
+ * @param scope 請求的 span，開始時間應為請求開始的時間
+ * @param curl 已完成的請求
+ */
+void trace_curl(const trace_scope* scope, CURL* curl);
+
+/**
+ * 導出所有線程緩衝區中的 span 為 Chrome trace-event JSON，可在任意線程中調用
+ * @return JSON 對象
+ */
+json_t* trace_export_chrome();
+
+/**
+ * 導出所有線程緩衝區中的 span 為 OTLP/HTTP JSON，可在任意線程中調用
+ * @return JSON 對象
+ */
+json_t* trace_export_otlp();
+
+/**
+ * 在後台線程中寫入 chrome_path 並推送上次推送之後的 span 到 otlp_endpoint，上一次尚未完成時忽略
+ */
+void trace_dump();
@@ -5,13 +5,21 @@
 #include <event2/event.h>
 #include <event2/util.h>
 #include <unistd.h>
-#include <hiredis/hiredis.h>
+#include <signal.h>
 #include <curl/curl.h>
 #include <jansson.h>
 
-#include "email.h"
-#include "redis.h"
-#include "sms.h"
+#include "aggregator.h"
+#include "alert.h"
+#include "anomaly.h"
+#include "api.h"
+#include "config.h"
+#include "logger.h"
+#include "loopmon.h"
+#include "rollup.h"
+#include "probe.h"
+#include "reload.h"
+#include "shard.h"
 
 // 服務列表數量
 gsize n_services = 0;
@@ -20,8 +28,14 @@ gchar** services = nullptr;
 // Docker Unix socket
 gchar* docker_socket = nullptr;
 
-// 錯誤是否在持續中
-gboolean error_ongoing = FALSE;
+// 同時重啓的服務數量
+gint64 restart_concurrency = 4;
+// 重啓線程池
+static GThreadPool* restart_pool = nullptr;
+// 排隊中與執行中的重啓 (restart_job*)
+static GPtrArray* restart_jobs = nullptr;
+// 保護 restart_jobs
+static GMutex restart_lock;
 
 /**
  * 讀取watcher配置
@@ -46,6 +60,13 @@ gboolean init_watcher_config(GKeyFile* keyfile, GError* error)
         g_printerr("Error reading socket: %s\n", error->message);
         goto error;
     }
+    // 讀取重啓併發數
+    if (!read_optional_integer(keyfile, "Services", "restart_concurrency", 4, &restart_concurrency)) goto error;
+    if (restart_concurrency <= 0)
+    {
+        g_printerr("Error reading restart_concurrency: must be positive\n");
+        goto error;
+    }
     return TRUE;
 
 error:
@@ -65,6 +86,8 @@ void destroy_watcher_config()
         g_strfreev(services);
         // 釋放docker socket
         g_free(docker_socket);
+        services = nullptr;
+        docker_socket = nullptr;
     }
 }
 
@@ -111,7 +134,7 @@ guint64 get_services_version(const gchar* service_id)
     const CURLcode res = curl_easy_perform(curl);
     if (res != CURLE_OK)
     {
-        fprintf(stderr, "curl_easy_perform() 失敗: %s\n", curl_easy_strerror(res));
+        g_printerr("curl_easy_perform() 失敗: %s\n", curl_easy_strerror(res));
         curl_easy_cleanup(curl);
         g_string_free(response, TRUE);
         g_free(url);
@@ -168,6 +191,12 @@ void restart_docker_container(const gchar* service_id)
         return;
     }
 
+    // 整個重啓及其中的兩個請求各記一個 span
+    gboolean restarted = FALSE;
+    trace_scope span;
+    trace_scope request_span;
+    trace_enter(&span, "docker.restart", nullptr);
+
     // 獲取服務詳情的 URL
     auto url = g_strdup_printf("http://localhost/services/%s", service_id);
 
@@ -180,7 +209,10 @@ void restart_docker_container(const gchar* service_id)
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, response);
 
     // 執行請求
+    trace_begin(&request_span, "docker.get", nullptr);
     CURLcode res = curl_easy_perform(curl);
+    trace_curl(&request_span, curl);
+    trace_end(&request_span, res != CURLE_OK, "GET /services/%s", service_id);
     if (res != CURLE_OK)
     {
         g_printerr("GET failed: %s\n", curl_easy_strerror(res));
@@ -259,7 +291,10 @@ void restart_docker_container(const gchar* service_id)
     curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
 
     // 執行請求
+    trace_begin(&request_span, "docker.update", nullptr);
     res = curl_easy_perform(curl);
+    trace_curl(&request_span, curl);
+    trace_end(&request_span, res != CURLE_OK, "POST /services/%s/update?version=%lu", service_id, version_index);
     if (res != CURLE_OK)
     {
         g_printerr("Service update failed: %s\n", curl_easy_strerror(res));
@@ -267,6 +302,7 @@ void restart_docker_container(const gchar* service_id)
     else
     {
         g_print("Service '%s' restarted successfully.\n", service_id);
+        restarted = TRUE;
     }
 
     // 清理
@@ -276,123 +312,181 @@ void restart_docker_container(const gchar* service_id)
     json_decref(root);
 
 cleanup:
+    trace_end(&span, !restarted, "%s", service_id);
     curl_easy_cleanup(curl);
     g_string_free(response, TRUE);
     g_free(url);
 }
 
 /**
- * 定时器回调函数
- * @param fd 文件描述符
- * @param event 事件类型
- * @param arg 回调函数参数
+ * 釋放重啓任務
+ * @param data 重啓任務
  */
-void timer_callback(const evutil_socket_t fd, const short event, void* arg)
+static void free_restart_job(gpointer data)
 {
-    (void)fd; // 未使用
-    (void)event; // 未使用
-    g_print("Timer callback called.\n");
+    restart_job* job = data;
+    g_free(job->service_id);
+    g_free(job->target);
+    g_free(job);
+}
 
-    // 建立 Redis 連接
-    const struct timeval timeout = {r_config->connect_timeout_seconds, 0};
-    const auto c = redisConnectWithTimeout(r_config->redis_host, r_config->redis_port, timeout);
+/**
+ * 重啓任務，在線程池中執行，避免 Docker API 阻塞事件循環
+ * @param data 重啓任務
+ * @param user_data 未使用
+ */
+static void restart_worker(gpointer data, gpointer user_data)
+{
+    (void)user_data; // 未使用
+    restart_job* job = data;
+
+    g_mutex_lock(&restart_lock);
+    job->started_at = g_get_real_time();
+    g_mutex_unlock(&restart_lock);
+
+    // 排隊時間與重啓都記為觸發重啓的探測的子 span
+    trace_record(&job->trace, "remediation.queue", job->queued_at, job->started_at - job->queued_at, FALSE,
+                 job->service_id);
+    trace_scope span;
+    trace_enter(&span, "remediation.restart", &job->trace);
+    restart_docker_container(job->service_id);
+    trace_end(&span, FALSE, "%s for %s", job->service_id, job->target);
+
+    // 完成後從列表中移除並釋放
+    g_mutex_lock(&restart_lock);
+    g_ptr_array_remove_fast(restart_jobs, job);
+    g_mutex_unlock(&restart_lock);
+}
 
-    // 如果連接失敗，則輸出錯誤信息
-    if (c == nullptr || c->err)
+/**
+ * 重啓目標關聯的服務
+ * @param t 目標
+ */
+static void restart_target_services(const target* t)
+{
+    for (gsize i = 0; i < t->config->n_services; ++i)
     {
-        if (c)
-        {
-            g_printerr("Redis connection error: %s\n", c->errstr);
-            // 如果先前未發生錯誤
-            if (!error_ongoing)
-            {
-                // 發送電子郵件通知
-                send_email_notification();
-                // 發送短信通知
-                send_sms();
-                error_ongoing = TRUE;
-            }
-        }
-        else
-        {
-            g_printerr("Redis connection error: can't allocate redis context\n");
-        }
-        goto finish;
+        restart_job* job = g_malloc0(sizeof(restart_job));
+        job->service_id = g_strdup(t->config->services[i]);
+        job->target = g_strdup(t->config->name);
+        job->queued_at = g_get_real_time();
+        trace_current(&job->trace);
+
+        g_mutex_lock(&restart_lock);
+        g_ptr_array_add(restart_jobs, job);
+        g_mutex_unlock(&restart_lock);
+        g_thread_pool_push(restart_pool, job, nullptr);
     }
+}
 
-    // 如果先前有錯誤，則重置
-    if (error_ongoing)
+/**
+ * 獲取排隊中與執行中的服務重啓，可在任意線程中調用
+ * @return 重啓列表副本 (restart_job*)，需要手動釋放
+ */
+GPtrArray* outstanding_restarts()
+{
+    GPtrArray* copies = g_ptr_array_new_with_free_func(free_restart_job);
+    g_mutex_lock(&restart_lock);
+    for (guint i = 0; restart_jobs != nullptr && i < restart_jobs->len; ++i)
     {
-        // 重啓 Docker 容器
-        for (gint i = 0; i < n_services; ++i)
-        {
-            restart_docker_container(services[i]);
-        }
-        error_ongoing = FALSE;
+        const restart_job* job = g_ptr_array_index(restart_jobs, i);
+        restart_job* copy = g_malloc0(sizeof(restart_job));
+        copy->service_id = g_strdup(job->service_id);
+        copy->target = g_strdup(job->target);
+        copy->queued_at = job->queued_at;
+        copy->started_at = job->started_at;
+        g_ptr_array_add(copies, copy);
     }
+    g_mutex_unlock(&restart_lock);
+    return copies;
+}
 
-    redisReply* reply = nullptr;
+/**
+ * 探測結果回调函数
+ * @param t 目標
+ * @param result 探測結果
+ * @param user_data 未使用
+ */
+static void on_probe_result(target* t, const probe_result* result, gpointer user_data)
+{
+    (void)user_data; // 未使用
+
+    // 交由匯總線程記錄到探測歷史與匯總
+    aggregate_result(t, result);
 
-    // 如果需要驗證，發送 AUTH 指令
-    if (r_config->auth)
+    // 如果探測失敗，則輸出錯誤信息
+    if (result->outcome != PROBE_OK)
     {
-        reply = redisCommand(c, "AUTH %s %s", r_config->redis_username, r_config->redis_password);
-        if (reply == nullptr)
+        LOG_EVENT(LOG_LEVEL_ERROR, t->config->name, "probe_failed",
+                  LOG_STRING("outcome", probe_outcome_name(result->outcome)), LOG_STRING("error", result->error),
+                  LOG_DOUBLE("total_ms", (gdouble)result->total_us / 1000.0));
+        // 如果先前未發生錯誤，記錄觸發的故障類型
+        if (!t->error_ongoing)
         {
-            printf("Sending AUTH failed, the connection may have been reset or Redis hangs\n");
-            goto finish;
+            t->error_outcome = result->outcome;
+            t->error_ongoing = TRUE;
         }
-        // 清理
-        freeReplyObject(reply);
-        reply = nullptr;
-    }
-
-
-    // 發送 PING 指令
-    reply = redisCommand(c, "PING");
-    if (reply == nullptr)
-    {
-        printf("Sending PING failed, the connection may have been reset or Redis hangs\n");
-        goto finish;
+        // 交由告警聚合，由抑制表決定是否通知
+        raise_alert(t, probe_outcome_name(t->error_outcome), ALERT_SEVERITY_CRITICAL, result);
+        return;
     }
 
-    // 檢查回應
-    if (reply->type == REDIS_REPLY_STATUS && strcmp(reply->str, "PONG") == 0)
-    {
-        printf("Redis Respond to PING: %s\n", reply->str);
-    }
-    else
+    // 如果先前有錯誤，則重置
+    if (t->error_ongoing)
     {
-        printf("Redis responds to exceptions: type=%d, str=%s\n", reply->type, reply->str);
+        // 重啓 Docker 容器
+        restart_target_services(t);
+        resolve_alert(t, probe_outcome_name(t->error_outcome), ALERT_SEVERITY_CRITICAL, result);
+        t->error_ongoing = FALSE;
+        // 恢復總是輸出，並重新開始採樣
+        t->success_logs = 0;
+        LOG_EVENT(LOG_LEVEL_WARN, t->config->name, "probe_recovered",
+                  LOG_STRING("outcome", probe_outcome_name(t->error_outcome)),
+                  LOG_DOUBLE("ping_ms", (gdouble)result->ping_us / 1000.0),
+                  LOG_DOUBLE("total_ms", (gdouble)result->total_us / 1000.0));
+        return;
     }
 
-    // 清理
-    freeReplyObject(reply);
-    reply = nullptr;
-
-    g_printf("Redis connection success\n");
-
-finish:
+    // 成功的日誌按目標採樣，sample_rate 供下游還原條數
+    if (!log_enabled(LOG_LEVEL_INFO) || !log_sample(&t->success_logs)) return;
+    LOG_EVENT(LOG_LEVEL_INFO, t->config->name, "probe_ok", LOG_DOUBLE("ping_ms", (gdouble)result->ping_us / 1000.0),
+              LOG_DOUBLE("total_ms", (gdouble)result->total_us / 1000.0),
+              LOG_INT("sample_rate", lg_config->success_sample));
+}
 
-    if (reply)
-    {
-        freeReplyObject(reply);
-    }
-    if (c)
-    {
-        redisFree(c);
-    }
+/**
+ * 退出信號回調，結束事件循環以便釋放資源
+ * @param sig 信號
+ * @param event 事件类型
+ * @param arg 事件循環
+ */
+static void signal_callback(const evutil_socket_t sig, const short event, void* arg)
+{
+    (void)event; // 未使用
+    g_print("Received signal %d, exiting.\n", (gint)sig);
+    event_base_loopbreak(arg);
+}
 
-    const auto ev = (struct event*)arg;
-    const struct timeval interval = {r_config->interval_seconds, 0};
-    evtimer_add(ev, &interval);
+/**
+ * SIGUSR2 回調，導出追蹤
+ * @param sig 信號
+ * @param event 事件类型
+ * @param arg 未使用
+ */
+static void trace_signal_callback(const evutil_socket_t sig, const short event, void* arg)
+{
+    (void)sig; // 未使用
+    (void)event; // 未使用
+    (void)arg; // 未使用
+    trace_dump();
 }
 
 /**
  * 開始事件循環
+ * @param config_path 配置文件路徑，用於重新載入
  * @return 返回值
  */
-int run_loop()
+int run_loop(const gchar* config_path)
 {
     // 创建 libevent 基础结构
     struct event_base* base = event_base_new();
@@ -402,28 +496,61 @@ int run_loop()
         return 1;
     }
 
-    // 定义定时器事件
-    const struct timeval interval = {r_config->interval_seconds, 0};
-
-    // 創建定時器事件
-    struct event* timer_event = evtimer_new(base, timer_callback, event_self_cbarg());
-    if (!timer_event)
+    // 創建重啓線程池
+    restart_pool = g_thread_pool_new(restart_worker, nullptr, (gint)restart_concurrency, FALSE, nullptr);
+    restart_jobs = g_ptr_array_new_with_free_func(free_restart_job);
+
+    // 退出信號
+    struct event* sigint_event = evsignal_new(base, SIGINT, signal_callback, base);
+    struct event* sigterm_event = evsignal_new(base, SIGTERM, signal_callback, base);
+    evsignal_add(sigint_event, nullptr);
+    evsignal_add(sigterm_event, nullptr);
+    // 導出追蹤信號
+    struct event* sigusr2_event = evsignal_new(base, SIGUSR2, trace_signal_callback, nullptr);
+    evsignal_add(sigusr2_event, nullptr);
+
+    // 啟動事件循環自我監控、告警聚合、指標匯總與耗時異常檢測
+    start_loop_monitor(base);
+    start_alerts(base);
+    start_rollups();
+    start_anomalies(base);
+
+    // 加入分片後只探測本副本負責的目標
+    int res = 0;
+    if (start_aggregator() && start_shard(base) && start_probes(base, on_probe_result, nullptr) && start_api(base))
     {
-        g_printerr("Cannot create timer event!\n");
-        event_base_free(base);
-        return 1;
+        // 監聽配置變更
+        start_reload(base, config_path);
+        // 运行事件循环
+        event_base_dispatch(base);
+    }
+    else
+    {
+        res = 1;
     }
 
-    // 启动定时器
-    evtimer_add(timer_event, &interval);
-    g_print("Timer started with interval %ld seconds.\n", r_config->interval_seconds);
-
-    // 运行事件循环
-    event_base_dispatch(base);
-
-    // 释放资源
-    event_free(timer_event);
+    // 释放资源，停止告警時會立即發出尚未發送的摘要
+    stop_api();
+    stop_reload();
+    // 先註銷成員，其他副本盡快接管
+    stop_shard();
+    stop_probes();
+    // 處理完已提交的結果再停止匯總
+    stop_aggregator();
+    stop_anomalies();
+    stop_alerts();
+    stop_rollups();
+    stop_loop_monitor();
+    event_free(sigint_event);
+    event_free(sigterm_event);
+    event_free(sigusr2_event);
     event_base_free(base);
 
-    return 0;
+    // 等待進行中的重啓完成
+    g_thread_pool_free(restart_pool, FALSE, TRUE);
+    restart_pool = nullptr;
+    g_ptr_array_free(restart_jobs, TRUE);
+    restart_jobs = nullptr;
+
+    return res;
 }
@@ -2,6 +2,30 @@
 
 #include <glib.h>
 
+#include "trace.h"
+
+// 默認的服務列表數量
+extern gsize n_services;
+// 默認的服務列表
+extern gchar** services;
+
+/**
+ * 進行中的服務重啓
+ */
+typedef struct restart_job
+{
+    // 服務ID
+    gchar* service_id;
+    // 觸發重啓的目標名稱
+    gchar* target;
+    // 排隊時間（UNIX 微秒）
+    gint64 queued_at;
+    // 開始時間（UNIX 微秒），尚在排隊時為 0
+    gint64 started_at;
+    // 觸發重啓的探測 span
+    trace_context trace;
+} restart_job;
+
 /**
  * 讀取watcher配置
  * @param keyfile 配置文件
@@ -25,8 +49,15 @@ guint64 get_services_version(const gchar* service_id);
  */
 void restart_docker_container(const gchar* service_id);
 
+/**
+ * 獲取排隊中與執行中的服務重啓，可在任意線程中調用
+ * @return 重啓列表副本 (restart_job*)，需要手動釋放
+ */
+GPtrArray* outstanding_restarts();
+
 /**
  * 開始事件循環
+ * @param config_path 配置文件路徑，用於重新載入
  * @return 返回值
  */
-int run_loop();
+int run_loop(const gchar* config_path);
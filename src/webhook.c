@@ -0,0 +1,446 @@
+#include "webhook.h"
+
+#include <jansson.h>
+#include <curl/curl.h>
+
+#include "config.h"
+#include "notifier.h"
+
+// Webhook 分組前綴
+#define WEBHOOK_GROUP_PREFIX "Webhook:"
+// PagerDuty Events API v2 地址
+#define PAGERDUTY_URL "https://events.pagerduty.com/v2/enqueue"
+// PagerDuty summary 的長度上限
+#define PAGERDUTY_SUMMARY_MAX 1024
+
+// Webhook 通道配置 (webhook_config*)
+static GPtrArray* webhooks = nullptr;
+
+/**
+ * Webhook 請求狀態，curl 不複製這些資料，需保留到請求完成
+ */
+typedef struct webhook_request
+{
+    // 請求體
+    gchar* body;
+    // 請求標頭
+    struct curl_slist* headers;
+} webhook_request;
+
+/**
+ * 釋放 Webhook 通道配置
+ * @param data 通道配置
+ */
+static void free_webhook_config(gpointer data)
+{
+    webhook_config* config = data;
+    g_free(config->name);
+    g_free(config->url);
+    g_free(config->routing_key);
+    g_free(config->template);
+    g_strfreev(config->headers);
+    g_free(config);
+}
+
+/**
+ * 釋放 Webhook 請求狀態
+ * @param data 請求狀態
+ */
+static void free_webhook_request(gpointer data)
+{
+    webhook_request* state = data;
+    g_free(state->body);
+    curl_slist_free_all(state->headers);
+    g_free(state);
+}
+
+/**
+ * 將文本轉為 JSON 字符串，非法 UTF-8 會被替換
+ * @param text 文本，可為空
+ * @return JSON 字符串
+ */
+static json_t* json_text(const gchar* text)
+{
+    gchar* valid = g_utf8_make_valid(text ? text : "", -1);
+    json_t* value = json_string(valid);
+    g_free(valid);
+    return value;
+}
+
+/**
+ * 去除文本中的回車，郵件內容使用 CRLF，聊天工具只需要 LF
+ * @param text 文本，可為空
+ * @return 文本 (需要手動釋放)
+ */
+static gchar* strip_cr(const gchar* text)
+{
+    GString* out = g_string_new(nullptr);
+    for (const gchar* p = text ? text : ""; *p; ++p)
+    {
+        if (*p != '\r') g_string_append_c(out, *p);
+    }
+    return g_string_free(out, FALSE);
+}
+
+/**
+ * 轉義為 JSON 字符串內容（不含引號）
+ * @param text 文本，可為空
+ * @return 轉義後的文本 (需要手動釋放)
+ */
+static gchar* json_escape(const gchar* text)
+{
+    json_t* value = json_text(text);
+    char* dumped = json_dumps(value, JSON_ENCODE_ANY);
+    json_decref(value);
+
+    gchar* result = g_strndup(dumped + 1, strlen(dumped) - 2);
+    free(dumped);
+    return result;
+}
+
+/**
+ * 渲染自定義模板，佔位符替換為轉義後的內容，未知佔位符原樣保留
+ * @param template 模板
+ * @param message 通知內容
+ * @return 請求體 (需要手動釋放)
+ */
+static gchar* render_template(const gchar* template, const notify_message* message)
+{
+    const struct
+    {
+        const gchar* name;
+        const gchar* value;
+    } fields[] = {
+        {"{{subject}}", message->subject},
+        {"{{body}}", message->body},
+        {"{{summary}}", message->summary ? message->summary : message->body},
+        {"{{routes}}", message->routes},
+        {"{{severity}}", message->severity},
+    };
+
+    GString* out = g_string_new(nullptr);
+    const gchar* p = template;
+    while (*p)
+    {
+        const gchar* start = strstr(p, "{{");
+        if (start == nullptr)
+        {
+            g_string_append(out, p);
+            break;
+        }
+        g_string_append_len(out, p, start - p);
+
+        gboolean replaced = FALSE;
+        for (gsize i = 0; i < G_N_ELEMENTS(fields); ++i)
+        {
+            if (!g_str_has_prefix(start, fields[i].name)) continue;
+            gchar* escaped = json_escape(fields[i].value);
+            g_string_append(out, escaped);
+            g_free(escaped);
+            p = start + strlen(fields[i].name);
+            replaced = TRUE;
+            break;
+        }
+        if (!replaced)
+        {
+            g_string_append(out, "{{");
+            p = start + 2;
+        }
+    }
+    return g_string_free(out, FALSE);
+}
+
+/**
+ * 構建 Slack 請求體
+ * @param message 通知內容
+ * @return 請求體 (需要手動釋放)
+ */
+static gchar* build_slack_payload(const notify_message* message)
+{
+    gchar* body = strip_cr(message->body);
+    gchar* text = g_strdup_printf("*%s*\n%s", message->subject, body);
+
+    json_t* root = json_object();
+    json_object_set_new(root, "text", json_text(text));
+    char* dumped = json_dumps(root, JSON_COMPACT);
+    json_decref(root);
+
+    gchar* result = g_strdup(dumped);
+    free(dumped);
+    g_free(text);
+    g_free(body);
+    return result;
+}
+
+/**
+ * 構建 PagerDuty 請求體
+ *
+ * 每條告警一個事件，以告警標識作為去重鍵，恢復時解除同一告警的事件；
+ * 發件箱中沒有標識的舊記錄退回以集群作為去重鍵
+ * @param config 通道配置
+ * @param message 通知內容
+ * @return 請求體 (需要手動釋放)
+ */
+static gchar* build_pagerduty_payload(const webhook_config* config, const notify_message* message)
+{
+    const gboolean resolved = g_strcmp0(message->severity, "resolved") == 0;
+    gchar* dedup_key = message->key != nullptr
+                           ? g_strdup_printf("redis-watcher/%s", message->key)
+                           : g_strdup_printf("redis-watcher/%s", message->routes ? message->routes : "default");
+    gchar* summary = g_utf8_substring(message->subject, 0,
+                                      MIN(g_utf8_strlen(message->subject, -1), PAGERDUTY_SUMMARY_MAX));
+
+    json_t* root = json_object();
+    json_object_set_new(root, "routing_key", json_text(config->routing_key));
+    json_object_set_new(root, "event_action", json_string(resolved ? "resolve" : "trigger"));
+    json_object_set_new(root, "dedup_key", json_text(dedup_key));
+    if (!resolved)
+    {
+        json_t* details = json_object();
+        gchar* body = strip_cr(message->body);
+        json_object_set_new(details, "body", json_text(body));
+        json_object_set_new(details, "clusters", json_text(message->routes));
+        g_free(body);
+
+        json_t* payload = json_object();
+        json_object_set_new(payload, "summary", json_text(summary));
+        json_object_set_new(payload, "source", json_string("redis-watcher"));
+        json_object_set_new(payload, "severity",
+                            json_string(g_strcmp0(message->severity, "warning") == 0 ? "warning" : "critical"));
+        json_object_set_new(payload, "custom_details", details);
+        json_object_set_new(root, "payload", payload);
+    }
+    char* dumped = json_dumps(root, JSON_COMPACT);
+    json_decref(root);
+
+    gchar* result = g_strdup(dumped);
+    free(dumped);
+    g_free(summary);
+    g_free(dedup_key);
+    return result;
+}
+
+/**
+ * 建構 Webhook 請求，由通知工作線程執行
+ *
+ * 句柄來自通知器的句柄池，優先使用 HTTP/2，同一主機的請求在一個連接上多路復用
+ * @param request 請求對象
+ * @param message 通知內容
+ * @param data 通道配置
+ * @return 是否成功
+ */
+static gboolean prepare_webhook_request(notify_request* request, const notify_message* message, gpointer data)
+{
+    const webhook_config* config = data;
+
+    gchar* body = nullptr;
+    switch (config->kind)
+    {
+    case WEBHOOK_SLACK:
+        body = build_slack_payload(message);
+        break;
+    case WEBHOOK_PAGERDUTY:
+        body = build_pagerduty_payload(config, message);
+        break;
+    case WEBHOOK_CUSTOM:
+        body = render_template(config->template, message);
+        break;
+    }
+
+    CURL* curl = acquire_curl_handle();
+    if (curl == nullptr)
+    {
+        g_printerr("curl_easy_init() failed\n");
+        g_free(body);
+        return FALSE;
+    }
+
+    webhook_request* state = g_malloc0(sizeof(webhook_request));
+    state->body = body;
+    state->headers = curl_slist_append(state->headers, "Content-Type: application/json");
+    for (gint i = 0; config->headers != nullptr && config->headers[i] != nullptr; ++i)
+    {
+        state->headers = curl_slist_append(state->headers, config->headers[i]);
+    }
+
+    curl_easy_setopt(curl, CURLOPT_URL, config->url);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, state->headers);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long)strlen(state->body));
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, state->body);
+    // 保持連接，併發請求等待復用已有連接
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_2TLS);
+    curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+
+    request->curl = curl;
+    request->data = state;
+    request->free_data = free_webhook_request;
+    return TRUE;
+}
+
+// Webhook 通知後端
+static const notify_backend webhook_backend = {
+    .kind = "webhook",
+    .prepare = prepare_webhook_request,
+};
+
+// PagerDuty 事件按告警去重，逐條接收告警
+static const notify_backend pagerduty_backend = {
+    .kind = "pagerduty",
+    .per_alert = TRUE,
+    .prepare = prepare_webhook_request,
+};
+
+/**
+ * 讀取單個 Webhook 分組
+ * @param keyfile 配置文件
+ * @param group 分組名稱
+ * @return 通道配置，出錯時返回空
+ */
+static webhook_config* read_webhook_group(GKeyFile* keyfile, const gchar* group)
+{
+    GError* error = nullptr;
+    gchar* kind = nullptr;
+    webhook_config* config = g_malloc0(sizeof(webhook_config));
+
+    config->name = g_strdup(group + strlen(WEBHOOK_GROUP_PREFIX));
+    if (*config->name == '\0')
+    {
+        g_printerr("Error reading %s: channel name is empty\n", group);
+        goto error;
+    }
+
+    // 讀取類型
+    if (!read_optional_string(keyfile, group, "kind", "custom", &kind)) goto error;
+    if (g_strcmp0(kind, "slack") == 0) config->kind = WEBHOOK_SLACK;
+    else if (g_strcmp0(kind, "pagerduty") == 0) config->kind = WEBHOOK_PAGERDUTY;
+    else if (g_strcmp0(kind, "custom") == 0) config->kind = WEBHOOK_CUSTOM;
+    else
+    {
+        g_printerr("Error reading %s kind: unknown webhook kind %s\n", group, kind);
+        goto error;
+    }
+
+    // 讀取請求地址
+    if (!read_optional_string(keyfile, group, "url", config->kind == WEBHOOK_PAGERDUTY ? PAGERDUTY_URL : nullptr,
+                              &config->url))
+        goto error;
+    if (config->url == nullptr)
+    {
+        g_printerr("Error reading %s url: url is required\n", group);
+        goto error;
+    }
+
+    // 讀取類型相關的配置
+    if (!read_optional_string(keyfile, group, "routing_key", nullptr, &config->routing_key)) goto error;
+    if (config->kind == WEBHOOK_PAGERDUTY && config->routing_key == nullptr)
+    {
+        g_printerr("Error reading %s routing_key: routing_key is required for pagerduty\n", group);
+        goto error;
+    }
+    if (!read_optional_string(keyfile, group, "template", nullptr, &config->template)) goto error;
+    if (config->kind == WEBHOOK_CUSTOM)
+    {
+        if (config->template == nullptr)
+        {
+            g_printerr("Error reading %s template: template is required for custom webhooks\n", group);
+            goto error;
+        }
+
+        // 用空內容渲染一次，確認模板是合法的 JSON
+        const notify_message sample = {"", "", "", "", ""};
+        gchar* rendered = render_template(config->template, &sample);
+        json_error_t json_error;
+        json_t* parsed = json_loads(rendered, 0, &json_error);
+        g_free(rendered);
+        if (parsed == nullptr)
+        {
+            g_printerr("Error reading %s template: %s\n", group, json_error.text);
+            goto error;
+        }
+        json_decref(parsed);
+    }
+
+    // 讀取額外的請求標頭
+    if (g_key_file_has_key(keyfile, group, "headers", nullptr))
+    {
+        config->headers = g_key_file_get_string_list(keyfile, group, "headers", nullptr, &error);
+        if (error != nullptr)
+        {
+            g_printerr("Error reading %s headers: %s\n", group, error->message);
+            g_error_free(error);
+            goto error;
+        }
+    }
+
+    // 讀取超時與併發上限
+    if (!read_optional_integer(keyfile, group, "timeout", 10, &config->timeout_seconds)) goto error;
+    if (!read_optional_integer(keyfile, group, "concurrency", 0, &config->concurrency)) goto error;
+    if (config->timeout_seconds <= 0 || config->concurrency < 0)
+    {
+        g_printerr("Error reading %s: timeout must be positive and concurrency must not be negative\n", group);
+        goto error;
+    }
+
+    g_free(kind);
+    return config;
+
+error:
+    g_free(kind);
+    free_webhook_config(config);
+    return nullptr;
+}
+
+/**
+ * 讀取所有 Webhook 通道並註冊到通知器，需在通知器配置之後讀取
+ * @param keyfile 配置文件
+ * @param error 錯誤對象
+ */
+gboolean init_webhook_config(GKeyFile* keyfile, GError* error)
+{
+    (void)error; // 各分組自行處理錯誤
+
+    webhooks = g_ptr_array_new_with_free_func(free_webhook_config);
+
+    // 讀取所有 [Webhook:<name>] 分組
+    gchar** groups = g_key_file_get_groups(keyfile, nullptr);
+    for (gint i = 0; groups[i] != nullptr; ++i)
+    {
+        if (!g_str_has_prefix(groups[i], WEBHOOK_GROUP_PREFIX)) continue;
+
+        webhook_config* config = read_webhook_group(keyfile, groups[i]);
+        if (config == nullptr)
+        {
+            g_strfreev(groups);
+            goto error;
+        }
+        g_ptr_array_add(webhooks, config);
+
+        const notify_backend* backend = config->kind == WEBHOOK_PAGERDUTY ? &pagerduty_backend : &webhook_backend;
+        if (!register_notify_channel(config->name, backend, config, (glong)(config->timeout_seconds * 1000),
+                                     (guint)config->concurrency))
+        {
+            g_strfreev(groups);
+            goto error;
+        }
+    }
+    g_strfreev(groups);
+    return TRUE;
+
+error:
+    // 釋放配置
+    destroy_webhook_config();
+    return FALSE;
+}
+
+/**
+ * 釋放 Webhook 配置
+ */
+void destroy_webhook_config()
+{
+    if (webhooks != nullptr)
+    {
+        g_ptr_array_free(webhooks, TRUE);
+        webhooks = nullptr;
+    }
+}
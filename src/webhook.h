@@ -0,0 +1,59 @@
+#pragma once
+#include <glib.h>
+
+/**
+ * Webhook 類型
+ */
+typedef enum webhook_kind
+{
+    // Slack Incoming Webhook
+    WEBHOOK_SLACK = 0,
+    // PagerDuty Events API v2
+    WEBHOOK_PAGERDUTY,
+    // 自定義 JSON 模板
+    WEBHOOK_CUSTOM
+} webhook_kind;
+
+/**
+ * Webhook 通道配置
+ *
+ * 配置（[Webhook:<name>] 分組，name 即通道名稱）:
+ *  - kind 類型：slack、pagerduty 或 custom，pagerduty 每條告警一個事件，其餘類型接收摘要
+ *  - url 請求地址，pagerduty 默認為官方 Events API
+ *  - routing_key PagerDuty 的 Integration Key
+ *  - template custom 類型的 JSON 模板，可使用 {{subject}} {{body}} {{summary}} {{routes}} 佔位符
+ *  - headers 額外的請求標頭列表，如 Authorization: Bearer xxx
+ *  - timeout 單次發送的超時秒數
+ *  - concurrency 同時發送的請求上限，0 表示不限制
+ */
+typedef struct webhook_config
+{
+    // 通道名稱
+    gchar* name;
+    // 類型
+    webhook_kind kind;
+    // 請求地址
+    gchar* url;
+    // PagerDuty Integration Key
+    gchar* routing_key;
+    // 自定義模板
+    gchar* template;
+    // 額外的請求標頭
+    gchar** headers;
+    // 超時秒數
+    gint64 timeout_seconds;
+    // 併發上限
+    gint64 concurrency;
+} webhook_config;
+
+/**
+ * 讀取所有 Webhook 通道並註冊到通知器，需在通知器配置之後讀取
+ * @param keyfile 配置文件
+ * @param error 錯誤對象
+ */
+gboolean init_webhook_config(GKeyFile* keyfile, GError* error);
+
+/**
+ * 釋放 Webhook 配置
+ */
+void destroy_webhook_config();
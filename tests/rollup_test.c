@@ -0,0 +1,120 @@
+#include <glib.h>
+#include <math.h>
+
+#include "rollup.h"
+
+// 樣本數，以 1.2% 的間隔遞增，每個樣本落在不同的桶，桶數遠超草圖的上限
+#define SAMPLES 600
+
+/**
+ * 以最小的相對誤差讀取匯總配置並啟動匯總
+ */
+static void setup_rollups()
+{
+    GKeyFile* keyfile = g_key_file_new();
+    g_key_file_load_from_data(keyfile, "[Rollup]\nrelative_accuracy = 0.005\n", -1, G_KEY_FILE_NONE, nullptr);
+    g_assert_true(init_rollup_config(keyfile, nullptr));
+    g_key_file_free(keyfile);
+    start_rollups();
+}
+
+/**
+ * 停止匯總並釋放配置
+ */
+static void teardown_rollups()
+{
+    stop_rollups();
+    destroy_rollup_config();
+}
+
+/**
+ * 第 i 個樣本的耗時
+ * @param i 序號
+ * @return 耗時（微秒）
+ */
+static gint64 sample_us(const guint i)
+{
+    return (gint64)(100 * pow(1.012, i));
+}
+
+/**
+ * 草圖中所有桶的計數之和
+ * @param bucket 時間桶
+ * @return 計數之和
+ */
+static guint64 sketch_total(const rollup_bucket* bucket)
+{
+    const guint32* counts = bucket->sketch.bins;
+    guint64 total = 0;
+    for (guint i = 0; i < bucket->sketch.n_bins; ++i) total += counts[i];
+    return total;
+}
+
+/**
+ * 檢查分位數的相對誤差
+ * @param bucket 時間桶
+ * @param q 分位
+ */
+static void assert_quantile(const rollup_bucket* bucket, const gdouble q)
+{
+    const gint64 expected = sample_us((guint)ceil(q * (SAMPLES - 1)));
+    const gint64 actual = rollup_quantile(bucket, q);
+    g_assert_cmpfloat(fabs((gdouble)(actual - expected)) / (gdouble)expected, <=, 0.03);
+}
+
+/**
+ * 逐個樣本升序寫入，新的最大值在桶數已滿後不丟失
+ */
+static void test_ascending_samples()
+{
+    setup_rollups();
+    const gint64 start = (gint64)1700000000 * G_USEC_PER_SEC;
+    for (guint i = 0; i < SAMPLES; ++i)
+    {
+        const probe_result result = {.outcome = PROBE_OK, .timestamp = start, .total_us = sample_us(i)};
+        rollup_append("target", &result);
+    }
+
+    rollup_bucket summary = {0};
+    g_assert_cmpuint(rollup_summarize("target", ROLLUP_HOUR, start, &summary), ==, 1);
+    g_assert_cmpuint(summary.count, ==, SAMPLES);
+    g_assert_cmpuint(sketch_total(&summary), ==, SAMPLES);
+    assert_quantile(&summary, 0.97);
+    assert_quantile(&summary, 0.99);
+    rollup_clear(&summary);
+    teardown_rollups();
+}
+
+/**
+ * 合併兩個各自滿桶的草圖，計數與高分位數不變
+ */
+static void test_merge_full_sketches()
+{
+    setup_rollups();
+    const gint64 start = (gint64)1700000000 * G_USEC_PER_SEC;
+    for (guint i = 0; i < SAMPLES; ++i)
+    {
+        const probe_result result = {.outcome = PROBE_OK, .timestamp = start, .total_us = sample_us(i)};
+        rollup_append(i % 2 == 0 ? "even" : "odd", &result);
+    }
+
+    rollup_bucket merged = {0};
+    rollup_bucket odd = {0};
+    g_assert_cmpuint(rollup_summarize("even", ROLLUP_HOUR, start, &merged), ==, 1);
+    g_assert_cmpuint(rollup_summarize("odd", ROLLUP_HOUR, start, &odd), ==, 1);
+    rollup_merge(&merged, &odd);
+    g_assert_cmpuint(merged.count, ==, SAMPLES);
+    g_assert_cmpuint(sketch_total(&merged), ==, SAMPLES);
+    assert_quantile(&merged, 0.99);
+    rollup_clear(&odd);
+    rollup_clear(&merged);
+    teardown_rollups();
+}
+
+int main(int argc, char* argv[])
+{
+    g_test_init(&argc, &argv, nullptr);
+    g_test_add_func("/rollup/ascending-samples", test_ascending_samples);
+    g_test_add_func("/rollup/merge-full-sketches", test_merge_full_sketches);
+    return g_test_run();
+}
@@ -0,0 +1,587 @@
+#include "fault_proxy.h"
+
+#include <errno.h>
+#include <netdb.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <event2/buffer.h>
+#include <event2/bufferevent.h>
+#include <event2/event.h>
+#include <event2/listener.h>
+
+struct fault_proxy
+{
+    // 當前的故障，只在代理線程中使用
+    fault_spec spec;
+    // 等待生效的故障
+    fault_spec pending;
+    // 保護 pending
+    GMutex lock;
+    // 上游地址
+    struct sockaddr_storage upstream;
+    // 上游地址長度
+    socklen_t upstream_length;
+    // 事件循環
+    struct event_base* base;
+    // 監聽器
+    struct evconnlistener* listener;
+    // 監聽的端口
+    guint16 port;
+    // 打開的連接 (fault_link*)
+    GPtrArray* links;
+    // 當前的限速配置，不限速時為空
+    struct ev_token_bucket_cfg* rate;
+    // 代理線程
+    GThread* thread;
+    // 停止通知
+    gint stop_fd;
+    // 停止事件
+    struct event* stop_event;
+    // 故障變更通知
+    gint update_fd;
+    // 故障變更事件
+    struct event* update_event;
+    // 隨機數，只在代理線程中使用
+    GRand* rand;
+    // 統計
+    _Atomic guint64 connections;
+    _Atomic guint64 resets;
+    _Atomic guint64 upstream_errors;
+    _Atomic guint64 bytes;
+    _Atomic guint64 open;
+};
+
+/**
+ * 延遲送達的一段數據
+ */
+typedef struct fault_chunk
+{
+    // 送達時間（單調時鐘）
+    gint64 due;
+    // 數據
+    struct evbuffer* data;
+} fault_chunk;
+
+typedef struct fault_link fault_link;
+
+/**
+ * 連接的一個方向
+ */
+typedef struct fault_pipe
+{
+    // 所屬連接
+    fault_link* link;
+    // 寫入端
+    struct bufferevent* to;
+    // 等待送達的數據 (fault_chunk*)，按送達時間排列
+    GQueue chunks;
+    // 送達定時器
+    struct event* timer;
+    // 最後一段數據的送達時間，保證數據順序
+    gint64 last_due;
+} fault_pipe;
+
+/**
+ * 一對客戶端與上游連接
+ */
+struct fault_link
+{
+    // 所屬代理
+    fault_proxy* proxy;
+    // 客戶端連接
+    struct bufferevent* client;
+    // 上游連接
+    struct bufferevent* server;
+    // 客戶端到上游
+    fault_pipe up;
+    // 上游到客戶端
+    fault_pipe down;
+    // 上游是否已連接
+    gboolean connected;
+};
+
+/**
+ * 解析 host:port 地址，IPv6 地址需用方括號括起
+ * @param text 地址
+ * @param passive 是否用於監聽
+ * @param address 輸出的地址
+ * @param length 輸出的地址長度
+ * @return 是否成功
+ */
+static gboolean resolve_address(const gchar* text, const gboolean passive, struct sockaddr_storage* address,
+                                socklen_t* length)
+{
+    const gchar* colon = strrchr(text, ':');
+    if (colon == nullptr || colon[1] == '\0')
+    {
+        g_printerr("Invalid address %s: expected host:port\n", text);
+        return FALSE;
+    }
+    gchar* host = g_strndup(text, colon - text);
+    if (host[0] == '[' && host[strlen(host) - 1] == ']')
+    {
+        memmove(host, host + 1, strlen(host));
+        host[strlen(host) - 1] = '\0';
+    }
+
+    const struct addrinfo hints = {
+        .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM, .ai_flags = passive ? AI_PASSIVE : 0
+    };
+    struct addrinfo* result = nullptr;
+    const gint rc = getaddrinfo(host[0] != '\0' ? host : nullptr, colon + 1, &hints, &result);
+    g_free(host);
+    if (rc != 0)
+    {
+        g_printerr("Cannot resolve %s: %s\n", text, gai_strerror(rc));
+        return FALSE;
+    }
+    memcpy(address, result->ai_addr, result->ai_addrlen);
+    *length = result->ai_addrlen;
+    freeaddrinfo(result);
+    return TRUE;
+}
+
+/**
+ * 關閉 Nagle 算法，避免小包被合併影響延遲的測量
+ * @param fd 連接
+ */
+static void set_nodelay(const evutil_socket_t fd)
+{
+    const gint on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+}
+
+/**
+ * 關閉時發送 RST 而不是 FIN
+ * @param fd 連接
+ */
+static void set_reset_on_close(const evutil_socket_t fd)
+{
+    const struct linger linger = {.l_onoff = 1, .l_linger = 0};
+    setsockopt(fd, SOL_SOCKET, SO_LINGER, &linger, sizeof(linger));
+}
+
+/**
+ * 釋放延遲送達的數據
+ * @param data 數據
+ */
+static void free_chunk(gpointer data)
+{
+    fault_chunk* chunk = data;
+    evbuffer_free(chunk->data);
+    g_free(chunk);
+}
+
+/**
+ * 安排送達隊首的數據，黑洞期間不送達
+ * @param pipe 方向
+ */
+static void schedule_pipe(fault_pipe* pipe)
+{
+    const fault_chunk* head = g_queue_peek_head(&pipe->chunks);
+    if (head == nullptr || pipe->link->proxy->spec.blackhole) return;
+
+    const gint64 delay = MAX(head->due - g_get_monotonic_time(), 0);
+    const struct timeval tv = {.tv_sec = delay / G_USEC_PER_SEC, .tv_usec = delay % G_USEC_PER_SEC};
+    evtimer_add(pipe->timer, &tv);
+}
+
+/**
+ * 送達定時器回調，寫入所有已到期的數據
+ * @param fd 文件描述符
+ * @param event 事件類型
+ * @param arg 方向
+ */
+static void deliver_callback(const evutil_socket_t fd, const short event, void* arg)
+{
+    (void)fd; // 未使用
+    (void)event; // 未使用
+
+    fault_pipe* pipe = arg;
+    const gint64 now = g_get_monotonic_time();
+    fault_chunk* head = nullptr;
+    while ((head = g_queue_peek_head(&pipe->chunks)) != nullptr && head->due <= now)
+    {
+        g_queue_pop_head(&pipe->chunks);
+        atomic_fetch_add_explicit(&pipe->link->proxy->bytes, evbuffer_get_length(head->data), memory_order_relaxed);
+        bufferevent_write_buffer(pipe->to, head->data);
+        free_chunk(head);
+    }
+    schedule_pipe(pipe);
+}
+
+/**
+ * 讀取回調，按當前的延遲轉發到另一端
+ * @param bev 讀取端
+ * @param arg 連接
+ */
+static void read_callback(struct bufferevent* bev, void* arg)
+{
+    fault_link* link = arg;
+    fault_pipe* pipe = bev == link->client ? &link->up : &link->down;
+    fault_proxy* proxy = link->proxy;
+    struct evbuffer* input = bufferevent_get_input(bev);
+
+    gint64 delay_ms = proxy->spec.latency_ms;
+    if (proxy->spec.jitter_ms > 0) delay_ms += g_rand_int_range(proxy->rand, 0, proxy->spec.jitter_ms + 1);
+    if (delay_ms <= 0 && g_queue_is_empty(&pipe->chunks))
+    {
+        atomic_fetch_add_explicit(&proxy->bytes, evbuffer_get_length(input), memory_order_relaxed);
+        bufferevent_write_buffer(pipe->to, input);
+        return;
+    }
+
+    // 不早於前一段數據，保持數據順序
+    fault_chunk* chunk = g_malloc0(sizeof(fault_chunk));
+    chunk->due = MAX(g_get_monotonic_time() + delay_ms * 1000, pipe->last_due);
+    chunk->data = evbuffer_new();
+    evbuffer_add_buffer(chunk->data, input);
+    pipe->last_due = chunk->due;
+    g_queue_push_tail(&pipe->chunks, chunk);
+    if (pipe->chunks.length == 1) schedule_pipe(pipe);
+}
+
+/**
+ * 釋放一個方向的數據與定時器
+ * @param pipe 方向
+ */
+static void clear_pipe(fault_pipe* pipe)
+{
+    event_free(pipe->timer);
+    g_queue_clear_full(&pipe->chunks, free_chunk);
+}
+
+/**
+ * 關閉連接，未送達的數據被丟棄
+ * @param link 連接
+ * @param reset 是否以 RST 關閉客戶端連接
+ */
+static void close_link(fault_link* link, const gboolean reset)
+{
+    fault_proxy* proxy = link->proxy;
+    if (reset)
+    {
+        set_reset_on_close(bufferevent_getfd(link->client));
+        atomic_fetch_add_explicit(&proxy->resets, 1, memory_order_relaxed);
+    }
+    g_ptr_array_remove_fast(proxy->links, link);
+    clear_pipe(&link->up);
+    clear_pipe(&link->down);
+    bufferevent_free(link->client);
+    bufferevent_free(link->server);
+    g_free(link);
+    atomic_fetch_sub_explicit(&proxy->open, 1, memory_order_relaxed);
+}
+
+/**
+ * 暫停或恢復連接的轉發
+ * @param link 連接
+ * @param held 是否暫停
+ */
+static void hold_link(fault_link* link, const gboolean held)
+{
+    if (held)
+    {
+        bufferevent_disable(link->client, EV_READ);
+        bufferevent_disable(link->server, EV_READ);
+        evtimer_del(link->up.timer);
+        evtimer_del(link->down.timer);
+        return;
+    }
+    bufferevent_enable(link->client, EV_READ);
+    bufferevent_enable(link->server, EV_READ);
+    schedule_pipe(&link->up);
+    schedule_pipe(&link->down);
+}
+
+/**
+ * 連接事件回調，任一端關閉或出錯時關閉整個連接
+ * @param bev 連接
+ * @param events 事件
+ * @param arg 連接
+ */
+static void event_callback(struct bufferevent* bev, const short events, void* arg)
+{
+    fault_link* link = arg;
+    if (events & BEV_EVENT_CONNECTED)
+    {
+        link->connected = TRUE;
+        set_nodelay(bufferevent_getfd(bev));
+        return;
+    }
+    if (!(events & (BEV_EVENT_EOF | BEV_EVENT_ERROR))) return;
+
+    if (bev == link->server && !link->connected)
+        atomic_fetch_add_explicit(&link->proxy->upstream_errors, 1, memory_order_relaxed);
+    close_link(link, FALSE);
+}
+
+/**
+ * 初始化連接的一個方向
+ * @param pipe 方向
+ * @param link 連接
+ * @param to 寫入端
+ */
+static void init_pipe(fault_pipe* pipe, fault_link* link, struct bufferevent* to)
+{
+    pipe->link = link;
+    pipe->to = to;
+    g_queue_init(&pipe->chunks);
+    pipe->timer = evtimer_new(link->proxy->base, deliver_callback, pipe);
+}
+
+/**
+ * 接受連接回調，重置期間立即以 RST 關閉，否則連接上游
+ * @param listener 監聽器
+ * @param fd 連接
+ * @param address 對端地址
+ * @param length 地址長度
+ * @param arg 代理
+ */
+static void accept_callback(struct evconnlistener* listener, const evutil_socket_t fd, struct sockaddr* address,
+                            const gint length, void* arg)
+{
+    (void)listener; // 未使用
+    (void)address; // 未使用
+    (void)length; // 未使用
+
+    fault_proxy* proxy = arg;
+    atomic_fetch_add_explicit(&proxy->connections, 1, memory_order_relaxed);
+    if (proxy->spec.reset)
+    {
+        set_reset_on_close(fd);
+        evutil_closesocket(fd);
+        atomic_fetch_add_explicit(&proxy->resets, 1, memory_order_relaxed);
+        return;
+    }
+    set_nodelay(fd);
+
+    fault_link* link = g_malloc0(sizeof(fault_link));
+    link->proxy = proxy;
+    link->client = bufferevent_socket_new(proxy->base, fd, BEV_OPT_CLOSE_ON_FREE);
+    link->server = bufferevent_socket_new(proxy->base, -1, BEV_OPT_CLOSE_ON_FREE);
+    init_pipe(&link->up, link, link->server);
+    init_pipe(&link->down, link, link->client);
+    g_ptr_array_add(proxy->links, link);
+    atomic_fetch_add_explicit(&proxy->open, 1, memory_order_relaxed);
+
+    bufferevent_setcb(link->client, read_callback, nullptr, event_callback, link);
+    bufferevent_setcb(link->server, read_callback, nullptr, event_callback, link);
+    if (proxy->rate != nullptr)
+    {
+        bufferevent_set_rate_limit(link->client, proxy->rate);
+        bufferevent_set_rate_limit(link->server, proxy->rate);
+    }
+    bufferevent_enable(link->client, EV_WRITE);
+    bufferevent_enable(link->server, EV_WRITE);
+    if (bufferevent_socket_connect(link->server, (struct sockaddr*)&proxy->upstream,
+                                   (gint)proxy->upstream_length) != 0)
+    {
+        atomic_fetch_add_explicit(&proxy->upstream_errors, 1, memory_order_relaxed);
+        close_link(link, FALSE);
+        return;
+    }
+    hold_link(link, proxy->spec.blackhole);
+}
+
+/**
+ * 在代理線程中替換注入的故障
+ * @param proxy 代理
+ * @param spec 故障
+ */
+static void apply_spec(fault_proxy* proxy, const fault_spec* spec)
+{
+    const fault_spec previous = proxy->spec;
+    proxy->spec = *spec;
+
+    // 限速配置由所有連接共用，替換後才能釋放舊的配置
+    if (spec->bandwidth != previous.bandwidth)
+    {
+        struct ev_token_bucket_cfg* old = proxy->rate;
+        const gsize rate = (gsize)spec->bandwidth;
+        proxy->rate = rate > 0 ? ev_token_bucket_cfg_new(rate, rate, rate, rate, nullptr) : nullptr;
+        for (guint i = 0; i < proxy->links->len; ++i)
+        {
+            const fault_link* link = g_ptr_array_index(proxy->links, i);
+            bufferevent_set_rate_limit(link->client, proxy->rate);
+            bufferevent_set_rate_limit(link->server, proxy->rate);
+        }
+        if (old != nullptr) ev_token_bucket_cfg_free(old);
+    }
+
+    if (spec->reset)
+    {
+        while (proxy->links->len > 0) close_link(g_ptr_array_index(proxy->links, proxy->links->len - 1), TRUE);
+    }
+    else if (spec->blackhole != previous.blackhole)
+    {
+        for (guint i = 0; i < proxy->links->len; ++i) hold_link(g_ptr_array_index(proxy->links, i), spec->blackhole);
+    }
+}
+
+/**
+ * 故障變更通知回調
+ * @param fd 文件描述符
+ * @param event 事件類型
+ * @param arg 代理
+ */
+static void update_callback(const evutil_socket_t fd, const short event, void* arg)
+{
+    (void)event; // 未使用
+
+    fault_proxy* proxy = arg;
+    eventfd_t count = 0;
+    eventfd_read(fd, &count);
+
+    g_mutex_lock(&proxy->lock);
+    const fault_spec spec = proxy->pending;
+    g_mutex_unlock(&proxy->lock);
+    apply_spec(proxy, &spec);
+}
+
+/**
+ * 停止通知回調
+ * @param fd 文件描述符
+ * @param event 事件類型
+ * @param arg 代理
+ */
+static void stop_callback(const evutil_socket_t fd, const short event, void* arg)
+{
+    (void)event; // 未使用
+
+    eventfd_t count = 0;
+    eventfd_read(fd, &count);
+    event_base_loopbreak(((fault_proxy*)arg)->base);
+}
+
+/**
+ * 代理線程
+ * @param data 代理
+ * @return 未使用
+ */
+static gpointer proxy_thread(gpointer data)
+{
+    const fault_proxy* proxy = data;
+    event_base_dispatch(proxy->base);
+    return nullptr;
+}
+
+/**
+ * 啟動代理
+ * @param listen 監聽地址，如 127.0.0.1:6380，端口為 0 時由系統分配
+ * @param upstream 上游地址，如 127.0.0.1:6379，啟動時解析一次
+ * @return 代理，失敗時返回空
+ */
+fault_proxy* fault_proxy_start(const gchar* listen, const gchar* upstream)
+{
+    fault_proxy* proxy = g_malloc0(sizeof(fault_proxy));
+    g_mutex_init(&proxy->lock);
+    proxy->base = event_base_new();
+    proxy->links = g_ptr_array_new();
+    proxy->rand = g_rand_new();
+    proxy->stop_fd = -1;
+    proxy->update_fd = -1;
+
+    struct sockaddr_storage address;
+    socklen_t length = 0;
+    if (!resolve_address(upstream, FALSE, &proxy->upstream, &proxy->upstream_length) ||
+        !resolve_address(listen, TRUE, &address, &length))
+        goto error;
+
+    proxy->listener = evconnlistener_new_bind(proxy->base, accept_callback, proxy,
+                                              LEV_OPT_CLOSE_ON_FREE | LEV_OPT_REUSEABLE, 128,
+                                              (struct sockaddr*)&address, (gint)length);
+    if (proxy->listener == nullptr)
+    {
+        g_printerr("Cannot listen on %s: %s\n", listen, g_strerror(errno));
+        goto error;
+    }
+
+    // 讀取系統分配的端口
+    length = sizeof(address);
+    getsockname(evconnlistener_get_fd(proxy->listener), (struct sockaddr*)&address, &length);
+    proxy->port = ntohs(address.ss_family == AF_INET6 ? ((struct sockaddr_in6*)&address)->sin6_port
+                                                      : ((struct sockaddr_in*)&address)->sin_port);
+
+    proxy->stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    proxy->stop_event = event_new(proxy->base, proxy->stop_fd, EV_READ | EV_PERSIST, stop_callback, proxy);
+    event_add(proxy->stop_event, nullptr);
+    proxy->update_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    proxy->update_event = event_new(proxy->base, proxy->update_fd, EV_READ | EV_PERSIST, update_callback, proxy);
+    event_add(proxy->update_event, nullptr);
+    proxy->thread = g_thread_new("fault-proxy", proxy_thread, proxy);
+    return proxy;
+
+error:
+    fault_proxy_stop(proxy);
+    return nullptr;
+}
+
+/**
+ * 獲取監聽的端口
+ * @param proxy 代理
+ * @return 端口
+ */
+guint16 fault_proxy_port(const fault_proxy* proxy)
+{
+    return proxy->port;
+}
+
+/**
+ * 替換注入的故障，可在任意線程中調用，在代理線程中生效並作用於現有連接
+ * @param proxy 代理
+ * @param spec 故障
+ */
+void fault_proxy_set(fault_proxy* proxy, const fault_spec* spec)
+{
+    g_mutex_lock(&proxy->lock);
+    proxy->pending = *spec;
+    g_mutex_unlock(&proxy->lock);
+    eventfd_write(proxy->update_fd, 1);
+}
+
+/**
+ * 獲取統計，可在任意線程中調用
+ * @param proxy 代理
+ * @param stats 輸出的統計
+ */
+void fault_proxy_get_stats(fault_proxy* proxy, fault_proxy_stats* stats)
+{
+    stats->connections = atomic_load_explicit(&proxy->connections, memory_order_relaxed);
+    stats->resets = atomic_load_explicit(&proxy->resets, memory_order_relaxed);
+    stats->upstream_errors = atomic_load_explicit(&proxy->upstream_errors, memory_order_relaxed);
+    stats->bytes = atomic_load_explicit(&proxy->bytes, memory_order_relaxed);
+    stats->open = atomic_load_explicit(&proxy->open, memory_order_relaxed);
+}
+
+/**
+ * 停止代理並關閉所有連接
+ * @param proxy 代理
+ */
+void fault_proxy_stop(fault_proxy* proxy)
+{
+    if (proxy->thread != nullptr)
+    {
+        eventfd_write(proxy->stop_fd, 1);
+        g_thread_join(proxy->thread);
+    }
+
+    // 代理線程已經結束，可以直接釋放連接
+    while (proxy->links->len > 0) close_link(g_ptr_array_index(proxy->links, proxy->links->len - 1), FALSE);
+    g_ptr_array_free(proxy->links, TRUE);
+    if (proxy->rate != nullptr) ev_token_bucket_cfg_free(proxy->rate);
+    if (proxy->listener != nullptr) evconnlistener_free(proxy->listener);
+    if (proxy->stop_event != nullptr) event_free(proxy->stop_event);
+    if (proxy->update_event != nullptr) event_free(proxy->update_event);
+    if (proxy->stop_fd >= 0) close(proxy->stop_fd);
+    if (proxy->update_fd >= 0) close(proxy->update_fd);
+    event_base_free(proxy->base);
+    g_rand_free(proxy->rand);
+    g_mutex_clear(&proxy->lock);
+    g_free(proxy);
+}
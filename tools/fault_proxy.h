@@ -0,0 +1,78 @@
+#pragma once
+#include <glib.h>
+
+/**
+ * 注入的故障，可在運行中隨時替換
+ */
+typedef struct fault_spec
+{
+    // 每段數據的固定延遲毫秒數，雙向各自計算
+    gint latency_ms;
+    // 在固定延遲上額外增加的隨機延遲毫秒數上限
+    gint jitter_ms;
+    // 黑洞：雙向停止轉發，數據滯留在代理中，恢復後按序送達，與網絡分區後 TCP 重傳的表現一致；
+    // 新連接的握手仍由內核完成，之後的數據同樣滯留
+    gboolean blackhole;
+    // 重置：以 RST 關閉現有連接，新連接接受後立即以 RST 關閉
+    gboolean reset;
+    // 每個連接每個方向每秒轉發的字節數，0 表示不限制
+    gint64 bandwidth;
+} fault_spec;
+
+/**
+ * 故障注入代理的統計
+ */
+typedef struct fault_proxy_stats
+{
+    // 接受的連接數
+    guint64 connections;
+    // 以 RST 關閉的連接數
+    guint64 resets;
+    // 上游連接失敗數
+    guint64 upstream_errors;
+    // 轉發的字節數
+    guint64 bytes;
+    // 當前打開的連接數
+    guint64 open;
+} fault_proxy_stats;
+
+/**
+ * 故障注入 TCP 代理，在獨立線程中把每個客戶端連接轉發到上游，
+ * 並按當前的 fault_spec 注入故障
+ */
+typedef struct fault_proxy fault_proxy;
+
+/**
+ * 啟動代理
+ * @param listen 監聽地址，如 127.0.0.1:6380，端口為 0 時由系統分配
+ * @param upstream 上游地址，如 127.0.0.1:6379，啟動時解析一次
+ * @return 代理，失敗時返回空
+ */
+fault_proxy* fault_proxy_start(const gchar* listen, const gchar* upstream);
+
+/**
+ * 獲取監聽的端口
+ * @param proxy 代理
+ * @return 端口
+ */
+guint16 fault_proxy_port(const fault_proxy* proxy);
+
+/**
+ * 替換注入的故障，可在任意線程中調用，在代理線程中生效並作用於現有連接
+ * @param proxy 代理
+ * @param spec 故障
+ */
+void fault_proxy_set(fault_proxy* proxy, const fault_spec* spec);
+
+/**
+ * 獲取統計，可在任意線程中調用
+ * @param proxy 代理
+ * @param stats 輸出的統計
+ */
+void fault_proxy_get_stats(fault_proxy* proxy, fault_proxy_stats* stats);
+
+/**
+ * 停止代理並關閉所有連接
+ * @param proxy 代理
+ */
+void fault_proxy_stop(fault_proxy* proxy);
@@ -0,0 +1,180 @@
+#include <glib.h>
+#include <signal.h>
+#include <event2/event.h>
+
+#include "fault_proxy.h"
+#include "scenario.h"
+
+// 監聽地址
+static gchar* listen_option = nullptr;
+// 上游地址
+static gchar* upstream_option = nullptr;
+// 回放的場景文件
+static gchar* scenario_path = nullptr;
+// 是否循環回放場景
+static gboolean loop = FALSE;
+// 未指定場景時持續注入的故障
+static fault_spec static_spec = {0};
+
+// 命令行選項
+static GOptionEntry entries[] = {
+    {"listen", 'l', 0, G_OPTION_ARG_STRING, &listen_option, "Address to listen on (default: 127.0.0.1:6380)",
+     "HOST:PORT"},
+    {"upstream", 'u', 0, G_OPTION_ARG_STRING, &upstream_option, "Redis to forward to (default: 127.0.0.1:6379)",
+     "HOST:PORT"},
+    {"scenario", 's', 0, G_OPTION_ARG_FILENAME, &scenario_path, "Replay the phases of a scenario file", "FILE"},
+    {"loop", 0, 0, G_OPTION_ARG_NONE, &loop, "Replay the scenario until interrupted", nullptr},
+    {"latency", 0, 0, G_OPTION_ARG_INT, &static_spec.latency_ms, "Fixed delay per chunk without a scenario", "MS"},
+    {"jitter", 0, 0, G_OPTION_ARG_INT, &static_spec.jitter_ms, "Extra random delay without a scenario", "MS"},
+    {"bandwidth", 0, 0, G_OPTION_ARG_INT64, &static_spec.bandwidth, "Bytes per second per direction", "BYTES"},
+    {"blackhole", 0, 0, G_OPTION_ARG_NONE, &static_spec.blackhole, "Stall all traffic without a scenario", nullptr},
+    {nullptr}
+};
+
+/**
+ * 回放狀態
+ */
+typedef struct replay
+{
+    // 代理
+    fault_proxy* proxy;
+    // 場景
+    const fault_scenario* scenario;
+    // 當前階段序號
+    guint phase;
+    // 階段定時器
+    struct event* timer;
+    // 回放開始時間（單調時鐘）
+    gint64 started_at;
+    // 事件循環
+    struct event_base* base;
+} replay;
+
+/**
+ * 進入當前階段並安排下一個階段
+ * @param state 回放狀態
+ */
+static void enter_phase(replay* state)
+{
+    const fault_phase* phase = g_ptr_array_index(state->scenario->phases, state->phase);
+    fault_proxy_set(state->proxy, &phase->spec);
+
+    gchar* description = fault_spec_describe(&phase->spec);
+    const gint64 elapsed = g_get_monotonic_time() - state->started_at;
+    g_print("[+%.1fs] phase %s%s: %s for %.1fs\n", (gdouble)elapsed / G_USEC_PER_SEC, phase->name,
+            phase->incident ? " (incident)" : "", description, (gdouble)phase->duration_ms / 1000);
+    g_free(description);
+
+    const struct timeval tv = {
+        .tv_sec = phase->duration_ms / 1000, .tv_usec = phase->duration_ms % 1000 * 1000
+    };
+    evtimer_add(state->timer, &tv);
+}
+
+/**
+ * 階段定時器回調，進入下一個階段，場景結束後停止或從頭回放
+ * @param fd 文件描述符
+ * @param event 事件類型
+ * @param arg 回放狀態
+ */
+static void phase_callback(const evutil_socket_t fd, const short event, void* arg)
+{
+    (void)fd; // 未使用
+    (void)event; // 未使用
+
+    replay* state = arg;
+    if (++state->phase == state->scenario->phases->len)
+    {
+        if (!loop)
+        {
+            g_print("Scenario %s finished\n", state->scenario->name);
+            event_base_loopbreak(state->base);
+            return;
+        }
+        state->phase = 0;
+    }
+    enter_phase(state);
+}
+
+/**
+ * 退出信號回調
+ * @param sig 信號
+ * @param event 事件類型
+ * @param arg 事件循環
+ */
+static void signal_callback(const evutil_socket_t sig, const short event, void* arg)
+{
+    (void)sig; // 未使用
+    (void)event; // 未使用
+    event_base_loopbreak(arg);
+}
+
+int main(int argc, char* argv[])
+{
+    GError* error = nullptr;
+    GOptionContext* context = g_option_context_new("- fault-injection TCP proxy");
+    g_option_context_add_main_entries(context, entries, nullptr);
+    g_option_context_set_summary(context,
+                                 "Forwards TCP connections to a Redis server and injects latency, jitter,\n"
+                                 "bandwidth limits, blackholes and resets, either fixed from the options or\n"
+                                 "replayed from the phases of a scenario file.");
+    if (!g_option_context_parse(context, &argc, &argv, &error))
+    {
+        g_printerr("Option parsing failed: %s\n", error->message);
+        g_error_free(error);
+        return 1;
+    }
+    g_option_context_free(context);
+    if (static_spec.latency_ms < 0 || static_spec.jitter_ms < 0 || static_spec.bandwidth < 0)
+    {
+        g_printerr("latency, jitter and bandwidth must not be negative\n");
+        return 1;
+    }
+
+    fault_scenario* scenario = nullptr;
+    if (scenario_path != nullptr && (scenario = fault_scenario_load(scenario_path)) == nullptr) return 1;
+
+    fault_proxy* proxy = fault_proxy_start(listen_option != nullptr ? listen_option : "127.0.0.1:6380",
+                                           upstream_option != nullptr ? upstream_option : "127.0.0.1:6379");
+    if (proxy == nullptr) return 1;
+    g_print("Listening on port %u, forwarding to %s\n", fault_proxy_port(proxy),
+            upstream_option != nullptr ? upstream_option : "127.0.0.1:6379");
+
+    struct event_base* base = event_base_new();
+    struct event* sigint_event = evsignal_new(base, SIGINT, signal_callback, base);
+    struct event* sigterm_event = evsignal_new(base, SIGTERM, signal_callback, base);
+    evsignal_add(sigint_event, nullptr);
+    evsignal_add(sigterm_event, nullptr);
+
+    replay state = {.proxy = proxy, .scenario = scenario, .base = base, .started_at = g_get_monotonic_time()};
+    state.timer = evtimer_new(base, phase_callback, &state);
+    if (scenario != nullptr)
+    {
+        enter_phase(&state);
+    }
+    else
+    {
+        fault_proxy_set(proxy, &static_spec);
+        gchar* description = fault_spec_describe(&static_spec);
+        g_print("Injecting: %s\n", description);
+        g_free(description);
+    }
+    event_base_dispatch(base);
+
+    fault_proxy_stats stats;
+    fault_proxy_get_stats(proxy, &stats);
+    g_print("proxy: %lu connections, %lu resets, %lu upstream errors, %lu bytes forwarded\n",
+            (gulong)stats.connections, (gulong)stats.resets, (gulong)stats.upstream_errors, (gulong)stats.bytes);
+
+    // 釋放資源
+    event_free(state.timer);
+    event_free(sigint_event);
+    event_free(sigterm_event);
+    event_base_free(base);
+    fault_proxy_stop(proxy);
+    fault_scenario_free(scenario);
+    g_free(listen_option);
+    g_free(upstream_option);
+    g_free(scenario_path);
+    return 0;
+}
@@ -0,0 +1,525 @@
+#include <glib.h>
+#include <event2/event.h>
+
+#include "fake_redis.h"
+#include "fault_proxy.h"
+#include "probe.h"
+#include "redis.h"
+#include "scenario.h"
+#include "target.h"
+
+// 探測間隔秒數
+static gint interval = 5;
+// 連接與命令超時秒數
+static gint connect_timeout = 5;
+// 連續失敗多少次後告警，1 與主程序一致
+static gint failures = 1;
+// φ 值告警閾值，0 表示不評估
+static gdouble phi_threshold = 0;
+// 探測目標數，所有目標經過同一個代理
+static gint n_targets = 1;
+// 每個場景的回放次數
+static gint repeat = 1;
+// 每次回放前無故障的預熱秒數，-1 表示 3 個探測間隔
+static gint warmup = -1;
+// 故障結束後仍計為檢測到的寬限秒數，-1 表示一個探測間隔加一個超時
+static gint grace = -1;
+// 上游地址，為空時使用進程內的模擬 Redis 服務
+static gchar* upstream_option = nullptr;
+// 是否輸出告警的觸發與解除
+static gboolean verbose = FALSE;
+// 場景文件
+static gchar** scenario_paths = nullptr;
+
+// 命令行選項
+static GOptionEntry entries[] = {
+    {"interval", 'i', 0, G_OPTION_ARG_INT, &interval, "Probe interval in seconds", "S"},
+    {"connect-timeout", 't', 0, G_OPTION_ARG_INT, &connect_timeout, "Connect and command timeout in seconds", "S"},
+    {"failures", 'f', 0, G_OPTION_ARG_INT, &failures, "Consecutive failed probes before alerting", "N"},
+    {"phi", 0, 0, G_OPTION_ARG_DOUBLE, &phi_threshold, "Also evaluate a phi accrual detector at this level", "PHI"},
+    {"targets", 'n', 0, G_OPTION_ARG_INT, &n_targets, "Number of targets probed through the proxy", "N"},
+    {"repeat", 'r', 0, G_OPTION_ARG_INT, &repeat, "Replays per scenario", "N"},
+    {"warmup", 'w', 0, G_OPTION_ARG_INT, &warmup, "Clean seconds before each replay (default: 3 intervals)", "S"},
+    {"grace", 'g', 0, G_OPTION_ARG_INT, &grace,
+     "Seconds after an incident in which alerts still count (default: interval + timeout)", "S"},
+    {"upstream", 'u', 0, G_OPTION_ARG_STRING, &upstream_option, "Real Redis to proxy instead of a fake", "HOST:PORT"},
+    {"verbose", 'v', 0, G_OPTION_ARG_NONE, &verbose, "Show every alert transition", nullptr},
+    {G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &scenario_paths, nullptr, "SCENARIO..."},
+    {nullptr}
+};
+
+/**
+ * 被評估的檢測方式
+ */
+typedef enum detector
+{
+    // 連續失敗次數
+    DETECTOR_FAILURES = 0,
+    // φ 值
+    DETECTOR_PHI,
+    // 檢測方式數量
+    DETECTOR_COUNT
+} detector;
+
+/**
+ * 一種檢測方式在一個場景中的表現
+ */
+typedef struct detector_report
+{
+    // 目標與故障的組合數
+    guint64 incidents;
+    // 從故障開始到告警的耗時（微秒）
+    GArray* detect_us;
+    // 從故障結束到告警解除的耗時（微秒）
+    GArray* clear_us;
+    // 無故障期間的告警數
+    guint64 false_alerts;
+} detector_report;
+
+/**
+ * 一個場景的統計
+ */
+typedef struct scenario_report
+{
+    // 場景
+    fault_scenario* scenario;
+    // 各檢測方式的表現
+    detector_report detectors[DETECTOR_COUNT];
+    // 無故障期間的探測數
+    guint64 benign_probes;
+} scenario_report;
+
+/**
+ * 一個目標的檢測狀態
+ */
+typedef struct target_track
+{
+    // 連續失敗次數
+    gint consecutive;
+    // 是否在告警中
+    gboolean alerting[DETECTOR_COUNT];
+    // 最近檢測到的故障序號
+    guint64 detected[DETECTOR_COUNT];
+    // 最近記錄了解除耗時的故障序號
+    guint64 cleared[DETECTOR_COUNT];
+} target_track;
+
+/**
+ * 回放狀態
+ */
+typedef struct runner
+{
+    // 事件循環
+    struct event_base* base;
+    // 代理
+    fault_proxy* proxy;
+    // 各場景的統計 (scenario_report*)
+    GPtrArray* reports;
+    // 當前場景序號
+    guint run;
+    // 當前場景的回放次數
+    gint replay;
+    // 當前階段序號，-1 表示預熱
+    gint phase;
+    // 階段定時器
+    struct event* timer;
+    // 是否在故障中
+    gboolean incident;
+    // 故障序號，每次從無故障進入故障時遞增
+    guint64 incident_id;
+    // 故障開始時間（UNIX 微秒）
+    gint64 incident_started;
+    // 故障結束時間（UNIX 微秒）
+    gint64 incident_ended;
+    // 寬限期結束時間（UNIX 微秒）
+    gint64 grace_until;
+    // 故障所屬場景的統計
+    scenario_report* incident_report;
+    // 是否已回放完所有場景
+    gboolean draining;
+    // 各目標的檢測狀態 (target* -> target_track*)
+    GHashTable* tracks;
+} runner;
+
+// 檢測方式的名稱
+static const gchar* detector_names[DETECTOR_COUNT] = {"failures", "phi"};
+
+/**
+ * 比較兩個 gint64
+ */
+static gint compare_int64(gconstpointer a, gconstpointer b)
+{
+    const gint64 x = *(const gint64*)a;
+    const gint64 y = *(const gint64*)b;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * 排序後的分位數
+ * @param values 數值 (gint64)，會被排序
+ * @param q 分位
+ * @return 數值，為空時返回 0
+ */
+static gint64 percentile(GArray* values, const gdouble q)
+{
+    if (values->len == 0) return 0;
+    g_array_sort(values, compare_int64);
+    return g_array_index(values, gint64, (guint)(q * (values->len - 1)));
+}
+
+/**
+ * 是否評估檢測方式
+ * @param d 檢測方式
+ * @return 是否評估
+ */
+static gboolean detector_enabled(const detector d)
+{
+    return d != DETECTOR_PHI || phi_threshold > 0;
+}
+
+/**
+ * 告警開始，按當前的故障歸類為檢測或誤報
+ * @param state 回放狀態
+ * @param t 目標
+ * @param track 檢測狀態
+ * @param d 檢測方式
+ * @param now 當前時間（UNIX 微秒）
+ */
+static void on_alert(runner* state, const target* t, target_track* track, const detector d, const gint64 now)
+{
+    if (state->incident || now < state->grace_until)
+    {
+        // 同一故障中的反覆告警不重複計入
+        if (track->detected[d] == state->incident_id) return;
+        track->detected[d] = state->incident_id;
+        const gint64 us = now - state->incident_started;
+        g_array_append_val(state->incident_report->detectors[d].detect_us, us);
+        if (verbose) g_print("  %s: %s alert after %.1fs\n", t->config->name, detector_names[d], (gdouble)us / 1e6);
+        return;
+    }
+    if (state->phase < 0) return;
+
+    scenario_report* report = g_ptr_array_index(state->reports, state->run);
+    report->detectors[d].false_alerts++;
+    if (verbose) g_print("  %s: %s false alert\n", t->config->name, detector_names[d]);
+}
+
+/**
+ * 告警解除，記錄故障結束到解除的耗時
+ * @param state 回放狀態
+ * @param t 目標
+ * @param track 檢測狀態
+ * @param d 檢測方式
+ * @param now 當前時間（UNIX 微秒）
+ */
+static void on_clear(runner* state, const target* t, target_track* track, const detector d, const gint64 now)
+{
+    if (state->incident || track->detected[d] != state->incident_id || track->cleared[d] == state->incident_id)
+        return;
+    track->cleared[d] = state->incident_id;
+    const gint64 us = MAX(now - state->incident_ended, 0);
+    g_array_append_val(state->incident_report->detectors[d].clear_us, us);
+    if (verbose) g_print("  %s: %s cleared %.1fs after heal\n", t->config->name, detector_names[d], (gdouble)us / 1e6);
+}
+
+/**
+ * 探測結果回調，更新各檢測方式的告警狀態
+ * @param t 目標
+ * @param result 探測結果
+ * @param user_data 回放狀態
+ */
+static void on_result(target* t, const probe_result* result, gpointer user_data)
+{
+    runner* state = user_data;
+    target_track* track = g_hash_table_lookup(state->tracks, t);
+    if (track == nullptr)
+    {
+        track = g_malloc0(sizeof(target_track));
+        g_hash_table_insert(state->tracks, t, track);
+    }
+
+    const gint64 now = g_get_real_time();
+    track->consecutive = result->outcome == PROBE_OK ? 0 : track->consecutive + 1;
+    if (state->phase >= 0 && !state->incident && now >= state->grace_until)
+        ((scenario_report*)g_ptr_array_index(state->reports, state->run))->benign_probes++;
+
+    const gboolean alerting[DETECTOR_COUNT] = {
+        track->consecutive >= failures,
+        phi_threshold > 0 && probe_phi(t) >= phi_threshold,
+    };
+    for (gint d = 0; d < DETECTOR_COUNT; ++d)
+    {
+        if (alerting[d] == track->alerting[d]) continue;
+        track->alerting[d] = alerting[d];
+        if (alerting[d]) on_alert(state, t, track, d, now);
+        else on_clear(state, t, track, d, now);
+    }
+}
+
+/**
+ * 進入當前階段並安排下一個階段
+ * @param state 回放狀態
+ */
+static void enter_phase(runner* state)
+{
+    scenario_report* report = g_ptr_array_index(state->reports, state->run);
+    const fault_phase* phase = state->phase >= 0 ? g_ptr_array_index(report->scenario->phases, state->phase) : nullptr;
+    const gboolean incident = phase != nullptr && phase->incident;
+    const gint64 now = g_get_real_time();
+
+    if (incident && !state->incident)
+    {
+        // 新的故障，已經在告警中的目標視為立即檢測到
+        state->incident_id++;
+        state->incident_started = now;
+        state->incident_report = report;
+        GHashTableIter iter;
+        gpointer key = nullptr;
+        gpointer value = nullptr;
+        g_hash_table_iter_init(&iter, state->tracks);
+        while (g_hash_table_iter_next(&iter, &key, &value))
+        {
+            target_track* track = value;
+            for (gint d = 0; d < DETECTOR_COUNT; ++d)
+            {
+                if (!track->alerting[d]) continue;
+                track->detected[d] = state->incident_id;
+                const gint64 zero = 0;
+                g_array_append_val(report->detectors[d].detect_us, zero);
+            }
+        }
+        for (gint d = 0; d < DETECTOR_COUNT; ++d) report->detectors[d].incidents += targets->len;
+    }
+    else if (!incident && state->incident)
+    {
+        state->incident_ended = now;
+        state->grace_until = now + (gint64)grace * G_USEC_PER_SEC;
+    }
+    state->incident = incident;
+
+    const fault_spec clean = {0};
+    fault_proxy_set(state->proxy, phase != nullptr ? &phase->spec : &clean);
+    const gint64 duration_ms = phase != nullptr ? phase->duration_ms : (gint64)warmup * 1000;
+    if (verbose && phase != nullptr)
+    {
+        gchar* description = fault_spec_describe(&phase->spec);
+        g_print("%s: phase %s%s: %s\n", report->scenario->name, phase->name, incident ? " (incident)" : "",
+                description);
+        g_free(description);
+    }
+
+    const struct timeval tv = {.tv_sec = duration_ms / 1000, .tv_usec = duration_ms % 1000 * 1000};
+    evtimer_add(state->timer, &tv);
+}
+
+/**
+ * 階段定時器回調，依次進入下一個階段、下一次回放與下一個場景
+ * @param fd 文件描述符
+ * @param event 事件類型
+ * @param arg 回放狀態
+ */
+static void phase_callback(const evutil_socket_t fd, const short event, void* arg)
+{
+    (void)fd; // 未使用
+    (void)event; // 未使用
+
+    runner* state = arg;
+    if (state->draining) return;
+    const scenario_report* report = g_ptr_array_index(state->reports, state->run);
+    if (++state->phase < (gint)report->scenario->phases->len)
+    {
+        enter_phase(state);
+        return;
+    }
+
+    // 回放結束，進入下一次回放或下一個場景的預熱
+    state->phase = -1;
+    if (++state->replay == repeat)
+    {
+        state->replay = 0;
+        state->run++;
+    }
+    if (state->run < state->reports->len)
+    {
+        enter_phase(state);
+        return;
+    }
+
+    // 所有場景結束，恢復正常並在最後一個故障的寬限期結束後停止
+    state->run = state->reports->len - 1;
+    state->draining = TRUE;
+    enter_phase(state);
+    const struct timeval tv = {.tv_sec = grace, .tv_usec = 0};
+    event_base_loopexit(state->base, &tv);
+}
+
+/**
+ * 輸出一個場景的統計
+ * @param report 統計
+ */
+static void print_report(scenario_report* report)
+{
+    g_print("\n%s: %u phase(s), %.1fs x %d replay(s), %d target(s)\n", report->scenario->name,
+            report->scenario->phases->len, (gdouble)report->scenario->duration_ms / 1000, repeat, n_targets);
+    g_print("  %-14s %10s %10s %10s %10s %8s %10s\n", "detector", "detect p50", "detect max", "detected", "clear p50",
+            "false", "fp/probe");
+    for (gint d = 0; d < DETECTOR_COUNT; ++d)
+    {
+        if (!detector_enabled(d)) continue;
+        detector_report* r = &report->detectors[d];
+        gchar name[32];
+        if (d == DETECTOR_FAILURES) g_snprintf(name, sizeof(name), "failures>=%d", failures);
+        else g_snprintf(name, sizeof(name), "phi>=%g", phi_threshold);
+        gchar detected[32];
+        g_snprintf(detected, sizeof(detected), "%u/%lu", r->detect_us->len, (gulong)r->incidents);
+        g_print("  %-14s %9.1fs %9.1fs %10s %9.1fs %8lu %10.4f\n", name, (gdouble)percentile(r->detect_us, 0.5) / 1e6,
+                (gdouble)percentile(r->detect_us, 1) / 1e6, detected, (gdouble)percentile(r->clear_us, 0.5) / 1e6,
+                (gulong)r->false_alerts,
+                report->benign_probes > 0 ? (gdouble)r->false_alerts / (gdouble)report->benign_probes : 0);
+    }
+}
+
+/**
+ * 釋放場景的統計
+ * @param data 統計
+ */
+static void free_report(gpointer data)
+{
+    scenario_report* report = data;
+    for (gint d = 0; d < DETECTOR_COUNT; ++d)
+    {
+        g_array_free(report->detectors[d].detect_us, TRUE);
+        g_array_free(report->detectors[d].clear_us, TRUE);
+    }
+    fault_scenario_free(report->scenario);
+    g_free(report);
+}
+
+/**
+ * 生成目標配置，所有目標經過代理
+ * @param port 代理端口
+ * @return 配置文件
+ */
+static GKeyFile* build_keyfile(const guint16 port)
+{
+    GKeyFile* keyfile = g_key_file_new();
+    g_key_file_set_integer(keyfile, "General", "interval", interval);
+    g_key_file_set_integer(keyfile, "General", "connect_timeout", connect_timeout);
+    g_key_file_set_string(keyfile, "General", "redis_host", "127.0.0.1");
+    g_key_file_set_integer(keyfile, "General", "redis_port", port);
+    g_key_file_set_boolean(keyfile, "General", "redis_auth", FALSE);
+    g_key_file_set_integer(keyfile, "Probe", "startup_window", interval);
+
+    for (gint i = 0; i < n_targets; ++i)
+    {
+        gchar group[64];
+        g_snprintf(group, sizeof(group), "Target:scenario-%03d", i);
+        g_key_file_set_string(keyfile, group, "host", "127.0.0.1");
+        g_key_file_set_integer(keyfile, group, "port", port);
+    }
+    return keyfile;
+}
+
+int main(int argc, char* argv[])
+{
+    GError* error = nullptr;
+    GOptionContext* context = g_option_context_new("SCENARIO... - replay fault scenarios against the probe engine");
+    g_option_context_add_main_entries(context, entries, nullptr);
+    g_option_context_set_summary(context,
+                                 "Probes targets through an in-process fault-injection proxy while replaying the\n"
+                                 "phases of each scenario file, and reports for the given interval, timeout and\n"
+                                 "detector settings how long incidents take to alert, how many are missed, how\n"
+                                 "long alerts take to clear, and how often benign phases raise false alerts.");
+    if (!g_option_context_parse(context, &argc, &argv, &error))
+    {
+        g_printerr("Option parsing failed: %s\n", error->message);
+        g_error_free(error);
+        return 1;
+    }
+    g_option_context_free(context);
+    if (scenario_paths == nullptr || interval < 1 || connect_timeout < 1 || failures < 1 || n_targets < 1 ||
+        repeat < 1 || phi_threshold < 0)
+    {
+        g_printerr("At least one scenario is required; interval, connect-timeout, failures, targets and repeat "
+                   "must be positive\n");
+        return 1;
+    }
+    if (warmup < 0) warmup = interval * 3;
+    if (grace < 0) grace = interval + connect_timeout;
+
+    GPtrArray* reports = g_ptr_array_new_with_free_func(free_report);
+    for (gchar** path = scenario_paths; *path != nullptr; ++path)
+    {
+        fault_scenario* scenario = fault_scenario_load(*path);
+        if (scenario == nullptr) return 1;
+        scenario_report* report = g_malloc0(sizeof(scenario_report));
+        report->scenario = scenario;
+        for (gint d = 0; d < DETECTOR_COUNT; ++d)
+        {
+            report->detectors[d].detect_us = g_array_new(FALSE, FALSE, sizeof(gint64));
+            report->detectors[d].clear_us = g_array_new(FALSE, FALSE, sizeof(gint64));
+        }
+        g_ptr_array_add(reports, report);
+    }
+
+    // 默認以模擬 Redis 服務為上游
+    fake_redis* server = nullptr;
+    gchar* upstream = g_strdup(upstream_option);
+    if (upstream == nullptr)
+    {
+        const fake_redis_options options = {0};
+        server = fake_redis_start(1, &options);
+        if (server == nullptr) return 1;
+        upstream = g_strdup_printf("127.0.0.1:%u", fake_redis_port(server, 0));
+    }
+    fault_proxy* proxy = fault_proxy_start("127.0.0.1:0", upstream);
+    if (proxy == nullptr) return 1;
+
+    // 以與主程序相同的方式讀取配置
+    GKeyFile* keyfile = build_keyfile(fault_proxy_port(proxy));
+    if (!init_redis_config(keyfile, nullptr) || !init_probe_config(keyfile, nullptr) ||
+        !init_target_config(keyfile, nullptr))
+        return 1;
+    g_key_file_free(keyfile);
+
+    gint64 total_ms = 0;
+    for (guint i = 0; i < reports->len; ++i)
+        total_ms += ((scenario_report*)g_ptr_array_index(reports, i))->scenario->duration_ms + (gint64)warmup * 1000;
+    g_print("Replaying %u scenario(s) x %d through %s: interval %ds, connect_timeout %ds, about %.0fs\n",
+            reports->len, repeat, upstream, interval, connect_timeout,
+            (gdouble)total_ms * repeat / 1000 + grace);
+
+    runner state = {
+        .base = event_base_new(),
+        .proxy = proxy,
+        .reports = reports,
+        .phase = -1,
+        .tracks = g_hash_table_new_full(g_direct_hash, g_direct_equal, nullptr, g_free),
+    };
+    state.timer = evtimer_new(state.base, phase_callback, &state);
+    if (!start_probes(state.base, on_result, &state)) return 1;
+    enter_phase(&state);
+    event_base_dispatch(state.base);
+
+    for (guint i = 0; i < reports->len; ++i) print_report(g_ptr_array_index(reports, i));
+    fault_proxy_stats stats;
+    fault_proxy_get_stats(proxy, &stats);
+    g_print("\nproxy: %lu connections, %lu resets, %lu upstream errors\n", (gulong)stats.connections,
+            (gulong)stats.resets, (gulong)stats.upstream_errors);
+
+    // 釋放資源
+    stop_probes();
+    event_free(state.timer);
+    event_base_free(state.base);
+    fault_proxy_stop(proxy);
+    if (server != nullptr) fake_redis_stop(server);
+    destroy_target_config();
+    destroy_probe_config();
+    destroy_redis_config();
+    g_hash_table_destroy(state.tracks);
+    g_ptr_array_free(reports, TRUE);
+    g_strfreev(scenario_paths);
+    g_free(upstream_option);
+    g_free(upstream);
+    return 0;
+}
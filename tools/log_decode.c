@@ -0,0 +1,115 @@
+#include <errno.h>
+#include <glib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "logger.h"
+
+// 每次讀取的字節數
+#define READ_CHUNK 65536
+
+// 命令行選項
+static gchar** inputs = nullptr;
+static GOptionEntry entries[] = {
+    {G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &inputs, "Binary log files, - for stdin", "FILE..."},
+    {nullptr}
+};
+
+/**
+ * 把一個二進制日誌流轉為 JSON 行寫到標準輸出，邊讀邊解碼
+ * @param name 文件名，用於錯誤信息
+ * @param file 文件
+ * @return 是否完整解碼，文件頭錯誤或記錄損壞時返回 FALSE
+ */
+static gboolean decode_stream(const gchar* name, FILE* file)
+{
+    GByteArray* buffer = g_byte_array_sized_new(READ_CHUNK);
+    GString* out = g_string_sized_new(READ_CHUNK);
+    gboolean header = FALSE;
+    gboolean ok = TRUE;
+    guint64 records = 0;
+    gsize n = 0;
+    guint8 chunk[READ_CHUNK];
+
+    while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0)
+    {
+        g_byte_array_append(buffer, chunk, (guint)n);
+        gsize offset = 0;
+        if (!header)
+        {
+            if (buffer->len < LOG_BINARY_MAGIC_SIZE) continue;
+            if (memcmp(buffer->data, LOG_BINARY_MAGIC, LOG_BINARY_MAGIC_SIZE) != 0)
+            {
+                g_printerr("%s: not a binary log file\n", name);
+                ok = FALSE;
+                goto done;
+            }
+            header = TRUE;
+            offset = LOG_BINARY_MAGIC_SIZE;
+        }
+
+        // 解碼完整的記錄，不完整的留到下次讀取
+        gsize size = 0;
+        while (log_record_next(buffer->data + offset, buffer->len - offset, &size))
+        {
+            log_record_json(buffer->data + offset, size, out);
+            offset += size;
+            ++records;
+        }
+        fwrite(out->str, 1, out->len, stdout);
+        g_string_truncate(out, 0);
+        g_byte_array_remove_range(buffer, 0, (guint)offset);
+    }
+
+    if (!header)
+    {
+        g_printerr("%s: not a binary log file\n", name);
+        ok = FALSE;
+    }
+    else if (buffer->len > 0)
+    {
+        g_printerr("%s: %u trailing bytes after %lu records are truncated or corrupt\n", name, buffer->len,
+                   (gulong)records);
+        ok = FALSE;
+    }
+
+done:
+    g_string_free(out, TRUE);
+    g_byte_array_free(buffer, TRUE);
+    return ok;
+}
+
+int main(int argc, char* argv[])
+{
+    GError* error = nullptr;
+    GOptionContext* context = g_option_context_new("- decode binary RedisWatcher logs to JSON lines");
+    g_option_context_add_main_entries(context, entries, nullptr);
+    if (!g_option_context_parse(context, &argc, &argv, &error))
+    {
+        g_printerr("Option parsing failed: %s\n", error->message);
+        g_error_free(error);
+        g_option_context_free(context);
+        return 1;
+    }
+    g_option_context_free(context);
+
+    // 未指定文件時讀標準輸入
+    static const gchar* const standard_input[] = {"-", nullptr};
+    const gchar* const* names = inputs != nullptr ? (const gchar* const*)inputs : standard_input;
+    gint res = 0;
+    for (guint i = 0; names[i] != nullptr; ++i)
+    {
+        const gboolean is_stdin = g_strcmp0(names[i], "-") == 0;
+        FILE* file = is_stdin ? stdin : fopen(names[i], "rb");
+        if (file == nullptr)
+        {
+            g_printerr("Cannot open %s: %s\n", names[i], g_strerror(errno));
+            res = 1;
+            continue;
+        }
+        if (!decode_stream(names[i], file)) res = 1;
+        if (!is_stdin) fclose(file);
+    }
+    g_strfreev(inputs);
+    return res;
+}
@@ -0,0 +1,139 @@
+#include "scenario.h"
+
+#include <string.h>
+
+#include "config.h"
+
+/**
+ * 釋放階段
+ * @param data 階段
+ */
+static void free_phase(gpointer data)
+{
+    fault_phase* phase = data;
+    g_free(phase->name);
+    g_free(phase);
+}
+
+/**
+ * 讀取一個階段
+ * @param keyfile 場景文件
+ * @param group 分組
+ * @return 階段，出錯時返回空
+ */
+static fault_phase* load_phase(GKeyFile* keyfile, const gchar* group)
+{
+    fault_phase* phase = g_malloc0(sizeof(fault_phase));
+    phase->name = g_strdup(group + strlen("Phase:"));
+
+    gdouble duration = 0;
+    gint64 latency = 0;
+    gint64 jitter = 0;
+    if (!read_optional_double(keyfile, group, "duration", 0, &duration)) goto error;
+    if (!read_optional_integer(keyfile, group, "latency", 0, &latency)) goto error;
+    if (!read_optional_integer(keyfile, group, "jitter", 0, &jitter)) goto error;
+    if (!read_optional_boolean(keyfile, group, "blackhole", FALSE, &phase->spec.blackhole)) goto error;
+    if (!read_optional_boolean(keyfile, group, "reset", FALSE, &phase->spec.reset)) goto error;
+    if (!read_optional_integer(keyfile, group, "bandwidth", 0, &phase->spec.bandwidth)) goto error;
+    if (!read_optional_boolean(keyfile, group, "incident", phase->spec.blackhole || phase->spec.reset,
+                               &phase->incident))
+        goto error;
+    if (duration <= 0 || latency < 0 || jitter < 0 || latency > G_MAXINT || jitter > G_MAXINT ||
+        phase->spec.bandwidth < 0)
+    {
+        g_printerr("Error reading %s: duration must be positive, "
+                   "latency, jitter and bandwidth must not be negative\n", group);
+        goto error;
+    }
+    phase->duration_ms = (gint64)(duration * 1000);
+    phase->spec.latency_ms = (gint)latency;
+    phase->spec.jitter_ms = (gint)jitter;
+    return phase;
+
+error:
+    free_phase(phase);
+    return nullptr;
+}
+
+/**
+ * 讀取場景文件
+ * @param path 文件路徑
+ * @return 場景，出錯時輸出錯誤並返回空
+ */
+fault_scenario* fault_scenario_load(const gchar* path)
+{
+    GError* error = nullptr;
+    GKeyFile* keyfile = g_key_file_new();
+    fault_scenario* scenario = g_malloc0(sizeof(fault_scenario));
+    scenario->phases = g_ptr_array_new_with_free_func(free_phase);
+    gchar** groups = nullptr;
+
+    if (!g_key_file_load_from_file(keyfile, path, G_KEY_FILE_NONE, &error))
+    {
+        g_printerr("Error loading scenario %s: %s\n", path, error->message);
+        g_error_free(error);
+        goto error;
+    }
+
+    gchar* basename = g_path_get_basename(path);
+    const gboolean read = read_optional_string(keyfile, "Scenario", "name", basename, &scenario->name);
+    g_free(basename);
+    if (!read) goto error;
+
+    groups = g_key_file_get_groups(keyfile, nullptr);
+    for (gchar** group = groups; *group != nullptr; ++group)
+    {
+        if (!g_str_has_prefix(*group, "Phase:")) continue;
+        fault_phase* phase = load_phase(keyfile, *group);
+        if (phase == nullptr) goto error;
+        g_ptr_array_add(scenario->phases, phase);
+        scenario->duration_ms += phase->duration_ms;
+    }
+    if (scenario->phases->len == 0)
+    {
+        g_printerr("Error loading scenario %s: no [Phase:<name>] groups\n", path);
+        goto error;
+    }
+    g_strfreev(groups);
+    g_key_file_free(keyfile);
+    return scenario;
+
+error:
+    g_strfreev(groups);
+    g_key_file_free(keyfile);
+    fault_scenario_free(scenario);
+    return nullptr;
+}
+
+/**
+ * 釋放場景
+ * @param scenario 場景
+ */
+void fault_scenario_free(fault_scenario* scenario)
+{
+    if (scenario == nullptr) return;
+    g_free(scenario->name);
+    g_ptr_array_free(scenario->phases, TRUE);
+    g_free(scenario);
+}
+
+/**
+ * 描述注入的故障
+ * @param spec 故障
+ * @return 描述，如 "latency 300ms +0-200ms, blackhole" (需要手動釋放)
+ */
+gchar* fault_spec_describe(const fault_spec* spec)
+{
+    GString* text = g_string_new(nullptr);
+    if (spec->latency_ms > 0 || spec->jitter_ms > 0)
+    {
+        g_string_append_printf(text, "latency %dms", spec->latency_ms);
+        if (spec->jitter_ms > 0) g_string_append_printf(text, " +0-%dms", spec->jitter_ms);
+    }
+    if (spec->bandwidth > 0)
+        g_string_append_printf(text, "%sbandwidth %ldB/s", text->len ? ", " : "", (glong)spec->bandwidth);
+    if (spec->blackhole) g_string_append_printf(text, "%sblackhole", text->len ? ", " : "");
+    if (spec->reset) g_string_append_printf(text, "%sreset", text->len ? ", " : "");
+    if (text->len == 0) g_string_append(text, "clean");
+    return g_string_free(text, FALSE);
+}
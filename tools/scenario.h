@@ -0,0 +1,64 @@
+#pragma once
+#include <glib.h>
+
+#include "fault_proxy.h"
+
+/**
+ * 場景中的一個階段
+ *
+ * 配置（[Phase:<name>] 分組，按文件中的順序回放）:
+ *  - duration 持續秒數，可為小數
+ *  - latency 每段數據的固定延遲毫秒數
+ *  - jitter 額外的隨機延遲毫秒數上限
+ *  - blackhole 是否雙向停止轉發
+ *  - reset 是否以 RST 關閉連接並拒絕新連接
+ *  - bandwidth 每個連接每個方向每秒轉發的字節數，0 表示不限制
+ *  - incident 是否為應當告警的故障，缺省時 blackhole 或 reset 的階段為故障，其餘為干擾
+ */
+typedef struct fault_phase
+{
+    // 階段名稱
+    gchar* name;
+    // 持續毫秒數
+    gint64 duration_ms;
+    // 注入的故障
+    fault_spec spec;
+    // 是否為應當告警的故障
+    gboolean incident;
+} fault_phase;
+
+/**
+ * 故障場景
+ *
+ * 配置（[Scenario] 分組）:
+ *  - name 場景名稱，缺省時為文件名
+ */
+typedef struct fault_scenario
+{
+    // 場景名稱
+    gchar* name;
+    // 階段 (fault_phase*)
+    GPtrArray* phases;
+    // 總持續毫秒數
+    gint64 duration_ms;
+} fault_scenario;
+
+/**
+ * 讀取場景文件
+ * @param path 文件路徑
+ * @return 場景，出錯時輸出錯誤並返回空
+ */
+fault_scenario* fault_scenario_load(const gchar* path);
+
+/**
+ * 釋放場景
+ * @param scenario 場景
+ */
+void fault_scenario_free(fault_scenario* scenario);
+
+/**
+ * 描述注入的故障
+ * @param spec 故障
+ * @return 描述，如 "latency 300ms +0-200ms, blackhole" (需要手動釋放)
+ */
+gchar* fault_spec_describe(const fault_spec* spec);